@@ -0,0 +1,569 @@
+/**
+ * BenchMain.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ *
+ * Measures throughput (messages/sec) and per-call latency of log++'s loggers
+ * and writes the results as JSON, so they can be compared between releases.
+ *
+ * Usage: logpp_bench [--duration-ms <ms>] [--threads <max threads>] [--dir <log dir>] [--output <file>] [--filter <substring>]
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include <log.hpp>
+#include <JsonLineFormatter.hpp>
+#include <memory_allocation/AllocationCounter.hpp>
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <unistd.h>
+
+LOGPP_INSTALL_ALLOCATION_COUNTER
+
+using logpp::AsyncLane;
+using logpp::AsyncLogger;
+using logpp::BasicConsoleLogger;
+using logpp::BasicFileLogger;
+using logpp::ConsoleLogger;
+using logpp::FileLogger;
+using logpp::FlushScheduler;
+using logpp::ILogger;
+using logpp::kv;
+using logpp::LogBatchEntry;
+using logpp::LogLevel;
+using logpp::NullLock;
+using logpp::OverflowPolicy;
+using logpp::RecordFormat;
+using logpp::ShmRingLogger;
+using logpp::ShmRingSink;
+using logpp::memory::AllocationScope;
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    const uint32_t  MAX_LATENCY_SAMPLES = 1u << 18; //!< Per thread; samples are decimated once this is reached
+    const uint32_t  DEADLINE_CHECK_INTERVAL = 64;   //!< Calls between two checks of the deadline
+    const char      BENCH_MESSAGE[] = "The quick brown fox jumps over the lazy dog; benchmark message of typical length";
+
+    /**
+     * @brief The different ways of calling into the logger that are benchmarked.
+     */
+    enum class CallKind {
+        Literal,    //!< info(const char*)
+        String,     //!< info(const string&)
+        Formatted,  //!< infoFmt(...) with two arguments
+        Structured, //!< info(msg, kv(...), ...) with three fields, as JSON lines
+        FmtText,    //!< info(fmt::format(...)) of the equivalent text line
+        Batch,      //!< logBatch() of BATCH_SIZE records, a quarter of them filtered out by level
+        BatchLoop   //!< The same records, logged one call at a time
+    };
+
+    const uint32_t  BATCH_SIZE = 64; //!< Records per call for CallKind::Batch and CallKind::BatchLoop
+
+    /**
+     * @brief A single benchmark configuration.
+     */
+    struct BenchCase {
+        string      sink;
+        CallKind    callKind;
+        uint32_t    bufferSize;
+        bool        flushAfterWrite;
+        uint32_t    threadCount;
+        bool        scheduledFlush; //!< Flushed by a FlushScheduler instead of the buffer size/flush-after-write rules
+    };
+
+    /**
+     * @brief The measured results of a single benchmark configuration.
+     */
+    struct BenchResult {
+        BenchCase   benchCase;
+        uint64_t    messages;
+        double      seconds;
+        double      allocationsPerMessage;
+        uint64_t    latencyNs[6]; //!< p50, p90, p99, p99.9, min, max
+    };
+
+    /**
+     * @brief Options parsed from the command line.
+     */
+    struct BenchOptions {
+        uint32_t    durationMs  = 500;
+        uint32_t    maxThreads  = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+        string      logDir      = "/dev/shm";
+        string      outputPath;
+        string      filter;
+    };
+
+    /**
+     * @brief Collects per-call latencies with bounded memory.
+     *
+     * Once the buffer is full, every second sample is dropped and the sampling stride doubles,
+     * so the samples stay evenly spread over the whole run.
+     */
+    class LatencyRecorder {
+        public:
+            LatencyRecorder(): _stride(1), _counter(0) { _samples.reserve(MAX_LATENCY_SAMPLES); }
+
+            void record(const uint32_t latencyNs) {
+                if (++_counter < _stride) { return; }
+                _counter = 0;
+
+                if (_samples.size() == MAX_LATENCY_SAMPLES) {
+                    for (size_t i = 0; i < _samples.size() / 2; i++) { _samples[i] = _samples[i * 2]; }
+                    _samples.resize(_samples.size() / 2);
+                    _stride *= 2;
+                }
+
+                _samples.push_back(latencyNs);
+            }
+
+            const vector<uint32_t>& getSamples() const { return _samples; }
+
+        private:
+            vector<uint32_t>    _samples;
+            uint32_t            _stride;
+            uint32_t            _counter;
+    };
+
+    const char* callKindToString(const CallKind callKind) {
+        switch (callKind) {
+            case CallKind::Literal:     return "literal";
+            case CallKind::String:      return "string";
+            case CallKind::Formatted:   return "formatted";
+            case CallKind::Structured:  return "structured_json";
+            case CallKind::FmtText:     return "fmt_text";
+            case CallKind::Batch:       return "batch64";
+            case CallKind::BatchLoop:   return "loop64";
+        }
+
+        return "unknown";
+    }
+
+    string getCaseName(const BenchCase& benchCase) {
+        return string(benchCase.sink) + "/" + callKindToString(benchCase.callKind) +
+               "/buf" + std::to_string(benchCase.bufferSize) + (benchCase.flushAfterWrite ? "/flush_after_write" : "") +
+               (benchCase.scheduledFlush ? "/scheduled" : "") +
+               "/t" + std::to_string(benchCase.threadCount);
+    }
+
+    unique_ptr<ILogger> createLogger(const BenchCase& benchCase, const string& logFile) {
+        unique_ptr<ILogger> logger;
+
+        if (benchCase.sink == "console") {
+            logger.reset(new ConsoleLogger("bench", LogLevel::Info, false, benchCase.bufferSize, benchCase.flushAfterWrite));
+        } else if (benchCase.sink == "async_file") {
+            // Blocking, so the throughput is that of records actually written rather than dropped
+            auto backend = std::make_shared<FileLogger>("bench", LogLevel::Info, logFile, benchCase.bufferSize, 4096, benchCase.flushAfterWrite, true);
+            auto asyncLogger = new AsyncLogger("bench", LogLevel::Info, backend);
+            asyncLogger->setOverflowPolicy(AsyncLane::Normal, OverflowPolicy::Block);
+            logger.reset(asyncLogger);
+        } else if (benchCase.sink == "shm_ring") {
+            logger.reset(new ShmRingLogger("bench", LogLevel::Info, "logpp_bench"));
+        } else {
+            logger.reset(new FileLogger("bench", LogLevel::Info, logFile, benchCase.bufferSize, 4096, benchCase.flushAfterWrite, true));
+        }
+
+        if (benchCase.callKind == CallKind::Structured) { logger->setRecordFormat(RecordFormat::JsonLines); }
+
+        return logger;
+    }
+
+    /**
+     * @brief Removes the files a FileLogger created for a benchmark case.
+     */
+    void removeLogFiles(const string& logFile) {
+        for (uint32_t i = 0; i <= FileLogger::DEFAULT_MAX_LOG_FILES + 1; i++) {
+            unlink((logFile + std::to_string(i)).c_str());
+        }
+    }
+
+    /**
+     * @brief Gets the records logged by CallKind::Batch and CallKind::BatchLoop; every fourth one is a debug record.
+     */
+    const vector<LogBatchEntry>& getBatchEntries() {
+        static const vector<LogBatchEntry> entries = []() {
+            vector<LogBatchEntry> batch;
+            for (uint32_t i = 0; i < BATCH_SIZE; i++) { batch.emplace_back(i % 4 == 3 ? LogLevel::Debug : LogLevel::Info, BENCH_MESSAGE); }
+
+            return batch;
+        }();
+
+        return entries;
+    }
+
+    template<typename Logger>
+    inline void logBatchLoop(Logger& logger) {
+        for (const auto& entry : getBatchEntries()) {
+            if (entry.level == LogLevel::Debug) {
+                logger.debug(entry.message);
+            } else {
+                logger.info(entry.message);
+            }
+        }
+    }
+
+    template<typename Logger, typename std::enable_if<std::is_base_of<ILogger, Logger>::value, int>::type = 0>
+    inline void logBatch(Logger& logger) {
+        const auto& entries = getBatchEntries();
+        logger.logBatch(entries.data(), entries.data() + entries.size());
+    }
+
+    template<typename Logger, typename std::enable_if<!std::is_base_of<ILogger, Logger>::value, int>::type = 0>
+    inline void logBatch(Logger& logger) { logBatchLoop(logger); } //!< The BasicLoggers have no batch API
+
+    /**
+     * @brief Logs a single benchmark message (or batch); Logger is an ILogger or one of the devirtualised BasicLoggers.
+     *
+     * @return The amount of records submitted, including those filtered out by level.
+     */
+    template<typename Logger>
+    inline uint32_t logOnce(Logger& logger, const CallKind callKind, const string& message, const uint64_t sequence) {
+        switch (callKind) {
+            case CallKind::Literal:
+                logger.info(BENCH_MESSAGE);
+                break;
+            case CallKind::String:
+                logger.info(message);
+                break;
+            case CallKind::Formatted:
+                #if logpp_USE_PRINTF
+                logger.infoFmt("Benchmark message %lu from %s", static_cast<unsigned long>(sequence), "logpp_bench");
+                #else
+                logger.infoFmt("Benchmark message {} from {}", sequence, "logpp_bench");
+                #endif
+                break;
+            case CallKind::Structured:
+                logger.info("Request served", kv("user", sequence), kv("lat_us", 187.5), kv("path", "/api/v1/users"));
+                break;
+            case CallKind::FmtText:
+                logger.info(fmt::format("Request served user={} lat_us={} path={}", sequence, 187.5, "/api/v1/users"));
+                break;
+            case CallKind::Batch:
+                logBatch(logger);
+                return BATCH_SIZE;
+            case CallKind::BatchLoop:
+                logBatchLoop(logger);
+                return BATCH_SIZE;
+        }
+
+        return 1;
+    }
+
+    uint64_t getPercentile(const vector<uint32_t>& sortedSamples, const double percentile) {
+        if (sortedSamples.empty()) { return 0; }
+
+        const auto index = static_cast<size_t>(percentile / 100.0 * (sortedSamples.size() - 1) + 0.5);
+        return sortedSamples[std::min(index, sortedSamples.size() - 1)];
+    }
+
+    /**
+     * @brief Runs a benchmark case against a logger, from warm-up to the final flush.
+     */
+    template<typename Logger>
+    BenchResult measureLogger(Logger& logger, const BenchCase& benchCase, const BenchOptions& options) {
+        // Warm up: grows the buffers and the per-thread arenas to their steady-state size.
+        for (uint32_t i = 0; i < 1000; i++) { logOnce(logger, benchCase.callKind, BENCH_MESSAGE, i); }
+        logger.flushBuffer();
+
+        std::atomic<uint32_t> readyThreads(0);
+        std::atomic<bool> go(false);
+        vector<LatencyRecorder> recorders(benchCase.threadCount);
+        vector<uint64_t> messageCounts(benchCase.threadCount, 0);
+        vector<uint64_t> allocationCounts(benchCase.threadCount, 0);
+        vector<std::thread> threads;
+
+        const auto duration = std::chrono::milliseconds(options.durationMs);
+        Clock::time_point startTime;
+
+        for (uint32_t t = 0; t < benchCase.threadCount; t++) {
+            threads.emplace_back([&, t]() {
+                const string message(BENCH_MESSAGE);
+                auto& recorder = recorders[t];
+
+                // Warm up this thread's arena before counting allocations
+                logOnce(logger, benchCase.callKind, message, 0);
+
+                readyThreads++;
+                while (!go.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+
+                const auto deadline = startTime + duration;
+                uint64_t messages = 0;
+                AllocationScope allocations;
+
+                for (bool running = true; running; ) {
+                    for (uint32_t i = 0; i < DEADLINE_CHECK_INTERVAL; i++) {
+                        const auto before = Clock::now();
+                        const auto submitted = logOnce(logger, benchCase.callKind, message, messages);
+                        const auto after = Clock::now();
+
+                        recorder.record(static_cast<uint32_t>(std::min<int64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count(), UINT32_MAX
+                        )));
+                        messages += submitted;
+                    }
+
+                    running = Clock::now() < deadline;
+                }
+
+                messageCounts[t] = messages;
+                allocationCounts[t] = allocations.getAllocationCount();
+            });
+        }
+
+        while (readyThreads.load() != benchCase.threadCount) { std::this_thread::yield(); }
+        startTime = Clock::now();
+        go.store(true, std::memory_order_release);
+
+        for (auto& thread : threads) { thread.join(); }
+        logger.flushBuffer();
+
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+        BenchResult result = { benchCase, 0, elapsed, 0, { 0 } };
+        uint64_t totalAllocations = 0;
+        vector<uint32_t> samples;
+
+        for (uint32_t t = 0; t < benchCase.threadCount; t++) {
+            result.messages += messageCounts[t];
+            totalAllocations += allocationCounts[t];
+            samples.insert(samples.end(), recorders[t].getSamples().begin(), recorders[t].getSamples().end());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        result.allocationsPerMessage = result.messages == 0 ? 0 : static_cast<double>(totalAllocations) / result.messages;
+        result.latencyNs[0] = getPercentile(samples, 50);
+        result.latencyNs[1] = getPercentile(samples, 90);
+        result.latencyNs[2] = getPercentile(samples, 99);
+        result.latencyNs[3] = getPercentile(samples, 99.9);
+        result.latencyNs[4] = samples.empty() ? 0 : samples.front();
+        result.latencyNs[5] = samples.empty() ? 0 : samples.back();
+
+        return result;
+    }
+
+    BenchResult runCase(const BenchCase& benchCase, const BenchOptions& options) {
+        const auto logFile = options.logDir + "/logpp_bench.log";
+        removeLogFiles(logFile);
+
+        BenchResult result;
+        if (benchCase.sink == "static_console") {
+            BasicConsoleLogger<> logger("bench", LogLevel::Info, benchCase.bufferSize, false);
+            result = measureLogger(logger, benchCase, options);
+        } else if (benchCase.sink == "static_file") {
+            BasicFileLogger<> logger("bench", LogLevel::Info, benchCase.bufferSize, logFile, "bench", 4096);
+            result = measureLogger(logger, benchCase, options);
+        } else if (benchCase.sink == "static_file_nolock") {
+            BasicFileLogger<NullLock> logger("bench", LogLevel::Info, benchCase.bufferSize, logFile, "bench", 4096);
+            result = measureLogger(logger, benchCase, options);
+        #if __cplusplus >= 201703L
+        } else if (benchCase.sink == "static_format_file") {
+            logpp::BasicLogger<logpp::FileSink, logpp::StaticTextFormatter<logpp::DefaultStaticFormat>> logger("bench", LogLevel::Info, benchCase.bufferSize, logFile, "bench", 4096);
+            result = measureLogger(logger, benchCase, options);
+        #endif
+        } else {
+            auto logger = createLogger(benchCase, logFile);
+            unique_ptr<FlushScheduler> scheduler;
+            if (benchCase.scheduledFlush) {
+                scheduler.reset(new FlushScheduler());
+                scheduler->registerLogger(logger.get());
+            }
+
+            result = measureLogger(*logger, benchCase, options);
+        }
+
+        removeLogFiles(logFile);
+        ShmRingSink::remove("logpp_bench");
+        return result;
+    }
+
+    vector<BenchCase> getBenchCases(const BenchOptions& options) {
+        // (bufferSize, flushAfterWrite); a buffer size of zero flushes on every write, too
+        const vector<std::pair<uint32_t, bool>> flushPolicies = {
+            { 4096, true }, { 0, false }, { 4096, false }, { 65536, false }, { 1048576, false }
+        };
+
+        vector<uint32_t> threadCounts;
+        for (uint32_t threads = 1; threads < options.maxThreads; threads *= 2) { threadCounts.push_back(threads); }
+        threadCounts.push_back(options.maxThreads);
+
+        vector<BenchCase> cases;
+        for (const auto& sink : { "console", "file" }) {
+            for (const auto& policy : flushPolicies) {
+                for (const auto threads : threadCounts) {
+                    cases.push_back({ sink, CallKind::Literal, policy.first, policy.second, threads, false });
+                }
+            }
+
+            // Cost of the different call paths, single threaded with the default buffering
+            cases.push_back({ sink, CallKind::String, 65536, false, 1, false });
+            cases.push_back({ sink, CallKind::Formatted, 65536, false, 1, false });
+            cases.push_back({ sink, CallKind::Structured, 65536, false, 1, false });
+            cases.push_back({ sink, CallKind::FmtText, 65536, false, 1, false });
+
+            // Records submitted in batches, against the same records one call at a time; latencies are per call
+            cases.push_back({ sink, CallKind::Batch, 65536, false, 1, false });
+            cases.push_back({ sink, CallKind::BatchLoop, 65536, false, 1, false });
+        }
+
+        // Formatting on the calling thread, writing on AsyncLogger's worker
+        for (const auto threads : threadCounts) {
+            cases.push_back({ "async_file", CallKind::Literal, 65536, false, threads, false });
+        }
+
+        // Publishing into a shared-memory ring, with no reader attached
+        for (const auto threads : threadCounts) {
+            cases.push_back({ "shm_ring", CallKind::Literal, 0, false, threads, false });
+        }
+
+        // The devirtualised BasicLogger templates; NullLock only makes sense single threaded
+        for (const auto& sink : { "static_console", "static_file" }) {
+            for (const auto threads : threadCounts) {
+                cases.push_back({ sink, CallKind::Literal, 65536, false, threads, false });
+            }
+
+            cases.push_back({ sink, CallKind::String, 65536, false, 1, false });
+            cases.push_back({ sink, CallKind::Formatted, 65536, false, 1, false });
+        }
+        cases.push_back({ "static_file", CallKind::Literal, 0, false, 1, false });
+        cases.push_back({ "static_file_nolock", CallKind::Literal, 65536, false, 1, false });
+
+        #if __cplusplus >= 201703L
+        // The same file logger with its format parsed at compile time
+        cases.push_back({ "static_format_file", CallKind::Literal, 65536, false, 1, false });
+        cases.push_back({ "static_format_file", CallKind::String, 65536, false, 1, false });
+        #endif
+
+        // The same buffering configurations, flushed by a FlushScheduler
+        for (const auto& policy : { std::make_pair(4096u, true), std::make_pair(65536u, false) }) {
+            cases.push_back({ "file", CallKind::Literal, policy.first, policy.second, 1, true });
+        }
+
+        if (!options.filter.empty()) {
+            cases.erase(std::remove_if(cases.begin(), cases.end(), [&](const BenchCase& benchCase) {
+                return getCaseName(benchCase).find(options.filter) == string::npos;
+            }), cases.end());
+        }
+
+        return cases;
+    }
+
+    string resultsToJson(const vector<BenchResult>& results, const BenchOptions& options) {
+        string json;
+        json += "{\n";
+        json += "  \"library\": \"logpp\",\n";
+        #if logpp_USE_PRINTF
+        json += "  \"format_mode\": \"printf\",\n";
+        #else
+        json += "  \"format_mode\": \"fmt\",\n";
+        #endif
+        json += string("  \"json_escape\": \"") + logpp::JsonLineFormatter::getEscapeImplementation() + "\",\n";
+        json += "  \"duration_ms\": " + std::to_string(options.durationMs) + ",\n";
+        json += "  \"hardware_threads\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+        json += "  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& result = results[i];
+            const auto& benchCase = result.benchCase;
+            char line[1024];
+
+            snprintf(line, sizeof(line),
+                "    { \"name\": \"%s\", \"sink\": \"%s\", \"call\": \"%s\", \"buffer_size\": %u, \"flush_after_write\": %s, \"scheduled_flush\": %s, \"threads\": %u, "
+                "\"messages\": %llu, \"seconds\": %.6f, \"messages_per_sec\": %.1f, \"allocations_per_message\": %.4f, "
+                "\"latency_ns\": { \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"min\": %llu, \"max\": %llu } }%s\n",
+                getCaseName(benchCase).c_str(), benchCase.sink.c_str(), callKindToString(benchCase.callKind),
+                benchCase.bufferSize, benchCase.flushAfterWrite ? "true" : "false", benchCase.scheduledFlush ? "true" : "false", benchCase.threadCount,
+                static_cast<unsigned long long>(result.messages), result.seconds,
+                result.seconds > 0 ? result.messages / result.seconds : 0.0, result.allocationsPerMessage,
+                static_cast<unsigned long long>(result.latencyNs[0]), static_cast<unsigned long long>(result.latencyNs[1]),
+                static_cast<unsigned long long>(result.latencyNs[2]), static_cast<unsigned long long>(result.latencyNs[3]),
+                static_cast<unsigned long long>(result.latencyNs[4]), static_cast<unsigned long long>(result.latencyNs[5]),
+                i + 1 == results.size() ? "" : ","
+            );
+
+            json += line;
+        }
+
+        json += "  ]\n}\n";
+        return json;
+    }
+
+    bool parseOptions(int32_t argC, char* argV[], BenchOptions& options) {
+        for (int32_t i = 1; i < argC; i++) {
+            const string arg = argV[i];
+            const bool hasValue = i + 1 < argC;
+
+            if (arg == "--duration-ms" && hasValue) {
+                options.durationMs = static_cast<uint32_t>(std::max(1l, strtol(argV[++i], nullptr, 10)));
+            } else if (arg == "--threads" && hasValue) {
+                options.maxThreads = static_cast<uint32_t>(std::max(1l, strtol(argV[++i], nullptr, 10)));
+            } else if (arg == "--dir" && hasValue) {
+                options.logDir = argV[++i];
+            } else if (arg == "--output" && hasValue) {
+                options.outputPath = argV[++i];
+            } else if (arg == "--filter" && hasValue) {
+                options.filter = argV[++i];
+            } else {
+                fprintf(stderr, "Usage: %s [--duration-ms <ms>] [--threads <max threads>] [--dir <log dir>] [--output <file>] [--filter <substring>]\n", argV[0]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+int main(int32_t argC, char* argV[]) {
+    BenchOptions options;
+    if (!parseOptions(argC, argV, options)) { return 1; }
+
+    // ConsoleLogger writes to stdout; keep the real stdout for the results and send the logs to /dev/null.
+    const auto resultFd = dup(STDOUT_FILENO);
+    const auto devNull = open("/dev/null", O_WRONLY);
+    if (resultFd < 0 || devNull < 0 || dup2(devNull, STDOUT_FILENO) < 0) {
+        perror("Failed to redirect stdout");
+        return 1;
+    }
+    close(devNull);
+
+    vector<BenchResult> results;
+    for (const auto& benchCase : getBenchCases(options)) {
+        fprintf(stderr, "Running %s...\n", getCaseName(benchCase).c_str());
+        results.push_back(runCase(benchCase, options));
+    }
+
+    const auto json = resultsToJson(results, options);
+
+    if (!options.outputPath.empty()) {
+        std::ofstream outStream(options.outputPath, std::ios_base::trunc);
+        outStream << json;
+    } else {
+        (void)!write(resultFd, json.data(), json.size());
+    }
+
+    close(resultFd);
+    return 0;
+}
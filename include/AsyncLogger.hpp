@@ -0,0 +1,172 @@
+/**
+ * AsyncLogger.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_ASYNCLOGGER_HPP
+#define LOGPP_ASYNCLOGGER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logpp {
+
+    using std::shared_ptr;
+    using std::string;
+    using std::thread;
+    using std::vector;
+
+    /**
+     * @brief The queue lanes of an AsyncLogger. Records are sorted into lanes by isBadLog().
+     */
+    enum class AsyncLane : uint8_t {
+        Normal  = 0, ///!< Ok, Info, Warning, Debug and Trace
+        Bad     = 1 ///!< Error and Fatal
+    };
+
+    /**
+     * @brief What an AsyncLogger does with a record when the record's lane is full.
+     */
+    enum class OverflowPolicy : uint8_t {
+        Block, ///!< Wait until the worker made room. Never drops, but the logging thread stalls.
+        DropNewest, ///!< Discard the incoming record.
+        DropOldest, ///!< Discard the oldest queued record of the lane to make room for the incoming one.
+        CounterOnly ///!< Discard the incoming record, but keep a count per level which is reported with the drop record.
+    };
+
+    string toString(const OverflowPolicy policy); ///!< Gets the name of an overflow policy ("block", "drop-newest", ...).
+
+    /**
+     * @brief A logger which formats records on the calling thread and hands them to a backend logger on a worker thread.
+     *
+     * Records are queued in two bounded lanes, one for bad logs (see isBadLog()) and one for everything else.
+     * The worker always drains the bad lane first, and each lane has its own capacity and overflow policy,
+     * so a flood of Trace records can neither delay nor push out the Fatal explaining a crash.
+     * By default the bad lane blocks when full and the normal lane drops the newest record.
+     *
+     * Records lost to a full lane are counted; once the lane has drained to half its capacity, the worker logs
+     * a single synthetic record saying how many were lost (at Warning for the normal lane, Error for the bad lane).
+     * Lost records are also counted in the metrics' droppedRecords, and the queue depth in queueHighWaterMark.
+     *
+     * @code
+     *  auto console = std::make_shared<logpp::ConsoleLogger>("app", LogLevel::Trace, true, 65536, false);
+     *  logpp::AsyncLogger logger("app", LogLevel::Trace, console);
+     *  logger.setOverflowPolicy(logpp::AsyncLane::Normal, logpp::OverflowPolicy::CounterOnly);
+     * @endcode
+     *
+     * @remarks Records are formatted with this logger's format and level; the backend only writes them out
+     * (and applies its own level filter). Queue slots keep their strings' capacity, so a steady state doesn't allocate.
+     * Only the worker thread calls the backend, flushes included, until the destructor flushes it after the worker stopped;
+     * so a backend which isn't thread-safe (e.g. a LoggerAdapter around a BasicLogger with a NullLock) is fine.
+     */
+    class AsyncLogger: public ILogger {
+        public: // +++ Static +++
+            static const uint32_t DEFAULT_QUEUE_CAPACITY; //!< Records per lane
+            static const uint32_t WORKER_BATCH_SIZE; //!< Records the worker takes from the queue per lock
+
+        public:
+            AsyncLogger(const string& logName, const LogLevel maxLogLevel, shared_ptr<ILogger> backend,
+                        const uint32_t queueCapacity = DEFAULT_QUEUE_CAPACITY); ///!< Object constructor; starts the worker.
+            virtual ~AsyncLogger(); ///!< Virtual destructor; drains the queue, stops the worker and flushes the backend.
+
+            AsyncLogger(const AsyncLogger&) = delete;
+            AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+            /**
+             * @brief Gets the logger records are written to.
+             */
+            shared_ptr<ILogger> getBackend() const { return this->_backend; }
+
+            /**
+             * @brief Gets the maximum amount of records queued per lane.
+             */
+            uint32_t getQueueCapacity() const { return this->_queueCapacity; }
+
+            /**
+             * @brief Gets the amount of records lost to full lanes since this logger was created.
+             */
+            uint64_t getDroppedCount() const { return this->_droppedTotal.load(std::memory_order_relaxed); }
+
+            OverflowPolicy getOverflowPolicy(const AsyncLane lane) const; ///!< Gets what happens to records when a lane is full.
+            void setOverflowPolicy(const AsyncLane lane, const OverflowPolicy policy); ///!< Sets what happens to records when a lane is full.
+
+            uint32_t getQueueDepth() const; ///!< Gets the amount of records currently queued in both lanes.
+
+            virtual void flushBuffer() override; ///!< Waits until the worker drained the queue and flushed the backend.
+            virtual void logMessage(const LogLevel level, const string& msg) override; ///!< Queues a formatted record.
+
+        protected:
+            /**
+             * @brief Has the backend write an emergency record, after its buffered records; async-signal-safe.
+             *
+             * @remarks Records still queued are lost: the queue is guarded by a mutex and holds strings.
+             */
+            virtual void writeEmergencyRecord(const LogLevel level, const LogBuffer* buffered, string_view record) override;
+
+        private:
+            /**
+             * @brief A queued, formatted record.
+             */
+            struct QueuedRecord {
+                LogLevel    level;
+                string      msg;
+            };
+
+            /**
+             * @brief A bounded ring of records. Guarded by _queueMutex.
+             */
+            struct Lane {
+                vector<QueuedRecord>        slots;
+                uint32_t                    head = 0; ///!< Index of the oldest record
+                uint32_t                    count = 0;
+                OverflowPolicy              policy = OverflowPolicy::DropNewest;
+
+                uint64_t                    dropped = 0; ///!< Records dropped since the last drop record
+                std::array<uint64_t, LOG_LEVEL_COUNT> demoted; ///!< Records counted (CounterOnly) since the last drop record, by level
+
+                std::condition_variable     notFull; ///!< Signalled when the worker took records from this lane
+            };
+
+            Lane& getLane(const LogLevel level) { return _lanes[isBadLog(level) ? 1 : 0]; }
+
+            void countDropped(Lane& lane, const LogLevel level);
+            bool takeDropReport(Lane& lane, const AsyncLane laneId, string& out);
+            void workerLoop();
+
+        private:
+            shared_ptr<ILogger>         _backend;
+            uint32_t                    _queueCapacity;
+
+            mutable std::mutex          _queueMutex;
+            std::condition_variable     _notEmpty; ///!< Signalled when a record was queued or the worker should stop
+            std::condition_variable     _flushed; ///!< Signalled when the worker flushed the backend or stopped
+            Lane                        _lanes[2];
+            uint64_t                    _flushesRequested;
+            uint64_t                    _flushesDone; ///!< The value of _flushesRequested when the worker last flushed the backend
+            bool                        _stopping;
+            std::thread::id             _workerId; ///!< Set by the worker; producers on the worker thread must not block
+
+            std::atomic<uint64_t>       _droppedTotal;
+
+            thread                      _workerThread;
+    };
+
+}
+
+#endif // LOGPP_ASYNCLOGGER_HPP
@@ -0,0 +1,397 @@
+/**
+ * BasicLogger.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_BASICLOGGER_HPP
+#define LOGPP_BASICLOGGER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+#include "JsonLineFormatter.hpp"
+#include "LogSinks.hpp"
+#include "TextFormatter.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace logpp {
+
+    /**
+     * @brief A lock policy which doesn't lock; for loggers only ever used by a single thread.
+     */
+    struct NullLock {
+        void lock() { }
+        bool try_lock() { return true; }
+        void unlock() { }
+    };
+
+    /**
+     * @brief The log shortcuts (debug(), info(), ..., kv overloads and *Fmt) for loggers without virtual functions.
+     *
+     * Derived must provide:
+     * @code
+     *  void log(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+     *           const LogField* fields, const size_t fieldCount);
+     * @endcode
+     * Every shortcut is a direct (inlinable) call to it.
+     */
+    template<typename Derived>
+    class LogShortcuts {
+        public:
+            void debug(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Debug, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging debug messages.
+            void error(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Error, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging error messages.
+            void fatal(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Fatal, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging fatal messages.
+            void info(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Info, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging info messages.
+            void ok(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Ok, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging ok messages.
+            void trace(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Trace, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging trace messages.
+            void warning(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { self().log(LogLevel::Warning, msg, except, line, func, nullptr, 0); } ///!< A shortcut method for logging warning messages.
+
+            // Structured records; see ILogger.
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void debug(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Debug, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void error(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Error, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void fatal(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Fatal, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void info(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Info, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void ok(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Ok, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void trace(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Trace, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void warning(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Warning, msg, field, fields...); }
+
+        #if defined(logpp_USE_PRINTF)
+            template<typename... Args>
+            void debugFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Debug, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void errorFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Error, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void fatalFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Fatal, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void infoFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Info, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void okFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Ok, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void traceFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Trace, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void warningFmt(const char* fmt, Args&&... args) { logFormatted(LogLevel::Warning, fmt, std::forward<Args>(args)...); }
+        #else
+            template<typename... Args>
+            void debugFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Debug, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void errorFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Error, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void fatalFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Fatal, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void infoFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Info, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void okFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Ok, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void traceFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Trace, fmt, std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void warningFmt(string_view fmt, Args&&... args) { logFormatted(LogLevel::Warning, fmt, std::forward<Args>(args)...); }
+
+        #if FMT_VERSION >= 80000
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void debugFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Debug, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void errorFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Error, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void fatalFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Fatal, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void infoFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Info, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void okFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Ok, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void traceFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Trace, fmt, std::forward<Args>(args)...); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void warningFmt(const S& fmt, Args&&... args) { logFormatted(LogLevel::Warning, fmt, std::forward<Args>(args)...); }
+        #endif // FMT_VERSION >= 80000
+        #endif // logpp_USE_PRINTF
+
+        protected:
+            /**
+             * @brief Logs a structured record.
+             */
+            template<typename... Fields>
+            void logFields(const LogLevel level, string_view msg, const Fields&... fields) {
+                const LogField fieldArray[] = { fields... };
+                self().log(level, msg, nullptr, -1, string_view(), fieldArray, sizeof...(Fields));
+            }
+
+            /**
+             * @brief Formats a message into the per-thread format buffer and logs it; filtered levels aren't formatted.
+             */
+        #if defined(logpp_USE_PRINTF)
+            template<typename... Args>
+            void logFormatted(const LogLevel level, const char* fmt, Args&&... args) {
+                if (level > self().getCurrentMaxLogLevel()) return;
+
+                self().log(level, formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...), nullptr, -1, string_view(), nullptr, 0);
+            }
+        #else
+            template<typename... Args>
+            void logFormatted(const LogLevel level, string_view fmt, const Args&... args) {
+                if (level > self().getCurrentMaxLogLevel()) return;
+
+                auto& buffer = getThreadFormatBuffer();
+                buffer.clear();
+                fmt::vformat_to(std::back_inserter(buffer), fmt::string_view(fmt.data(), fmt.size()), fmt::make_format_args(args...));
+                self().log(level, buffer, nullptr, -1, string_view(), nullptr, 0);
+            }
+
+        #if FMT_VERSION >= 80000
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void logFormatted(const LogLevel level, const S& fmt, Args&&... args) {
+                if (level > self().getCurrentMaxLogLevel()) return;
+
+                auto& buffer = getThreadFormatBuffer();
+                buffer.clear();
+                fmt::format_to(std::back_inserter(buffer), fmt.format, std::forward<Args>(args)...);
+                self().log(level, buffer, nullptr, -1, string_view(), nullptr, 0);
+            }
+        #endif // FMT_VERSION >= 80000
+        #endif // logpp_USE_PRINTF
+
+            /**
+             * @brief Gets a per-thread string for the *Fmt shortcuts; it keeps its capacity between calls.
+             */
+            static string& getThreadFormatBuffer() {
+                static thread_local string buffer;
+                return buffer;
+            }
+
+        private:
+            Derived& self() { return static_cast<Derived&>(*this); }
+    };
+
+    /**
+     * @brief A logger assembled from policies at compile time, without a single virtual call.
+     *
+     * @tparam Sink Where flushed records go; see ConsoleSink and FileSink. Must provide write(string_view buffer),
+     *         writeDirect(string_view record) and writesDirectly(LogLevel).
+     * @tparam Formatter How records are laid out; TextFormatter (the logger format string) or JsonLineFormatter.
+     *         Must provide formatTo(out, level, loggerName, msg, fields, fieldCount, func, line, except).
+     * @tparam LockPolicy Serialises the buffer and the sink; std::mutex, or NullLock for single-threaded use.
+     *
+     * Records are formatted straight into the buffer, which is handed to the sink when it reaches the maximum buffer size
+     * or on bad logs. The sink, formatter and level filter are all known to the compiler, so a log call inlines down to
+     * the level check, the format walk and the buffer append.
+     *
+     * @code
+     *  logpp::BasicFileLogger<logpp::NullLock> logger("worker", LogLevel::Info, 64 * 1024, "/var/log/worker.log", "worker", 10);
+     *  logger.getFormatter().setFormat("${ts_us} ${llevel} ${lmsg}");
+     *  logger.info("Job done", kv("job", id));
+     * @endcode
+     *
+     * This trades ILogger's runtime features (duplicate collapsing, self-metrics, FlushScheduler, LogConfigWatcher) for speed;
+     * wrap a BasicLogger in a LoggerAdapter where an ILogger is needed.
+     *
+     * @remarks Configure the formatter and sink before logging from multiple threads; only the level may be changed concurrently.
+     */
+    template<typename Sink, typename Formatter = TextFormatter, typename LockPolicy = std::mutex>
+    class BasicLogger: public LogShortcuts<BasicLogger<Sink, Formatter, LockPolicy>> {
+        public:
+            /**
+             * @brief Construct a new BasicLogger object.
+             *
+             * @param logName The name for this logger.
+             * @param maxLogLevel The maximum logging level to log.
+             * @param bufferSize The buffer size at which records are handed to the sink; 0 writes every record right away.
+             * @param sinkArgs Passed on to the sink's constructor.
+             */
+            template<typename... SinkArgs>
+            BasicLogger(const string& logName, const LogLevel maxLogLevel, const uint32_t bufferSize, SinkArgs&&... sinkArgs):
+            _logName(logName), _maxLogLevel(maxLogLevel), _maxBufferSize(bufferSize), _sink(std::forward<SinkArgs>(sinkArgs)...) {
+                _buffer.reserve(bufferSize);
+            }
+
+            ~BasicLogger() { flushBuffer(); } ///!< Destructor; flushes the buffer.
+
+            BasicLogger(const BasicLogger&) = delete;
+            BasicLogger& operator=(const BasicLogger&) = delete;
+
+            const string& getCurrentLoggerName() const { return this->_logName; } ///!< Gets the name of this logger.
+            LogLevel getCurrentMaxLogLevel() const { return this->_maxLogLevel.load(std::memory_order_relaxed); } ///!< Gets the maximum level logged.
+            void setCurrentMaxLogLevel(const LogLevel level) { this->_maxLogLevel.store(level, std::memory_order_relaxed); } ///!< Sets the maximum level logged.
+
+            uint32_t getMaxBufferSize() const { return this->_maxBufferSize.load(std::memory_order_relaxed); } ///!< Gets the buffer size at which the buffer is flushed.
+            void setMaxBufferSize(const uint32_t bufferSize) { this->_maxBufferSize.store(bufferSize, std::memory_order_relaxed); } ///!< Sets the buffer size at which the buffer is flushed.
+
+            Formatter& getFormatter() { return this->_formatter; } ///!< Gets the formatter, e.g. to set the logger format.
+            Sink& getSink() { return this->_sink; } ///!< Gets the sink.
+
+            /**
+             * @brief Filters, formats and logs a record. All log shortcuts end up here.
+             *
+             * @param level The log level of the record.
+             * @param msg The pure message.
+             * @param except (Optional) The exception thrown.
+             * @param line (Optional) The line at which the logger was called.
+             * @param func (Optional) The function/method in which the logger was called.
+             * @param fields (Optional) The record's structured fields.
+             * @param fieldCount (Optional) The amount of fields.
+             */
+            void log(const LogLevel level, string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view(),
+                     const LogField* fields = nullptr, const size_t fieldCount = 0) {
+                if (level > getCurrentMaxLogLevel()) return;
+
+                std::lock_guard<LockPolicy> lock(_lock);
+                if (_sink.writesDirectly(level)) {
+                    _directRecord.clear();
+                    _formatter.formatTo(_directRecord, level, _logName, msg, fields, fieldCount, func, line, except);
+                    _sink.writeDirect(_directRecord);
+                    return;
+                }
+
+                _formatter.formatTo(_buffer, level, _logName, msg, fields, fieldCount, func, line, except);
+                onRecordAppended(level);
+            }
+
+            /**
+             * @brief Logs an already formatted record; used by LoggerAdapter.
+             *
+             * @param level The log level of the record.
+             * @param record The formatted record.
+             */
+            void logMessage(const LogLevel level, string_view record) {
+                if (level > getCurrentMaxLogLevel() || record.size() == 0) return;
+
+                std::lock_guard<LockPolicy> lock(_lock);
+                if (_sink.writesDirectly(level)) {
+                    _sink.writeDirect(record);
+                    return;
+                }
+
+                _buffer.append(record.data(), record.size());
+                onRecordAppended(level);
+            }
+
+            /**
+             * @brief Hands the buffered records to the sink.
+             */
+            void flushBuffer() {
+                std::lock_guard<LockPolicy> lock(_lock);
+                flushLocked();
+            }
+
+        private:
+            /**
+             * @brief Terminates the record just appended and flushes on bad logs or a full buffer. Call with the lock held.
+             */
+            void onRecordAppended(const LogLevel level) {
+                if (!_buffer.empty() && _buffer.back() != '\n') { _buffer += '\n'; }
+
+                if (isBadLog(level) || _buffer.size() >= getMaxBufferSize()) { flushLocked(); }
+            }
+
+            void flushLocked() {
+                if (_buffer.empty()) return;
+
+                _sink.write(_buffer);
+                _buffer.clear();
+            }
+
+        private:
+            string              _logName;
+            atomic<LogLevel>    _maxLogLevel;
+            atomic<uint32_t>    _maxBufferSize;
+
+            LockPolicy          _lock; ///!< Guards everything below
+            Formatter           _formatter;
+            Sink                _sink;
+            string              _buffer; ///!< Keeps its capacity between flushes
+            string              _directRecord; ///!< Scratch space for records which bypass the buffer
+    };
+
+    template<typename LockPolicy = std::mutex>
+    using BasicConsoleLogger = BasicLogger<ConsoleSink, TextFormatter, LockPolicy>; ///!< A devirtualised ConsoleLogger (without colours or file output).
+
+    template<typename LockPolicy = std::mutex>
+    using BasicFileLogger = BasicLogger<FileSink, TextFormatter, LockPolicy>; ///!< A devirtualised FileLogger.
+
+    /**
+     * @brief Wraps a BasicLogger (or anything with logMessage(level, record) and flushBuffer()) in an ILogger,
+     * for code which needs runtime polymorphism, e.g. an AsyncLogger backend.
+     *
+     * Records are formatted by the ILogger side, with its settings (setCurrentLoggerFormat(), setRecordFormat(), ...),
+     * and handed to the wrapped logger preformatted; the wrapped logger buffers and writes them.
+     *
+     * @code
+     *  auto backend = std::make_shared<logpp::LoggerAdapter<logpp::BasicFileLogger<logpp::NullLock>>>("app", LogLevel::Trace, 64 * 1024, "app.log", "app", 10);
+     *  logpp::AsyncLogger logger("app", LogLevel::Info, backend); // only the worker thread writes to and flushes the backend
+     * @endcode
+     */
+    template<typename Logger>
+    class LoggerAdapter: public ILogger {
+        public:
+            /**
+             * @brief Construct a new LoggerAdapter object.
+             *
+             * @param logName The name for this logger.
+             * @param maxLogLevel The maximum logging level to log; the wrapped logger logs everything it's given.
+             * @param loggerArgs Passed on to the wrapped logger's constructor, after the name and level.
+             */
+            template<typename... LoggerArgs>
+            LoggerAdapter(const string& logName, const LogLevel maxLogLevel, LoggerArgs&&... loggerArgs):
+            ILogger(logName, maxLogLevel, 0, false), _logger(logName, LOGLEVEL_MAXVALUE, std::forward<LoggerArgs>(loggerArgs)...) { }
+
+            virtual ~LoggerAdapter() { flushDuplicateSummary(); } ///!< Virtual destructor; the wrapped logger flushes itself.
+
+            Logger& getLogger() { return this->_logger; } ///!< Gets the wrapped logger.
+
+            virtual void flushBuffer() override { flushDuplicateSummary(); _logger.flushBuffer(); } ///!< Flushes the wrapped logger.
+
+            /**
+             * @brief Hands a formatted record to the wrapped logger.
+             */
+            virtual void logMessage(const LogLevel level, const string& msg) override {
+                if (level > getCurrentMaxLogLevel()) return;
+
+                _logger.logMessage(level, msg);
+            }
+
+        private:
+            Logger _logger;
+    };
+
+}
+
+#endif // LOGPP_BASICLOGGER_HPP
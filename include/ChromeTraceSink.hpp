@@ -0,0 +1,58 @@
+/**
+ * ChromeTraceSink.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_CHROMETRACESINK_HPP
+#define LOGPP_CHROMETRACESINK_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ScopedTimer.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace logpp {
+
+    using std::string;
+
+    /**
+     * @brief Writes spans to a file in the Chrome trace-event JSON format, as read by chrome://tracing, Perfetto and speedscope.
+     *
+     * Each span becomes a complete ("X") event with microsecond timestamps on the steady_clock time line.
+     * Batches are formatted outside the file lock and written with a single fwrite.
+     *
+     * @code
+     *  logpp::Tracing::setSink(std::make_shared<logpp::ChromeTraceSink>("/tmp/myapp.trace.json"));
+     * @endcode
+     *
+     * @remarks The closing bracket is written when the sink is destroyed; the trace viewers also accept files without it.
+     */
+    class ChromeTraceSink: public ITraceSink {
+        public:
+            explicit ChromeTraceSink(const string& filename); ///!< Object constructor. Throws runtime_error if the file can't be created.
+            virtual ~ChromeTraceSink(); ///!< Closes the JSON array and the file.
+
+            ChromeTraceSink(const ChromeTraceSink&) = delete;
+            ChromeTraceSink& operator=(const ChromeTraceSink&) = delete;
+
+            virtual void writeSpans(const TraceSpan* spans, const size_t count) override;
+            virtual void flush() override;
+
+        private:
+            std::mutex  _fileMutex;
+            FILE*       _file;
+            bool        _hasEvents; ///!< Whether the next event needs a separating comma
+            uint32_t    _processId;
+    };
+
+}
+
+#endif // LOGPP_CHROMETRACESINK_HPP
@@ -33,7 +33,7 @@ namespace logpp {
              * @return true If bad logs should be output to std err.
              * @return false Otherwise.
              */
-            bool outputBadLogsToStderr() const { return this->_outputBadLogsToStderr; }
+            bool outputBadLogsToStderr() const { return this->_sink.outputBadLogsToStderr(); }
 
             /**
              * @brief Gets a value indicating whether to output debug logs to std err or not.
@@ -51,7 +51,7 @@ namespace logpp {
              * 
              * @param outputToStderr True if bad logs should be output to std err.
              */
-            void setOutputBadLogsToStderr(bool outputToStderr) { this->_outputBadLogsToStderr = outputToStderr; }
+            void setOutputBadLogsToStderr(bool outputToStderr) { this->_sink.setOutputBadLogsToStderr(outputToStderr); }
 
             /**
              * @brief Sets a value indicating whether to output debug logs to std err or not.
@@ -69,21 +69,26 @@ namespace logpp {
 
         protected:
             /**
-             * @brief Formats an entire log message which may then be directly printed to any given (string) output.
+             * @brief Appends the log level, coloured if colouring is enabled.
              *
-             * @param msg A reference to a string containing the log message. Also used as the output for the entire (formatted) message.
-             * @param lvl The log level for the given message. Used for formatting.
-             * @param func The function which called the logger. Used for formatting.
-             * @param line The line at which the logger was called. Used for formatting.
-             * @param except A pointer to an exception which should be logged.
-             *
-             * @return Returns the entire formatted message so it may be used in a function call.
+             * @param out The string to append to.
+             * @param lvl The log level to append.
+             */
+            virtual void appendLogLevel(string& out, const LogLevel lvl) const override;
+
+            /**
+             * @brief Appends a batch to the buffer at once; records written straight to stderr are still written one by one.
+             */
+            virtual void logBatchRecords(const LogBatchEntry* entries, const uint32_t* selected, const size_t count) override;
+
+            /**
+             * @brief Writes an emergency record like logMessage() would, uncoloured, and to the file logger if there is one; async-signal-safe.
              */
-            virtual string formatLogMessage(const string& msg, LogLevel lvl, const string& func = "", const int32_t line = -1, const exception* except = nullptr) override;
+            virtual void writeEmergencyRecord(const LogLevel level, const LogBuffer* buffered, string_view record) override;
 
         private:
             bool _colourLogLevels;
-            bool _outputBadLogsToStderr;
+            ConsoleSink _sink; ///!< Written with the write mutex held
             bool _outputDebugToStderr;
             bool _logToFile;
 
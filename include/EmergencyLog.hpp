@@ -0,0 +1,69 @@
+/**
+ * EmergencyLog.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_EMERGENCYLOG_HPP
+#define LOGPP_EMERGENCYLOG_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogBufferPool.hpp"
+#include "LogLevel.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstddef>
+#include <cstdint>
+
+namespace logpp {
+
+    /**
+     * @brief The async-signal-safe building blocks of ILogger::emergencyLog(): formatting into caller-provided memory and write(2).
+     *
+     * Nothing here allocates, takes a lock or consults the locale. Timestamps are computed from clock_gettime() and the
+     * UTC offset captured by captureUtcOffset(), since localtime() isn't async-signal-safe.
+     */
+    class EmergencyLog {
+        public: // +++ Static +++
+            static const size_t MAX_RECORD_SIZE = 1024; ///!< Emergency records are formatted on the stack and truncated to this size
+
+            /**
+             * @brief Remembers the local time's current UTC offset for the timestamps; not async-signal-safe.
+             *
+             * @remarks Called whenever a logger is created; a DST change afterwards shifts emergency timestamps by an hour.
+             */
+            static void captureUtcOffset();
+
+            /**
+             * @brief Formats a record in the default layout: "[ 2026.10.18 19:48:22 ] [  Fatal  ] message\n".
+             *
+             * Control characters in the message are replaced by spaces, so the record stays on a line of its own.
+             *
+             * @param out The memory to format into.
+             * @param capacity The size of out; the message is truncated to fit.
+             *
+             * @return size_t The length of the record, including its line feed.
+             */
+            static size_t formatRecord(char* out, const size_t capacity, const LogLevel level, const char* message);
+
+            static size_t formatTimestamp(char* out, const size_t capacity); ///!< Formats the current local time as "2026.10.18 19:48:22".
+
+            /**
+             * @brief Formats an unsigned integer in decimal, padded with zeros to minDigits.
+             *
+             * @return size_t The amount of characters written; 0 if capacity is too small.
+             */
+            static size_t formatUnsigned(char* out, const size_t capacity, uint64_t value, const uint32_t minDigits = 1);
+
+            static bool writeFully(const int32_t fd, const char* data, size_t size); ///!< write(2)s everything, retrying on EINTR and short writes.
+            static bool writeBuffer(const int32_t fd, const LogBuffer& buffer); ///!< write(2)s a logger's buffer chunk by chunk.
+    };
+
+}
+
+#endif // LOGPP_EMERGENCYLOG_HPP
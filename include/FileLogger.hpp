@@ -9,6 +9,7 @@
 #define FILE_LOGGER_HPP
 
 #include "ILogger.hpp"
+#include "LogSinks.hpp"
 
 namespace logpp {
 
@@ -31,34 +32,28 @@ namespace logpp {
 
             virtual void logMessage(const LogLevel level, const string& msg) override;
 
-            virtual FileLogger& setMaxFileCount(const uint32_t maxFileCount = DEFAULT_MAX_LOG_FILES) { _maxFileCount = maxFileCount; return *this; }
+            virtual FileLogger& setMaxFileCount(const uint32_t maxFileCount = DEFAULT_MAX_LOG_FILES) { _sink.setMaxFileCount(maxFileCount); return *this; }
 
         protected:
-            string getControlFilePath() const; //!< Gets the path to the control file for this logger
-            void initLogContinuation(); //!< Initialises the log continuation logic
-            void storeLatestLogFile(); //!< Stores the latest written log file to a control file in (...)/.logpp/<loggername>
+            virtual void logBatchRecords(const LogBatchEntry* entries, const uint32_t* selected, const size_t count) override { appendBatchToBuffer(entries, selected, count); } ///!< Appends a batch to the buffer at once.
+
+            string getControlFilePath() const { return _sink.getControlFilePath(); } //!< Gets the path to the control file for this logger
+            void initLogContinuation() { _sink.initLogContinuation(); } //!< Initialises the log continuation logic
+            void storeLatestLogFile() { _sink.storeLatestLogFile(); } //!< Stores the latest written log file to a control file in (...)/.logpp/<loggername>
+
+            /**
+             * @brief Appends an emergency record to the current log file; async-signal-safe.
+             */
+            virtual void writeEmergencyRecord(const LogLevel, const LogBuffer* buffered, string_view record) override { _sink.writeEmergency(buffered, record); }
 
         private:
-            string _filename;
-            uint32_t _numLogs = 0;
-            uint32_t _maxFileSize; ///!< max size of log file in MB
-            uint32_t _maxFileCount; ///!< The maximum amount of files logpp is allowed to create before overwriting the files in a loop
+            FileSink _sink; ///!< Rotates the log files; written with the write mutex held
 
-            bool fileExists(const string& filename);
-            uint32_t fileSize(const string& filename);
             virtual void flushBuffer() override; ///!< Flushes the underlying buffer.
-            uint32_t maxFileSizeInMiB() const { return _maxFileSize; } ///!< getter for _maxFileSize
-            void maxFileSize(const uint32_t maxFileSize) { _maxFileSize = maxFileSize; } ///!< setter for _maxFileSize
+            uint32_t maxFileSizeInMiB() const { return _sink.getMaxFileSizeInMiB(); } ///!< getter for the maximum file size
+            void maxFileSize(const uint32_t maxFileSize) { _sink.setMaxFileSizeInMiB(maxFileSize); } ///!< setter for the maximum file size
     };
 
-    /**
-     * @brief Simple struct containing the internal structure of the control file
-     */
-    struct ControlFileContents {
-        uint32_t magicNumber;
-        uint32_t currentWrittenLogFile;
-    } __attribute__((packed));
-
 }
 
 #endif // FILE_LOGGER_HPP
@@ -0,0 +1,116 @@
+/**
+ * FlushScheduler.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_FLUSHSCHEDULER_HPP
+#define LOGPP_FLUSHSCHEDULER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logpp {
+
+    using std::thread;
+    using std::vector;
+
+    /**
+     * @brief Flushes loggers from a timer thread, so no record stays buffered for longer than a maximum staleness.
+     *
+     * Without a scheduler, a logger flushes when its buffer is full, on bad logs or after every write:
+     * a quiet logger may hold a partial buffer forever, while a busy one with a small buffer (or flush-after-write)
+     * makes a syscall every few records.
+     *
+     * A registered logger's buffer size and flush-after-write settings are replaced by a threshold the scheduler adapts
+     * to the logger's observed byte rate: about the amount of bytes logged within the maximum staleness, between
+     * MIN_FLUSH_THRESHOLD and the scheduler's maximum threshold. The timer flushes whatever is older than the staleness target
+     * in the meantime, so each logger makes about one write per staleness period, however many records it logs.
+     * Bad logs are still flushed immediately.
+     *
+     * @code
+     *  logpp::FlushScheduler scheduler(100); // no record waits longer than ~100ms
+     *  scheduler.registerLogger(&fileLogger);
+     * @endcode
+     *
+     * @remarks Registered loggers must outlive the scheduler or be unregistered first.
+     * Loggers which don't buffer through ILogger::logMessage (or FileLogger::logMessage) aren't affected.
+     */
+    class FlushScheduler {
+        public: // +++ Static +++
+            static const uint32_t DEFAULT_MAX_STALENESS_MS; //!< Default staleness target
+            static const uint32_t MIN_FLUSH_THRESHOLD; //!< The smallest adaptive threshold, in bytes
+            static const uint32_t DEFAULT_MAX_FLUSH_THRESHOLD; //!< Default cap for the adaptive threshold, in bytes
+
+        public:
+            FlushScheduler(const uint32_t maxStalenessMs = DEFAULT_MAX_STALENESS_MS,
+                           const uint32_t maxFlushThreshold = DEFAULT_MAX_FLUSH_THRESHOLD); ///!< Object constructor; starts the timer.
+            virtual ~FlushScheduler(); ///!< Virtual destructor; stops the timer and unregisters all loggers.
+
+            FlushScheduler(const FlushScheduler&) = delete;
+            FlushScheduler& operator=(const FlushScheduler&) = delete;
+
+            /**
+             * @brief Gets the maximum time a record may stay buffered, in milliseconds.
+             */
+            uint32_t getMaxStalenessMs() const { return this->_maxStalenessMs; }
+
+            /**
+             * @brief Gets the largest flush threshold the scheduler will set, in bytes.
+             */
+            uint32_t getMaxFlushThreshold() const { return this->_maxFlushThreshold; }
+
+            /**
+             * @brief Gets the amount of flushes made by the timer (as opposed to the loggers reaching their thresholds).
+             */
+            uint64_t getTimerFlushCount() const { return this->_timerFlushes.load(std::memory_order_relaxed); }
+
+            FlushScheduler& registerLogger(ILogger* logger); ///!< Lets the scheduler manage a logger's flushes.
+            FlushScheduler& unregisterLogger(ILogger* logger); ///!< Flushes a logger and restores its own flushing rules.
+
+        private:
+            /**
+             * @brief A registered logger and what the scheduler observed of it.
+             */
+            struct ScheduledLogger {
+                ILogger*    logger;
+                uint64_t    lastByteCount; ///!< The logger's buffered byte count at the previous tick
+                uint64_t    lastTickTime;
+                double      bytesPerSecond; ///!< Smoothed over a few ticks
+                uint64_t    handledBufferedTime; ///!< The oldest-record time the timer last flushed for
+            };
+
+            void tick();
+            void timerLoop();
+
+        private:
+            uint32_t                    _maxStalenessMs;
+            uint32_t                    _maxFlushThreshold;
+
+            std::mutex                  _loggerMutex; ///!< Guards _loggers; held for a whole tick, so unregistered loggers are no longer touched
+            vector<ScheduledLogger>     _loggers;
+
+            std::mutex                  _timerMutex;
+            std::condition_variable     _timerCondition;
+            bool                        _stopping;
+
+            std::atomic<uint64_t>       _timerFlushes;
+
+            thread                      _timerThread;
+    };
+
+}
+
+#endif // LOGPP_FLUSHSCHEDULER_HPP
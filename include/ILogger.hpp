@@ -10,26 +10,68 @@
 /****************************
  *	    Local Includes	    *
  ****************************/
+#include "LogBatch.hpp"
+#include "LogBufferPool.hpp"
+#include "LogClock.hpp"
+#include "LogContext.hpp"
 #include "LogExtensions.hpp"
+#include "LogField.hpp"
+#include "LogFormat.hpp"
+#include "LoggerMetrics.hpp"
 #include "LogLevel.hpp"
+#include "StringView.hpp"
+#include "TextFormatter.hpp"
 
 /***************************
  *	    System Includes    *
  ***************************/
 
+#include <atomic>
+#include <ctime>
 #include <exception>
+#include <iterator>
 #include <mutex>
-#include <sstream>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <fmt/core.h>
+#if !defined(logpp_USE_PRINTF) && FMT_VERSION >= 80000
+    #include <fmt/compile.h>
+#endif
 
 namespace logpp {
 
+    using std::atomic;
     using std::exception;
     using std::mutex;
 	using std::string;
-    using std::stringstream;
+    using std::vector;
+
+    class StackTraceSymboliser;
+
+#if !defined(logpp_USE_PRINTF) && FMT_VERSION >= 80000
+    /**
+     * @brief A format string marked with LOGPP_FMT; holds what FMT_COMPILE made of it.
+     */
+    template<typename S>
+    struct CompileTimeFormat {
+        S format;
+    };
+
+    template<typename S>
+    CompileTimeFormat<S> makeCompileTimeFormat(const S& format) { return CompileTimeFormat<S>{ format }; } ///!< Used by LOGPP_FMT.
+
+    /**
+     * @brief Determines whether S is a format string created by LOGPP_FMT.
+     */
+    template<typename S>
+    struct isCompileTimeFormat: std::false_type { };
+
+    template<typename S>
+    struct isCompileTimeFormat<CompileTimeFormat<S>>: std::true_type { };
+#endif
 
     /**
      * @brief Base abstract logger class.
@@ -62,6 +104,11 @@ namespace logpp {
             static const string LOG_FMT_EXCEPT; ///! ${except} => if an exception was passed, output that
             static const string LOG_FMT_APPNAME; ///! ${appname} => if the application's name was set, output that
             static const string LOG_FMT_CUSTOM; ///! ${custom} => this allows for some custom flare to be added to log outputs
+            static const string LOG_FMT_TS_NS; ///! ${ts_ns} => the record's wall-clock time in nanoseconds since the Unix epoch
+            static const string LOG_FMT_TS_US; ///! ${ts_us} => the record's wall-clock time in microseconds since the Unix epoch
+            static const string LOG_FMT_MONO_NS; ///! ${mono_ns} => the record's monotonic time in nanoseconds
+            static const string LOG_FMT_TID; ///! ${tid} => the kernel thread id of the logging thread
+            static const string LOG_FMT_CTX; ///! ${ctx} => the logging thread's LogContext as key=value pairs; ${ctx:key} outputs a single value
 
 	    public:
             virtual ~ILogger(); ///!< Virtual destructor
@@ -72,49 +119,64 @@ namespace logpp {
              * @return true If the buffer should be flushed after each write.
              * @return false Otherwise.
              */
-            bool flushBufferAfterWrite() const { return this->_flushBufferAfterWrite; }
+            bool flushBufferAfterWrite() const { return this->_flushBufferAfterWrite.load(std::memory_order_relaxed); }
 
             /**
              * @brief Gets the current max log level for this instance.
              */
-            LogLevel getCurrentMaxLogLevel() const { return this->_maxLoggingLevel; }
+            LogLevel getCurrentMaxLogLevel() const { return this->_maxLoggingLevel.load(std::memory_order_relaxed); }
 
             /**
              * @brief Gets the name of the application that was set in this logger instance.
              */
-            string getCurrentApplicationName() const { return this->_appName; }
+            string getCurrentApplicationName() const { return this->_textFormatter.getApplicationName(); }
 
             /**
              * @brief Gets the name of the class using this logger. Only handy if multiple loggers are used.
              */
-            string getCurrentClassName() const { return this->_className; }
+            string getCurrentClassName() const { return this->_textFormatter.getClassName(); }
 
             /**
              * @brief Gets the custom flare set to use when logging.
              */
-            string getCurrentCustomFlare() const { return this->_customFlare; }
+            string getCurrentCustomFlare() const { return this->_textFormatter.getCustomFlare(); }
 
             /**
              * @brief Gets the string used to format log outputs.
              */
-            string getCurrentLoggerFormat() const { return this->_loggerFormat; }
+            string getCurrentLoggerFormat() const { return this->_textFormatter.getFormat().getPattern(); }
 
             /**
              * @brief Gets the name of this logger.
              */
-            string getCurrentLoggerName() const { return this->_logName; }
+            const string& getCurrentLoggerName() const { return this->_logName; }
+
+            /**
+             * @brief Gets how this logger lays out its records.
+             */
+            RecordFormat getRecordFormat() const { return this->_recordFormat; }
+
+            /**
+             * @brief Gets the clock record timestamps are taken from.
+             */
+            shared_ptr<ILogClock> getClock() const { return this->_textFormatter.getClock(); }
+
+            /**
+             * @brief Gets how messages are sanitised in text records.
+             */
+            SanitiseMode getSanitiseMode() const { return this->_textFormatter.getSanitiseMode(); }
 
             /**
              * @brief Gets the current date as per format rules.
              *
-             * @return The current date as defined by _dateFormatString
+             * @return The current date as defined by the date format
              */
             virtual string getCurrentDate() const;
 
             /**
              * @brief Gets the current date as per format rules.
              *
-             * @return The current date as defined by _dateTimeFormatString
+             * @return The current date as defined by the date and time formats
              */
             virtual string getCurrentDateTime() const;
 
@@ -123,12 +185,56 @@ namespace logpp {
              */
             virtual string getOsNewLineChar() const;
 
+            /**
+             * @brief Gets a value indicating whether consecutive duplicate messages are collapsed.
+             */
+            bool collapseDuplicates() const { return this->_collapseDuplicates.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the total amount of messages suppressed as duplicates by this logger.
+             */
+            uint64_t getSuppressedDuplicateCount() const;
+
+            /**
+             * @brief Gets a value indicating whether this logger collects self-metrics.
+             */
+            bool metricsEnabled() const { return this->_metricsEnabled.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets a copy of this logger's self-metrics, summed up over all threads.
+             *
+             * @remarks This may be called from any thread, e.g. by a metrics exporter polling periodically.
+             */
+            LoggerMetricsSnapshot getMetricsSnapshot() const;
+
             /**
              * @brief Gets the size of the string (in bytes) of the underlying buffer.
              *
              * @return The size (in bytes) of the underlying buffer.
              */
-            uint32_t getBufferSize() const { return this->_logBuffer.str().size(); }
+            uint32_t getBufferSize() const { return static_cast<uint32_t>(this->_logBuffer.size()); }
+
+            /**
+             * @brief Gets the buffer size at which a FlushScheduler wants this logger flushed; 0 if no scheduler manages this logger.
+             */
+            uint32_t getScheduledFlushThreshold() const { return this->_scheduledFlushThreshold.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the StackTraceSymboliser which traces this logger's bad logs; nullptr if none.
+             */
+            StackTraceSymboliser* getStackTraceSymboliser() const { return this->_stackTraceSymboliser.load(std::memory_order_acquire); }
+
+            /**
+             * @brief Gets the total amount of bytes appended to the buffer while a FlushScheduler manages this logger.
+             */
+            uint64_t getBufferedByteCount() const { return this->_bufferedBytes.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the time (see LoggerMetrics::now()) at which the oldest buffered record was appended, while a FlushScheduler manages this logger.
+             *
+             * @remarks Only updated when appending to an empty buffer; may refer to a record which has since been flushed.
+             */
+            uint64_t getOldestBufferedTime() const { return this->_oldestBufferedTime.load(std::memory_order_relaxed); }
 
             /**
              * @brief Gets the maximum size for the logger buffer.
@@ -137,12 +243,12 @@ namespace logpp {
              *
              * @return The maximum configured buffer size.
              */
-            uint32_t getMaxBufferSize() const { return this->_maxBufferSize; }
+            uint32_t getMaxBufferSize() const { return this->_maxBufferSize.load(std::memory_order_relaxed); }
 
             /**
              * @brief Gets the current date as per format rules.
              *
-             * @return The current date as defined by _timeFormatString
+             * @return The current date as defined by the time format
              */
             virtual string getCurrentTime() const;
 
@@ -159,6 +265,20 @@ namespace logpp {
              */
             virtual string formatLogMessage(const string& msg, const LogLevel lvl, const string& func = "", const int32_t line = -1, const exception* except = nullptr);
 
+            /**
+             * @brief Formats an entire log message and appends it to the given string.
+             *
+             * This is what the log shortcuts use; passing a reused string means formatting doesn't have to allocate.
+             *
+             * @param out The string to append the formatted message to.
+             * @param msg The log message.
+             * @param lvl The log level for the given message. Used for formatting.
+             * @param func The function which called the logger. Used for formatting.
+             * @param line The line at which the logger was called. Used for formatting.
+             * @param except A pointer to an exception which should be logged.
+             */
+            virtual void formatLogMessageTo(string& out, string_view msg, const LogLevel lvl, string_view func = string_view(), const int32_t line = -1, const exception* except = nullptr);
+
             /**
              * @brief Flushes the internal buffer; abstract.
              */
@@ -169,6 +289,13 @@ namespace logpp {
              */
             virtual void logMessage(const LogLevel level, const string& msg);
 
+            /**
+             * @brief Emits the "last message repeated N times" summary for pending duplicates, if there are any.
+             *
+             * @remarks This is done automatically as soon as a different message is logged, and by the loggers' flushBuffer() and destructors.
+             */
+            void flushDuplicateSummary();
+
             //////////////////////////////
             //      Log Shortcuts       //
             //////////////////////////////
@@ -179,71 +306,247 @@ namespace logpp {
             virtual void ok(const string& msg, const exception* except = nullptr, const int32_t line = -1, const string& func = ""); ///!< A shortcut method for logging ok messages. Abstract.
             virtual void trace(const string& msg, const exception* except = nullptr, const int32_t line = -1, const string& func = ""); ///!< A shortcut method for logging trace messages. Abstract.
             virtual void warning(const string& msg, const exception* except = nullptr, const int32_t line = -1, const string& func = ""); ///!< A shortcut method for logging warning messages. Abstract.
-            
+
+            // These overloads accept literals and string views. They go through the const string& overloads above, so subclasses
+            // overriding those see every message; the message is copied into a per-thread string which keeps its capacity.
+            void debug(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::debug, msg, except, line, func); } ///!< A shortcut method for logging debug messages.
+            void error(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::error, msg, except, line, func); } ///!< A shortcut method for logging error messages.
+            void fatal(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::fatal, msg, except, line, func); } ///!< A shortcut method for logging fatal messages.
+            void info(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::info, msg, except, line, func); } ///!< A shortcut method for logging info messages.
+            void ok(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::ok, msg, except, line, func); } ///!< A shortcut method for logging ok messages.
+            void trace(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::trace, msg, except, line, func); } ///!< A shortcut method for logging trace messages.
+            void warning(const char* msg, const exception* except = nullptr, const int32_t line = -1, const char* func = "") { forwardShortcut(&ILogger::warning, msg, except, line, func); } ///!< A shortcut method for logging warning messages.
+
+            void debug(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::debug, msg, except, line, func); } ///!< A shortcut method for logging debug messages.
+            void error(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::error, msg, except, line, func); } ///!< A shortcut method for logging error messages.
+            void fatal(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::fatal, msg, except, line, func); } ///!< A shortcut method for logging fatal messages.
+            void info(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::info, msg, except, line, func); } ///!< A shortcut method for logging info messages.
+            void ok(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::ok, msg, except, line, func); } ///!< A shortcut method for logging ok messages.
+            void trace(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::trace, msg, except, line, func); } ///!< A shortcut method for logging trace messages.
+            void warning(string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view()) { forwardShortcut(&ILogger::warning, msg, except, line, func); } ///!< A shortcut method for logging warning messages.
+
+            /**
+             * @brief Logs a record from a signal handler (e.g. for SIGSEGV or SIGABRT), where fatal() may deadlock; async-signal-safe.
+             *
+             * The record is formatted on the stack in the default text layout, without allocating or consulting the locale (see EmergencyLog),
+             * and written straight to the logger's output with write(2). Filters, the logger format, fields and metrics are bypassed.
+             *
+             * The records still buffered are written first unless a writer is active (see WriteLock). Otherwise another thread, or the
+             * thread this interrupted, is in the middle of a write, and they're left where they are; a note after the record says so.
+             *
+             * @remarks The write mutex itself is never touched, as locking isn't async-signal-safe; an atomic flag is claimed instead.
+             * The drained buffer's chunks aren't returned to the LogBufferPool.
+             *
+             * @param level The level of the record.
+             * @param message The message; truncated to fit into EmergencyLog::MAX_RECORD_SIZE.
+             */
+            void emergencyLog(const LogLevel level, const char* message);
+
+            //////////////////////////////////////////////////////////////////////////////////
+            // Structured records: logger.info("Request served", kv("user", id), kv("lat_us", x))
+            // Fields keep their types until the record is formatted; with RecordFormat::JsonLines
+            // they become members of the JSON object, otherwise they follow the message as key=value.
+            //////////////////////////////////////////////////////////////////////////////////
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void debug(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Debug, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void error(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Error, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void fatal(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Fatal, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void info(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Info, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void ok(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Ok, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void trace(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Trace, msg, field, fields...); }
+
+            template<typename... Fields, typename std::enable_if<areLogFields<Fields...>::value, int>::type = 0>
+            void warning(string_view msg, const LogField& field, const Fields&... fields) { logFields(LogLevel::Warning, msg, field, fields...); }
+
+            //////////////////////////////////////////////////////////////////////////////////
+            // Batches: for producers which already hold many records (queue drains, replay, bulk imports).
+            // The whole batch is filtered at once, and loggers which buffer their output (console, file)
+            // format it with a single clock read and append it under a single lock.
+            //////////////////////////////////////////////////////////////////////////////////
+            /**
+             * @brief Logs a batch of records, in order.
+             *
+             * Records above the maximum log level are dropped; what's left behaves as if it had been logged one record at a time,
+             * except that every record gets the same timestamp and no other thread's records end up between them.
+             *
+             * @param begin An iterator to the first LogBatchEntry (or anything convertible to one).
+             * @param end An iterator past the last entry.
+             *
+             * @remarks Pointers and vector<LogBatchEntry> iterators are used in place; other iterators are copied into a per-thread vector first.
+             * Other contiguous containers (e.g. std::array) avoid the copy by passing data() and size() to the overload below.
+             */
+            template<typename Iterator>
+            void logBatch(Iterator begin, Iterator end) { logBatch(begin, end, isContiguousBatchIterator<Iterator>()); }
+
+            /**
+             * @brief Logs an array of count records, in order; see above.
+             */
+            void logBatch(const LogBatchEntry* entries, const size_t count) { logBatchEntries(entries, count); }
+
         #if defined(logpp_USE_PRINTF)
             template<typename... Args>
-            void debugFmt(const string& fmt, Args... args) { debug(formatString(fmt, args...)); }
+            void debugFmt(const char* fmt, Args&&... args) { debug(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void errorFmt(const string& fmt, Args... args) { error(formatString(fmt, args...)); }
+            void errorFmt(const char* fmt, Args&&... args) { error(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void fatalFmt(const string& fmt, Args... args) { fatal(formatString(fmt, args...)); }
+            void fatalFmt(const char* fmt, Args&&... args) { fatal(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void infoFmt(const string& fmt, Args... args) { info(formatString(fmt, args...)); }
+            void infoFmt(const char* fmt, Args&&... args) { info(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void okFmt(const string& fmt, Args... args) { ok(formatString(fmt, args...)); }
+            void okFmt(const char* fmt, Args&&... args) { ok(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void traceFmt(const string& fmt, Args... args) { trace(formatString(fmt, args...)); }
+            void traceFmt(const char* fmt, Args&&... args) { trace(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
 
             template<typename... Args>
-            void warningFmt(const string& fmt, Args... args) { warning(formatString(fmt, args...)); }
+            void warningFmt(const char* fmt, Args&&... args) { warning(formatStringTo(getThreadFormatBuffer(), fmt, std::forward<Args>(args)...)); }
+
+            template<typename... Args>
+            void debugFmt(const string& fmt, Args&&... args) { debugFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void errorFmt(const string& fmt, Args&&... args) { errorFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void fatalFmt(const string& fmt, Args&&... args) { fatalFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void infoFmt(const string& fmt, Args&&... args) { infoFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void okFmt(const string& fmt, Args&&... args) { okFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void traceFmt(const string& fmt, Args&&... args) { traceFmt(fmt.c_str(), std::forward<Args>(args)...); }
+
+            template<typename... Args>
+            void warningFmt(const string& fmt, Args&&... args) { warningFmt(fmt.c_str(), std::forward<Args>(args)...); }
         #else
             template<typename... Args>
-            void debugFmt(const string& fmt, Args... args) { debug(fmt::format(fmt, args...)); }
+            void debugFmt(string_view fmt, Args&&... args) { debug(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void errorFmt(const string& fmt, Args... args) { error(fmt::format(fmt, args...)); }
+            void errorFmt(string_view fmt, Args&&... args) { error(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void fatalFmt(const string& fmt, Args... args) { fatal(fmt::format(fmt, args...)); }
+            void fatalFmt(string_view fmt, Args&&... args) { fatal(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void infoFmt(const string& fmt, Args... args) { info(fmt::format(fmt, args...)); }
+            void infoFmt(string_view fmt, Args&&... args) { info(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void okFmt(const string& fmt, Args... args) { ok(fmt::format(fmt, args...)); }
+            void okFmt(string_view fmt, Args&&... args) { ok(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void traceFmt(const string& fmt, Args... args) { trace(fmt::format(fmt, args...)); }
+            void traceFmt(string_view fmt, Args&&... args) { trace(fmtFormatTo(fmt, args...)); }
 
             template<typename... Args>
-            void warningFmt(const string& fmt, Args... args) { warning(fmt::format(fmt, args...)); }
+            void warningFmt(string_view fmt, Args&&... args) { warning(fmtFormatTo(fmt, args...)); }
+
+        #if FMT_VERSION >= 80000
+            //////////////////////////////////////////////////////////////////////////////////
+            // Compile-time format strings: logger.infoFmt(LOGPP_FMT("{} took {}ms"), a, b)
+            // The format string is checked at compile time; with C++17, FMT_COMPILE also
+            // turns it into formatting code, so nothing is parsed at runtime.
+            //////////////////////////////////////////////////////////////////////////////////
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void debugFmt(const S& fmt, Args&&... args) { debug(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void errorFmt(const S& fmt, Args&&... args) { error(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void fatalFmt(const S& fmt, Args&&... args) { fatal(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void infoFmt(const S& fmt, Args&&... args) { info(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void okFmt(const S& fmt, Args&&... args) { ok(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void traceFmt(const S& fmt, Args&&... args) { trace(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            void warningFmt(const S& fmt, Args&&... args) { warning(fmtFormatTo(fmt, std::forward<Args>(args)...)); }
+        #endif // FMT_VERSION >= 80000
         #endif // logpp_USE_PRINTF
 
 
+            /**
+             * @brief Sets a value indicating whether consecutive duplicate messages should be collapsed.
+             *
+             * When enabled, a message (and level) identical to the previous one is not logged, but only counted.
+             * As soon as a different message is logged, or the logger is flushed, a "last message repeated N times" summary is emitted.
+             * Repeats of messages up to 256 bytes are counted without taking a lock.
+             *
+             * @param collapse A value indicating whether to collapse duplicates.
+             */
+            void setCollapseDuplicates(bool collapse) { this->_collapseDuplicates.store(collapse, std::memory_order_relaxed); }
+
+            /**
+             * @brief Sets a value indicating whether this logger collects self-metrics (see getMetricsSnapshot).
+             *
+             * @remarks Metrics are off by default. When on, each record costs two clock reads and a few uncontended counter updates.
+             *
+             * @param enabled A value indicating whether to collect metrics.
+             */
+            void setMetricsEnabled(bool enabled) { this->_metricsEnabled.store(enabled, std::memory_order_relaxed); }
+
             /**
              * @brief Sets the application name for this logger instance.
              */
-            void setCurrentApplicationName(const string& appName) { this->_appName = appName; }
+            void setCurrentApplicationName(const string& appName) { this->_textFormatter.setApplicationName(appName); }
 
             /**
              * @brief Sets the name of the class using this instance.
              */
-            void setCurrentClassName(const string& _className) { this->_className = _className; }
+            void setCurrentClassName(const string& className) { this->_textFormatter.setClassName(className); }
 
             /**
              * @brief Sets the custom flare to use with this instance.
              */
-            void setCurrentCustomFlare(const string& _customFlare) { this->_customFlare = _customFlare; }
+            void setCurrentCustomFlare(const string& customFlare) { this->_textFormatter.setCustomFlare(customFlare); }
 
             /**
              * @brief Sets the custom logger format. Default is default
              */
-            void setCurrentLoggerFormat(const string& loggerFormat = "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}") { this->_loggerFormat = loggerFormat; }
+            void setCurrentLoggerFormat(const string& loggerFormat = "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}") { this->_textFormatter.setFormat(loggerFormat); }
+
+            /**
+             * @brief Sets how this logger lays out its records: as text using the logger format, or as JSON lines.
+             *
+             * @remarks Like the logger format, set this before logging from multiple threads.
+             */
+            void setRecordFormat(const RecordFormat recordFormat) { this->_recordFormat = recordFormat; }
+
+            /**
+             * @brief Sets the clock record timestamps are taken from; nullptr restores the default SystemClock.
+             *
+             * @remarks Like the logger format, set the clock before logging from multiple threads.
+             */
+            void setClock(shared_ptr<ILogClock> clock) { this->_textFormatter.setClock(std::move(clock)); }
+
+            /**
+             * @brief Sets how messages are sanitised in text records (JSON lines are escaped regardless). The default is SanitiseMode::Escape.
+             *
+             * @remarks Like the logger format, set this before logging from multiple threads.
+             */
+            void setSanitiseMode(const SanitiseMode mode) { this->_textFormatter.setSanitiseMode(mode); }
 
             /**
              * @brief Sets the custom name for this logger. If default, generates random ID.
@@ -252,8 +555,10 @@ namespace logpp {
 
             /**
              * @brief Sets the current maximum log level.
+             *
+             * @remarks This may be called while other threads are logging; the new level is picked up by the next log call.
              */
-            void setCurrentMaxLogLevel(const LogLevel level = LogLevel::Error) { this->_maxLoggingLevel = level; }
+            void setCurrentMaxLogLevel(const LogLevel level = LogLevel::Error) { this->_maxLoggingLevel.store(level, std::memory_order_relaxed); }
 
             /**
              * @brief Sets a value indicating whether to flush the underlying buffer after each write.
@@ -262,7 +567,7 @@ namespace logpp {
              *
              * @param flushAfterWrite A value indicating whether to flush the buffer after each write.
              */
-            void setFlushAfterWrite(bool flushAfterWrite) { this->_flushBufferAfterWrite = flushAfterWrite; }
+            void setFlushAfterWrite(bool flushAfterWrite) { this->_flushBufferAfterWrite.store(flushAfterWrite, std::memory_order_relaxed); }
 
             /**
              * @brief Sets the maximum size (in bytes) of the underlying buffer.
@@ -271,53 +576,307 @@ namespace logpp {
              *
              * @param maxSize The maximum buffer size in bytes.
              */
-            void setMaxBufferSize(const uint32_t maxSize) { this->_maxBufferSize = maxSize; }
+            void setMaxBufferSize(const uint32_t maxSize) { this->_maxBufferSize.store(maxSize, std::memory_order_relaxed); }
+
+            /**
+             * @brief Sets the buffer size at which the buffer is flushed; used by FlushScheduler.
+             *
+             * While this is non-zero, it replaces the maximum buffer size and flush-after-write: the buffer is flushed when it reaches
+             * the threshold, on bad logs and by the scheduler's timer. Setting it to 0 restores the configured behaviour.
+             *
+             * @param threshold The flush threshold in bytes, or 0.
+             */
+            void setScheduledFlushThreshold(const uint32_t threshold) { this->_scheduledFlushThreshold.store(threshold, std::memory_order_relaxed); }
+
+            /**
+             * @brief Sets the StackTraceSymboliser which traces this logger's bad logs and records with exceptions; used by StackTraceSymboliser::registerLogger().
+             *
+             * @param symboliser The symboliser, or nullptr to stop capturing traces.
+             *
+             * @remarks To stop capturing traces before the symboliser is destroyed, use detachStackTraceSymboliser() instead.
+             */
+            void setStackTraceSymboliser(StackTraceSymboliser* symboliser) { this->_stackTraceSymboliser.store(symboliser); }
+
+            /**
+             * @brief Stops capturing traces and waits for the threads still capturing one through the previous symboliser;
+             *        used by StackTraceSymboliser before it's unregistered or destroyed.
+             */
+            void detachStackTraceSymboliser();
 
 	    protected:
 	        ILogger(const string& logName, LogLevel maxLevel, uint32_t bufferSize, bool flushBufferAfterWrite); ///!< Base constructor.
 
             /**
-             * @brief Gets a reference to the string stream used as a buffer.
+             * @brief Filters, formats and logs a message. All log shortcuts end up here.
              *
-             * @return A reference to the back-end string stream used as a buffer.
+             * @param level The log level of the message.
+             * @param msg The pure message.
+             * @param except (Optional) The exception thrown.
+             * @param line (Optional) The line at which the logger was called.
+             * @param func (Optional) The function/method in which the logger was called.
+             * @param fields (Optional) The record's structured fields.
+             * @param fieldCount (Optional) The amount of fields.
+             */
+            void formatAndLog(const LogLevel level, string_view msg, const exception* except = nullptr, const int32_t line = -1, string_view func = string_view(),
+                              const LogField* fields = nullptr, const size_t fieldCount = 0);
+
+            /**
+             * @brief Logs a structured record.
              */
-            stringstream& getLogBuffer() { return this->_logBuffer; }
+            template<typename... Fields>
+            void logFields(const LogLevel level, string_view msg, const Fields&... fields) {
+                const LogField fieldArray[] = { fields... };
+                formatAndLog(level, msg, nullptr, -1, string_view(), fieldArray, sizeof...(Fields));
+            }
+
+            /**
+             * @brief Gets a reference to the buffer.
+             *
+             * @remarks Clear the buffer with clear() after flushing; this returns its chunks to the LogBufferPool.
+             *
+             * @return A reference to the buffer; write it with forEachChunk().
+             */
+            LogBuffer& getLogBuffer() { return this->_logBuffer; }
+
+            /**
+             * @brief Does the bookkeeping after a record was appended to the buffer and decides whether to flush. Call with the write mutex held.
+             *
+             * @param level The level of the record.
+             * @param previousSize The buffer's size before the record was appended.
+             *
+             * @return true If the buffer has to be flushed now.
+             */
+            bool onBufferAppended(const LogLevel level, const uint32_t previousSize);
 
 			/**
-			 * @brief Gets the string representation of the underlying buffer.
+			 * @brief Gets a copy of the underlying buffer.
 			 *
 			 * @return The string from the underlying buffer.
 			 */
-			string getLogBufferAsString() { return getLogBuffer().str(); }
+			string getLogBufferAsString() { return getLogBuffer().toString(); }
+
+            /**
+             * @brief Appends a formatted record to the buffer within the LogBufferPool's budget and flushes the buffer accordingly.
+             *
+             * @remarks Takes the write mutex; loggers writing to the buffer from logMessage() call this.
+             */
+            void bufferRecord(const LogLevel level, string_view record);
+
+            /**
+             * @brief Writes an emergency record, after the buffered records if there are any, straight to the output; see emergencyLog().
+             *
+             * @remarks Runs in signal handlers, so it must be async-signal-safe: write(2), not streams. The default writes to stderr;
+             * loggers with other outputs override this.
+             *
+             * @param level The level of the record.
+             * @param buffered The buffered records to write first; nullptr if they couldn't be had.
+             * @param record The formatted record, including its line feed.
+             */
+            virtual void writeEmergencyRecord(const LogLevel level, const LogBuffer* buffered, string_view record);
+
+            /**
+             * @brief Has another logger write an emergency record, e.g. a backend or a copy to a file; async-signal-safe.
+             *
+             * @param drainBuffer Writes the other logger's buffered records first and empties its buffer; only with the writer flag claimed.
+             */
+            static void forwardEmergencyRecord(ILogger& logger, const LogLevel level, const bool drainBuffer, string_view record);
+
+            /**
+             * @brief Formats a record which passed the level filter and hands it to logMessage().
+             *
+             * @remarks Override this for outputs which keep a record's parts apart (e.g. journald fields) instead of a line of text.
+             */
+            virtual void logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                                   const LogField* fields, const size_t fieldCount);
+
+            /**
+             * @brief Logs the records of a batch which passed the level filter; by default, each one goes through logRecord().
+             *
+             * @remarks Override this for outputs which can take a whole batch at once; appendBatchToBuffer() does so for the log buffer.
+             *
+             * @param entries The batch.
+             * @param selected The indices of the entries to log, in order.
+             * @param count The amount of indices.
+             */
+            virtual void logBatchRecords(const LogBatchEntry* entries, const uint32_t* selected, const size_t count);
+
+            /**
+             * @brief Formats records of a batch with a single clock read and appends them to the log buffer under a single lock.
+             *
+             * @remarks This bypasses logMessage(), but not the formatting overrides (formatLogMessageTo(), appendLogLevel()).
+             */
+            void appendBatchToBuffer(const LogBatchEntry* entries, const uint32_t* selected, const size_t count);
+
+            /**
+             * @brief Appends the string representation of a log level to a formatted message.
+             *
+             * @remarks Override this to decorate log levels, e.g. with colours.
+             *
+             * @param out The string to append to.
+             * @param lvl The log level to append.
+             */
+            virtual void appendLogLevel(string& out, const LogLevel lvl) const;
+
+            /**
+             * @brief Gets a per-thread string for formatting messages passed to the *Fmt shortcuts.
+             *
+             * @remarks The string keeps its capacity between calls, so formatting doesn't allocate in the steady state.
+             */
+            static string& getThreadFormatBuffer();
+
+        #if !defined(logpp_USE_PRINTF)
+            /**
+             * @brief Formats into the per-thread format buffer using fmt.
+             *
+             * @return A reference to the formatted string.
+             */
+            template<typename... Args>
+            static const string& fmtFormatTo(string_view fmt, const Args&... args) {
+                auto& buffer = getThreadFormatBuffer();
+                buffer.clear();
+                fmt::vformat_to(std::back_inserter(buffer), fmt::string_view(fmt.data(), fmt.size()), fmt::make_format_args(args...));
+
+                return buffer;
+            }
+
+        #if FMT_VERSION >= 80000
+            /**
+             * @brief Formats into the per-thread format buffer using a format string checked at compile time.
+             *
+             * @return A reference to the formatted string.
+             */
+            template<typename S, typename... Args, typename std::enable_if<isCompileTimeFormat<S>::value, int>::type = 0>
+            static const string& fmtFormatTo(const S& fmt, Args&&... args) {
+                auto& buffer = getThreadFormatBuffer();
+                buffer.clear();
+                fmt::format_to(std::back_inserter(buffer), fmt.format, std::forward<Args>(args)...);
+
+                return buffer;
+            }
+        #endif // FMT_VERSION >= 80000
+        #endif // !logpp_USE_PRINTF
+
+            /**
+             * @brief Gets the metrics collected by this logger; loggers with their own outputs record flushes and writes here.
+             */
+            LoggerMetrics& getMetrics() { return this->_metrics; }
 
             /**
              * @brief Get the Write Mutex object
              * 
+             * @remarks Lock it through a WriteLock, so emergencyLog() can tell a writer is active.
+             *
              * @return mutex& A reference to the mutex object.
              */
             mutex& getWriteMutex() { return *_writeMutex; }
 
+            /**
+             * @brief Holds the write mutex and marks a writer as active, for emergencyLog(), which mustn't touch the mutex.
+             */
+            class WriteLock {
+                public:
+                    WriteLock(); ///!< Locks the write mutex, then claims the writer flag; waits while an emergency record is written.
+                    ~WriteLock(); ///!< Releases the writer flag, then the write mutex.
+
+                    WriteLock(const WriteLock&) = delete;
+                    WriteLock& operator=(const WriteLock&) = delete;
+
+                private:
+                    std::lock_guard<mutex> _lock;
+            };
+
+	    private:
+            using Shortcut = void (ILogger::*)(const string& msg, const exception* except, const int32_t line, const string& func);
+
+            void forwardShortcut(Shortcut shortcut, string_view msg, const exception* except, const int32_t line, string_view func);
+
+            bool isRepeatedMessage(const LogLevel level, string_view msg);
+            void logDuplicateSummary(const LogLevel level, const uint64_t repeats);
+
+            void logTraceableRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line,
+                                    string_view func, const LogField* fields, const size_t fieldCount);
+
+            void logBatchEntries(const LogBatchEntry* entries, const size_t count);
+
+            /**
+             * @brief Determines whether a batch can be logged straight from the memory Iterator points to.
+             */
+            template<typename Iterator>
+            struct isContiguousBatchIterator: std::integral_constant<bool, std::is_convertible<Iterator, const LogBatchEntry*>::value ||
+                                                                           std::is_same<Iterator, vector<LogBatchEntry>::iterator>::value ||
+                                                                           std::is_same<Iterator, vector<LogBatchEntry>::const_iterator>::value> { };
+
+            template<typename Iterator>
+            void logBatch(Iterator begin, Iterator end, std::true_type) {
+                if (begin == end) return;
+
+                const LogBatchEntry* first = &*begin;
+                logBatchEntries(first, static_cast<size_t>(end - begin));
+            }
+
+            template<typename Iterator>
+            void logBatch(Iterator begin, Iterator end, std::false_type) {
+                // Taken out of the arena, so a batch logged from within logBatchRecords() can't clobber it.
+                vector<LogBatchEntry> entries;
+                entries.swap(getThreadBatchEntries());
+                entries.clear();
+                for (; begin != end; ++begin) { entries.push_back(*begin); }
+
+                logBatchEntries(entries.data(), entries.size());
+                entries.swap(getThreadBatchEntries());
+            }
+
+            static vector<LogBatchEntry>& getThreadBatchEntries(); ///!< Per-thread copy of batches passed as anything but an array
+
+            void formatRecordTo(string& out, string_view msg, const LogLevel level, string_view func, const int32_t line, const exception* except,
+                                const LogField* fields, const size_t fieldCount);
+
 	    private:
             static mutex* _writeMutex; ///!< Lock me before writing!
+            static atomic<bool> _writerActive; ///!< Claimed by WriteLock and by emergencyLog(), which can't lock the mutex
 
-            string          _appName;
-            string          _className;
-            string          _customFlare;
-            string          _loggerFormat;
+            TextFormatter   _textFormatter; ///!< The logger format, its variables' values and the clock
+            RecordFormat    _recordFormat;
 			string          _logName;
 
-			LogLevel        _maxLoggingLevel;
-
-            string          _dateFormatString;
-            string          _dateTimeFormatString;
-            string          _timeFormatString;
+			atomic<LogLevel> _maxLoggingLevel; ///!< Atomic so the level may be changed at runtime (see LogConfigWatcher)
 
             // Logger buffer
-            bool            _flushBufferAfterWrite;
-            stringstream    _logBuffer;
-            uint32_t        _maxBufferSize;
+            atomic<bool>    _flushBufferAfterWrite;
+            LogBuffer       _logBuffer; ///!< Chunks from the LogBufferPool; empty buffers hold none
+            atomic<uint32_t> _maxBufferSize;
+            atomic<uint32_t> _scheduledFlushThreshold; ///!< Set by a FlushScheduler; 0 if none manages this logger
+            atomic<uint64_t> _bufferedBytes; ///!< Only written with the write mutex held
+            atomic<uint64_t> _oldestBufferedTime;
+
+            atomic<StackTraceSymboliser*> _stackTraceSymboliser; ///!< Set while a StackTraceSymboliser traces this logger
+            atomic<uint32_t> _traceCaptureEpoch; ///!< Selects the counter in _activeTraceCaptures new captures use; flipped by detachStackTraceSymboliser()
+            atomic<uint32_t> _activeTraceCaptures[2]; ///!< Threads which may be using _stackTraceSymboliser, per epoch
+
+            // Duplicate suppression
+            static const uint32_t LAST_MESSAGE_WORDS = 32; ///!< Messages up to 256 bytes are compared without the lock
+
+            atomic<bool>     _collapseDuplicates;
+            mutex            _lastMessageMutex; ///!< Serialises changes of the last message
+            string           _lastMessage; ///!< Compared under the lock, for messages which don't fit into _lastMessageWords
+            LogLevel         _lastMessageLevel;
+            atomic<uint64_t> _lastMessageKey; ///!< The last message's length and level
+            atomic<uint64_t> _lastMessageWords[LAST_MESSAGE_WORDS]; ///!< The last message, zero-padded, if it fits
+            atomic<uint64_t> _repeatState; ///!< The last message's generation, a flag set while it changes, and the duplicates since the last summary
+            atomic<uint64_t> _suppressedDuplicates; ///!< Duplicates already reported in a summary
+
+            // Self-metrics
+            atomic<bool>     _metricsEnabled;
+            LoggerMetrics    _metrics;
     };
 
 }
 
+#if !defined(logpp_USE_PRINTF) && FMT_VERSION >= 80000
+    /**
+     * @brief Marks a format string for compile-time checking (and, with C++17, compilation) in the *Fmt shortcuts.
+     */
+    #define LOGPP_FMT(fmtString) logpp::makeCompileTimeFormat(FMT_COMPILE(fmtString))
+#endif
+
 #endif // LIBLOGPP_ILOGGER_HPP
@@ -0,0 +1,53 @@
+/**
+ * JournalLogger.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_JOURNALLOGGER_HPP
+#define LOGPP_JOURNALLOGGER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+#include "UnixDatagramSink.hpp"
+
+namespace logpp {
+
+    /**
+     * @brief A logger which sends its records straight to systemd-journald, instead of through stdout.
+     *
+     * Records keep their severity (PRIORITY), code location (CODE_FUNC, CODE_LINE) and structured fields as journal fields.
+     * The logger format defaults to "${lmsg}", since the journal timestamps records and knows their levels.
+     * Sending never blocks; see UnixDatagramSink for what happens under load.
+     *
+     * @code
+     *  auto logger = std::make_shared<logpp::JournalLogger>("http", LogLevel::Info, "my-service");
+     *  logger->warning("Slow request", kv("path", path), kv("duration_ms", ms)); // PATH=..., DURATION_MS=...
+     * @endcode
+     */
+    class JournalLogger: public ILogger {
+        public:
+            JournalLogger(const string& logName, const LogLevel maxLogLevel, const string& identifier = "",
+                          const string& socketPath = JournalSink::DEFAULT_SOCKET_PATH); ///!< Object constructor.
+            virtual ~JournalLogger() { flushDuplicateSummary(); } ///!< Virtual destructor; sends a pending duplicate summary.
+
+            virtual void flushBuffer() override { flushDuplicateSummary(); _sink.flush(); } ///!< Sends the records still waiting for the socket, as far as it takes them.
+            virtual void logMessage(const LogLevel level, const string& msg) override; ///!< Sends an already formatted record.
+
+            const string& getIdentifier() const { return this->_identifier; } ///!< Gets the SYSLOG_IDENTIFIER records are sent with.
+            JournalSink& getSink() { return this->_sink; } ///!< Gets the socket records are sent through.
+
+        protected:
+            virtual void logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                                   const LogField* fields, const size_t fieldCount) override;
+
+        private:
+            JournalSink _sink; ///!< Thread-safe on its own
+            string      _identifier;
+    };
+
+}
+
+#endif // LOGPP_JOURNALLOGGER_HPP
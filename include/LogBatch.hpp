@@ -0,0 +1,67 @@
+/**
+ * LogBatch.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGBATCH_HPP
+#define LOGPP_LOGBATCH_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogField.hpp"
+#include "LogLevel.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+namespace logpp {
+
+    using std::exception;
+
+    /**
+     * @brief A record submitted with ILogger::logBatch(): its level, message and metadata.
+     *
+     * @remarks Like LogField, an entry references its strings and fields; they must outlive the logBatch() call.
+     */
+    struct LogBatchEntry {
+        LogLevel            level;
+        string_view         message;
+        const LogField*     fields; ///!< May be nullptr if fieldCount is 0
+        size_t              fieldCount;
+        string_view         func; ///!< The function the record was logged from; may be empty
+        int32_t             line; ///!< The line the record was logged from; left out if negative
+        const exception*    except; ///!< May be nullptr
+
+        LogBatchEntry(): LogBatchEntry(LogLevel::Info, string_view()) { } ///!< Object constructor; an empty info record.
+
+        /**
+         * @brief Object constructor.
+         */
+        LogBatchEntry(const LogLevel level, string_view message, const LogField* fields = nullptr, const size_t fieldCount = 0,
+                      string_view func = string_view(), const int32_t line = -1, const exception* except = nullptr):
+        level(level), message(message), fields(fields), fieldCount(fieldCount), func(func), line(line), except(except) { }
+    };
+
+    /**
+     * @brief Selects the entries to log: writes the indices of the entries at or below maxLevel to selected, in order.
+     *
+     * The levels are compared 16 at a time with SSE2 where available.
+     *
+     * @param selected Receives the indices; must have room for count of them.
+     *
+     * @return size_t The amount of entries selected.
+     */
+    size_t selectLogBatchEntries(const LogBatchEntry* entries, const size_t count, const LogLevel maxLevel, uint32_t* selected);
+
+    const char* getLogBatchFilterImplementation(); ///!< Gets the level filter implementation in use: "sse2" or "scalar".
+
+}
+
+#endif // LOGPP_LOGBATCH_HPP
@@ -0,0 +1,184 @@
+/**
+ * LogBufferPool.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGBUFFERPOOL_HPP
+#define LOGPP_LOGBUFFERPOOL_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace logpp {
+
+    using std::string;
+
+    /**
+     * @brief A fixed-size piece of a log buffer; chunks are chained to hold a logger's buffered records.
+     */
+    struct LogBufferChunk {
+        static const uint32_t CAPACITY = 4096 - 2 * sizeof(void*); ///!< So a chunk takes up a page
+
+        LogBufferChunk* next;
+        size_t          size; ///!< The bytes used
+        char            data[CAPACITY];
+    };
+
+    /**
+     * @brief The occupancy of the LogBufferPool.
+     */
+    struct LogBufferPoolStats {
+        uint64_t    budgetBytes; ///!< The most bytes of chunks the pool hands out, unless it's overdrawn; 0 means unlimited
+        uint32_t    chunkSize; ///!< The bytes of records a chunk holds
+
+        uint64_t    leasedChunks; ///!< Chunks holding buffered records
+        uint64_t    freeChunks; ///!< Chunks kept for reuse; they count against the budget
+        uint64_t    peakLeasedChunks;
+
+        uint64_t    exhaustedAppends; ///!< Records which didn't fit into the budget; their loggers were flushed early
+        uint64_t    overdrawnChunks; ///!< Chunks handed out beyond the budget, for records written straight through
+
+        /**
+         * @brief Gets the share of the budget holding buffered records, between 0 and 1 (or above, while overdrawn); 0 if unlimited.
+         */
+        double getOccupancy() const { return budgetBytes == 0 ? 0 : static_cast<double>(leasedChunks) * sizeof(LogBufferChunk) / budgetBytes; }
+    };
+
+    /**
+     * @brief The process-wide pool of chunks which all loggers' buffers draw from, within a global byte budget.
+     *
+     * Buffers only hold chunks while they hold records: flushing returns them to the pool, where other loggers reuse them.
+     * So memory grows with the records buffered at once, not with the amount of loggers and their buffer sizes.
+     *
+     * Free chunks are kept for reuse and count against the budget; trim() releases them.
+     * Like the AllocationTracker, the pool lives in static storage and is never destroyed, so loggers may outlive main().
+     */
+    class LogBufferPool {
+        public: // +++ Static +++
+            static const uint64_t DEFAULT_BUDGET = 64ull << 20; ///!< 64 MiB
+
+            static LogBufferPool& getInstance(); ///!< Gets the pool shared by all loggers.
+
+        public:
+            LogBufferPool(const LogBufferPool&) = delete;
+            LogBufferPool& operator=(const LogBufferPool&) = delete;
+
+            /**
+             * @brief Takes chunks out of the pool, allocating them if there are no free ones.
+             *
+             * @param count The amount of chunks.
+             * @param overdraw Hands them out even if that exceeds the budget.
+             *
+             * @return LogBufferChunk* A chain of count empty chunks, or nullptr if they'd exceed the budget.
+             */
+            LogBufferChunk* acquire(const size_t count, const bool overdraw = false);
+
+            void release(LogBufferChunk* chunks); ///!< Returns a chain of chunks to the pool.
+
+            /**
+             * @brief Sets the most bytes of chunks the pool hands out; free chunks beyond a lowered budget are released.
+             *
+             * @param budgetBytes The budget in bytes, or 0 for no limit; it allows for whole chunks, and at least one.
+             */
+            void setBudget(const uint64_t budgetBytes);
+            uint64_t getBudget() const { return _budgetBytes.load(std::memory_order_relaxed); } ///!< Gets the budget in bytes; 0 means unlimited.
+
+            void trim(); ///!< Releases the free chunks to the system.
+
+            LogBufferPoolStats getStats() const; ///!< Gets the pool's occupancy; may be called from any thread.
+
+        private:
+            LogBufferPool();
+
+            void releaseFreeChunks(const uint64_t keepChunks); ///!< Call with _poolMutex held.
+
+        private:
+            mutable std::mutex      _poolMutex;
+            LogBufferChunk*         _freeChunks; ///!< A chain of the free chunks
+            uint64_t                _freeChunkCount;
+            uint64_t                _leasedChunkCount;
+            uint64_t                _peakLeasedChunkCount;
+            uint64_t                _exhaustedAppends;
+            uint64_t                _overdrawnChunks;
+
+            std::atomic<uint64_t>   _budgetBytes;
+    };
+
+    /**
+     * @brief A logger's buffer: a chain of chunks from the LogBufferPool.
+     *
+     * Records may span chunks; sinks write the chunks one after the other (see forEachChunk()).
+     *
+     * @remarks Not thread-safe; loggers guard their buffer with their write mutex.
+     */
+    class LogBuffer {
+        public:
+            LogBuffer(): _firstChunk(nullptr), _lastChunk(nullptr), _size(0) { } ///!< Object constructor; an empty buffer holds no chunks.
+            ~LogBuffer() { clear(); } ///!< Object destructor; returns the chunks to the pool.
+
+            LogBuffer(const LogBuffer&) = delete;
+            LogBuffer& operator=(const LogBuffer&) = delete;
+
+            /**
+             * @brief Appends a record and its line ending, if the pool's budget allows for the chunks needed.
+             *
+             * @return false If the budget is exhausted; nothing was appended then.
+             */
+            bool append(string_view record, string_view lineEnding = string_view()) { return appendRecord(record, lineEnding, false); }
+
+            /**
+             * @brief Appends a record and its line ending even if that exceeds the pool's budget; flush the buffer right after.
+             */
+            void appendOverdrawn(string_view record, string_view lineEnding = string_view()) { appendRecord(record, lineEnding, true); }
+
+            void clear(); ///!< Returns the chunks to the pool.
+
+            /**
+             * @brief Empties the buffer without returning its chunks to the pool, as that takes the pool's lock; async-signal-safe.
+             *
+             * @remarks For emergencies only: the chunks are leaked, and stay counted against the budget.
+             */
+            void abandon() {
+                _firstChunk = nullptr;
+                _lastChunk = nullptr;
+                _size = 0;
+            }
+
+            size_t size() const { return this->_size; } ///!< Gets the amount of bytes buffered.
+            bool empty() const { return this->_size == 0; } ///!< Gets a value indicating whether the buffer is empty.
+
+            /**
+             * @brief Calls function with each chunk's contents, in order.
+             */
+            template<typename Function>
+            void forEachChunk(Function function) const {
+                for (auto chunk = _firstChunk; chunk != nullptr; chunk = chunk->next) { function(string_view(chunk->data, chunk->size)); }
+            }
+
+            string toString() const; ///!< Gets a copy of the buffered records.
+
+        private:
+            bool appendRecord(string_view record, string_view lineEnding, const bool overdraw);
+            void copyToChunks(string_view data);
+
+        private:
+            LogBufferChunk* _firstChunk;
+            LogBufferChunk* _lastChunk;
+            size_t          _size;
+    };
+
+}
+
+#endif // LOGPP_LOGBUFFERPOOL_HPP
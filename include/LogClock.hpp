@@ -0,0 +1,100 @@
+/**
+ * LogClock.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGCLOCK_HPP
+#define LOGPP_LOGCLOCK_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace logpp {
+
+    using std::atomic;
+    using std::shared_ptr;
+
+    /**
+     * @brief The time of a log record, taken once per record.
+     */
+    struct LogTimestamp {
+        int64_t     realtimeNanoseconds; ///!< Nanoseconds since the Unix epoch; ${ts_ns}, ${ts_us}, ${date} and ${time}
+        int64_t     monotonicNanoseconds; ///!< Nanoseconds on CLOCK_MONOTONIC (steady_clock); ${mono_ns}
+    };
+
+    /**
+     * @brief Base class for the clocks loggers take their record timestamps from.
+     *
+     * Implementations must be thread-safe; now() is called once per formatted record.
+     */
+    class ILogClock {
+        public:
+            virtual ~ILogClock() = default;
+
+            virtual LogTimestamp now() const = 0; ///!< Gets the current time.
+    };
+
+    /**
+     * @brief Reads CLOCK_REALTIME and CLOCK_MONOTONIC. Nanosecond resolution; the default.
+     */
+    class SystemClock: public ILogClock {
+        public:
+            virtual LogTimestamp now() const override;
+    };
+
+    /**
+     * @brief Reads CLOCK_REALTIME_COARSE and CLOCK_MONOTONIC_COARSE: the time of the last timer tick.
+     *
+     * The cheapest clock the kernel offers, but only as precise as the tick rate (typically 1-4 ms).
+     */
+    class CoarseRealtimeClock: public ILogClock {
+        public:
+            virtual LogTimestamp now() const override;
+    };
+
+    /**
+     * @brief Reads the TSC (see TscClock) and derives both times from it; a single instruction per record.
+     *
+     * The offset between the TSC and CLOCK_REALTIME is measured at construction. As the TSC isn't adjusted
+     * by NTP, the wall-clock times may drift from the system clock over time; call resynchronise() periodically
+     * (e.g. once a minute) to correct that.
+     */
+    class TscRealtimeClock: public ILogClock {
+        public:
+            TscRealtimeClock(); ///!< Object constructor.
+
+            virtual LogTimestamp now() const override;
+
+            void resynchronise(); ///!< Measures the offset between the TSC and CLOCK_REALTIME again.
+
+        private:
+            atomic<int64_t> _realtimeOffset; ///!< CLOCK_REALTIME - CLOCK_MONOTONIC, in nanoseconds
+    };
+
+    /**
+     * @brief A clock that only changes when told to; for tests and reproducible output.
+     */
+    class FrozenClock: public ILogClock {
+        public:
+            explicit FrozenClock(const int64_t realtimeNanoseconds = 0, const int64_t monotonicNanoseconds = 0); ///!< Object constructor.
+
+            virtual LogTimestamp now() const override;
+
+            void set(const int64_t realtimeNanoseconds, const int64_t monotonicNanoseconds); ///!< Sets both times.
+            void advance(const int64_t nanoseconds); ///!< Moves both times forward.
+
+        private:
+            atomic<int64_t> _realtimeNanoseconds;
+            atomic<int64_t> _monotonicNanoseconds;
+    };
+
+    shared_ptr<ILogClock> getDefaultLogClock(); ///!< Gets the process-wide SystemClock used by loggers without a clock of their own.
+
+}
+
+#endif // LOGPP_LOGCLOCK_HPP
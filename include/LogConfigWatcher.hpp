@@ -0,0 +1,129 @@
+/**
+ * LogConfigWatcher.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGCONFIGWATCHER_HPP
+#define LOGPP_LOGCONFIGWATCHER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logpp {
+
+    using std::string;
+    using std::thread;
+    using std::vector;
+
+    /**
+     * @brief Watches a small configuration file and applies its contents to registered loggers.
+     *
+     * The configuration is re-read whenever the file is written or replaced (inotify) and whenever the process receives SIGHUP.
+     * Each non-empty line not starting with '#' has the form
+     *
+     * @code
+     *  <logger name|*>.<key> = <value>
+     * @endcode
+     *
+     * where key is one of
+     *  - level             the maximum log level (name or number, see tryParseLogLevel)
+     *  - bufferSize        the maximum buffer size in bytes (see ILogger::setMaxBufferSize)
+     *  - flushAfterWrite   true/false (see ILogger::setFlushAfterWrite)
+     *
+     * Lines are applied in order, so a "*" line followed by a logger-specific line lets a single component be turned up.
+     *
+     * @remarks Only the watcher thread and the (un)registration methods take the watcher's lock.
+     * Loggers pick up new values through atomic stores; their logging paths are never blocked by a reload.
+     * Registered loggers must outlive the watcher or be unregistered first.
+     */
+    class LogConfigWatcher {
+        public: // +++ Static +++
+            static const char   CONFIG_KEY_SEPARATOR; //!< Separates logger names from keys
+            static const string CONFIG_WILDCARD; //!< Matches all registered loggers
+
+        public:
+            LogConfigWatcher(const string& configPath, const bool reloadOnSighup = true); ///!< Object constructor.
+            virtual ~LogConfigWatcher(); ///!< Virtual destructor; stops the watcher thread.
+
+            LogConfigWatcher(const LogConfigWatcher&) = delete;
+            LogConfigWatcher& operator=(const LogConfigWatcher&) = delete;
+
+            /**
+             * @brief Gets the path to the watched configuration file.
+             */
+            string getConfigPath() const { return this->_configPath; }
+
+            /**
+             * @brief Gets the amount of times the configuration was successfully (re-)applied.
+             */
+            uint64_t getReloadCount() const { return this->_reloadCount.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the amount of invalid lines encountered during the last reload.
+             */
+            uint32_t getInvalidLineCount() const { return this->_invalidLines.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets a value indicating whether the watcher thread is running.
+             */
+            bool isRunning() const { return this->_running.load(); }
+
+            LogConfigWatcher& registerLogger(ILogger* logger); ///!< Adds a logger to the set of reconfigurable loggers.
+            LogConfigWatcher& unregisterLogger(ILogger* logger); ///!< Removes a logger from the set of reconfigurable loggers.
+
+            bool reload(); ///!< Reads the configuration file and applies it immediately.
+
+            void start(); ///!< Applies the current configuration and starts watching for changes.
+            void stop(); ///!< Stops watching for changes.
+
+        private:
+            /**
+             * @brief A single, parsed line of the configuration file.
+             */
+            struct ConfigDirective {
+                string      loggerName;
+                string      key;
+                string      value;
+            };
+
+            bool parseConfig(const string& contents, vector<ConfigDirective>& out, uint32_t& invalidLines) const;
+            bool applyDirective(ILogger* logger, const ConfigDirective& directive) const;
+            void watchLoop();
+
+        private:
+            static void sighupHandler(int32_t);
+
+            static std::atomic<int32_t> _sighupPipeFd; ///!< Write end of the pipe the SIGHUP handler wakes the watcher through
+
+        private:
+            bool                    _reloadOnSighup;
+
+            int32_t                 _inotifyFd;
+            int32_t                 _wakeupPipe[2];
+
+            std::atomic<bool>       _running;
+            std::atomic<uint32_t>   _invalidLines;
+            std::atomic<uint64_t>   _reloadCount;
+
+            std::mutex              _loggerMutex;
+            vector<ILogger*>        _loggers;
+
+            string                  _configPath;
+            thread                  _watcherThread;
+    };
+
+}
+
+#endif // LOGPP_LOGCONFIGWATCHER_HPP
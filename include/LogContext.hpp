@@ -0,0 +1,81 @@
+/**
+ * LogContext.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGCONTEXT_HPP
+#define LOGPP_LOGCONTEXT_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+namespace logpp {
+
+    using std::string;
+
+    /**
+     * @brief Per-thread key/value context (a "mapped diagnostic context"), such as request id, tenant or shard.
+     *
+     * The context is a stack: entries are pushed by LogContextScope and popped when the scope ends.
+     * An entry shadows earlier entries with the same key.
+     *
+     * Loggers output it with ${ctx} (all entries, as "key=value key=value") or ${ctx:key} (a single value).
+     * The rendered ${ctx} string is cached and only rebuilt after the context changed, so a record
+     * only copies the cached bytes. Entries keep their storage when popped; a steady state of pushes and pops doesn't allocate.
+     */
+    class LogContext {
+        public: // +++ Static +++
+            static const uint32_t MAX_DEPTH; //!< Entries per thread; pushes beyond this are ignored (but still popped)
+
+            static void push(string_view key, string_view value); ///!< Adds an entry to the current thread's context.
+            static void pop(); ///!< Removes the most recently added entry.
+
+            static string_view get(string_view key); ///!< Gets the innermost value for a key; empty if unset.
+            static const string& getRendered(); ///!< Gets the whole context as "key=value key=value".
+
+            static uint32_t getDepth(); ///!< Gets the amount of entries in the current thread's context.
+    };
+
+    /**
+     * @brief Adds entries to the current thread's log context for its lifetime.
+     *
+     * @code
+     *  void handleRequest(const Request& request) {
+     *      logpp::LogContextScope context({ { "request", request.id() }, { "tenant", request.tenant() } });
+     *      logger.info("Handling request"); // with "${ctx} ${lmsg}": "request=42 tenant=acme Handling request"
+     *  }
+     * @endcode
+     */
+    class LogContextScope {
+        public:
+            LogContextScope(string_view key, string_view value): _entries(1) { LogContext::push(key, value); }
+
+            LogContextScope(std::initializer_list<std::pair<string_view, string_view>> entries): _entries(static_cast<uint32_t>(entries.size())) {
+                for (const auto& entry : entries) { LogContext::push(entry.first, entry.second); }
+            }
+
+            ~LogContextScope() {
+                for (uint32_t i = 0; i < _entries; i++) { LogContext::pop(); }
+            }
+
+            LogContextScope(const LogContextScope&) = delete;
+            LogContextScope& operator=(const LogContextScope&) = delete;
+
+        private:
+            uint32_t    _entries;
+    };
+
+}
+
+#endif // LOGPP_LOGCONTEXT_HPP
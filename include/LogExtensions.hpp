@@ -20,6 +20,9 @@
  #include <sstream>
  #include <string>
 
+ #include <sys/syscall.h>
+ #include <unistd.h>
+
 namespace logpp {
 
     using std::iostream;
@@ -123,6 +126,46 @@ namespace logpp {
 
         return string(buffer.get(), buffer.get() + stringSize - 1); // std::string handles termination for us.
     }
+
+    /**
+     * @brief Formats into an existing string, replacing its contents.
+     *
+     * Unlike formatString(), this reuses the string's capacity, so repeated calls with a reused string don't allocate.
+     *
+     * @tparam Args The formatting argument types.
+     * @param out The string to format into.
+     * @param format The format string.
+     * @param args The format arguments (strings must be converted to C-style strings!)
+     *
+     * @return const string& A reference to out.
+     */
+    template<typename... Args>
+    const string& formatStringTo(string& out, const char* format, Args... args) {
+        // Try the existing capacity first; writing the terminator to out[size()] is allowed.
+        out.resize(out.capacity());
+        auto stringSize = snprintf(&out[0], out.size() + 1, format, args...);
+
+        if (stringSize < 0) {
+            out.clear();
+            return out;
+        } else if ((size_t)stringSize > out.size()) {
+            out.resize(stringSize);
+            snprintf(&out[0], out.size() + 1, format, args...);
+        }
+
+        out.resize(stringSize);
+        return out;
+    }
+
+    /**
+     * @brief Formats into an existing string, replacing its contents.
+     *
+     * @see formatStringTo(string&, const char*, Args...)
+     */
+    template<typename... Args>
+    const string& formatStringTo(string& out, const string& format, Args... args) {
+        return formatStringTo(out, format.c_str(), args...);
+    }
 #else
 #endif // logpp_USE_PRINTF
 
@@ -133,7 +176,8 @@ namespace logpp {
      */
     inline struct tm getCurrentLocalTime() {
         auto timeNow = time(NULL);
-        auto timeStruct = *localtime(&timeNow);
+        struct tm timeStruct;
+        localtime_r(&timeNow, &timeStruct);
 
         return timeStruct;
     }
@@ -172,6 +216,16 @@ namespace logpp {
      */
     inline string getBaseName(string const &path) { return path.substr(path.find_last_of("/\\") + 1); }
 
+    /**
+     * @brief Gets the kernel thread id (as shown by top and gdb) of the calling thread.
+     *
+     * @return uint32_t The thread id; cached per thread, so this only costs a system call once.
+     */
+    inline uint32_t getCurrentThreadId() {
+        static thread_local const uint32_t threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+        return threadId;
+    }
+
 }
 
 #endif // LIBLOGPP_EXTENSIONS_HPP
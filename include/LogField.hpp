@@ -0,0 +1,112 @@
+/**
+ * LogField.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGFIELD_HPP
+#define LOGPP_LOGFIELD_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace logpp {
+
+    /**
+     * @brief A typed key/value pair attached to a structured log record; created with kv().
+     *
+     * Values are kept as they are (numbers aren't stringified) until the record is formatted.
+     *
+     * @remarks Strings are referenced, not copied; a field must not outlive the log call it is passed to.
+     */
+    struct LogField {
+        /**
+         * @brief The type of a field's value.
+         */
+        enum class Type : uint8_t {
+            Int,
+            UInt,
+            Double,
+            Bool,
+            String
+        };
+
+        string_view     key;
+        Type            type;
+        union {
+            int64_t     intValue;
+            uint64_t    uintValue;
+            double      doubleValue;
+            bool        boolValue;
+        };
+        string_view     stringValue;
+    };
+
+    /**
+     * @brief Creates a field with a signed integer value.
+     */
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    inline LogField kv(string_view key, const T value) {
+        LogField field { key, LogField::Type::Int, { }, string_view() };
+        field.intValue = value;
+        return field;
+    }
+
+    /**
+     * @brief Creates a field with an unsigned integer value.
+     */
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    inline LogField kv(string_view key, const T value) {
+        LogField field { key, LogField::Type::UInt, { }, string_view() };
+        field.uintValue = value;
+        return field;
+    }
+
+    /**
+     * @brief Creates a field with a floating-point value.
+     */
+    template<typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    inline LogField kv(string_view key, const T value) {
+        LogField field { key, LogField::Type::Double, { }, string_view() };
+        field.doubleValue = value;
+        return field;
+    }
+
+    /**
+     * @brief Creates a field with a boolean value.
+     */
+    inline LogField kv(string_view key, const bool value) {
+        LogField field { key, LogField::Type::Bool, { }, string_view() };
+        field.boolValue = value;
+        return field;
+    }
+
+    /**
+     * @brief Creates a field with a string value. The string is referenced, not copied.
+     */
+    inline LogField kv(string_view key, string_view value) { return { key, LogField::Type::String, { }, value }; }
+
+    inline LogField kv(string_view key, const char* value) { return kv(key, string_view(value == nullptr ? "" : value)); } ///!< Creates a field with a string value.
+    inline LogField kv(string_view key, const std::string& value) { return kv(key, string_view(value)); } ///!< Creates a field with a string value.
+
+    /**
+     * @brief Determines whether all types of a parameter pack are LogField.
+     */
+    template<typename... Ts>
+    struct areLogFields: std::true_type { };
+
+    template<typename T, typename... Ts>
+    struct areLogFields<T, Ts...>: std::integral_constant<bool, std::is_same<typename std::decay<T>::type, LogField>::value && areLogFields<Ts...>::value> { };
+
+}
+
+#endif // LOGPP_LOGFIELD_HPP
@@ -0,0 +1,161 @@
+/**
+ * LogFormat.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGFORMAT_HPP
+#define LOGPP_LOGFORMAT_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace logpp {
+
+    using std::string;
+    using std::vector;
+
+    /**
+     * @brief How a logger lays out its records.
+     */
+    enum class RecordFormat : uint8_t {
+        Text,       //!< The logger format string (setCurrentLoggerFormat); structured fields follow the message as key=value
+        JsonLines   //!< One JSON object per record (see JsonLineFormatter); the logger format string is ignored
+    };
+
+    /**
+     * @brief A logger format string (e.g. "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}"), precompiled into segments.
+     *
+     * Parsing the format once when it is set means formatting a log message is a single pass
+     * appending literals and variable values, instead of one search-and-replace per variable.
+     *
+     * Unknown variables are kept as literal text.
+     */
+    class LogFormat {
+        public:
+            /**
+             * @brief The different kinds of segments a format is made of.
+             */
+            enum class Token : uint8_t {
+                Literal,    //!< Literal text from the format string
+                Date,       //!< ${date}
+                Time,       //!< ${time}
+                DateTime,   //!< ${datetime}
+                LogLevel,   //!< ${llevel}
+                Message,    //!< ${lmsg}
+                Function,   //!< ${func}
+                Line,       //!< ${lineno}
+                Class,      //!< ${class}
+                Exception,  //!< ${except}
+                AppName,    //!< ${appname}
+                Custom,     //!< ${custom}
+                TimestampNs, //!< ${ts_ns}
+                TimestampUs, //!< ${ts_us}
+                MonotonicNs, //!< ${mono_ns}
+                ThreadId,   //!< ${tid}
+                Context,    //!< ${ctx}
+                ContextValue //!< ${ctx:key}; the segment refers to the key
+            };
+
+            /**
+             * @brief A single segment of a compiled format. Literals (and ${ctx:key}'s key) refer to a slice of the format string.
+             */
+            struct Segment {
+                Token       token;
+                uint32_t    offset;
+                uint32_t    length;
+            };
+
+        public:
+            LogFormat(const string& pattern = ""); ///!< Object constructor; compiles the pattern.
+
+            /**
+             * @brief Gets the format string this object was compiled from.
+             */
+            const string& getPattern() const { return this->_pattern; }
+
+            /**
+             * @brief Gets the compiled segments.
+             */
+            const vector<Segment>& getSegments() const { return this->_segments; }
+
+            /**
+             * @brief Gets a pointer to the first character of a literal segment, or of the key of a ${ctx:key} segment.
+             */
+            const char* getLiteral(const Segment& segment) const { return this->_pattern.data() + segment.offset; }
+
+            /**
+             * @brief Gets the amount of literal characters in the format; a lower bound for a formatted message's length.
+             */
+            size_t getLiteralLength() const { return this->_literalLength; }
+
+            /**
+             * @brief Gets a value indicating whether the format contains the given variable.
+             */
+            bool uses(const Token token) const { return (this->_usedTokens & (1u << (uint32_t)token)) != 0; }
+
+            /**
+             * @brief Gets a value indicating whether the format needs the current local time.
+             */
+            bool usesLocalTime() const { return uses(Token::Date) || uses(Token::Time) || uses(Token::DateTime); }
+
+            /**
+             * @brief Gets a value indicating whether the format needs the record's timestamp, i.e. the clock must be read.
+             */
+            bool usesClock() const { return usesLocalTime() || uses(Token::TimestampNs) || uses(Token::TimestampUs) || uses(Token::MonotonicNs); }
+
+            /**
+             * @brief Gets a value indicating whether the format is empty.
+             */
+            bool empty() const { return this->_pattern.empty(); }
+
+        private:
+            void compile();
+            void addSegment(const Token token, const size_t offset = 0, const size_t length = 0);
+
+        private:
+            string              _pattern;
+            vector<Segment>     _segments;
+            size_t              _literalLength;
+            uint32_t            _usedTokens;
+    };
+
+    /**
+     * @brief A format variable's name (without "${" and "}") and its token.
+     */
+    struct LogFormatVariable {
+        const char*         name;
+        LogFormat::Token    token;
+    };
+
+    /**
+     * @brief The format variables; shared by LogFormat and the compile-time formats (StaticFormat.hpp).
+     */
+    constexpr LogFormatVariable LOG_FORMAT_VARIABLES[] = {
+        { "date",       LogFormat::Token::Date },
+        { "time",       LogFormat::Token::Time },
+        { "datetime",   LogFormat::Token::DateTime },
+        { "llevel",     LogFormat::Token::LogLevel },
+        { "lmsg",       LogFormat::Token::Message },
+        { "func",       LogFormat::Token::Function },
+        { "lineno",     LogFormat::Token::Line },
+        { "class",      LogFormat::Token::Class },
+        { "except",     LogFormat::Token::Exception },
+        { "appname",    LogFormat::Token::AppName },
+        { "custom",     LogFormat::Token::Custom },
+        { "ts_ns",      LogFormat::Token::TimestampNs },
+        { "ts_us",      LogFormat::Token::TimestampUs },
+        { "mono_ns",    LogFormat::Token::MonotonicNs },
+        { "tid",        LogFormat::Token::ThreadId },
+        { "ctx",        LogFormat::Token::Context },
+    };
+
+    constexpr char LOG_FORMAT_CONTEXT_VALUE_PREFIX[] = "ctx:"; //!< ${ctx:key}
+
+}
+
+#endif // LOGPP_LOGFORMAT_HPP
@@ -84,9 +84,11 @@ namespace logpp {
     /**
      * @brief Gets a value indicating whether a given log level is bad or not.
      *
+     * Bad logs are errors and fatal errors. Debug and Trace sort above Fatal numerically, but are anything but bad.
+     *
      * @returns @code true @endcode if the log level is considered bad.
      */
-    inline bool isBadLog(LogLevel level) { return ((uint32_t)level) >= 4; }
+    inline bool isBadLog(LogLevel level) { return level == LogLevel::Error || level == LogLevel::Fatal; }
 
     
     bool tryParseLogLevel(string level, LogLevel& out); ///!< Attempts to parse a string to a LogLevel.
@@ -0,0 +1,117 @@
+/**
+ * LogSampling.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGSAMPLING_HPP
+#define LOGPP_LOGSAMPLING_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogLevel.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <chrono>
+#include <cstdint>
+
+namespace logpp {
+
+    /**
+     * @brief Gets a pseudo-random number from a per-thread xorshift64* generator.
+     *
+     * The generator is seeded once per thread. It is not suitable for anything but sampling decisions.
+     *
+     * @return uint64_t A pseudo-random 64-bit value.
+     */
+    inline uint64_t getSamplingRandom() {
+        static thread_local uint64_t state = [] {
+            // splitmix64 over the address of a thread-local and the time yields distinct seeds per thread.
+            uint64_t seed = reinterpret_cast<uintptr_t>(&state) ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+            seed += 0x9e3779b97f4a7c15ull;
+            seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ull;
+            seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebull;
+            seed ^= seed >> 31;
+
+            return seed == 0 ? 1 : seed;
+        }();
+
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+
+        return state * 0x2545f4914f6cdd1dull;
+    }
+
+    /**
+     * @brief Returns true with the given probability.
+     *
+     * @param probability The probability in the range [0, 1]; values outside it are clamped, NaN counts as 0.
+     */
+    inline bool sampleWithProbability(const double probability) {
+        // The conversion below is undefined outside [0, 2^64), so clamp first; !(p > 0) also catches NaN.
+        if (!(probability > 0)) { return false; }
+        if (probability >= 1) { return true; }
+
+        // Compare the upper 53 bits against p * 2^53; exact for every double in [0, 1].
+        return (getSamplingRandom() >> 11) < static_cast<uint64_t>(probability * 9007199254740992.0);
+    }
+
+}
+
+/**
+ * @brief Logs the first k of every n executions of this statement on the current thread.
+ *
+ * The message arguments are only evaluated if the statement is sampled and the logger's level permits the message.
+ * Each call site keeps its own thread-local counter, so sampling costs an increment and a compare.
+ *
+ * @code
+ *  LOGPP_TRACE_SAMPLED(logger, 1, 1000, "Handling request " + request.id()); // logs one in 1000 requests
+ * @endcode
+ */
+#define LOGPP_SAMPLED(logger, method, level, k, n, ...) \
+    do { \
+        if ((logger).getCurrentMaxLogLevel() >= (level)) { \
+            static thread_local uint32_t _logppSampleCounter = 0; \
+            const bool _logppSampled = _logppSampleCounter < (uint32_t)(k); \
+            if (++_logppSampleCounter >= (uint32_t)(n)) { _logppSampleCounter = 0; } \
+            if (_logppSampled) { (logger).method(__VA_ARGS__); } \
+        } \
+    } while (false)
+
+/**
+ * @brief Logs with the given probability (0..1, clamped) each time this statement is executed.
+ *
+ * The message arguments are only evaluated if the statement is sampled and the logger's level permits the message.
+ *
+ * @code
+ *  LOGPP_TRACE_WITH_PROBABILITY(logger, 0.001, "Handling request " + request.id());
+ * @endcode
+ */
+#define LOGPP_WITH_PROBABILITY(logger, method, level, probability, ...) \
+    do { \
+        if ((logger).getCurrentMaxLogLevel() >= (level) && ::logpp::sampleWithProbability(probability)) { \
+            (logger).method(__VA_ARGS__); \
+        } \
+    } while (false)
+
+#define LOGPP_DEBUG_SAMPLED(logger, k, n, ...)      LOGPP_SAMPLED(logger, debug, ::logpp::LogLevel::Debug, k, n, __VA_ARGS__)
+#define LOGPP_ERROR_SAMPLED(logger, k, n, ...)      LOGPP_SAMPLED(logger, error, ::logpp::LogLevel::Error, k, n, __VA_ARGS__)
+#define LOGPP_FATAL_SAMPLED(logger, k, n, ...)      LOGPP_SAMPLED(logger, fatal, ::logpp::LogLevel::Fatal, k, n, __VA_ARGS__)
+#define LOGPP_INFO_SAMPLED(logger, k, n, ...)       LOGPP_SAMPLED(logger, info, ::logpp::LogLevel::Info, k, n, __VA_ARGS__)
+#define LOGPP_OK_SAMPLED(logger, k, n, ...)         LOGPP_SAMPLED(logger, ok, ::logpp::LogLevel::Ok, k, n, __VA_ARGS__)
+#define LOGPP_TRACE_SAMPLED(logger, k, n, ...)      LOGPP_SAMPLED(logger, trace, ::logpp::LogLevel::Trace, k, n, __VA_ARGS__)
+#define LOGPP_WARNING_SAMPLED(logger, k, n, ...)    LOGPP_SAMPLED(logger, warning, ::logpp::LogLevel::Warning, k, n, __VA_ARGS__)
+
+#define LOGPP_DEBUG_WITH_PROBABILITY(logger, probability, ...)      LOGPP_WITH_PROBABILITY(logger, debug, ::logpp::LogLevel::Debug, probability, __VA_ARGS__)
+#define LOGPP_ERROR_WITH_PROBABILITY(logger, probability, ...)      LOGPP_WITH_PROBABILITY(logger, error, ::logpp::LogLevel::Error, probability, __VA_ARGS__)
+#define LOGPP_FATAL_WITH_PROBABILITY(logger, probability, ...)      LOGPP_WITH_PROBABILITY(logger, fatal, ::logpp::LogLevel::Fatal, probability, __VA_ARGS__)
+#define LOGPP_INFO_WITH_PROBABILITY(logger, probability, ...)       LOGPP_WITH_PROBABILITY(logger, info, ::logpp::LogLevel::Info, probability, __VA_ARGS__)
+#define LOGPP_OK_WITH_PROBABILITY(logger, probability, ...)         LOGPP_WITH_PROBABILITY(logger, ok, ::logpp::LogLevel::Ok, probability, __VA_ARGS__)
+#define LOGPP_TRACE_WITH_PROBABILITY(logger, probability, ...)      LOGPP_WITH_PROBABILITY(logger, trace, ::logpp::LogLevel::Trace, probability, __VA_ARGS__)
+#define LOGPP_WARNING_WITH_PROBABILITY(logger, probability, ...)    LOGPP_WITH_PROBABILITY(logger, warning, ::logpp::LogLevel::Warning, probability, __VA_ARGS__)
+
+#endif // LOGPP_LOGSAMPLING_HPP
@@ -0,0 +1,144 @@
+/**
+ * LogSinks.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGSINKS_HPP
+#define LOGPP_LOGSINKS_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogBufferPool.hpp"
+#include "LogLevel.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace logpp {
+
+    using std::string;
+
+    /**
+     * @brief Where ConsoleLogger's records go: buffered records to stdout, and optionally bad records straight to stderr.
+     *
+     * Sinks write whole buffers of newline-terminated records and know nothing about levels, formats or locking;
+     * the loggers (ConsoleLogger, BasicLogger) decide when to write and serialise access.
+     */
+    class ConsoleSink {
+        public:
+            ConsoleSink(const bool outputBadLogsToStderr = true): _outputBadLogsToStderr(outputBadLogsToStderr) { } ///!< Object constructor.
+
+            /**
+             * @brief Gets a value indicating whether bad logs bypass the buffer and are written to stderr.
+             */
+            bool outputBadLogsToStderr() const { return this->_outputBadLogsToStderr; }
+
+            /**
+             * @brief Sets a value indicating whether bad logs bypass the buffer and are written to stderr.
+             */
+            void setOutputBadLogsToStderr(const bool outputToStderr) { this->_outputBadLogsToStderr = outputToStderr; }
+
+            /**
+             * @brief Determines whether a record of the given level is written right away (writeDirect()) instead of being buffered.
+             */
+            bool writesDirectly(const LogLevel level) const { return _outputBadLogsToStderr && isBadLog(level); }
+
+            void write(string_view buffer); ///!< Writes buffered records to stdout and flushes it.
+            void write(const LogBuffer& buffer); ///!< Writes a logger's buffer to stdout and flushes it.
+            void writeDirect(string_view record); ///!< Writes a single record to stderr.
+
+            /**
+             * @brief Writes buffered records to stdout and an emergency record where writeDirect() would, with write(2); async-signal-safe.
+             *
+             * @param buffered The buffered records; nullptr if there are none to write.
+             */
+            void writeEmergency(const LogLevel level, const LogBuffer* buffered, string_view record) const;
+
+        private:
+            bool _outputBadLogsToStderr;
+    };
+
+    /**
+     * @brief Where FileLogger's records go: a set of numbered log files which are rotated when they reach a maximum size.
+     *
+     * The number of the file being written is kept in a control file, so a restarted application continues where it left off.
+     * The current file stays open between writes; it's reopened if it was deleted, but files renamed from outside (e.g. by logrotate
+     * without copytruncate) keep being written to.
+     */
+    class FileSink {
+        public: // +++ Public Static +++
+            static const char* const LOGPP_CTRL_DIR; //!< .logpp/
+            static const uint32_t    CTRL_FILE_MAGIC = 0xf00dbeef; //!< Magic number for control files
+            static const uint32_t    DEFAULT_MAX_LOG_FILES = 4;
+
+        public:
+            FileSink(const string& filename, const string& loggerName, const uint32_t maxFileSizeInMiB); ///!< Object constructor; reads the control file.
+            ~FileSink(); ///!< Object destructor; closes the current log file.
+
+            FileSink(const FileSink&) = delete;
+            FileSink& operator=(const FileSink&) = delete;
+
+            /**
+             * @brief Records are always buffered; files have no separate output for bad logs.
+             */
+            bool writesDirectly(const LogLevel) const { return false; }
+
+            /**
+             * @brief Sets the maximum amount of files to create before overwriting the files in a loop.
+             */
+            void setMaxFileCount(const uint32_t maxFileCount = DEFAULT_MAX_LOG_FILES) { this->_maxFileCount = maxFileCount; }
+
+            uint32_t getMaxFileSizeInMiB() const { return this->_maxFileSize; } ///!< Gets the size at which files are rotated, in MiB.
+            void setMaxFileSizeInMiB(const uint32_t maxFileSize) { this->_maxFileSize = maxFileSize; } ///!< Sets the size at which files are rotated, in MiB.
+
+            void write(string_view buffer); ///!< Appends buffered records to the current log file, rotating it if it's full.
+            void write(const LogBuffer& buffer); ///!< Appends a logger's buffer to the current log file, rotating it if it's full.
+            void writeDirect(string_view record) { write(record); } ///!< Appends a single record; unused unless writesDirectly() is overridden.
+
+            /**
+             * @brief Appends buffered records and an emergency record to the current log file with open(2) and write(2); async-signal-safe.
+             *
+             * @remarks The file isn't rotated; the path is built on the stack, so this needs PATH_MAX bytes of it.
+             *
+             * @param buffered The buffered records; nullptr if there are none to write.
+             */
+            void writeEmergency(const LogBuffer* buffered, string_view record) const;
+
+            string getControlFilePath() const; //!< Gets the path to the control file for this logger
+            void initLogContinuation(); //!< Initialises the log continuation logic
+            void storeLatestLogFile(); //!< Stores the latest written log file to a control file in (...)/.logpp/<loggername>
+
+        private:
+            bool openLogFile(); ///!< Makes sure the current log file is open, rotating it first if it's full.
+            void closeLogFile();
+
+            static bool fileExists(const string& filename);
+            static uint32_t fileSize(const string& filename);
+
+        private:
+            string      _filename;
+            string      _loggerName;
+            uint32_t    _numLogs;
+            uint32_t    _maxFileSize; ///!< max size of log file in MB
+            uint32_t    _maxFileCount; ///!< The maximum amount of files logpp is allowed to create before overwriting the files in a loop
+            int         _fd; ///!< The current log file; -1 until the first write
+    };
+
+    /**
+     * @brief Simple struct containing the internal structure of the control file
+     */
+    struct ControlFileContents {
+        uint32_t magicNumber;
+        uint32_t currentWrittenLogFile;
+    } __attribute__((packed));
+
+}
+
+#endif // LOGPP_LOGSINKS_HPP
@@ -0,0 +1,265 @@
+/**
+ * LoggerMetrics.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_LOGGERMETRICS_HPP
+#define LOGPP_LOGGERMETRICS_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogLevel.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace logpp {
+
+    using std::array;
+    using std::atomic;
+    using std::string;
+    using std::vector;
+
+    const uint32_t LOG_LEVEL_COUNT = static_cast<uint32_t>(LOGLEVEL_MAXVALUE) + 1;
+
+    /**
+     * @brief A log-linear (HDR-style) latency histogram.
+     *
+     * Values are grouped by their most significant bit, and each power of two is split into SUB_BUCKET_COUNT
+     * linear sub-buckets, so every recorded value is reproduced within 1/SUB_BUCKET_COUNT (12.5%) of its true value
+     * while the whole histogram stays a fixed, small array.
+     *
+     * @tparam Counter The type of the bucket counters; atomic in the per-thread shards, plain in snapshots.
+     */
+    template<typename Counter>
+    class BasicLatencyHistogram {
+        public: // +++ Static +++
+            static const uint32_t SUB_BUCKET_BITS   = 3;
+            static const uint32_t SUB_BUCKET_COUNT  = 1u << SUB_BUCKET_BITS;
+            static const uint32_t MAGNITUDE_COUNT   = 42 - SUB_BUCKET_BITS; //!< Covers up to ~73 minutes in nanoseconds
+            static const uint32_t BUCKET_COUNT      = (MAGNITUDE_COUNT + 1) * SUB_BUCKET_COUNT;
+
+            /**
+             * @brief Gets the index of the bucket a value falls into.
+             */
+            static uint32_t getBucketIndex(const uint64_t value) {
+                if (value < SUB_BUCKET_COUNT) { return static_cast<uint32_t>(value); }
+
+                const uint32_t magnitude = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS + 1;
+                if (magnitude > MAGNITUDE_COUNT) { return BUCKET_COUNT - 1; }
+
+                const auto subBucket = static_cast<uint32_t>(value >> (magnitude - 1)) & (SUB_BUCKET_COUNT - 1);
+                return magnitude * SUB_BUCKET_COUNT + subBucket;
+            }
+
+            /**
+             * @brief Gets the highest value which falls into a bucket.
+             */
+            static uint64_t getBucketUpperBound(const uint32_t index) {
+                const auto magnitude = index / SUB_BUCKET_COUNT;
+                const auto subBucket = index % SUB_BUCKET_COUNT;
+                if (magnitude == 0) { return subBucket; }
+
+                return ((uint64_t)(SUB_BUCKET_COUNT + subBucket + 1) << (magnitude - 1)) - 1;
+            }
+
+        public:
+            BasicLatencyHistogram() { for (auto& bucket : _buckets) { store(bucket, 0); } }
+
+            /**
+             * @brief Records a value.
+             *
+             * @remarks The per-thread shards only have a single writer, so a plain load and store suffice; no atomic RMW is needed.
+             */
+            void record(const uint64_t value) {
+                auto& bucket = _buckets[getBucketIndex(value)];
+                store(bucket, load(bucket) + 1);
+            }
+
+            /**
+             * @brief Adds the counts of another histogram to this one.
+             */
+            template<typename OtherCounter>
+            void merge(const BasicLatencyHistogram<OtherCounter>& other) {
+                for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+                    store(_buckets[i], load(_buckets[i]) + other.getBucketCount(i));
+                }
+            }
+
+            /**
+             * @brief Gets the amount of values recorded in a bucket.
+             */
+            uint64_t getBucketCount(const uint32_t index) const { return load(_buckets[index]); }
+
+            /**
+             * @brief Gets the amount of values recorded.
+             */
+            uint64_t getCount() const {
+                uint64_t count = 0;
+                for (uint32_t i = 0; i < BUCKET_COUNT; i++) { count += load(_buckets[i]); }
+
+                return count;
+            }
+
+            /**
+             * @brief Gets the (upper bound of the) value below which the given percentage of values fall.
+             *
+             * @param percentile The percentile, 0..100.
+             *
+             * @return The percentile's value or 0 if nothing was recorded.
+             */
+            uint64_t getPercentile(const double percentile) const {
+                const auto count = getCount();
+                if (count == 0) { return 0; }
+
+                auto rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+                if (rank == 0) { rank = 1; }
+
+                uint64_t seen = 0;
+                for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+                    seen += load(_buckets[i]);
+                    if (seen >= rank) { return getBucketUpperBound(i); }
+                }
+
+                return getBucketUpperBound(BUCKET_COUNT - 1);
+            }
+
+            /**
+             * @brief Gets the (upper bound of the) largest value recorded.
+             */
+            uint64_t getMax() const {
+                for (uint32_t i = BUCKET_COUNT; i > 0; i--) {
+                    if (load(_buckets[i - 1]) != 0) { return getBucketUpperBound(i - 1); }
+                }
+
+                return 0;
+            }
+
+        private:
+            static uint64_t load(const uint64_t& counter) { return counter; }
+            static uint64_t load(const atomic<uint64_t>& counter) { return counter.load(std::memory_order_relaxed); }
+            static void store(uint64_t& counter, const uint64_t value) { counter = value; }
+            static void store(atomic<uint64_t>& counter, const uint64_t value) { counter.store(value, std::memory_order_relaxed); }
+
+        private:
+            array<Counter, BUCKET_COUNT> _buckets;
+    };
+
+    using LatencyHistogram = BasicLatencyHistogram<uint64_t>;
+
+    /**
+     * @brief A point-in-time copy of a logger's metrics, as returned by ILogger::getMetricsSnapshot().
+     *
+     * All counters are totals since the logger was created; compute rates by diffing two snapshots.
+     * Latencies are in nanoseconds.
+     */
+    struct LoggerMetricsSnapshot {
+        string              loggerName;
+
+        array<uint64_t, LOG_LEVEL_COUNT> recordsAccepted; ///!< Records which passed the level filter, indexed by LogLevel
+        array<uint64_t, LOG_LEVEL_COUNT> recordsFiltered; ///!< Records discarded by the level filter, indexed by LogLevel
+
+        uint64_t            bytesWritten; ///!< Bytes handed to the logger's output
+        uint64_t            flushCount;
+        uint64_t            droppedRecords; ///!< Records lost, e.g. to a full queue
+        uint64_t            suppressedDuplicates; ///!< See ILogger::setCollapseDuplicates
+
+        uint64_t            bufferHighWaterMark; ///!< The largest buffer size (in bytes) seen at a flush
+        uint64_t            queueHighWaterMark; ///!< The largest amount of queued records, for loggers with a queue
+
+        LatencyHistogram    appendLatency; ///!< Time from accepting a record until the logging call returns
+        LatencyHistogram    flushLatency; ///!< Time spent writing the buffer to its output
+
+        /**
+         * @brief Gets the amount of accepted records over all levels.
+         */
+        uint64_t getTotalAccepted() const { uint64_t total = 0; for (auto count : recordsAccepted) { total += count; } return total; }
+
+        /**
+         * @brief Gets the amount of filtered records over all levels.
+         */
+        uint64_t getTotalFiltered() const { uint64_t total = 0; for (auto count : recordsFiltered) { total += count; } return total; }
+    };
+
+    /**
+     * @brief Collects a logger's self-metrics.
+     *
+     * Counters are kept in per-thread shards which only their own thread writes to, so recording a metric never
+     * contends with other threads; the shards are summed up when a snapshot is taken.
+     * A thread's shard outlives the thread, so nothing is lost when threads exit.
+     */
+    class LoggerMetrics {
+        public: // +++ Static +++
+            /**
+             * @brief Gets a monotonic timestamp in nanoseconds, for measuring latencies.
+             */
+            static uint64_t now() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+        public:
+            LoggerMetrics(); ///!< Object constructor.
+
+            LoggerMetrics(const LoggerMetrics&) = delete;
+            LoggerMetrics& operator=(const LoggerMetrics&) = delete;
+
+            void recordAccepted(const LogLevel level, const uint64_t startTime); ///!< Counts an accepted record and its latency.
+            void recordFiltered(const LogLevel level); ///!< Counts a record discarded by the level filter.
+            void recordFlush(const uint64_t bytes, const uint64_t startTime); ///!< Counts a flush, its size and latency.
+            void recordWrite(const uint64_t bytes); ///!< Counts bytes written without going through the buffer.
+            void recordDropped(const uint64_t count = 1); ///!< Counts records which were lost.
+            void recordQueueDepth(const uint64_t depth); ///!< Updates the queue high-water mark.
+
+            void fillSnapshot(LoggerMetricsSnapshot& snapshot) const; ///!< Sums up all shards into a snapshot.
+
+        private:
+            /**
+             * @brief The counters of a single thread. Only the owning thread writes to it.
+             */
+            struct Shard {
+                array<atomic<uint64_t>, LOG_LEVEL_COUNT> recordsAccepted;
+                array<atomic<uint64_t>, LOG_LEVEL_COUNT> recordsFiltered;
+                atomic<uint64_t>    bytesWritten;
+                atomic<uint64_t>    flushCount;
+                atomic<uint64_t>    droppedRecords;
+
+                BasicLatencyHistogram<atomic<uint64_t>> appendLatency;
+                BasicLatencyHistogram<atomic<uint64_t>> flushLatency;
+
+                Shard();
+            };
+
+            Shard& getThreadShard();
+            Shard& createThreadShard();
+
+            static void increment(atomic<uint64_t>& counter, const uint64_t amount = 1) {
+                counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+            }
+
+            static void updateMax(atomic<uint64_t>& maximum, const uint64_t value);
+
+        private:
+            const uint64_t                  _id; ///!< Unique for the process' lifetime; identifies this object in the thread-local shard caches
+            std::shared_ptr<void>           _liveness; ///!< Watched by the shard caches' entries, which are pruned once it's gone
+
+            mutable std::mutex              _shardMutex; ///!< Guards _shards; only taken when a thread first records a metric and for snapshots
+            vector<std::unique_ptr<Shard>>  _shards;
+
+            atomic<uint64_t>                _bufferHighWaterMark;
+            atomic<uint64_t>                _queueHighWaterMark;
+    };
+
+}
+
+#endif // LOGPP_LOGGERMETRICS_HPP
@@ -0,0 +1,75 @@
+/**
+ * MessageSanitiser.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_MESSAGESANITISER_HPP
+#define LOGPP_MESSAGESANITISER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace logpp {
+
+    using std::string;
+
+    /**
+     * @brief How the text of a record's message (and its text-mode fields) is sanitised.
+     *
+     * In every mode but Off, embedded line breaks are followed by MessageSanitiser::CONTINUATION_PREFIX, trailing
+     * line breaks are dropped and invalid UTF-8 is replaced by U+FFFD, so every record starts a line of its own.
+     */
+    enum class SanitiseMode: uint8_t {
+        Off,    ///!< Messages are written as they are
+        Escape, ///!< Control characters are written as \xHH, which also defuses ANSI escape sequences; the default
+        Strip   ///!< Control characters and whole ANSI escape sequences are removed
+    };
+
+    /**
+     * @brief Makes messages safe to write to line-oriented logs and terminals.
+     *
+     * Messages are scanned 16 (SSE2) or 32 (AVX2) bytes at a time for bytes which may need attention: control characters
+     * other than tab, DEL and non-ASCII bytes. Clean messages, the vast majority, are left alone after that single pass;
+     * otherwise only the bytes found are handled one at a time, and the runs between them are copied at once.
+     * AVX2 is picked at runtime if the CPU supports it; other architectures use a scalar loop.
+     */
+    class MessageSanitiser {
+        public: // +++ Static +++
+            static const char* const CONTINUATION_PREFIX; ///!< "    "; most multi-line log parsers join lines starting with whitespace to the previous one
+
+            static size_t findUnsafe(string_view msg); ///!< Gets the offset of the first byte which may need sanitising, or msg.size() if there's none.
+
+            /**
+             * @brief Appends a sanitised copy of a message.
+             *
+             * @param out The string to append to.
+             * @param msg The message; must not overlap out.
+             * @param mode How to deal with control characters; Off appends msg as is.
+             */
+            static void sanitiseTo(string& out, string_view msg, const SanitiseMode mode);
+
+            /**
+             * @brief Sanitises the end of a string in place, e.g. a message just appended to a record.
+             *
+             * @param out The string.
+             * @param start The offset at which the text to sanitise starts.
+             * @param mode How to deal with control characters.
+             */
+            static void sanitiseTail(string& out, const size_t start, const SanitiseMode mode);
+
+            static const char* getScanImplementation(); ///!< Gets the scanning implementation in use: "avx2", "sse2" or "scalar".
+    };
+
+}
+
+#endif // LOGPP_MESSAGESANITISER_HPP
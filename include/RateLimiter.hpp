@@ -0,0 +1,151 @@
+/**
+ * RateLimiter.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_RATELIMITER_HPP
+#define LOGPP_RATELIMITER_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace logpp {
+
+    using std::atomic;
+    using std::string;
+
+    /**
+     * @brief A lock-free token bucket for rate limiting a single log call site.
+     *
+     * Instances are normally created by the LOGPP_*_RATE_LIMITED macros below, which place one static
+     * RateLimiter at each call site; no lookup is required to find the bucket for a message.
+     *
+     * The bucket is implemented as a GCRA (generic cell rate algorithm), so its whole state is a single atomic timestamp.
+     * A permitted message costs one CAS, a suppressed message costs a single atomic increment.
+     */
+    class RateLimiter {
+        public: // +++ Static +++
+            static uint64_t getTotalSuppressedCount(); ///!< Gets the amount of suppressed messages over all registered call sites.
+            static void forEachCallSite(const std::function<void(const RateLimiter&)>& callback); ///!< Iterates over all registered call sites.
+
+        public:
+            RateLimiter(const double messagesPerSecond, const uint32_t burst, const char* file = nullptr, const int32_t line = -1); ///!< Object constructor.
+
+            RateLimiter(const RateLimiter&) = delete;
+            RateLimiter& operator=(const RateLimiter&) = delete;
+
+            /**
+             * @brief Gets the file containing the call site, if known.
+             */
+            const char* getFile() const { return this->_file; }
+
+            /**
+             * @brief Gets the line of the call site, or -1.
+             */
+            int32_t getLine() const { return this->_line; }
+
+            /**
+             * @brief Gets the amount of messages this call site has suppressed in total.
+             */
+            uint64_t getSuppressedCount() const { return this->_suppressed.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Attempts to take a token from the bucket.
+             *
+             * @return true If the message may be logged.
+             * @return false If the message must be suppressed. The suppression is counted.
+             */
+            bool tryAcquire() {
+                const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                int64_t arrival = _theoreticalArrival.load(std::memory_order_relaxed);
+
+                for (;;) {
+                    const int64_t nextArrival = (arrival > now ? arrival : now) + _emissionInterval;
+
+                    if (nextArrival - now > _burstWindow) {
+                        _suppressed.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+
+                    if (_theoreticalArrival.compare_exchange_weak(arrival, nextArrival, std::memory_order_relaxed)) {
+                        return true;
+                    }
+                }
+            }
+
+            /**
+             * @brief Gets the amount of suppressions since the last call and marks them as reported.
+             *
+             * @remarks _reported only moves forward, so concurrent callers never report a suppression twice, nor a negative amount.
+             */
+            uint64_t takeUnreportedSuppressions() {
+                const auto suppressed = _suppressed.load(std::memory_order_relaxed);
+                auto reported = _reported.load(std::memory_order_relaxed);
+
+                while (reported < suppressed) {
+                    if (_reported.compare_exchange_weak(reported, suppressed, std::memory_order_relaxed)) {
+                        return suppressed - reported;
+                    }
+                }
+
+                return 0;
+            }
+
+            string getSuppressionSummary(const uint64_t suppressedCount) const; ///!< Gets a summary message for suppressed messages.
+
+        private:
+            static atomic<RateLimiter*> _callSites; ///!< Intrusive list of all call sites
+
+        private:
+            const char*         _file;
+            int32_t             _line;
+
+            int64_t             _emissionInterval; ///!< Nanoseconds per token
+            int64_t             _burstWindow; ///!< Nanoseconds worth of tokens the bucket may hold
+
+            atomic<int64_t>     _theoreticalArrival;
+            atomic<uint64_t>    _suppressed;
+            atomic<uint64_t>    _reported;
+
+            RateLimiter*        _nextCallSite;
+    };
+
+}
+
+/**
+ * @brief Logs through the given logger method at most messagesPerSecond times per second, allowing bursts of up to burst messages.
+ *
+ * When a message gets through after others were suppressed, a summary containing the amount of suppressed messages is logged first.
+ * The message arguments are not evaluated if the message is suppressed.
+ *
+ * @code
+ *  LOGPP_RATE_LIMITED(logger, error, 10, 20, "Connection failed: " + reason);
+ *  LOGPP_ERROR_RATE_LIMITED(logger, 10, 20, "Connection failed: " + reason); // equivalent
+ * @endcode
+ */
+#define LOGPP_RATE_LIMITED(logger, method, messagesPerSecond, burst, ...) \
+    do { \
+        static ::logpp::RateLimiter _logppCallSite((messagesPerSecond), (burst), __FILE__, __LINE__); \
+        if (_logppCallSite.tryAcquire()) { \
+            const auto _logppSuppressed = _logppCallSite.takeUnreportedSuppressions(); \
+            if (_logppSuppressed > 0) { (logger).method(_logppCallSite.getSuppressionSummary(_logppSuppressed)); } \
+            (logger).method(__VA_ARGS__); \
+        } \
+    } while (false)
+
+#define LOGPP_DEBUG_RATE_LIMITED(logger, messagesPerSecond, burst, ...)     LOGPP_RATE_LIMITED(logger, debug, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_ERROR_RATE_LIMITED(logger, messagesPerSecond, burst, ...)     LOGPP_RATE_LIMITED(logger, error, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_FATAL_RATE_LIMITED(logger, messagesPerSecond, burst, ...)     LOGPP_RATE_LIMITED(logger, fatal, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_INFO_RATE_LIMITED(logger, messagesPerSecond, burst, ...)      LOGPP_RATE_LIMITED(logger, info, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_OK_RATE_LIMITED(logger, messagesPerSecond, burst, ...)        LOGPP_RATE_LIMITED(logger, ok, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_TRACE_RATE_LIMITED(logger, messagesPerSecond, burst, ...)     LOGPP_RATE_LIMITED(logger, trace, messagesPerSecond, burst, __VA_ARGS__)
+#define LOGPP_WARNING_RATE_LIMITED(logger, messagesPerSecond, burst, ...)   LOGPP_RATE_LIMITED(logger, warning, messagesPerSecond, burst, __VA_ARGS__)
+
+#endif // LOGPP_RATELIMITER_HPP
@@ -0,0 +1,129 @@
+/**
+ * ScopedTimer.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_SCOPEDTIMER_HPP
+#define LOGPP_SCOPEDTIMER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogExtensions.hpp"
+#include "TscClock.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace logpp {
+
+    using std::atomic;
+    using std::shared_ptr;
+
+    /**
+     * @brief A completed timing span.
+     *
+     * @remarks name and category are not copied; they must outlive the span's trip to the sink (string literals do).
+     */
+    struct TraceSpan {
+        const char*     name;
+        const char*     category;
+        uint64_t        beginTicks; ///!< TscClock ticks
+        uint64_t        endTicks; ///!< TscClock ticks
+        uint32_t        threadId;
+    };
+
+    /**
+     * @brief Base class for destinations of completed spans.
+     *
+     * Spans are buffered per thread and handed to the sink in batches; implementations must be thread-safe.
+     */
+    class ITraceSink {
+        public:
+            virtual ~ITraceSink() = default;
+
+            virtual void writeSpans(const TraceSpan* spans, const size_t count) = 0; ///!< Writes a batch of spans.
+            virtual void flush() { } ///!< Flushes whatever the sink buffers itself.
+    };
+
+    /**
+     * @brief The process-wide trace configuration: where completed spans go.
+     *
+     * Tracing is disabled until a sink is set. While disabled, a ScopedTimer costs a single relaxed load.
+     */
+    class Tracing {
+        public: // +++ Static +++
+            static const uint32_t SPANS_PER_BATCH = 256; //!< Spans buffered per thread before they are handed to the sink
+
+            /**
+             * @brief Gets a value indicating whether a sink is set.
+             */
+            static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+            static void setSink(shared_ptr<ITraceSink> sink); ///!< Sets the sink; nullptr disables tracing.
+            static shared_ptr<ITraceSink> getSink(); ///!< Gets the current sink.
+
+            static void recordSpan(const TraceSpan& span); ///!< Buffers a completed span on the current thread.
+            static void flush(); ///!< Hands the current thread's spans to the sink and flushes it.
+
+        private:
+            static atomic<bool> _enabled;
+    };
+
+    /**
+     * @brief Measures the time between its construction and destruction and records it as a span.
+     *
+     * @code
+     *  void handleRequest() {
+     *      logpp::ScopedTimer timer("handleRequest", "http");
+     *      ...
+     *  }
+     * @endcode
+     *
+     * @remarks The name and category must outlive the span (use string literals).
+     */
+    class ScopedTimer {
+        public:
+            explicit ScopedTimer(const char* name, const char* category = "default"):
+            _name(name), _category(category), _active(Tracing::isEnabled()), _beginTicks(_active ? TscClock::now() : 0) { }
+
+            ~ScopedTimer() {
+                if (_active) { Tracing::recordSpan({ _name, _category, _beginTicks, TscClock::now(), getCurrentThreadId() }); }
+            }
+
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+            /**
+             * @brief Gets the time since construction; 0 if tracing was disabled at construction.
+             */
+            uint64_t getElapsedNanoseconds() const { return _active ? TscClock::toNanoseconds(TscClock::now() - _beginTicks) : 0; }
+
+        private:
+            const char*     _name;
+            const char*     _category;
+            bool            _active;
+            uint64_t        _beginTicks;
+    };
+
+}
+
+#define LOGPP_TRACE_CONCAT_(a, b) a##b
+#define LOGPP_TRACE_CONCAT(a, b) LOGPP_TRACE_CONCAT_(a, b)
+
+/**
+ * @brief Times the rest of the enclosing scope.
+ */
+#define LOGPP_TRACE_SCOPE(name) ::logpp::ScopedTimer LOGPP_TRACE_CONCAT(_logppScopedTimer, __LINE__)(name)
+
+/**
+ * @brief Times the rest of the enclosing function, named after the function.
+ */
+#define LOGPP_TRACE_FUNCTION() LOGPP_TRACE_SCOPE(__func__)
+
+#endif // LOGPP_SCOPEDTIMER_HPP
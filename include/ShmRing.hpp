@@ -0,0 +1,156 @@
+/**
+ * ShmRing.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_SHMRING_HPP
+#define LOGPP_SHMRING_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogLevel.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace logpp {
+
+    using std::string;
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared-memory ring needs lock-free (address-free) 64-bit atomics");
+
+    /**
+     * @brief The header at the start of a shared-memory ring.
+     *
+     * The ring is shared between processes, so its layout is fixed: plain integers and lock-free atomics only.
+     */
+    struct ShmRingHeader {
+        uint32_t                magic; ///!< SHM_RING_MAGIC once the creator has initialised the ring
+        uint32_t                version;
+        uint32_t                slotCount; ///!< Always a power of two
+        uint32_t                slotSize; ///!< Bytes per slot, including its ShmRingSlot header
+        alignas(64) std::atomic<uint64_t> nextSequence; ///!< The sequence number the next record will get; claimed by the writers
+    };
+
+    /**
+     * @brief The header of a slot; the record's text follows it.
+     *
+     * sequence works like a seqlock: it's ((record sequence + 1) << 1) | 1 while the record is being written and
+     * (record sequence + 1) << 1 once it's complete. Zero means the slot has never been written.
+     */
+    struct ShmRingSlot {
+        std::atomic<uint64_t>   sequence;
+        uint32_t                length; ///!< Length of the text, without the trailing line feed
+        uint8_t                 level; ///!< The LogLevel, or SHM_RING_UNKNOWN_LEVEL
+        uint8_t                 flags; ///!< SHM_RING_TRUNCATED
+        uint16_t                reserved;
+    };
+
+    const uint32_t SHM_RING_MAGIC = 0x52505050; ///!< "PPPR"
+    const uint32_t SHM_RING_VERSION = 1;
+    const uint8_t  SHM_RING_UNKNOWN_LEVEL = 0xff; ///!< Records written through ShmRingSink::write() don't carry their level
+    const uint8_t  SHM_RING_TRUNCATED = 0x01; ///!< The record didn't fit its slot and was cut short
+
+    /**
+     * @brief Publishes records into a POSIX shared-memory ring, for other processes (such as logpp-tail) to follow.
+     *
+     * Writing a record is a sequence number claim and a copy into the ring; there's no file or pipe I/O.
+     * The writer never waits for readers: a reader that falls more than a ring's worth behind loses records,
+     * which it sees as gaps in the sequence numbers (see ShmRingReader::getLostRecords()).
+     * Records longer than a slot are truncated.
+     *
+     * Several writers (threads or processes) may share a ring. Writers a lap apart don't copy into the same slot at once:
+     * the later one waits for the earlier one, or drops its record if the slot already holds a later one.
+     * The ring outlives the writers, so readers can still read what was logged last; remove() deletes it.
+     *
+     * It's also a sink policy for BasicLogger; records written that way don't carry their level.
+     *
+     * @code
+     *  logpp::BasicLogger<logpp::ShmRingSink> logger("svc", LogLevel::Trace, 0, "svc");
+     *  // $ logpp-tail svc
+     * @endcode
+     */
+    class ShmRingSink {
+        public: // +++ Static +++
+            static const uint32_t DEFAULT_SLOT_COUNT = 4096;
+            static const uint32_t DEFAULT_SLOT_SIZE = 512;
+
+            static string getShmName(const string& ringName); ///!< Gets the POSIX shared-memory object name ("/logpp.<ringName>").
+            static bool remove(const string& ringName); ///!< Deletes a ring; processes that have it mapped keep their mapping.
+
+        public:
+            ShmRingSink(const string& ringName, const uint32_t slotCount = DEFAULT_SLOT_COUNT, const uint32_t slotSize = DEFAULT_SLOT_SIZE); ///!< Object constructor; creates the ring or attaches to it. Throws runtime_error on failure.
+            ~ShmRingSink(); ///!< Unmaps the ring, leaving it in place.
+
+            ShmRingSink(const ShmRingSink&) = delete;
+            ShmRingSink& operator=(const ShmRingSink&) = delete;
+
+            /**
+             * @brief Every record is published on its own; the ring is the buffer.
+             */
+            bool writesDirectly(const LogLevel) const { return true; }
+
+            void publish(const LogLevel level, string_view record); ///!< Publishes a single record.
+            void write(string_view buffer); ///!< Publishes each line of a buffer as a record.
+            void writeDirect(string_view record) { publishRecord(SHM_RING_UNKNOWN_LEVEL, record); } ///!< Publishes a single record without its level.
+
+            uint32_t getSlotCount() const { return this->_header->slotCount; } ///!< Gets the number of records the ring holds.
+            uint32_t getMaxRecordLength() const { return this->_header->slotSize - sizeof(ShmRingSlot); } ///!< Gets the length at which records are truncated.
+            uint64_t getNextSequence() const { return this->_header->nextSequence.load(std::memory_order_relaxed); } ///!< Gets the sequence number of the next record.
+
+        private:
+            void publishRecord(const uint8_t level, string_view record);
+            static bool claimSlot(ShmRingSlot* slot, const uint64_t stamp); ///!< Marks a slot as being written, unless a later record owns it.
+
+        private:
+            ShmRingHeader*  _header;
+            size_t          _mappingSize;
+    };
+
+    /**
+     * @brief A record copied out of a shared-memory ring.
+     */
+    struct ShmRingRecord {
+        uint64_t    sequence;
+        uint8_t     level; ///!< The LogLevel, or SHM_RING_UNKNOWN_LEVEL
+        bool        truncated;
+        string      text; ///!< Without the trailing line feed
+    };
+
+    /**
+     * @brief Follows a shared-memory ring written by ShmRingSink.
+     *
+     * Reading never blocks or slows the writers. Records that were overwritten before they could be read
+     * (or while they were being copied) are skipped and counted.
+     */
+    class ShmRingReader {
+        public:
+            ShmRingReader(const string& ringName, const bool fromOldest = false); ///!< Object constructor; maps the ring read-only. Throws runtime_error if it doesn't exist or isn't a ring.
+            ~ShmRingReader(); ///!< Unmaps the ring.
+
+            ShmRingReader(const ShmRingReader&) = delete;
+            ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+            bool read(ShmRingRecord& record); ///!< Copies the next record; false if there's none yet.
+
+            uint64_t getLostRecords() const { return this->_lostRecords; } ///!< Gets the number of records skipped so far because the reader fell behind.
+            uint64_t getNextSequence() const { return this->_nextSequence; } ///!< Gets the sequence number of the next record to read.
+
+        private:
+            const ShmRingHeader*    _header;
+            size_t                  _mappingSize;
+            uint64_t                _nextSequence;
+            uint64_t                _lostRecords;
+    };
+
+}
+
+#endif // LOGPP_SHMRING_HPP
@@ -0,0 +1,46 @@
+/**
+ * ShmRingLogger.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_SHMRINGLOGGER_HPP
+#define LOGPP_SHMRINGLOGGER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+#include "ShmRing.hpp"
+
+namespace logpp {
+
+    /**
+     * @brief A logger which publishes its records into a shared-memory ring, for logpp-tail or other processes to follow.
+     *
+     * Records are formatted as by any other logger and copied straight into the ring, tagged with their level; there's no buffer to flush.
+     * See ShmRingSink for what happens when readers fall behind.
+     *
+     * @code
+     *  auto logger = std::make_shared<logpp::ShmRingLogger>("svc", LogLevel::Trace, "svc");
+     *  // $ logpp-tail svc --level Warning
+     * @endcode
+     */
+    class ShmRingLogger: public ILogger {
+        public:
+            ShmRingLogger(const string& logName, const LogLevel maxLogLevel, const string& ringName,
+                          const uint32_t slotCount = ShmRingSink::DEFAULT_SLOT_COUNT, const uint32_t slotSize = ShmRingSink::DEFAULT_SLOT_SIZE); ///!< Object constructor.
+            virtual ~ShmRingLogger() { flushDuplicateSummary(); } ///!< Virtual destructor; publishes a pending duplicate summary.
+
+            virtual void flushBuffer() override { flushDuplicateSummary(); } ///!< Records are published as they're logged; only a pending duplicate summary is left.
+            virtual void logMessage(const LogLevel level, const string& msg) override; ///!< Publishes a record into the ring.
+
+            ShmRingSink& getSink() { return this->_sink; } ///!< Gets the ring records are published into.
+
+        private:
+            ShmRingSink _sink; ///!< Safe to use without the write mutex
+    };
+
+}
+
+#endif // LOGPP_SHMRINGLOGGER_HPP
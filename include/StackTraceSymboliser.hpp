@@ -0,0 +1,132 @@
+/**
+ * StackTraceSymboliser.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_STACKTRACESYMBOLISER_HPP
+#define LOGPP_STACKTRACESYMBOLISER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace logpp {
+
+    using std::string;
+    using std::thread;
+    using std::vector;
+
+    /**
+     * @brief Adds stack traces to the error records of its loggers, without symbolising them on the failing thread.
+     *
+     * When a registered logger logs a bad log (error, fatal) or a record with an exception, only the raw return addresses
+     * are captured and queued; the record gets a trace=<id> field. A background thread resolves the addresses (dladdr and
+     * the C++ demangler; resolved addresses are cached) and logs the trace to the same logger, at the same level:
+     *
+     * @code
+     *  [  Error  ] Connection lost trace=3
+     *  [  Error  ] Stack trace 3:
+     *      #0 0x55d0c1a4b1f3 Client::reconnect(int)+0x53 (./my-service)
+     *      #1 0x55d0c1a4b6a0 main+0x20 (./my-service)
+     * @endcode
+     *
+     * Link executables with -rdynamic for their own functions to be named; otherwise their frames are given as
+     * module+offset, which addr2line resolves offline.
+     *
+     * If the queue is full, records are logged without a trace and the traces are counted as dropped.
+     * Like with FlushScheduler, loggers must be unregistered (or the symboliser destroyed) before they're destroyed.
+     */
+    class StackTraceSymboliser {
+        public: // +++ Static +++
+            static const uint32_t MAX_FRAMES = 32; ///!< The deepest trace captured
+            static const uint32_t DEFAULT_QUEUE_CAPACITY = 64; ///!< The traces waiting to be symbolised at most
+
+            static string describeAddress(const void* address); ///!< Resolves a return address to "symbol+0xoffset (module)", demangled; uncached.
+
+        public:
+            explicit StackTraceSymboliser(const uint32_t queueCapacity = DEFAULT_QUEUE_CAPACITY); ///!< Object constructor; starts the background thread.
+            virtual ~StackTraceSymboliser(); ///!< Virtual destructor; logs the queued traces, then stops and unregisters all loggers.
+
+            StackTraceSymboliser(const StackTraceSymboliser&) = delete;
+            StackTraceSymboliser& operator=(const StackTraceSymboliser&) = delete;
+
+            StackTraceSymboliser& registerLogger(ILogger* logger); ///!< Adds stack traces to a logger's error records.
+            StackTraceSymboliser& unregisterLogger(ILogger* logger); ///!< Logs the logger's queued traces and stops tracing its records.
+
+            /**
+             * @brief Captures the calling thread's stack and queues it for symbolisation; called by the loggers.
+             *
+             * @param logger The logger to log the trace to.
+             * @param level The level of the record which caused the trace.
+             *
+             * @return uint64_t The trace's id, or 0 if none was captured.
+             */
+            uint64_t capture(ILogger* logger, const LogLevel level);
+
+            /**
+             * @brief Lets the background thread log a captured trace; called once the record referencing it has been logged,
+             *        so the trace never precedes its record.
+             *
+             * @param traceId The id returned by capture().
+             */
+            void release(const uint64_t traceId);
+
+            void flush(); ///!< Waits until the traces queued so far have been logged.
+
+            uint64_t getCapturedTraces() const { return this->_capturedTraces.load(std::memory_order_relaxed); } ///!< Gets the amount of traces queued so far.
+            uint64_t getDroppedTraces() const { return this->_droppedTraces.load(std::memory_order_relaxed); } ///!< Gets the amount of traces lost to a full queue, or to a logger throwing while the trace was logged.
+            size_t getCachedAddresses() const; ///!< Gets the amount of distinct addresses resolved so far.
+
+        private:
+            struct PendingTrace {
+                ILogger*    logger;
+                LogLevel    level;
+                uint64_t    id;
+                uint32_t    depth;
+                bool        released; ///!< Whether its record has been logged
+                void*       frames[MAX_FRAMES];
+            };
+
+            void symboliserLoop();
+            void writeTrace(const PendingTrace& trace);
+            const string& resolveAddress(void* address);
+
+        private:
+            std::mutex                  _loggerMutex; ///!< Guards _loggers; held while a trace is written, so unregistered loggers are no longer touched
+            vector<ILogger*>            _loggers;
+
+            mutable std::mutex          _queueMutex;
+            std::condition_variable     _queueCondition; ///!< Signals new traces to the background thread
+            std::condition_variable     _idleCondition; ///!< Signals written traces to flush()
+            vector<PendingTrace>        _queue; ///!< A ring of preallocated traces, so capturing never allocates
+            uint64_t                    _queueHead; ///!< The next trace to write
+            uint64_t                    _queueTail; ///!< The next free slot
+            bool                        _stopping;
+
+            mutable std::mutex          _cacheMutex;
+            std::unordered_map<const void*, string> _addressCache; ///!< Resolved addresses; only the background thread adds to it
+
+            std::atomic<uint64_t>       _nextTraceId;
+            std::atomic<uint64_t>       _capturedTraces;
+            std::atomic<uint64_t>       _droppedTraces;
+
+            thread                      _symboliserThread;
+    };
+
+}
+
+#endif // LOGPP_STACKTRACESYMBOLISER_HPP
@@ -0,0 +1,438 @@
+/**
+ * StaticFormat.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_STATICFORMAT_HPP
+#define LOGPP_STATICFORMAT_HPP
+
+#if __cplusplus < 201703L
+    #error "StaticFormat.hpp requires C++17 (configure log++ with -Dlogpp_USE_CXX17=ON)"
+#endif
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogClock.hpp"
+#include "LogContext.hpp"
+#include "LogExtensions.hpp"
+#include "LogField.hpp"
+#include "LogFormat.hpp"
+#include "LogLevel.hpp"
+#include "MessageSanitiser.hpp"
+#include "TextFormatter.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief Defines a layout for StaticTextFormatter at namespace scope, e.g. LOGPP_STATIC_FORMAT(ServiceLayout, "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}");
+ */
+#define LOGPP_STATIC_FORMAT(name, formatString) struct name { static constexpr std::string_view pattern = formatString; }
+
+namespace logpp {
+
+    /**
+     * @brief A segment of a format parsed at compile time; literals refer to a slice of the format string.
+     */
+    struct StaticFormatSegment {
+        LogFormat::Token    token;
+        size_t              offset;
+        size_t              length;
+    };
+
+    /**
+     * @brief Parses logger format strings at compile time, with the same variables as LogFormat.
+     *
+     * Unlike LogFormat, which keeps unknown variables as text, an unknown ${variable} is reported,
+     * so StaticFormat can turn it into a compile error.
+     */
+    class StaticFormatParser {
+        public: // +++ Static +++
+            static constexpr size_t ALL_VARIABLES_KNOWN = std::string_view::npos;
+
+            /**
+             * @brief Splits a format into segments.
+             *
+             * @param pattern The format string.
+             * @param onSegment Called as onSegment(token, offset, length) for each segment, in order. Empty literals are left out.
+             *
+             * @return The offset of the first unknown variable, or ALL_VARIABLES_KNOWN.
+             */
+            template<typename OnSegment>
+            static constexpr size_t parse(const std::string_view pattern, OnSegment&& onSegment) {
+                constexpr std::string_view contextValuePrefix = LOG_FORMAT_CONTEXT_VALUE_PREFIX;
+                size_t literalStart = 0;
+                size_t position = 0;
+
+                while ((position = pattern.find("${", position)) != std::string_view::npos) {
+                    const auto closingBrace = pattern.find('}', position + 2);
+                    if (closingBrace == std::string_view::npos) { break; }
+
+                    const auto nameStart = position + 2;
+                    const auto name = pattern.substr(nameStart, closingBrace - nameStart);
+
+                    if (position > literalStart) { onSegment(LogFormat::Token::Literal, literalStart, position - literalStart); }
+
+                    if (name.size() > contextValuePrefix.size() && name.substr(0, contextValuePrefix.size()) == contextValuePrefix) {
+                        onSegment(LogFormat::Token::ContextValue, nameStart + contextValuePrefix.size(), name.size() - contextValuePrefix.size());
+                    } else {
+                        bool isKnownVariable = false;
+                        for (const auto& variable : LOG_FORMAT_VARIABLES) {
+                            if (name == std::string_view(variable.name)) {
+                                onSegment(variable.token, 0, 0);
+                                isKnownVariable = true;
+                                break;
+                            }
+                        }
+
+                        if (!isKnownVariable) { return position; }
+                    }
+
+                    literalStart = closingBrace + 1;
+                    position = literalStart;
+                }
+
+                if (pattern.size() > literalStart) { onSegment(LogFormat::Token::Literal, literalStart, pattern.size() - literalStart); }
+
+                return ALL_VARIABLES_KNOWN;
+            }
+
+            /**
+             * @brief Gets the offset of the first unknown variable in a format, or ALL_VARIABLES_KNOWN.
+             */
+            static constexpr size_t findUnknownVariable(const std::string_view pattern) {
+                return parse(pattern, [](LogFormat::Token, size_t, size_t) { });
+            }
+
+            /**
+             * @brief Gets the amount of segments a format is made of.
+             */
+            static constexpr size_t countSegments(const std::string_view pattern) {
+                size_t count = 0;
+                parse(pattern, [&count](LogFormat::Token, size_t, size_t) { count++; });
+
+                return count;
+            }
+
+            /**
+             * @brief Gets a format's segments.
+             *
+             * @tparam SegmentCount countSegments(pattern)
+             */
+            template<size_t SegmentCount>
+            static constexpr std::array<StaticFormatSegment, SegmentCount> getSegments(const std::string_view pattern) {
+                std::array<StaticFormatSegment, SegmentCount> segments { };
+                size_t index = 0;
+                parse(pattern, [&segments, &index](LogFormat::Token token, size_t offset, size_t length) { segments[index++] = { token, offset, length }; });
+
+                return segments;
+            }
+
+            /**
+             * @brief Gets the most characters a segment can add to a record, not counting the parts only known at runtime
+             * (message, function, exception, class, application name, custom flare and context).
+             */
+            static constexpr size_t getSizeBound(const StaticFormatSegment& segment) {
+                switch (segment.token) {
+                    case LogFormat::Token::Literal:     return segment.length;
+                    case LogFormat::Token::Date:        return 10; // %Y.%m.%d
+                    case LogFormat::Token::Time:        return 8; // %H:%M:%S
+                    case LogFormat::Token::DateTime:    return 19;
+                    case LogFormat::Token::LogLevel:    return 7; // see toString(LogLevel)
+                    case LogFormat::Token::Line:        return 11;
+                    case LogFormat::Token::TimestampNs:
+                    case LogFormat::Token::TimestampUs:
+                    case LogFormat::Token::MonotonicNs: return 20;
+                    case LogFormat::Token::ThreadId:    return 10;
+                    default:                            return 0;
+                }
+            }
+
+            /**
+             * @brief Gets the most characters a format can produce, not counting the parts only known at runtime.
+             */
+            template<size_t SegmentCount>
+            static constexpr size_t getSizeBound(const std::array<StaticFormatSegment, SegmentCount>& segments) {
+                size_t bound = 0;
+                for (const auto& segment : segments) { bound += getSizeBound(segment); }
+
+                return bound;
+            }
+
+            /**
+             * @brief Determines whether a format contains the given variable.
+             */
+            template<size_t SegmentCount>
+            static constexpr bool uses(const std::array<StaticFormatSegment, SegmentCount>& segments, const LogFormat::Token token) {
+                for (const auto& segment : segments) {
+                    if (segment.token == token) { return true; }
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief Determines whether a format needs the record's timestamp, i.e. the clock must be read.
+             */
+            template<size_t SegmentCount>
+            static constexpr bool usesClock(const std::array<StaticFormatSegment, SegmentCount>& segments) {
+                return uses(segments, LogFormat::Token::Date) || uses(segments, LogFormat::Token::Time) || uses(segments, LogFormat::Token::DateTime) ||
+                       uses(segments, LogFormat::Token::TimestampNs) || uses(segments, LogFormat::Token::TimestampUs) || uses(segments, LogFormat::Token::MonotonicNs);
+            }
+    };
+
+    /**
+     * @brief A logger format parsed at compile time.
+     *
+     * @tparam Layout A type with a static constexpr std::string_view pattern; see LOGPP_STATIC_FORMAT.
+     */
+    template<typename Layout>
+    class StaticFormat {
+        public: // +++ Static +++
+            static constexpr std::string_view PATTERN = Layout::pattern;
+
+            static_assert(StaticFormatParser::findUnknownVariable(PATTERN) == StaticFormatParser::ALL_VARIABLES_KNOWN,
+                          "Unknown ${variable} in a static logger format; see LOG_FORMAT_VARIABLES for the ones available");
+
+            static constexpr size_t SEGMENT_COUNT = StaticFormatParser::countSegments(PATTERN);
+            static constexpr std::array<StaticFormatSegment, SEGMENT_COUNT> SEGMENTS = StaticFormatParser::getSegments<SEGMENT_COUNT>(PATTERN);
+
+            static constexpr bool USES_CLOCK = StaticFormatParser::usesClock(SEGMENTS);
+            static constexpr size_t STATIC_SIZE_BOUND = StaticFormatParser::getSizeBound(SEGMENTS); //!< The most characters a record can have, not counting the parts only known at runtime
+
+            /**
+             * @brief Determines whether the format contains the given variable.
+             */
+            static constexpr bool uses(const LogFormat::Token token) { return StaticFormatParser::uses(SEGMENTS, token); }
+    };
+
+    /**
+     * @brief A Formatter policy for BasicLogger with a format fixed at compile time.
+     *
+     * The format is parsed by the compiler into a fixed sequence of appends: there is no segment loop or token switch at runtime,
+     * literals are copied with their length known, and the buffer is reserved once per record.
+     * ${date}, ${time} and ${datetime} use TextFormatter's default layouts (%Y.%m.%d and %H:%M:%S), formatted without strftime.
+     * Like TextFormatter, it sanitises the message, its fields, the exception's message and the context values (see SanitiseMode).
+     *
+     * @code
+     *  LOGPP_STATIC_FORMAT(ServiceLayout, "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}");
+     *  logpp::BasicLogger<logpp::FileSink, logpp::StaticTextFormatter<ServiceLayout>> logger("svc", LogLevel::Info, 64 * 1024, "svc.log", "svc", 10);
+     * @endcode
+     *
+     * @tparam Layout A type with a static constexpr std::string_view pattern; see LOGPP_STATIC_FORMAT. Unknown variables don't compile.
+     */
+    template<typename Layout>
+    class StaticTextFormatter {
+        public: // +++ Static +++
+            using Format = StaticFormat<Layout>;
+
+            static_assert(Format::SEGMENT_COUNT > 0, "A static logger format can't be empty"); // also instantiates Format, so its checks run as soon as the formatter is used
+
+            static constexpr size_t STATIC_SIZE_BOUND = Format::STATIC_SIZE_BOUND; //!< The most characters a record takes up, besides the runtime values
+
+        public:
+            StaticTextFormatter(): _clock(getDefaultLogClock()), _sanitiseMode(SanitiseMode::Escape) { } ///!< Object constructor; records are timestamped by the default clock.
+
+            const string& getClassName() const { return this->_className; } ///!< Gets the value of ${class}.
+            const string& getApplicationName() const { return this->_appName; } ///!< Gets the value of ${appname}.
+            const string& getCustomFlare() const { return this->_customFlare; } ///!< Gets the value of ${custom}.
+            const shared_ptr<ILogClock>& getClock() const { return this->_clock; } ///!< Gets the clock records are timestamped with.
+            SanitiseMode getSanitiseMode() const { return this->_sanitiseMode; } ///!< Gets how messages, exceptions and context values are sanitised.
+
+            void setClassName(const string& className) { this->_className = className; } ///!< Sets the value of ${class}.
+            void setApplicationName(const string& appName) { this->_appName = appName; } ///!< Sets the value of ${appname}.
+            void setCustomFlare(const string& customFlare) { this->_customFlare = customFlare; } ///!< Sets the value of ${custom}.
+            void setClock(shared_ptr<ILogClock> clock) { this->_clock = clock == nullptr ? getDefaultLogClock() : std::move(clock); } ///!< Sets the clock; nullptr restores the default.
+            void setSanitiseMode(const SanitiseMode mode) { this->_sanitiseMode = mode; } ///!< Sets how messages, exceptions and context values are sanitised; SanitiseMode::Off writes them as they are.
+
+            /**
+             * @brief Gets the size to reserve for a record: the static bound plus the lengths of the runtime values the format uses.
+             *
+             * @remarks Structured fields and ${ctx} aren't included; they're rare enough in fixed layouts to let the string grow.
+             */
+            size_t getSizeBound(string_view msg, string_view func) const {
+                return STATIC_SIZE_BOUND +
+                       (Format::uses(LogFormat::Token::Message) ? msg.size() : 0) +
+                       (Format::uses(LogFormat::Token::Function) ? func.size() : 0) +
+                       (Format::uses(LogFormat::Token::Class) ? _className.size() : 0) +
+                       (Format::uses(LogFormat::Token::AppName) ? _appName.size() : 0) +
+                       (Format::uses(LogFormat::Token::Custom) ? _customFlare.size() : 0);
+            }
+
+            /**
+             * @brief Formats a record and appends it to out; the Formatter policy interface (see BasicLogger).
+             *
+             * @param out The string to append to.
+             * @param level The record's level.
+             * @param loggerName The name of the logger. Unused; the text layout has no variable for it.
+             * @param msg The message.
+             * @param fields The record's structured fields, appended to the message as " key=value" pairs.
+             * @param fieldCount The amount of fields.
+             * @param func The function the record was logged from.
+             * @param line The line the record was logged from; left out if negative.
+             * @param except The exception passed with the record; may be nullptr.
+             */
+            void formatTo(string& out, const LogLevel level, string_view loggerName, string_view msg, const LogField* fields, const size_t fieldCount,
+                          string_view func = string_view(), const int32_t line = -1, const exception* except = nullptr) const {
+                if (msg.size() == 0 && fieldCount == 0) { return; }
+
+                out.reserve(out.size() + getSizeBound(msg, func));
+
+                const Record record {
+                    level, msg, fields, fieldCount, func, line, except,
+                    Format::USES_CLOCK ? _clock->now() : LogTimestamp{ 0, 0 }
+                };
+
+                emitSegments(out, record, std::make_index_sequence<Format::SEGMENT_COUNT>());
+            }
+
+        private:
+            /**
+             * @brief Everything a record's variables are rendered from.
+             */
+            struct Record {
+                LogLevel            level;
+                string_view         msg;
+                const LogField*     fields;
+                size_t              fieldCount;
+                string_view         func;
+                int32_t             line;
+                const exception*    except;
+                LogTimestamp        timestamp;
+            };
+
+            template<size_t... Indices>
+            void emitSegments(string& out, const Record& record, std::index_sequence<Indices...>) const {
+                (emitSegment<Indices>(out, record), ...);
+            }
+
+            /**
+             * @brief Appends a single segment; instantiated once per segment, so each one compiles to just its own append.
+             */
+            template<size_t Index>
+            void emitSegment(string& out, const Record& record) const {
+                constexpr StaticFormatSegment segment = Format::SEGMENTS[Index];
+
+                if constexpr (segment.token == LogFormat::Token::Literal) {
+                    out.append(Format::PATTERN.data() + segment.offset, segment.length);
+                } else if constexpr (segment.token == LogFormat::Token::Date) {
+                    out.append(getLocalDateTime(record.timestamp), 10);
+                } else if constexpr (segment.token == LogFormat::Token::Time) {
+                    out.append(getLocalDateTime(record.timestamp) + 11, 8);
+                } else if constexpr (segment.token == LogFormat::Token::DateTime) {
+                    out.append(getLocalDateTime(record.timestamp), 19);
+                } else if constexpr (segment.token == LogFormat::Token::LogLevel) {
+                    appendLogLevel(out, record.level);
+                } else if constexpr (segment.token == LogFormat::Token::Message) {
+                    const auto start = out.size();
+                    out.append(record.msg.data(), record.msg.size());
+                    TextFormatter::appendFields(out, record.fields, record.fieldCount);
+
+                    MessageSanitiser::sanitiseTail(out, start, _sanitiseMode);
+                } else if constexpr (segment.token == LogFormat::Token::Function) {
+                    out.append(record.func.data(), record.func.size());
+                } else if constexpr (segment.token == LogFormat::Token::Line) {
+                    if (record.line >= 0) { TextFormatter::appendInteger(out, record.line); }
+                } else if constexpr (segment.token == LogFormat::Token::Class) {
+                    out.append(_className);
+                } else if constexpr (segment.token == LogFormat::Token::Exception) {
+                    if (record.except != nullptr) { TextFormatter::appendSanitised(out, record.except->what(), _sanitiseMode); }
+                } else if constexpr (segment.token == LogFormat::Token::AppName) {
+                    out.append(_appName);
+                } else if constexpr (segment.token == LogFormat::Token::Custom) {
+                    out.append(_customFlare);
+                } else if constexpr (segment.token == LogFormat::Token::TimestampNs) {
+                    TextFormatter::appendInteger(out, record.timestamp.realtimeNanoseconds);
+                } else if constexpr (segment.token == LogFormat::Token::TimestampUs) {
+                    TextFormatter::appendInteger(out, record.timestamp.realtimeNanoseconds / 1000);
+                } else if constexpr (segment.token == LogFormat::Token::MonotonicNs) {
+                    TextFormatter::appendInteger(out, record.timestamp.monotonicNanoseconds);
+                } else if constexpr (segment.token == LogFormat::Token::ThreadId) {
+                    TextFormatter::appendInteger(out, getCurrentThreadId());
+                } else if constexpr (segment.token == LogFormat::Token::Context) {
+                    TextFormatter::appendSanitised(out, LogContext::getRendered(), _sanitiseMode);
+                } else if constexpr (segment.token == LogFormat::Token::ContextValue) {
+                    const auto value = LogContext::get(string_view(Format::PATTERN.data() + segment.offset, segment.length));
+                    TextFormatter::appendSanitised(out, value, _sanitiseMode);
+                }
+            }
+
+            /**
+             * @brief Appends a level as toString(LogLevel) does, without building a string.
+             */
+            static void appendLogLevel(string& out, const LogLevel level) {
+                static constexpr std::string_view LEVEL_NAMES[] = { " Okay  ", " Info  ", "Warning", " Error ", " Fatal ", " Debug ", " Trace " };
+
+                const auto index = static_cast<uint32_t>(level);
+                if (index >= sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0])) {
+                    out.append("Unknown");
+                    return;
+                }
+
+                out.append(LEVEL_NAMES[index].data(), LEVEL_NAMES[index].size());
+            }
+
+            /**
+             * @brief Gets the local time of a timestamp as "%Y.%m.%d %H:%M:%S" (19 characters, not terminated).
+             *
+             * Rendered once per second and thread; localtime_r() takes a lock in glibc.
+             */
+            static const char* getLocalDateTime(const LogTimestamp& timestamp) {
+                struct DateTimeCache {
+                    time_t  second = -1;
+                    char    text[19];
+                };
+                static thread_local DateTimeCache cache;
+
+                const auto second = static_cast<time_t>(timestamp.realtimeNanoseconds / 1000000000);
+                if (second != cache.second) {
+                    struct tm localTime;
+                    localtime_r(&second, &localTime);
+
+                    const auto writeDigits = [](char* cursor, uint32_t value, uint32_t digits) {
+                        for (cursor += digits; digits > 0; digits--, value /= 10) { *--cursor = static_cast<char>('0' + value % 10); }
+                    };
+
+                    writeDigits(cache.text, static_cast<uint32_t>(localTime.tm_year + 1900) % 10000, 4);
+                    cache.text[4] = '.';
+                    writeDigits(cache.text + 5, static_cast<uint32_t>(localTime.tm_mon + 1), 2);
+                    cache.text[7] = '.';
+                    writeDigits(cache.text + 8, static_cast<uint32_t>(localTime.tm_mday), 2);
+                    cache.text[10] = ' ';
+                    writeDigits(cache.text + 11, static_cast<uint32_t>(localTime.tm_hour), 2);
+                    cache.text[13] = ':';
+                    writeDigits(cache.text + 14, static_cast<uint32_t>(localTime.tm_min), 2);
+                    cache.text[16] = ':';
+                    writeDigits(cache.text + 17, static_cast<uint32_t>(localTime.tm_sec), 2);
+
+                    cache.second = second;
+                }
+
+                return cache.text;
+            }
+
+        private:
+            string                  _className;
+            string                  _appName;
+            string                  _customFlare;
+            shared_ptr<ILogClock>   _clock;
+            SanitiseMode            _sanitiseMode;
+    };
+
+    LOGPP_STATIC_FORMAT(DefaultStaticFormat, "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}"); ///!< ILogger's default layout
+
+}
+
+#endif // LOGPP_STATICFORMAT_HPP
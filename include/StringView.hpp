@@ -0,0 +1,35 @@
+/**
+ * StringView.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_STRINGVIEW_HPP
+#define LOGPP_STRINGVIEW_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#if __cplusplus >= 201703L
+    #include <string_view>
+#else
+    #include <fmt/core.h>
+#endif
+
+namespace logpp {
+
+#if __cplusplus >= 201703L
+    using string_view = std::string_view;
+#else
+    /**
+     * @brief Non-owning string reference for C++14 builds.
+     *
+     * fmt already ships one with the same interface as std::string_view (data(), size(), implicit construction from
+     * const char* and std::string), so there's no point in adding another dependency or rolling our own.
+     */
+    using string_view = fmt::string_view;
+#endif
+
+}
+
+#endif // LOGPP_STRINGVIEW_HPP
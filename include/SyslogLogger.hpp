@@ -0,0 +1,55 @@
+/**
+ * SyslogLogger.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_SYSLOGLOGGER_HPP
+#define LOGPP_SYSLOGLOGGER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ILogger.hpp"
+#include "UnixDatagramSink.hpp"
+
+namespace logpp {
+
+    /**
+     * @brief A logger which sends its records to the local syslog daemon as RFC 5424 messages.
+     *
+     * The level becomes the message's severity; code location and structured fields are sent as structured data.
+     * The logger format defaults to "${lmsg}", since the message header carries the time and severity.
+     * Sending never blocks; see UnixDatagramSink for what happens under load.
+     *
+     * @code
+     *  auto logger = std::make_shared<logpp::SyslogLogger>("http", LogLevel::Info, "my-service", LOG_LOCAL0); // from syslog.h
+     * @endcode
+     */
+    class SyslogLogger: public ILogger {
+        public:
+            SyslogLogger(const string& logName, const LogLevel maxLogLevel, const string& appName = "", const int facility = SYSLOG_FACILITY_USER,
+                         const string& socketPath = SyslogSink::DEFAULT_SOCKET_PATH); ///!< Object constructor.
+            virtual ~SyslogLogger() { flushDuplicateSummary(); } ///!< Virtual destructor; sends a pending duplicate summary.
+
+            virtual void flushBuffer() override { flushDuplicateSummary(); _sink.flush(); } ///!< Sends the records still waiting for the socket, as far as it takes them.
+            virtual void logMessage(const LogLevel level, const string& msg) override; ///!< Sends an already formatted record.
+
+            const string& getAppName() const { return this->_appName; } ///!< Gets the APP-NAME records are sent with.
+            SyslogSink& getSink() { return this->_sink; } ///!< Gets the socket records are sent through.
+
+        protected:
+            virtual void logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                                   const LogField* fields, const size_t fieldCount) override;
+
+        private:
+            SyslogSink  _sink; ///!< Thread-safe on its own
+            string      _appName;
+            string      _hostName;
+            int         _facility;
+            uint32_t    _processId;
+    };
+
+}
+
+#endif // LOGPP_SYSLOGLOGGER_HPP
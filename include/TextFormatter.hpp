@@ -0,0 +1,186 @@
+/**
+ * TextFormatter.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_TEXTFORMATTER_HPP
+#define LOGPP_TEXTFORMATTER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogClock.hpp"
+#include "LogContext.hpp"
+#include "LogExtensions.hpp"
+#include "LogField.hpp"
+#include "LogFormat.hpp"
+#include "LogLevel.hpp"
+#include "MessageSanitiser.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace logpp {
+
+    using std::exception;
+    using std::shared_ptr;
+    using std::string;
+
+    /**
+     * @brief Formats records according to a logger format string (see LogFormat), e.g. "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}".
+     *
+     * This is the text layout every logger uses by default: ILogger keeps one for its format settings,
+     * and BasicLogger uses it as its default Formatter policy.
+     * Structured fields follow the message as " key=value" pairs.
+     * The message, its fields, the exception's message and the context values are sanitised (see SanitiseMode),
+     * so a record can't span lines or inject terminal escapes.
+     */
+    class TextFormatter {
+        public: // +++ Static +++
+            static void appendInteger(string& out, int64_t value); ///!< Appends an integer's decimal representation without going through std::to_string.
+            static void appendFields(string& out, const LogField* fields, const size_t fieldCount); ///!< Appends structured fields as " key=value" pairs.
+
+            /**
+             * @brief Appends text which comes from outside the format (an exception's message, a context value), sanitised.
+             */
+            static void appendSanitised(string& out, string_view text, const SanitiseMode mode) {
+                const auto start = out.size();
+                out.append(text.data(), text.size());
+
+                MessageSanitiser::sanitiseTail(out, start, mode);
+            }
+
+            /**
+             * @brief Appends the plain string representation of a log level.
+             */
+            static void appendLogLevel(string& out, const LogLevel level) { out.append(toString(level)); }
+
+        public:
+            TextFormatter(const string& format = "[ ${date} ${time} ] [ ${llevel} ] ${lmsg}"); ///!< Object constructor; compiles the format.
+
+            const LogFormat& getFormat() const { return this->_format; } ///!< Gets the compiled format.
+            const string& getDateFormat() const { return this->_dateFormat; } ///!< Gets the strftime format used for ${date}.
+            const string& getTimeFormat() const { return this->_timeFormat; } ///!< Gets the strftime format used for ${time}.
+            const string& getDateTimeFormat() const { return this->_dateTimeFormat; } ///!< Gets the strftime format used for ${datetime}.
+            const string& getClassName() const { return this->_className; } ///!< Gets the value of ${class}.
+            const string& getApplicationName() const { return this->_appName; } ///!< Gets the value of ${appname}.
+            const string& getCustomFlare() const { return this->_customFlare; } ///!< Gets the value of ${custom}.
+            const shared_ptr<ILogClock>& getClock() const { return this->_clock; } ///!< Gets the clock records are timestamped with.
+            SanitiseMode getSanitiseMode() const { return this->_sanitiseMode; } ///!< Gets how messages, exceptions and context values are sanitised.
+
+            void setFormat(const string& format) { this->_format = LogFormat(format); } ///!< Compiles and sets a new format.
+            void setDateFormat(const string& dateFormat); ///!< Sets the strftime format used for ${date}.
+            void setTimeFormat(const string& timeFormat); ///!< Sets the strftime format used for ${time}.
+            void setClassName(const string& className) { this->_className = className; } ///!< Sets the value of ${class}.
+            void setApplicationName(const string& appName) { this->_appName = appName; } ///!< Sets the value of ${appname}.
+            void setCustomFlare(const string& customFlare) { this->_customFlare = customFlare; } ///!< Sets the value of ${custom}.
+            void setClock(shared_ptr<ILogClock> clock) { this->_clock = clock == nullptr ? getDefaultLogClock() : std::move(clock); } ///!< Sets the clock; nullptr restores the default.
+            void setSanitiseMode(const SanitiseMode mode) { this->_sanitiseMode = mode; } ///!< Sets how messages, exceptions and context values are sanitised; SanitiseMode::Off writes them as they are.
+
+            void appendLocalTime(string& out, const string& format, const LogTimestamp& timestamp) const; ///!< Appends a timestamp's local time using a strftime format.
+
+            /**
+             * @brief Formats a record and appends it to out; the Formatter policy interface (see BasicLogger).
+             *
+             * @param out The string to append to.
+             * @param level The record's level.
+             * @param loggerName The name of the logger. Unused; the text layout has no variable for it.
+             * @param msg The message.
+             * @param fields The record's structured fields; may be nullptr if fieldCount is 0.
+             * @param fieldCount The amount of fields.
+             * @param func The function the record was logged from.
+             * @param line The line the record was logged from; left out if negative.
+             * @param except The exception passed with the record; may be nullptr.
+             */
+            void formatTo(string& out, const LogLevel level, string_view loggerName, string_view msg, const LogField* fields, const size_t fieldCount,
+                          string_view func = string_view(), const int32_t line = -1, const exception* except = nullptr) const {
+                formatWith(out, level, msg, fields, fieldCount, func, line, except, &TextFormatter::appendLogLevel);
+            }
+
+            /**
+             * @brief Formats a record and appends it to out, letting the caller decorate the log level.
+             *
+             * Walks the precompiled format once; variables which weren't set (class, function, ...) are left empty.
+             * The clock is read once, and only if the format contains a time variable.
+             *
+             * @param appendLevel Called as appendLevel(out, level) for ${llevel}.
+             */
+            template<typename LevelAppender>
+            void formatWith(string& out, const LogLevel level, string_view msg, const LogField* fields, const size_t fieldCount,
+                          string_view func, const int32_t line, const exception* except, LevelAppender&& appendLevel) const {
+                const auto timestamp = _format.usesClock() && !_format.empty() && (msg.size() != 0 || fieldCount != 0) ? _clock->now() : LogTimestamp{ 0, 0 };
+                formatWith(out, timestamp, level, msg, fields, fieldCount, func, line, except, std::forward<LevelAppender>(appendLevel));
+            }
+
+            /**
+             * @brief Formats a record with a timestamp taken by the caller, e.g. one shared by a batch of records.
+             */
+            template<typename LevelAppender>
+            void formatWith(string& out, const LogTimestamp& timestamp, const LogLevel level, string_view msg, const LogField* fields, const size_t fieldCount,
+                          string_view func, const int32_t line, const exception* except, LevelAppender&& appendLevel) const {
+                if (_format.empty() || (msg.size() == 0 && fieldCount == 0)) {
+                    appendMessage(out, msg, fields, fieldCount);
+                    return;
+                }
+
+                for (const auto& segment : _format.getSegments()) {
+                    switch (segment.token) {
+                        case LogFormat::Token::Literal:     out.append(_format.getLiteral(segment), segment.length); break;
+                        case LogFormat::Token::Date:        appendLocalTime(out, _dateFormat, timestamp); break;
+                        case LogFormat::Token::Time:        appendLocalTime(out, _timeFormat, timestamp); break;
+                        case LogFormat::Token::DateTime:    appendLocalTime(out, _dateTimeFormat, timestamp); break;
+                        case LogFormat::Token::LogLevel:    appendLevel(out, level); break;
+                        case LogFormat::Token::Message:     appendMessage(out, msg, fields, fieldCount); break;
+                        case LogFormat::Token::Function:    out.append(func.data(), func.size()); break;
+                        case LogFormat::Token::Line:        if (line >= 0) { appendInteger(out, line); } break;
+                        case LogFormat::Token::Class:       out.append(_className); break;
+                        case LogFormat::Token::Exception:   if (except != nullptr) { appendSanitised(out, except->what(), _sanitiseMode); } break;
+                        case LogFormat::Token::AppName:     out.append(_appName); break;
+                        case LogFormat::Token::Custom:      out.append(_customFlare); break;
+                        case LogFormat::Token::TimestampNs: appendInteger(out, timestamp.realtimeNanoseconds); break;
+                        case LogFormat::Token::TimestampUs: appendInteger(out, timestamp.realtimeNanoseconds / 1000); break;
+                        case LogFormat::Token::MonotonicNs: appendInteger(out, timestamp.monotonicNanoseconds); break;
+                        case LogFormat::Token::ThreadId:    appendInteger(out, getCurrentThreadId()); break;
+                        case LogFormat::Token::Context:     appendSanitised(out, LogContext::getRendered(), _sanitiseMode); break;
+                        case LogFormat::Token::ContextValue:
+                            appendSanitised(out, LogContext::get(string_view(_format.getLiteral(segment), segment.length)), _sanitiseMode);
+                            break;
+                    }
+                }
+            }
+
+        private:
+            /**
+             * @brief Appends the message and its fields, sanitised.
+             */
+            void appendMessage(string& out, string_view msg, const LogField* fields, const size_t fieldCount) const {
+                const auto start = out.size();
+                out.append(msg.data(), msg.size());
+                appendFields(out, fields, fieldCount);
+
+                MessageSanitiser::sanitiseTail(out, start, _sanitiseMode);
+            }
+
+        private:
+            LogFormat               _format;
+            string                  _dateFormat;
+            string                  _timeFormat;
+            string                  _dateTimeFormat; ///!< Always "<date format> <time format>"
+            string                  _className;
+            string                  _appName;
+            string                  _customFlare;
+            shared_ptr<ILogClock>   _clock;
+            SanitiseMode            _sanitiseMode;
+    };
+
+}
+
+#endif // LOGPP_TEXTFORMATTER_HPP
@@ -0,0 +1,96 @@
+/**
+ * TscClock.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_TSCCLOCK_HPP
+#define LOGPP_TSCCLOCK_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+namespace logpp {
+
+    /**
+     * @brief A timestamp clock reading the CPU's time-stamp counter, calibrated against std::chrono::steady_clock.
+     *
+     * Reading the TSC costs a few nanoseconds and involves no system call, which makes it suitable for timing
+     * very short spans. Ticks are converted to nanoseconds only when spans are written out.
+     *
+     * The TSC is only used if the CPU reports it as invariant (constant rate, synchronised across cores);
+     * otherwise, and on architectures without a TSC, ticks are steady_clock nanoseconds.
+     */
+    class TscClock {
+        public: // +++ Static +++
+            /**
+             * @brief Gets the current tick count.
+             */
+            static uint64_t now() {
+                #if defined(__x86_64__) || defined(__i386__)
+                    if (getCalibration().usesTsc) { return __rdtsc(); }
+                #endif
+
+                return getSteadyNanoseconds();
+            }
+
+            /**
+             * @brief Gets a value indicating whether ticks are read from the TSC.
+             */
+            static bool usesTsc() { return getCalibration().usesTsc; }
+
+            /**
+             * @brief Gets the amount of ticks per nanosecond; 1 if the TSC isn't used.
+             */
+            static double getTicksPerNanosecond() { return getCalibration().ticksPerNanosecond; }
+
+            /**
+             * @brief Converts a tick count (as returned by now()) to nanoseconds on the steady_clock time line.
+             */
+            static int64_t toSteadyNanoseconds(const uint64_t ticks) {
+                const auto& calibration = getCalibration();
+                const auto elapsedTicks = static_cast<double>(static_cast<int64_t>(ticks - calibration.baseTicks));
+
+                return calibration.baseNanoseconds + static_cast<int64_t>(elapsedTicks / calibration.ticksPerNanosecond);
+            }
+
+            /**
+             * @brief Converts a difference of two tick counts to nanoseconds.
+             */
+            static uint64_t toNanoseconds(const uint64_t ticks) {
+                return static_cast<uint64_t>(static_cast<double>(ticks) / getCalibration().ticksPerNanosecond);
+            }
+
+        private:
+            /**
+             * @brief The relation between ticks and steady_clock, measured once per process.
+             */
+            struct Calibration {
+                bool        usesTsc;
+                double      ticksPerNanosecond;
+                uint64_t    baseTicks; ///!< A tick count...
+                int64_t     baseNanoseconds; ///!< ...and the steady_clock time it was taken at
+            };
+
+            static int64_t getSteadyNanoseconds() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            static const Calibration& getCalibration() {
+                static const Calibration calibration = calibrate();
+                return calibration;
+            }
+
+            static Calibration calibrate();
+    };
+
+}
+
+#endif // LOGPP_TSCCLOCK_HPP
@@ -0,0 +1,158 @@
+/**
+ * UnixDatagramSink.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_UNIXDATAGRAMSINK_HPP
+#define LOGPP_UNIXDATAGRAMSINK_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogField.hpp"
+#include "LogLevel.hpp"
+#include "StringView.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+
+namespace logpp {
+
+    using std::atomic;
+    using std::exception;
+    using std::string;
+
+    /**
+     * @brief Maps a log level to a syslog severity (LOG_EMERG = 0 ... LOG_DEBUG = 7), as used by journald's PRIORITY field.
+     */
+    int getSyslogSeverity(const LogLevel level);
+
+    const int SYSLOG_FACILITY_USER = 1 << 3; ///!< LOG_USER; syslog.h isn't included, its LOG_* macros clash with too many logging macros
+
+    /**
+     * @brief Sends records as datagrams over a connected, non-blocking Unix datagram socket (e.g. journald's or syslog's).
+     *
+     * Sending never blocks the logging thread. While the receiver keeps up, every record is sent on its own.
+     * Under load, when the socket's queue is full, records are kept and sent in batches with sendmmsg(): whenever MAX_BATCH_SIZE
+     * records have piled up, with the first record sent a millisecond or more after the last attempt, or when flush() is called.
+     * If more than the maximum pending bytes pile up, new records are dropped and counted.
+     *
+     * There is no timer: records kept while the socket was full wait for the next send() or flush(). Callers whose logging may
+     * stop under load flush when it does, or periodically (the loggers' flushBuffer() flushes their sink), or drain() before exiting.
+     *
+     * If the receiver isn't running, records are dropped and reconnection is retried at most once per second.
+     */
+    class UnixDatagramSink {
+        public: // +++ Static +++
+            static const size_t     DEFAULT_MAX_PENDING_BYTES = 1024 * 1024;
+            static const uint32_t   MAX_BATCH_SIZE = 64; ///!< The most datagrams handed to one sendmmsg() call
+            static const uint32_t   CLOSE_DRAIN_TIMEOUT_MS = 100; ///!< How long a sink waits for pending datagrams when it's destroyed
+
+        public:
+            explicit UnixDatagramSink(const string& socketPath, const size_t maxPendingBytes = DEFAULT_MAX_PENDING_BYTES); ///!< Object constructor; connects lazily.
+            virtual ~UnixDatagramSink(); ///!< Tries to send what's pending for a short while, then closes the socket.
+
+            UnixDatagramSink(const UnixDatagramSink&) = delete;
+            UnixDatagramSink& operator=(const UnixDatagramSink&) = delete;
+
+            void send(string_view datagram); ///!< Sends a datagram, or queues it if the socket is full.
+            void flush(); ///!< Sends as much of the pending datagrams as the socket takes, without blocking.
+            bool drain(const std::chrono::milliseconds timeout); ///!< Waits up to timeout for all pending datagrams to be sent.
+
+            const string& getSocketPath() const { return this->_socketPath; } ///!< Gets the path of the receiving socket.
+            size_t getPendingDatagrams() const; ///!< Gets the amount of datagrams waiting for the socket to drain.
+            uint64_t getBatchedDatagrams() const { return this->_batchedDatagrams.load(std::memory_order_relaxed); } ///!< Gets the amount of datagrams sent in batches so far.
+            uint64_t getDroppedDatagrams() const { return this->_droppedDatagrams.load(std::memory_order_relaxed); } ///!< Gets the amount of datagrams lost so far.
+
+        protected:
+            /**
+             * @brief Sends a datagram the socket refused as too large (EMSGSIZE). Called with the sink's lock held.
+             *
+             * @param socketFd The connected socket.
+             * @param datagram The datagram.
+             *
+             * @return false If the datagram couldn't be sent and has to be dropped; the default.
+             */
+            virtual bool sendOversized(const int socketFd, string_view datagram);
+
+        private:
+            bool connectLocked();
+            void closeLocked();
+            bool sendDirectLocked(string_view datagram);
+            void flushLocked();
+
+        private:
+            mutable std::mutex  _sinkMutex;
+            string              _socketPath;
+            int                 _socketFd;
+            std::chrono::steady_clock::time_point _nextConnectAttempt;
+
+            std::deque<string>  _pending;
+            size_t              _pendingBytes;
+            size_t              _maxPendingBytes;
+            uint32_t            _queuedSinceFlush;
+            std::chrono::steady_clock::time_point _nextFlushAttempt;
+
+            atomic<uint64_t>    _batchedDatagrams;
+            atomic<uint64_t>    _droppedDatagrams;
+    };
+
+    /**
+     * @brief Sends records to systemd-journald using its native protocol, so levels, code locations and structured fields
+     *        arrive as journal fields (see `journalctl -o verbose`).
+     *
+     * Records too large for a datagram are written to a sealed memfd whose descriptor is passed to journald instead.
+     */
+    class JournalSink: public UnixDatagramSink {
+        public: // +++ Static +++
+            static const char* const DEFAULT_SOCKET_PATH; ///!< /run/systemd/journal/socket
+
+            static void appendField(string& out, string_view name, string_view value); ///!< Appends a field in the native protocol's encoding.
+            static void appendFieldName(string& out, string_view key); ///!< Appends a structured field's key as a valid journal field name.
+            static void formatEntry(string& out, const LogLevel level, string_view identifier, string_view loggerName, string_view message,
+                                    const LogField* fields, const size_t fieldCount, string_view func, const int32_t line, const exception* except); ///!< Appends a journal entry.
+
+        public:
+            explicit JournalSink(const string& socketPath = DEFAULT_SOCKET_PATH): UnixDatagramSink(socketPath) { } ///!< Object constructor.
+            virtual ~JournalSink() { drain(std::chrono::milliseconds(CLOSE_DRAIN_TIMEOUT_MS)); } ///!< Sends what's pending while oversized entries can still go through a memfd.
+
+        protected:
+            virtual bool sendOversized(const int socketFd, string_view datagram) override;
+    };
+
+    /**
+     * @brief Sends records to the local syslog daemon as RFC 5424 messages.
+     *
+     * Structured fields and the code location are sent as the parameters of a structured-data element ([logpp@32473 ...]).
+     * Records too large for a datagram are truncated.
+     */
+    class SyslogSink: public UnixDatagramSink {
+        public: // +++ Static +++
+            static const char* const DEFAULT_SOCKET_PATH; ///!< /dev/log
+            static const char* const STRUCTURED_DATA_ID; ///!< logpp@32473
+            static const size_t      MAX_TRUNCATED_SIZE = 8192; ///!< The size oversized messages are cut down to
+
+            static void formatEntry(string& out, const int facility, const LogLevel level, const int64_t realtimeNanoseconds, string_view hostName,
+                                    string_view appName, const uint32_t processId, string_view message, const LogField* fields, const size_t fieldCount,
+                                    string_view func, const int32_t line, const exception* except); ///!< Appends an RFC 5424 message.
+
+        public:
+            explicit SyslogSink(const string& socketPath = DEFAULT_SOCKET_PATH): UnixDatagramSink(socketPath) { } ///!< Object constructor.
+            virtual ~SyslogSink() { drain(std::chrono::milliseconds(CLOSE_DRAIN_TIMEOUT_MS)); } ///!< Sends what's pending while oversized messages can still be truncated.
+
+        protected:
+            virtual bool sendOversized(const int socketFd, string_view datagram) override;
+    };
+
+}
+
+#endif // LOGPP_UNIXDATAGRAMSINK_HPP
@@ -9,8 +9,23 @@
 
 #include <iostream>
 
+#include <AsyncLogger.hpp>
+#include <BasicLogger.hpp>
 #include <ConsoleLogger.hpp>
+#include <FlushScheduler.hpp>
 #include <LogExtensions.hpp>
+#include <LogSampling.hpp>
+#include <RateLimiter.hpp>
+#include <LogContext.hpp>
+#include <ScopedTimer.hpp>
+#include <ShmRingLogger.hpp>
+#include <JournalLogger.hpp>
+#include <SyslogLogger.hpp>
+#include <StackTraceSymboliser.hpp>
+#include <EmergencyLog.hpp>
+#if __cplusplus >= 201703L
+    #include <StaticFormat.hpp>
+#endif
 // #include <StreamLogger.hpp>
 
  namespace logpp {
@@ -0,0 +1,167 @@
+/**
+ * AddressTable.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_ADDRESSTABLE_HPP
+#define LOGPP_ADDRESSTABLE_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+namespace logpp { namespace memory {
+
+    /**
+     * @brief A fixed-size, lock-free open-addressing hash table mapping live allocations to a payload.
+     *
+     * Used by the allocation tracker and the heap profiler, so it must never allocate through operator new:
+     * the slots are calloc'd once, and untouched parts of the table take up no physical memory.
+     *
+     * Inserting is a single CAS on a free slot, removing a single store. Probing is bounded by MAX_PROBE_LENGTH;
+     * if no slot is found within that, insert() fails rather than slowing down every allocation.
+     *
+     * @remarks Each address may only be inserted once and only be removed by whoever owns the allocation,
+     * which is always the case for memory handed out by operator new.
+     *
+     * @tparam Payload The data stored per allocation. Must be trivially copyable.
+     */
+    template<typename Payload>
+    class AddressTable {
+        static_assert(std::is_trivially_copyable<Payload>::value, "AddressTable payloads must be trivially copyable");
+
+        public: // +++ Static +++
+            static const uint32_t MAX_PROBE_LENGTH = 64; //!< The maximum amount of slots looked at per operation
+
+        public:
+            /**
+             * @brief Construct a new AddressTable object.
+             *
+             * @param capacity The amount of slots; rounded up to a power of two.
+             */
+            explicit AddressTable(const uint32_t capacity) {
+                uint32_t slotCount = 1;
+                while (slotCount < capacity) { slotCount <<= 1; }
+
+                _slots = static_cast<Slot*>(calloc(slotCount, sizeof(Slot)));
+                _slotMask = _slots == nullptr ? 0 : slotCount - 1;
+            }
+
+            ~AddressTable() { free(_slots); }
+
+            AddressTable(const AddressTable&) = delete;
+            AddressTable& operator=(const AddressTable&) = delete;
+
+            /**
+             * @brief Gets the amount of slots in the table.
+             */
+            uint32_t getCapacity() const { return _slots == nullptr ? 0 : _slotMask + 1; }
+
+            /**
+             * @brief Adds an allocation to the table.
+             *
+             * @return true If the allocation was added.
+             * @return false If no free slot was found.
+             */
+            bool insert(const void* address, const Payload& payload) {
+                if (_slots == nullptr) { return false; }
+
+                const auto startIndex = getSlotIndex(address);
+                for (uint32_t probe = 0; probe < MAX_PROBE_LENGTH; probe++) {
+                    auto& slot = _slots[(startIndex + probe) & _slotMask];
+                    auto current = slot.address.load(std::memory_order_relaxed);
+
+                    if (current != EMPTY_SLOT && current != TOMBSTONE_SLOT) { continue; }
+                    if (!slot.address.compare_exchange_strong(current, RESERVED_SLOT, std::memory_order_acquire)) { continue; }
+
+                    slot.payload = payload;
+                    slot.address.store(reinterpret_cast<uintptr_t>(address), std::memory_order_release);
+                    return true;
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief Removes an allocation from the table.
+             *
+             * @param address The allocation to remove.
+             * @param payload (Optional) Receives the allocation's payload.
+             *
+             * @return true If the allocation was in the table.
+             */
+            bool remove(const void* address, Payload* payload = nullptr) {
+                if (_slots == nullptr) { return false; }
+
+                const auto target = reinterpret_cast<uintptr_t>(address);
+                const auto startIndex = getSlotIndex(address);
+
+                for (uint32_t probe = 0; probe < MAX_PROBE_LENGTH; probe++) {
+                    auto& slot = _slots[(startIndex + probe) & _slotMask];
+                    const auto current = slot.address.load(std::memory_order_acquire);
+
+                    if (current == target) {
+                        // Only the owner of an address frees it, so nobody else can be modifying this slot.
+                        if (payload != nullptr) { *payload = slot.payload; }
+                        slot.address.store(TOMBSTONE_SLOT, std::memory_order_release);
+                        return true;
+                    }
+
+                    if (current == EMPTY_SLOT) { return false; }
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief Calls callback(const void* address, const Payload& payload) for each allocation in the table.
+             *
+             * @remarks Allocations added or removed concurrently may or may not be visited.
+             */
+            template<typename Callback>
+            void forEach(Callback callback) const {
+                for (uint32_t i = 0; _slots != nullptr && i <= _slotMask; i++) {
+                    const auto& slot = _slots[i];
+                    const auto address = slot.address.load(std::memory_order_acquire);
+                    if (address <= RESERVED_SLOT) { continue; }
+
+                    callback(reinterpret_cast<const void*>(address), slot.payload);
+                }
+            }
+
+        private:
+            /**
+             * @brief A single slot. address is one of the markers below or the address of a live allocation,
+             * the payload is written before the address is published.
+             */
+            struct Slot {
+                std::atomic<uintptr_t>  address;
+                Payload                 payload;
+            };
+
+            static const uintptr_t EMPTY_SLOT = 0;
+            static const uintptr_t TOMBSTONE_SLOT = 1;
+            static const uintptr_t RESERVED_SLOT = 2;
+
+            /**
+             * @brief Gets the first slot to probe for an address.
+             */
+            uint32_t getSlotIndex(const void* address) const {
+                // Allocations are at least 16-byte aligned; drop the low bits and mix the rest (Fibonacci hashing).
+                const auto hash = (reinterpret_cast<uintptr_t>(address) >> 4) * 0x9e3779b97f4a7c15ull;
+                return static_cast<uint32_t>(hash >> 32) & _slotMask;
+            }
+
+        private:
+            Slot*       _slots;
+            uint32_t    _slotMask;
+    };
+
+} /* memory */ } /* logpp */
+
+#endif // LOGPP_ADDRESSTABLE_HPP
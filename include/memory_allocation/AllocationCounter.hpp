@@ -0,0 +1,106 @@
+/**
+ * AllocationCounter.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_ALLOCATIONCOUNTER_HPP
+#define LOGPP_ALLOCATIONCOUNTER_HPP
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace logpp { namespace memory {
+
+    /**
+     * @brief Gets a reference to the amount of heap allocations the current thread made.
+     *
+     * @remarks This is only counted in programs which use LOGPP_INSTALL_ALLOCATION_COUNTER.
+     */
+    inline uint64_t& getThreadAllocationCount() {
+        static thread_local uint64_t allocationCount = 0;
+        return allocationCount;
+    }
+
+    /**
+     * @brief Counts the heap allocations made by the current thread while an instance is alive.
+     *
+     * @code
+     *  logger.info("warm-up");
+     *  AllocationScope scope;
+     *  logger.info("Hello, world!");
+     *  assert(scope.getAllocationCount() == 0);
+     * @endcode
+     */
+    class AllocationScope {
+        public:
+            AllocationScope(): _allocationsBefore(getThreadAllocationCount()) { }
+
+            /**
+             * @brief Gets the amount of allocations made by this thread since this object was created.
+             */
+            uint64_t getAllocationCount() const { return getThreadAllocationCount() - _allocationsBefore; }
+
+        private:
+            uint64_t _allocationsBefore;
+    };
+
+} /* memory */ } /* logpp */
+
+#if defined(__cpp_aligned_new)
+    /**
+     * @brief The over-aligned operator new/delete variants (C++17), so they're counted and paired with the other replacements.
+     */
+    #define LOGPP_ALLOCATION_COUNTER_ALIGNED_OPERATORS \
+        void* operator new(std::size_t size, std::align_val_t alignment) { \
+            ++::logpp::memory::getThreadAllocationCount(); \
+            void* memory = nullptr; \
+            const auto memoryAlignment = static_cast<std::size_t>(alignment) < sizeof(void*) ? sizeof(void*) : static_cast<std::size_t>(alignment); \
+            if (posix_memalign(&memory, memoryAlignment, size == 0 ? 1 : size) == 0) { return memory; } \
+            throw std::bad_alloc(); \
+        } \
+        void* operator new[](std::size_t size, std::align_val_t alignment) { return ::operator new(size, alignment); } \
+        void operator delete(void* memory, std::align_val_t) noexcept { ::operator delete(memory); } \
+        void operator delete[](void* memory, std::align_val_t) noexcept { ::operator delete(memory); } \
+        void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { ::operator delete(memory); } \
+        void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { ::operator delete(memory); }
+#else
+    #define LOGPP_ALLOCATION_COUNTER_ALIGNED_OPERATORS
+#endif
+
+/**
+ * @brief Replaces the global operator new/delete with versions which count allocations per thread.
+ *
+ * Use this in exactly one translation unit of a test or benchmark program, at namespace scope.
+ * It is a test hook and should not be used in production code.
+ *
+ * Every variant allocates through the plain operator new (or, if over-aligned, posix_memalign()) and frees through the plain
+ * operator delete, so allocations and deallocations stay paired whichever variant the compiler picks.
+ * The plain operator delete isn't inlined: GCC would see free() called on what operator new returned (-Wmismatched-new-delete).
+ */
+#define LOGPP_INSTALL_ALLOCATION_COUNTER \
+    void* operator new(std::size_t size) { \
+        ++::logpp::memory::getThreadAllocationCount(); \
+        if (void* memory = std::malloc(size == 0 ? 1 : size)) { return memory; } \
+        throw std::bad_alloc(); \
+    } \
+    void* operator new[](std::size_t size) { return ::operator new(size); } \
+    void* operator new(std::size_t size, const std::nothrow_t&) noexcept { \
+        try { return ::operator new(size); } catch (...) { return nullptr; } \
+    } \
+    void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { \
+        try { return ::operator new(size); } catch (...) { return nullptr; } \
+    } \
+    __attribute__((noinline)) void operator delete(void* memory) noexcept { std::free(memory); } \
+    void operator delete[](void* memory) noexcept { ::operator delete(memory); } \
+    void operator delete(void* memory, std::size_t) noexcept { ::operator delete(memory); } \
+    void operator delete[](void* memory, std::size_t) noexcept { ::operator delete(memory); } \
+    void operator delete(void* memory, const std::nothrow_t&) noexcept { ::operator delete(memory); } \
+    void operator delete[](void* memory, const std::nothrow_t&) noexcept { ::operator delete(memory); } \
+    LOGPP_ALLOCATION_COUNTER_ALIGNED_OPERATORS
+
+#endif // LOGPP_ALLOCATIONCOUNTER_HPP
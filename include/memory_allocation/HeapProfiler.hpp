@@ -0,0 +1,192 @@
+/**
+ * HeapProfiler.hpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+#ifndef LOGPP_HEAPPROFILER_HPP
+#define LOGPP_HEAPPROFILER_HPP
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "memory_allocation/AddressTable.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace logpp {
+
+    class ILogger;
+
+namespace memory {
+
+    using std::atomic;
+    using std::string;
+    using std::vector;
+
+    /**
+     * @brief A single allocation site (call stack) of a heap profile.
+     *
+     * Byte counts are estimates extrapolated from the sampled allocations.
+     */
+    struct HeapProfileSite {
+        vector<const void*> frames; ///!< The call stack, innermost frame first
+        uint64_t            liveBytes; ///!< Estimated bytes allocated from here and not yet freed
+        uint64_t            allocatedBytes; ///!< Estimated bytes allocated from here in total
+        double              allocatedBytesPerSecond; ///!< Allocation rate since the previous report
+    };
+
+    /**
+     * @brief A sampling heap profiler, cheap enough to leave enabled in production.
+     *
+     * Rather than recording every allocation, one allocation is sampled per SAMPLE_INTERVAL bytes allocated
+     * on average (the distance between samples is drawn from an exponential distribution, so allocation
+     * patterns can't line up with it). Only sampled allocations have their call stack captured and are
+     * looked at again when freed; all other allocations cost a thread-local subtraction.
+     *
+     * Each sample stands for size / P(sampled) bytes, which keeps the per-site estimates unbiased
+     * regardless of allocation size.
+     *
+     * While running, a summary of the sites with the most live bytes, and their allocation rates, is
+     * periodically written to a logger (typically a FileLogger).
+     *
+     * @remarks The profiler sees allocations going through the hooks in LeakDetection.hpp, i.e. DEBUG_NEW and,
+     * with LOGPP_INSTALL_ALLOCATION_TRACKER, all of operator new. To profile without tracking every allocation,
+     * disable the tracker (AllocationTracker::setEnabled(false)).
+     */
+    class HeapProfiler {
+        public: // +++ Static +++
+            static const uint64_t DEFAULT_SAMPLE_INTERVAL; //!< 512 KiB
+            static const uint32_t MAX_STACK_DEPTH = 32; //!< Frames captured per sample
+            static const uint32_t MAX_SITES; //!< Distinct call stacks kept
+            static const uint32_t MAX_REPORTED_SITES; //!< Sites listed per summary
+
+            static HeapProfiler& getInstance(); ///!< Gets the process-wide profiler. It is never destroyed.
+
+            /**
+             * @brief Gets a value indicating whether allocations are currently being sampled.
+             */
+            static bool isActive() { return _active.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets a value indicating whether the profiler was ever started, i.e. whether frees need to be looked at.
+             */
+            static bool wasStarted() { return _started.load(std::memory_order_relaxed); }
+
+        public:
+            HeapProfiler(const HeapProfiler&) = delete;
+            HeapProfiler& operator=(const HeapProfiler&) = delete;
+
+            /**
+             * @brief Gets the average amount of bytes allocated between two samples.
+             */
+            uint64_t getSampleInterval() const { return this->_sampleInterval.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the amount of samples which couldn't be recorded because the tables were full.
+             */
+            uint64_t getDroppedSampleCount() const { return this->_droppedSamples.load(std::memory_order_relaxed); }
+
+            void start(ILogger& logger, const uint64_t sampleInterval = DEFAULT_SAMPLE_INTERVAL,
+                       const std::chrono::seconds reportInterval = std::chrono::seconds(60)); ///!< Starts sampling and periodic reporting.
+            void stop(); ///!< Stops sampling and reporting.
+
+            /**
+             * @brief Accounts for an allocation; samples it once enough bytes were allocated on this thread.
+             *
+             * @param memory The allocated memory.
+             * @param size The size of the allocation.
+             * @param caller The return address of operator new; the captured call stack starts there.
+             */
+            void recordAllocation(const void* memory, const size_t size, const void* caller) {
+                auto& bytesUntilSample = getThreadBytesUntilSample();
+                bytesUntilSample -= static_cast<int64_t>(size);
+
+                if (bytesUntilSample <= 0) { sampleAllocation(memory, size, caller); }
+            }
+
+            /**
+             * @brief Accounts for freeing memory. Most frees are of unsampled allocations and are rejected by the sample filter.
+             */
+            void recordDeallocation(const void* memory) {
+                if (_sampleFilter[getFilterIndex(memory)].load(std::memory_order_relaxed) != 0) { removeSample(memory); }
+            }
+
+            vector<HeapProfileSite> getProfile() const; ///!< Gets all sites, most live bytes first.
+            string formatProfile() const; ///!< Gets a human-readable summary of the sites with the most live bytes.
+            void logProfile(ILogger& logger); ///!< Logs the summary and starts a new rate interval.
+
+        private:
+            HeapProfiler(); ///!< Object constructor.
+
+            /**
+             * @brief What is kept per sampled allocation.
+             */
+            struct Sample {
+                uint64_t    weight; ///!< The amount of bytes this sample stands for
+                uint32_t    siteIndex;
+            };
+
+            /**
+             * @brief A distinct call stack. hash is 0 (free), 1 (being written) or the stack's hash, published last.
+             */
+            struct Site {
+                atomic<uint64_t>    hash;
+                uint32_t            depth;
+                const void*         frames[MAX_STACK_DEPTH];
+                atomic<uint64_t>    liveBytes;
+                atomic<uint64_t>    allocatedBytes;
+            };
+
+            static const uint32_t SAMPLE_FILTER_SIZE = 4096;
+
+            static uint32_t getFilterIndex(const void* memory) {
+                return static_cast<uint32_t>(((reinterpret_cast<uintptr_t>(memory) >> 4) * 0x9e3779b97f4a7c15ull) >> 52);
+            }
+
+            static int64_t& getThreadBytesUntilSample() {
+                static thread_local int64_t bytesUntilSample = 0;
+                return bytesUntilSample;
+            }
+
+            void sampleAllocation(const void* memory, const size_t size, const void* caller);
+            void removeSample(const void* memory);
+            int64_t getNextSampleDistance();
+            uint32_t findOrAddSite(const void* const* frames, const uint32_t depth);
+            vector<HeapProfileSite> collectSites() const;
+            void reportLoop();
+
+        private:
+            static atomic<bool> _active;
+            static atomic<bool> _started;
+
+            AddressTable<Sample>        _samples;
+            atomic<uint16_t>            _sampleFilter[SAMPLE_FILTER_SIZE]; ///!< Live samples per address hash; keeps frees away from the sample table
+            Site*                       _sites;
+
+            atomic<uint64_t>            _sampleInterval;
+            atomic<uint64_t>            _droppedSamples;
+
+            // Reporting; only touched under _reportMutex
+            mutable std::mutex          _reportMutex;
+            std::condition_variable     _reportCondition;
+            std::thread                 _reportThread;
+            ILogger*                    _reportLogger;
+            std::chrono::seconds        _reportInterval;
+            vector<uint64_t>            _previousAllocatedBytes; ///!< Per site, at the previous report
+            std::chrono::steady_clock::time_point _previousReportTime;
+    };
+
+} /* memory */ } /* logpp */
+
+#endif // LOGPP_HEAPPROFILER_HPP
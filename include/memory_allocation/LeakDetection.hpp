@@ -1,67 +1,197 @@
 /**
  * @file LeakDetection.hpp
  * @author Simon Cahill (simon@h3lix.de)
- * @brief Contains a simple override for new and delete, which can be used to detect and debug memory leaks.
- * @version 0.1
+ * @brief Contains a low-overhead allocation tracker, which can be used to detect and debug memory leaks.
+ * @version 0.2
  * @date 2020-01-29
- * 
+ *
  * @copyright Copyright (c) 2020
- * 
+ *
  */
 
 #ifndef LOGPP_LEAKDETECTION_HPP
 #define LOGPP_LEAKDETECTION_HPP
 
-#include "ConsoleLogger.hpp"
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "memory_allocation/AddressTable.hpp"
 
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
 #include <string>
+#include <vector>
 
-using std::string;
-namespace logpp { namespace memory {
+namespace logpp {
 
+    class ILogger;
+
+namespace memory {
+
+    using std::atomic;
+    using std::string;
+    using std::vector;
+
+    /**
+     * @brief Gets a reference to a flag which is set while the current thread is inside the allocation hooks' own code
+     * (e.g. building a report), so the allocations made there aren't tracked or profiled.
+     */
+    inline bool& isInsideAllocationHook() {
+        static thread_local bool insideHook = false;
+        return insideHook;
+    }
 
     /**
-     * @brief Very simple class which outputs memory allocations/deallocations to console.
+     * @brief Sets isInsideAllocationHook() for its lifetime.
      */
-    class LeakLogger {
+    class AllocationHookGuard {
         public:
-            static LeakLogger& getInstance() {
-                return  (_instance == nullptr) ?
-                       *(_instance = new LeakLogger()) :
-                       * _instance;
-            }
-
-            ~LeakLogger() {
-                delete _instance;
-                delete _consoleLogger;
-            }
-
-        public: // +++ Logging +++
-            void allocatedMemory(const size_t bytes, const string file, const int32_t line) {
-                _consoleLogger->trace(formatString("Allocated memory (%d Bytes) in %s:%d!", bytes, getBaseName(file).c_str(), line));
-            }
-
-            void deallocatedMemory(const string file, const int32_t line) {
-                _consoleLogger->trace(formatString("Deallocated memory in %s:%d!", getBaseName(file).c_str(), line));
-            }
+            AllocationHookGuard(): _wasInside(isInsideAllocationHook()) { isInsideAllocationHook() = true; }
+            ~AllocationHookGuard() { isInsideAllocationHook() = _wasInside; }
 
         private:
-            LeakLogger(): _consoleLogger(new ConsoleLogger("Memory Allocation", LOGLEVEL_MAXVALUE, true, 0, true)) { }
+            bool _wasInside;
+    };
+
+    string describeAddress(const void* address); ///!< Gets a readable name (symbol+offset) for a code address.
+
+    /**
+     * @brief The live allocations made from a single call site, as reported by AllocationTracker::getLiveAllocationsBySite().
+     */
+    struct AllocationSiteReport {
+        const char*     file; ///!< The file passed to DEBUG_NEW, or nullptr
+        int32_t         line; ///!< The line passed to DEBUG_NEW, or -1
+        const void*     caller; ///!< The return address of operator new, for allocations without file and line
+        uint64_t        allocations;
+        uint64_t        bytes;
+    };
+
+    /**
+     * @brief Keeps track of live heap allocations, so leaks can be reported grouped by call site.
+     *
+     * Allocations are kept in a fixed-size, lock-free open-addressing hash table keyed by address.
+     * Tracking an allocation is a single CAS on a slot; untracking it a single store. Nothing in the
+     * tracking path allocates, locks or logs, so the tracker can be left on under load.
+     *
+     * Allocations made via DEBUG_NEW are recorded with their file and line; all others (if the tracking
+     * operators are installed with LOGPP_INSTALL_ALLOCATION_TRACKER) with the address they were made from.
+     *
+     * @remarks If the table is full (or an address' probe sequence is), an allocation is counted as untracked
+     * instead of slowing down all allocations.
+     */
+    class AllocationTracker {
+        public: // +++ Static +++
+            static const uint32_t DEFAULT_CAPACITY; //!< Slots in the table; one live allocation each
+
+            static AllocationTracker& getInstance(); ///!< Gets the process-wide tracker. It is never destroyed.
+
+        public:
+            AllocationTracker(const AllocationTracker&) = delete;
+            AllocationTracker& operator=(const AllocationTracker&) = delete;
+
+            /**
+             * @brief Gets a value indicating whether allocations are being tracked.
+             */
+            bool isEnabled() const { return this->_enabled.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the sampling interval; 1 in N allocations is tracked.
+             */
+            uint32_t getSampleInterval() const { return this->_sampleInterval.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Gets the amount of allocations which could not be tracked because the table was full.
+             */
+            uint64_t getUntrackedCount() const { return this->_untrackedCount.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Enables or disables tracking. Allocations which are already tracked are still untracked when freed.
+             */
+            void setEnabled(const bool enabled) { this->_enabled.store(enabled, std::memory_order_relaxed); }
+
+            /**
+             * @brief Only tracks 1 in interval allocations (per thread).
+             *
+             * @remarks Sampling reduces the overhead further; reported counts and sizes are then those of the sampled allocations.
+             */
+            void setSampleInterval(const uint32_t interval) { this->_sampleInterval.store(interval == 0 ? 1 : interval, std::memory_order_relaxed); }
+
+            void* allocate(const size_t size, const char* file, const int32_t line, const void* caller); ///!< Allocates memory and tracks it.
+            void deallocate(void* memory); ///!< Untracks and frees memory.
+
+            void track(const void* memory, const size_t size, const char* file, const int32_t line, const void* caller); ///!< Tracks an allocation made elsewhere.
+            bool untrack(const void* memory); ///!< Stops tracking an allocation.
+
+            vector<AllocationSiteReport> getLiveAllocationsBySite() const; ///!< Gets the live allocations grouped by call site, largest first.
+            string formatLeakReport() const; ///!< Gets a human-readable report of the live allocations.
+            void logLeakReport(ILogger& logger) const; ///!< Logs the report as warnings.
+
+            void reportLeaksAtExit(ILogger* logger = nullptr); ///!< Logs the report (or prints it to stderr) when the process exits.
+
+        private:
+            AllocationTracker(const uint32_t capacity); ///!< Object constructor.
+
+            /**
+             * @brief What is known about a tracked allocation.
+             */
+            struct TrackedAllocation {
+                uint64_t        size;
+                const char*     file;
+                const void*     caller;
+                int32_t         line;
+            };
+
+            bool shouldSample();
+
+            static void atExitHandler();
 
         private:
-            ConsoleLogger* _consoleLogger = nullptr;
+            AddressTable<TrackedAllocation> _allocations;
 
-            static LeakLogger* _instance;
+            atomic<bool>        _enabled;
+            atomic<uint32_t>    _sampleInterval;
+            atomic<uint64_t>    _untrackedCount;
+
+            atomic<bool>        _exitReportRegistered;
+            atomic<ILogger*>    _exitLogger;
     };
 
 } /* memory */ } /* logpp */
 
-void* operator new(const size_t, const string, const int32_t);
-void* operator new[](const size_t, const string, const int32_t);
-void operator delete(void*, const string, const int32_t);
-void operator delete[](void*, const string, const int32_t);
+// Tracked allocations: Foo* foo = DEBUG_NEW Foo(); records this file and line.
+// The matching placement deletes are only called by the compiler if a constructor throws.
+void* operator new(const std::size_t size, const char* file, const int32_t line);
+void* operator new[](const std::size_t size, const char* file, const int32_t line);
+void operator delete(void* memory, const char* file, const int32_t line) noexcept;
+void operator delete[](void* memory, const char* file, const int32_t line) noexcept;
+
 #define DEBUG_NEW new(__FILE__, __LINE__)
 //#define new DEBUG_NEW
-#define DEBUG_DELETE delete(__FILE__, __LINE__)
-//#define DEBUG_DELETE[] delete[](__FILE__, __LINE__)
-#endif // LOGPP_LEAKDETECTION_HPP
\ No newline at end of file
+
+/**
+ * @brief Replaces the global operator new/delete with versions which track allocations.
+ *
+ * Use this in exactly one translation unit of the program, at namespace scope. Without it, DEBUG_NEW allocations are
+ * tracked but plain deletes can't untrack them, so every DEBUG_NEW allocation would be reported as a leak.
+ *
+ * @remarks This and LOGPP_INSTALL_ALLOCATION_COUNTER both replace the global operators and are mutually exclusive.
+ * The operators must not be inlined into their callers; their return address is the allocation's call site.
+ */
+#define LOGPP_INSTALL_ALLOCATION_TRACKER \
+    __attribute__((noinline)) void* operator new(std::size_t size) { \
+        return ::logpp::memory::AllocationTracker::getInstance().allocate(size, nullptr, -1, __builtin_return_address(0)); \
+    } \
+    __attribute__((noinline)) void* operator new[](std::size_t size) { \
+        return ::logpp::memory::AllocationTracker::getInstance().allocate(size, nullptr, -1, __builtin_return_address(0)); \
+    } \
+    void operator delete(void* memory) noexcept { ::logpp::memory::AllocationTracker::getInstance().deallocate(memory); } \
+    void operator delete[](void* memory) noexcept { ::logpp::memory::AllocationTracker::getInstance().deallocate(memory); } \
+    void operator delete(void* memory, std::size_t) noexcept { ::logpp::memory::AllocationTracker::getInstance().deallocate(memory); } \
+    void operator delete[](void* memory, std::size_t) noexcept { ::logpp::memory::AllocationTracker::getInstance().deallocate(memory); }
+
+#endif // LOGPP_LEAKDETECTION_HPP
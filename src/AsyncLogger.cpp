@@ -0,0 +1,336 @@
+/**
+ * AsyncLogger.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "AsyncLogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace logpp {
+
+    using std::invalid_argument;
+    using std::lock_guard;
+    using std::mutex;
+    using std::unique_lock;
+
+    const uint32_t AsyncLogger::DEFAULT_QUEUE_CAPACITY = 8192;
+    const uint32_t AsyncLogger::WORKER_BATCH_SIZE = 64;
+
+    namespace {
+        /**
+         * @brief Removes the padding toString() adds to level names.
+         */
+        string trimString(const string& str) {
+            const auto first = str.find_first_not_of(' ');
+            if (first == string::npos) { return ""; }
+
+            return str.substr(first, str.find_last_not_of(' ') - first + 1);
+        }
+    }
+
+    /**
+     * @brief Gets the name of an overflow policy, as used in drop records.
+     */
+    string toString(const OverflowPolicy policy) {
+        switch (policy) {
+            case OverflowPolicy::Block:         return "block";
+            case OverflowPolicy::DropNewest:    return "drop-newest";
+            case OverflowPolicy::DropOldest:    return "drop-oldest";
+            case OverflowPolicy::CounterOnly:   return "counter-only";
+            default:                            return "unknown";
+        }
+    }
+
+    /**
+     * @brief Construct a new AsyncLogger object and start its worker.
+     *
+     * @param logName The name for this logger.
+     * @param maxLogLevel The maximum log level to queue.
+     * @param backend The logger the worker writes records to.
+     * @param queueCapacity The maximum amount of records queued per lane.
+     */
+    AsyncLogger::AsyncLogger(const string& logName, const LogLevel maxLogLevel, shared_ptr<ILogger> backend, const uint32_t queueCapacity):
+    ILogger(logName, maxLogLevel, 0, false), _backend(std::move(backend)), _queueCapacity(queueCapacity), _flushesRequested(0), _flushesDone(0), _stopping(false), _droppedTotal(0) {
+        if (_backend == nullptr) {
+            throw invalid_argument("Backend must not be null!");
+        }
+
+        if (queueCapacity == 0) {
+            throw invalid_argument("Queue capacity must be greater than zero!");
+        }
+
+        for (auto& lane : _lanes) {
+            lane.slots.resize(queueCapacity);
+            lane.demoted.fill(0);
+        }
+        _lanes[static_cast<uint32_t>(AsyncLane::Bad)].policy = OverflowPolicy::Block;
+
+        _workerThread = thread(&AsyncLogger::workerLoop, this);
+    }
+
+    /**
+     * @brief Destroy the AsyncLogger object.
+     *
+     * @remarks Everything queued up to here is written before the worker stops. Blocked producers are released and their records dropped.
+     */
+    AsyncLogger::~AsyncLogger() {
+        flushDuplicateSummary();
+
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            _stopping = true;
+        }
+
+        _notEmpty.notify_all();
+        for (auto& lane : _lanes) { lane.notFull.notify_all(); }
+
+        if (_workerThread.joinable()) { _workerThread.join(); }
+
+        _backend->flushBuffer();
+    }
+
+    /**
+     * @brief Gets the policy applied to records arriving while a lane is full.
+     */
+    OverflowPolicy AsyncLogger::getOverflowPolicy(const AsyncLane lane) const {
+        lock_guard<mutex> lock(_queueMutex);
+        return _lanes[static_cast<uint32_t>(lane)].policy;
+    }
+
+    /**
+     * @brief Sets the policy applied to records arriving while a lane is full.
+     *
+     * @param lane The lane to configure.
+     * @param policy The new policy. Producers blocked by the previous policy re-check the lane and apply the new one.
+     */
+    void AsyncLogger::setOverflowPolicy(const AsyncLane lane, const OverflowPolicy policy) {
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            _lanes[static_cast<uint32_t>(lane)].policy = policy;
+        }
+
+        _lanes[static_cast<uint32_t>(lane)].notFull.notify_all();
+    }
+
+    /**
+     * @brief Gets the amount of records waiting for the worker in both lanes.
+     */
+    uint32_t AsyncLogger::getQueueDepth() const {
+        lock_guard<mutex> lock(_queueMutex);
+        return _lanes[0].count + _lanes[1].count;
+    }
+
+    /**
+     * @brief Has the worker flush the backend once it handed everything queued to it, and waits for that.
+     *
+     * The backend is flushed on the worker thread, so it's never called from two threads at once.
+     *
+     * @remarks Called on the worker thread (e.g. from within the backend), this flushes the backend right away.
+     */
+    void AsyncLogger::flushBuffer() {
+        flushDuplicateSummary();
+
+        unique_lock<mutex> lock(_queueMutex);
+        if (std::this_thread::get_id() == _workerId) {
+            lock.unlock();
+            _backend->flushBuffer();
+            return;
+        }
+
+        const auto request = ++_flushesRequested;
+        _notEmpty.notify_one();
+
+        _flushed.wait(lock, [this, request] { return _stopping || _flushesDone >= request; });
+    }
+
+    /**
+     * @brief Copies a formatted record into its lane, applying the lane's overflow policy if it is full.
+     *
+     * @param level The log level of the message.
+     * @param msg The formatted message.
+     */
+    void AsyncLogger::logMessage(const LogLevel level, const string& msg) {
+        if (level > getCurrentMaxLogLevel() || msg.empty()) return;
+
+        uint32_t depth = 0;
+        {
+            unique_lock<mutex> lock(_queueMutex);
+            auto& lane = getLane(level);
+
+            while (lane.count == _queueCapacity) {
+                auto policy = lane.policy;
+
+                // Nobody would make room for the worker itself, nor after the worker stopped.
+                if (policy == OverflowPolicy::Block && (_stopping || std::this_thread::get_id() == _workerId)) {
+                    policy = OverflowPolicy::DropNewest;
+                }
+
+                if (policy == OverflowPolicy::Block) {
+                    lane.notFull.wait(lock);
+                    continue;
+                }
+
+                countDropped(lane, level);
+                if (policy != OverflowPolicy::DropOldest) { return; }
+
+                lane.head = (lane.head + 1) % _queueCapacity;
+                lane.count--;
+            }
+
+            auto& slot = lane.slots[(lane.head + lane.count) % _queueCapacity];
+            slot.level = level;
+            slot.msg.assign(msg);
+            lane.count++;
+
+            depth = _lanes[0].count + _lanes[1].count;
+        }
+
+        // The worker only waits while both lanes are empty; for every other record, it'll find it without being woken up.
+        if (depth == 1) { _notEmpty.notify_one(); }
+
+        if (metricsEnabled()) { getMetrics().recordQueueDepth(depth); }
+    }
+
+    /**
+     * @brief Has the backend write an emergency record, after its buffered records if this logger could drain its own.
+     *
+     * @param level The level of the record.
+     * @param buffered This logger's buffer, which stays empty as records are queued instead; nullptr if it couldn't be had.
+     * @param record The formatted record, including its line feed.
+     */
+    void AsyncLogger::writeEmergencyRecord(const LogLevel level, const LogBuffer* buffered, string_view record) {
+        // The writer flag is shared by all loggers, so holding it for this logger's buffer means holding it for the backend's
+        forwardEmergencyRecord(*_backend, level, buffered != nullptr, record);
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Counts a record lost to a full lane. Must be called with _queueMutex held.
+     */
+    void AsyncLogger::countDropped(Lane& lane, const LogLevel level) {
+        if (lane.policy == OverflowPolicy::CounterOnly) {
+            lane.demoted[static_cast<uint32_t>(level)]++;
+        } else {
+            lane.dropped++;
+        }
+
+        _droppedTotal.fetch_add(1, std::memory_order_relaxed);
+        if (metricsEnabled()) { getMetrics().recordDropped(); }
+    }
+
+    /**
+     * @brief Builds the drop record for a lane, if it lost records and has drained to half its capacity.
+     * Must be called with _queueMutex held.
+     *
+     * @param lane The lane.
+     * @param laneId The lane's id, for the message.
+     * @param out The string to write the message to.
+     *
+     * @return true If out contains a drop record, which has to be logged.
+     */
+    bool AsyncLogger::takeDropReport(Lane& lane, const AsyncLane laneId, string& out) {
+        if (lane.count > _queueCapacity / 2) { return false; }
+
+        uint64_t demoted = 0;
+        for (auto count : lane.demoted) { demoted += count; }
+        if (lane.dropped == 0 && demoted == 0) { return false; }
+
+        const char* laneName = laneId == AsyncLane::Bad ? "bad" : "normal";
+        out.clear();
+
+        if (lane.dropped != 0) {
+            fmt::format_to(std::back_inserter(out), "AsyncLogger: dropped {} records from the {} lane (queue full, policy {})",
+                           lane.dropped, laneName, toString(lane.policy));
+        }
+
+        if (demoted != 0) {
+            if (!out.empty()) { out += "; "; }
+            fmt::format_to(std::back_inserter(out), "AsyncLogger: {} records from the {} lane counted but not logged (queue full):", demoted, laneName);
+
+            for (uint32_t level = 0; level < LOG_LEVEL_COUNT; level++) {
+                if (lane.demoted[level] == 0) { continue; }
+                fmt::format_to(std::back_inserter(out), " {}={}", trimString(toString(static_cast<LogLevel>(level))), lane.demoted[level]);
+            }
+        }
+
+        lane.dropped = 0;
+        lane.demoted.fill(0);
+
+        return true;
+    }
+
+    /**
+     * @brief Takes batches of records from the queue, bad lane first, and writes them to the backend.
+     *
+     * The queue lock is only held while moving records out of the lanes; slots and batch entries swap their strings,
+     * so neither side allocates once both have grown to the usual record size.
+     * Flushes requested by flushBuffer() are done once the lanes are empty, after the batch which emptied them.
+     */
+    void AsyncLogger::workerLoop() {
+        vector<QueuedRecord> batch(WORKER_BATCH_SIZE);
+        string dropReports[2];
+        bool hasDropReport[2] = { false, false };
+
+        unique_lock<mutex> lock(_queueMutex);
+        _workerId = std::this_thread::get_id();
+
+        while (true) {
+            _notEmpty.wait(lock, [this] { return _stopping || _lanes[0].count != 0 || _lanes[1].count != 0 || _flushesRequested != _flushesDone; });
+
+            uint32_t taken = 0;
+            for (const auto laneId : { AsyncLane::Bad, AsyncLane::Normal }) {
+                auto& lane = _lanes[static_cast<uint32_t>(laneId)];
+                const bool wasFull = lane.count == _queueCapacity;
+
+                while (lane.count != 0 && taken < WORKER_BATCH_SIZE) {
+                    auto& slot = lane.slots[lane.head];
+                    batch[taken].level = slot.level;
+                    batch[taken].msg.swap(slot.msg);
+                    taken++;
+
+                    lane.head = (lane.head + 1) % _queueCapacity;
+                    lane.count--;
+                }
+
+                if (wasFull && lane.count != _queueCapacity) { lane.notFull.notify_all(); }
+
+                const auto index = static_cast<uint32_t>(laneId);
+                hasDropReport[index] = takeDropReport(lane, laneId, dropReports[index]);
+            }
+
+            if (taken == 0 && _stopping && !hasDropReport[0] && !hasDropReport[1]) { break; }
+
+            const auto flushRequest = _flushesRequested;
+            const bool flush = flushRequest != _flushesDone && _lanes[0].count == 0 && _lanes[1].count == 0;
+            lock.unlock();
+
+            for (uint32_t i = 0; i < taken; i++) { _backend->logMessage(batch[i].level, batch[i].msg); }
+
+            if (hasDropReport[1]) { _backend->logMessage(LogLevel::Error, formatLogMessage(dropReports[1], LogLevel::Error)); }
+            if (hasDropReport[0]) { _backend->logMessage(LogLevel::Warning, formatLogMessage(dropReports[0], LogLevel::Warning)); }
+
+            if (flush) { _backend->flushBuffer(); }
+
+            lock.lock();
+            if (flush) {
+                _flushesDone = flushRequest;
+                _flushed.notify_all();
+            }
+        }
+
+        _flushed.notify_all();
+    }
+
+}
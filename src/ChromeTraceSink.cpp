@@ -0,0 +1,147 @@
+/**
+ * ChromeTraceSink.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ChromeTraceSink.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+namespace logpp {
+
+    using std::lock_guard;
+    using std::mutex;
+    using std::runtime_error;
+
+    namespace {
+        void appendLiteral(fmt::memory_buffer& buffer, const char* literal) {
+            buffer.append(literal, literal + strlen(literal));
+        }
+
+        /**
+         * @brief Appends a JSON string literal (including quotes) to a buffer.
+         */
+        void appendJsonString(fmt::memory_buffer& buffer, const char* value) {
+            buffer.push_back('"');
+
+            const char* runStart = value == nullptr ? "" : value;
+            const char* current = runStart;
+            for (; *current != '\0'; current++) {
+                const auto character = static_cast<unsigned char>(*current);
+                if (character != '"' && character != '\\' && character >= 0x20) { continue; }
+
+                // Copy the unescaped run in one go, then the escape.
+                buffer.append(runStart, current);
+                runStart = current + 1;
+
+                if (character < 0x20) {
+                    fmt::format_to(std::back_inserter(buffer), "\\u{:04x}", character);
+                } else {
+                    buffer.push_back('\\');
+                    buffer.push_back(*current);
+                }
+            }
+
+            buffer.append(runStart, current);
+            buffer.push_back('"');
+        }
+
+        void appendInteger(fmt::memory_buffer& buffer, const uint64_t value) {
+            const fmt::format_int formatted(value);
+            buffer.append(formatted.data(), formatted.data() + formatted.size());
+        }
+
+        /**
+         * @brief Appends nanoseconds as fractional microseconds, the unit of the trace-event format.
+         */
+        void appendMicroseconds(fmt::memory_buffer& buffer, const uint64_t nanoseconds) {
+            const auto fraction = nanoseconds % 1000;
+
+            appendInteger(buffer, nanoseconds / 1000);
+            buffer.push_back('.');
+            buffer.push_back(static_cast<char>('0' + fraction / 100));
+            buffer.push_back(static_cast<char>('0' + fraction / 10 % 10));
+            buffer.push_back(static_cast<char>('0' + fraction % 10));
+        }
+    }
+
+    /**
+     * @brief Construct a new ChromeTraceSink object.
+     *
+     * @param filename The file to write the trace to. An existing file is overwritten.
+     */
+    ChromeTraceSink::ChromeTraceSink(const string& filename): _hasEvents(false), _processId(static_cast<uint32_t>(getpid())) {
+        _file = fopen(filename.c_str(), "w");
+
+        if (_file == nullptr) {
+            throw runtime_error(fmt::format("Failed to create trace file {}: {}", filename, strerror(errno)));
+        }
+
+        fputs("[\n", _file);
+    }
+
+    /**
+     * @brief Destroy the ChromeTraceSink object, completing the JSON document.
+     */
+    ChromeTraceSink::~ChromeTraceSink() {
+        lock_guard<mutex> lock(_fileMutex);
+
+        fputs("\n]\n", _file);
+        fclose(_file);
+    }
+
+    /**
+     * @brief Writes a batch of spans as complete events.
+     */
+    void ChromeTraceSink::writeSpans(const TraceSpan* spans, const size_t count) {
+        fmt::memory_buffer buffer;
+
+        for (size_t i = 0; i < count; i++) {
+            const auto& span = spans[i];
+
+            appendLiteral(buffer, i == 0 ? "{\"name\":" : ",\n{\"name\":");
+            appendJsonString(buffer, span.name);
+            appendLiteral(buffer, ",\"cat\":");
+            appendJsonString(buffer, span.category);
+            appendLiteral(buffer, ",\"ph\":\"X\",\"ts\":");
+            appendMicroseconds(buffer, static_cast<uint64_t>(TscClock::toSteadyNanoseconds(span.beginTicks)));
+            appendLiteral(buffer, ",\"dur\":");
+            appendMicroseconds(buffer, TscClock::toNanoseconds(span.endTicks - span.beginTicks));
+            appendLiteral(buffer, ",\"pid\":");
+            appendInteger(buffer, _processId);
+            appendLiteral(buffer, ",\"tid\":");
+            appendInteger(buffer, span.threadId);
+            buffer.push_back('}');
+        }
+
+        if (buffer.size() == 0) { return; }
+
+        lock_guard<mutex> lock(_fileMutex);
+
+        if (_hasEvents) { fputs(",\n", _file); }
+        fwrite(buffer.data(), 1, buffer.size(), _file);
+        _hasEvents = true;
+    }
+
+    /**
+     * @brief Flushes the file.
+     */
+    void ChromeTraceSink::flush() {
+        lock_guard<mutex> lock(_fileMutex);
+
+        fflush(_file);
+    }
+
+}
@@ -15,11 +15,13 @@
  ***************************/
 #include <iostream>
 #include <ostream>
+#include <vector>
 
 namespace logpp {
 
     using std::iostream;
     using std::ostream;
+    using std::vector;
 
     /**
      * @brief Construct a new Console Logger:: Console Logger object
@@ -31,7 +33,7 @@ namespace logpp {
      * @param flushBufferAfterWrite Indicates whether to flush the buffer after each write to it.
      */
     ConsoleLogger::ConsoleLogger(const string& logName, const LogLevel maxLogLevel, const bool outputBadLogsToStderr, const uint32_t bufferSize, const bool flushBufferAfterWrite):
-    ILogger(logName, maxLogLevel, flushBufferAfterWrite, bufferSize), _fileLogger(nullptr), _logToFile(false), _colourLogLevels(true) {
+    ILogger(logName, maxLogLevel, bufferSize, flushBufferAfterWrite), _fileLogger(nullptr), _logToFile(false), _colourLogLevels(true) {
         setOutputBadLogsToStderr(outputBadLogsToStderr);
     }
 
@@ -49,7 +51,7 @@ namespace logpp {
      */
     ConsoleLogger::ConsoleLogger(const string& logName, const LogLevel maxLogLevel, const bool outputBadLogsToStderr, const uint32_t bufferSize, const bool flushBufferAfterWrite,
                                  const bool logToFile, const string& logPath, const uint32_t maxFileSize): 
-    ConsoleLogger(logName, maxLogLevel, outputBadLogsToStderr, flushBufferAfterWrite, bufferSize) {
+    ConsoleLogger(logName, maxLogLevel, outputBadLogsToStderr, bufferSize, flushBufferAfterWrite) {
         this->_logToFile = logToFile;
         if (_logToFile) {
             _fileLogger = new FileLogger(logName, maxLogLevel, fmt::format("{}/{}.log", logPath, logName), bufferSize, maxFileSize, flushBufferAfterWrite, true);
@@ -58,8 +60,12 @@ namespace logpp {
 
     /**
      * @brief Destroy the Console Logger:: Console Logger object
+     *
+     * @remarks Flushes the buffer, and a pending duplicate summary with it.
      */
     ConsoleLogger::~ConsoleLogger() {
+        flushBuffer();
+
         // Destroy FileLogger object if it was set.
         if (_logToFile && _fileLogger != nullptr) {
             delete _fileLogger;
@@ -70,24 +76,24 @@ namespace logpp {
      * @brief Flushes the underlying buffer to its respective output.
      */
     void ConsoleLogger::flushBuffer() {
-        using std::cout;
-        using std::endl;
+        flushDuplicateSummary();
+
+        WriteLock lock;
 
-        getWriteMutex().lock();
         // TODO: Implement functionality where bad logs are output to cerr if desired.
         // This will require overriding logMessage()
-        auto output = getLogBufferAsString();
-
+        auto& output = getLogBuffer();
         if (output.empty()) return;
 
-        string newLine = "\n";
-        
-        if (output.substr(output.size() - 1) == newLine) {
-            cout << output;
-        } else cout << output << endl;
-        
-        clearStringStream(getLogBuffer());
-        getWriteMutex().unlock();
+        const bool measure = metricsEnabled();
+        const auto flushStart = measure ? LoggerMetrics::now() : 0;
+
+        _sink.write(output);
+
+        if (measure) { getMetrics().recordFlush(output.size(), flushStart); }
+
+        // Returns the chunks to the pool, for this or any other logger's next records
+        output.clear();
     }
 
     /**
@@ -96,84 +102,143 @@ namespace logpp {
      * @remarks This method is overridden. While the core functionality remains the same, 
      * the major difference is that "bad" logs are automatically redirected to stderr, instead of 
      * being buffered.
-     * A "bad" log is any log level >= 4.
+     * A "bad" log is an Error or Fatal log (see isBadLog()).
      * 
      * @param level The log level of the message.
      * @param msg The message to be output.
      */
     void ConsoleLogger::logMessage(const LogLevel level, const string& msg) {
-        using std::cerr;
-        using std::endl;
-
         if (level > getCurrentMaxLogLevel()) return;
 
         if (_logToFile && _fileLogger != nullptr)
             _fileLogger->logMessage(level, msg);
 
-        string newLine = "\n";
+        if (_sink.writesDirectly(level) && !msg.empty()) {
+            WriteLock lock;
 
-        getWriteMutex().lock();
-        if (outputBadLogsToStderr() && isBadLog(level)) {
             // Bypass log buffer and print directly to stderr.
-            if (msg.substr(msg.size() - 1) == newLine) {
-                cerr << msg;
-            } else cerr << msg << endl;
+            _sink.writeDirect(msg);
+
+            if (metricsEnabled()) { getMetrics().recordWrite(msg.size()); }
 
-            getWriteMutex().unlock();
             return;
         }
-        getWriteMutex().unlock();
 
         ILogger::logMessage(level, msg);
     }
 
     /**
-     * @brief Virtual method for formatting log messages as desired.
+     * @brief Writes an emergency record to stdout or stderr like logMessage() would, and to the file logger if there is one.
+     *
+     * @param level The level of the record.
+     * @param buffered The buffered records to write first; the file logger's are drained along with them. nullptr if they couldn't be had.
+     * @param record The formatted record, including its line feed.
+     */
+    void ConsoleLogger::writeEmergencyRecord(const LogLevel level, const LogBuffer* buffered, string_view record) {
+        _sink.writeEmergency(level, buffered, record);
+
+        if (_logToFile && _fileLogger != nullptr) {
+            forwardEmergencyRecord(*_fileLogger, level, buffered != nullptr, record);
+        }
+    }
+
+    /**
+     * @brief Logs the records of a batch which passed the level filter.
      *
-     * This method provides a simple way of creating a custom flare for your log messages.
-     * This method may be overridden by classes inheriting this abstract class.
+     * Records bound for the buffer are appended at once; bad logs which bypass the buffer are written directly,
+     * in the same order relative to each other. With a file logger attached, every record is logged on its own.
      *
-     * @param msg A reference to the message to be logged. This string will be modified!
+     * @param entries The batch.
+     * @param selected The indices of the entries to log, in order.
+     * @param count The amount of indices.
      */
-    string ConsoleLogger::formatLogMessage(const string& msg, const LogLevel lvl, const string& func, const int32_t line, const exception* except) {
-        // logFormat local class variable containing formatting
-        if (getCurrentLoggerFormat().empty() || msg.empty()) {
-            return msg;
+    void ConsoleLogger::logBatchRecords(const LogBatchEntry* entries, const uint32_t* selected, const size_t count) {
+        if (_logToFile && _fileLogger != nullptr) {
+            ILogger::logBatchRecords(entries, selected, count);
+            return;
         }
 
-        string formattedMsg = ILogger::formatLogMessage(msg, lvl, func, line, except);
-        if (_colourLogLevels) {
-            auto foreground = TextColour::None;
-            auto background = TextColour::None;
-
-            switch (lvl) {
-                case LogLevel::Debug:
-                    foreground = TextColour::CyanForeground;
-                    break;
-                case LogLevel::Error:
-                    foreground = TextColour::RedForeground;
-                    break;
-                case LogLevel::Fatal:
-                    foreground = TextColour::BlackForeground;
-                    background = TextColour::RedBackground;
-                    break;
-                case LogLevel::Info:
-                    foreground = TextColour::BlueForeground;
-                    break;
-                case LogLevel::Ok:
-                    foreground = TextColour::GreenForeground;
-                    break;
-                case LogLevel::Trace:
-                    foreground = TextColour::MagentaForeground;
-                    break;
-                case LogLevel::Warning:
-                    foreground = TextColour::YellowForeground;
-                    break;
+        size_t directCount = 0;
+        for (size_t i = 0; i < count; i++) { directCount += _sink.writesDirectly(entries[selected[i]].level); }
+
+        if (directCount == 0) {
+            appendBatchToBuffer(entries, selected, count);
+            return;
+        }
+
+        vector<uint32_t> buffered;
+        buffered.reserve(count - directCount);
+
+        for (size_t i = 0; i < count; i++) {
+            const auto& entry = entries[selected[i]];
+            if (_sink.writesDirectly(entry.level)) {
+                logRecord(entry.level, entry.message, entry.except, entry.line, entry.func, entry.fields, entry.fieldCount);
+            } else {
+                buffered.push_back(selected[i]);
             }
-            stringReplace(formattedMsg, toString(lvl), toString(lvl, foreground, background));
         }
 
-        return formattedMsg;
+        appendBatchToBuffer(entries, buffered.data(), buffered.size());
+    }
+
+    /**
+     * @brief Appends the log level to a formatted message, coloured by level if colouring is enabled.
+     *
+     * The coloured strings are built once; appending them doesn't allocate.
+     *
+     * @param out The string to append to.
+     * @param lvl The log level to append.
+     */
+    void ConsoleLogger::appendLogLevel(string& out, const LogLevel lvl) const {
+        if (!_colourLogLevels) {
+            ILogger::appendLogLevel(out, lvl);
+            return;
+        }
+
+        static const vector<string> colouredLevels = [] {
+            vector<string> levels;
+
+            for (auto i = (int32_t)LOGLEVEL_MINVALUE; i <= (int32_t)LOGLEVEL_MAXVALUE; i++) {
+                auto foreground = TextColour::None;
+                auto background = TextColour::None;
+
+                switch ((LogLevel)i) {
+                    case LogLevel::Debug:
+                        foreground = TextColour::CyanForeground;
+                        break;
+                    case LogLevel::Error:
+                        foreground = TextColour::RedForeground;
+                        break;
+                    case LogLevel::Fatal:
+                        foreground = TextColour::BlackForeground;
+                        background = TextColour::RedBackground;
+                        break;
+                    case LogLevel::Info:
+                        foreground = TextColour::BlueForeground;
+                        break;
+                    case LogLevel::Ok:
+                        foreground = TextColour::GreenForeground;
+                        break;
+                    case LogLevel::Trace:
+                        foreground = TextColour::MagentaForeground;
+                        break;
+                    case LogLevel::Warning:
+                        foreground = TextColour::YellowForeground;
+                        break;
+                }
+
+                levels.push_back(toString((LogLevel)i, foreground, background));
+            }
+
+            return levels;
+        }();
+
+        if (lvl < LOGLEVEL_MINVALUE || lvl > LOGLEVEL_MAXVALUE) {
+            ILogger::appendLogLevel(out, lvl);
+            return;
+        }
+
+        out.append(colouredLevels[(uint32_t)lvl]);
     }
 
 }
@@ -0,0 +1,203 @@
+/**
+ * EmergencyLog.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "EmergencyLog.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <atomic>
+#include <cerrno>
+#include <ctime>
+
+#include <unistd.h>
+
+namespace logpp {
+
+    const size_t EmergencyLog::MAX_RECORD_SIZE;
+
+    namespace {
+
+        const int64_t SECONDS_PER_DAY = 86400;
+
+        std::atomic<int64_t> utcOffsetSeconds(0); ///!< Lock-free on every platform we build for, so it may be read in a signal handler
+
+        /**
+         * @brief The level names as toString(LogLevel) has them, without the allocation.
+         */
+        const char* getLevelName(const LogLevel level) {
+            switch (level) {
+                case LogLevel::Ok:      return " Okay  ";
+                case LogLevel::Info:    return " Info  ";
+                case LogLevel::Warning: return "Warning";
+                case LogLevel::Error:   return " Error ";
+                case LogLevel::Fatal:   return " Fatal ";
+                case LogLevel::Debug:   return " Debug ";
+                case LogLevel::Trace:   return " Trace ";
+                default:                return "Unknown";
+            }
+        }
+
+        /**
+         * @brief Appends a NUL-terminated string, as far as it fits; control characters become spaces.
+         */
+        size_t appendText(char* out, const size_t capacity, size_t length, const char* text) {
+            for (; *text != '\0' && length < capacity; text++) {
+                const auto character = static_cast<unsigned char>(*text);
+                out[length++] = character < 0x20 || character == 0x7f ? ' ' : *text;
+            }
+
+            return length;
+        }
+
+        /**
+         * @brief Converts days since 1970-01-01 to a date in the proleptic Gregorian calendar (H. Hinnant's civil_from_days).
+         */
+        void getCivilDate(int64_t days, int64_t& year, uint32_t& month, uint32_t& day) {
+            days += 719468;
+            const auto era = (days >= 0 ? days : days - 146096) / 146097;
+            const auto dayOfEra = static_cast<uint64_t>(days - era * 146097);
+            const auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+            const auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+            const auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+            day = static_cast<uint32_t>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+            month = static_cast<uint32_t>(shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9);
+            year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2 ? 1 : 0);
+        }
+
+    }
+
+    /**
+     * @brief Remembers the local time's current UTC offset.
+     */
+    void EmergencyLog::captureUtcOffset() {
+        const auto now = time(nullptr);
+        struct tm localTime;
+
+        if (localtime_r(&now, &localTime) != nullptr) {
+            utcOffsetSeconds.store(localTime.tm_gmtoff, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Formats a record in the default layout.
+     */
+    size_t EmergencyLog::formatRecord(char* out, const size_t capacity, const LogLevel level, const char* message) {
+        if (capacity < 2) { return 0; }
+
+        const auto limit = capacity - 1; // Room for the line feed
+        size_t length = appendText(out, limit, 0, "[ ");
+        length += formatTimestamp(out + length, limit - length);
+        length = appendText(out, limit, length, " ] [ ");
+        length = appendText(out, limit, length, getLevelName(level));
+        length = appendText(out, limit, length, " ] ");
+        length = appendText(out, limit, length, message != nullptr ? message : "");
+
+        out[length++] = '\n';
+        return length;
+    }
+
+    /**
+     * @brief Formats the current local time as "2026.10.18 19:48:22".
+     *
+     * @return size_t The amount of characters written; 0 if they don't fit.
+     */
+    size_t EmergencyLog::formatTimestamp(char* out, const size_t capacity) {
+        const size_t TIMESTAMP_LENGTH = 19;
+        if (capacity < TIMESTAMP_LENGTH) { return 0; }
+
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        const auto seconds = static_cast<int64_t>(now.tv_sec) + utcOffsetSeconds.load(std::memory_order_relaxed);
+        auto days = seconds / SECONDS_PER_DAY;
+        auto secondOfDay = seconds % SECONDS_PER_DAY;
+        if (secondOfDay < 0) {
+            secondOfDay += SECONDS_PER_DAY;
+            days--;
+        }
+
+        int64_t year;
+        uint32_t month;
+        uint32_t day;
+        getCivilDate(days, year, month, day);
+
+        // Years before 1000 or after 9999 don't occur in logs; they're clamped to keep the width
+        formatUnsigned(out, 4, static_cast<uint64_t>(year < 0 ? 0 : year > 9999 ? 9999 : year), 4);
+        out[4] = '.';
+        formatUnsigned(out + 5, 2, month, 2);
+        out[7] = '.';
+        formatUnsigned(out + 8, 2, day, 2);
+        out[10] = ' ';
+        formatUnsigned(out + 11, 2, static_cast<uint64_t>(secondOfDay / 3600), 2);
+        out[13] = ':';
+        formatUnsigned(out + 14, 2, static_cast<uint64_t>(secondOfDay / 60 % 60), 2);
+        out[16] = ':';
+        formatUnsigned(out + 17, 2, static_cast<uint64_t>(secondOfDay % 60), 2);
+
+        return TIMESTAMP_LENGTH;
+    }
+
+    /**
+     * @brief Formats an unsigned integer in decimal, padded with zeros to minDigits.
+     */
+    size_t EmergencyLog::formatUnsigned(char* out, const size_t capacity, uint64_t value, const uint32_t minDigits) {
+        char digits[20];
+        size_t count = 0;
+
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        while (count < minDigits && count < sizeof(digits)) { digits[count++] = '0'; }
+        if (count > capacity) { return 0; }
+
+        for (size_t i = 0; i < count; i++) { out[i] = digits[count - 1 - i]; }
+        return count;
+    }
+
+    /**
+     * @brief write(2)s everything, retrying on EINTR and short writes.
+     *
+     * @return true If everything was written.
+     */
+    bool EmergencyLog::writeFully(const int32_t fd, const char* data, size_t size) {
+        const auto savedErrno = errno; // Signal handlers mustn't change errno for the code they interrupted
+
+        while (size > 0) {
+            const auto written = write(fd, data, size);
+            if (written < 0 && errno == EINTR) { continue; }
+            if (written <= 0) {
+                errno = savedErrno;
+                return false;
+            }
+
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+
+        errno = savedErrno;
+        return true;
+    }
+
+    /**
+     * @brief write(2)s a logger's buffer chunk by chunk.
+     *
+     * @return true If everything was written.
+     */
+    bool EmergencyLog::writeBuffer(const int32_t fd, const LogBuffer& buffer) {
+        bool written = true;
+        buffer.forEachChunk([fd, &written](string_view chunk) { written = written && writeFully(fd, chunk.data(), chunk.size()); });
+
+        return written;
+    }
+
+}
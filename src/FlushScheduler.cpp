@@ -0,0 +1,177 @@
+/**
+ * FlushScheduler.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "FlushScheduler.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace logpp {
+
+    using std::invalid_argument;
+    using std::lock_guard;
+    using std::mutex;
+    using std::unique_lock;
+
+    const uint32_t FlushScheduler::DEFAULT_MAX_STALENESS_MS = 100;
+    const uint32_t FlushScheduler::MIN_FLUSH_THRESHOLD = 4096;
+    const uint32_t FlushScheduler::DEFAULT_MAX_FLUSH_THRESHOLD = 1024 * 1024;
+
+    namespace {
+        const uint32_t  TICKS_PER_STALENESS = 4; //!< The timer's resolution; records are flushed no later than one tick before they'd become stale
+        const double    RATE_SMOOTHING = 0.25; //!< Weight of the latest tick in the smoothed byte rate
+    }
+
+    /**
+     * @brief Construct a new FlushScheduler object and start its timer.
+     *
+     * @param maxStalenessMs The maximum time a record may stay buffered, in milliseconds.
+     * @param maxFlushThreshold The largest flush threshold to set, in bytes; caps the memory a busy logger's buffer takes up.
+     */
+    FlushScheduler::FlushScheduler(const uint32_t maxStalenessMs, const uint32_t maxFlushThreshold):
+    _maxStalenessMs(maxStalenessMs), _maxFlushThreshold(maxFlushThreshold), _stopping(false), _timerFlushes(0) {
+        if (maxStalenessMs == 0) {
+            throw invalid_argument("Maximum staleness must be greater than zero!");
+        }
+
+        if (maxFlushThreshold < MIN_FLUSH_THRESHOLD) {
+            throw invalid_argument(fmt::format("Maximum flush threshold must be at least {} bytes!", MIN_FLUSH_THRESHOLD));
+        }
+
+        _timerThread = thread(&FlushScheduler::timerLoop, this);
+    }
+
+    /**
+     * @brief Destroy the FlushScheduler object.
+     *
+     * @remarks Stops the timer, then flushes all registered loggers and restores their own flushing rules.
+     */
+    FlushScheduler::~FlushScheduler() {
+        {
+            lock_guard<mutex> lock(_timerMutex);
+            _stopping = true;
+        }
+
+        _timerCondition.notify_all();
+        if (_timerThread.joinable()) { _timerThread.join(); }
+
+        lock_guard<mutex> lock(_loggerMutex);
+        for (auto& scheduled : _loggers) {
+            scheduled.logger->setScheduledFlushThreshold(0);
+            scheduled.logger->flushBuffer();
+        }
+    }
+
+    /**
+     * @brief Lets the scheduler manage a logger's flushes.
+     *
+     * The logger is flushed right away, so records buffered before registration don't escape the staleness target.
+     *
+     * @param logger The logger to manage.
+     *
+     * @return FlushScheduler& A reference to this object.
+     */
+    FlushScheduler& FlushScheduler::registerLogger(ILogger* logger) {
+        if (logger == nullptr) { return *this; }
+
+        lock_guard<mutex> lock(_loggerMutex);
+        const auto existing = std::find_if(_loggers.begin(), _loggers.end(), [logger](const ScheduledLogger& scheduled) { return scheduled.logger == logger; });
+        if (existing != _loggers.end()) { return *this; }
+
+        logger->setScheduledFlushThreshold(MIN_FLUSH_THRESHOLD);
+        logger->flushBuffer();
+
+        _loggers.push_back({ logger, logger->getBufferedByteCount(), LoggerMetrics::now(), 0.0, logger->getOldestBufferedTime() });
+
+        return *this;
+    }
+
+    /**
+     * @brief Stops managing a logger; it is flushed and its buffer size and flush-after-write settings apply again.
+     *
+     * @param logger The logger to remove.
+     *
+     * @return FlushScheduler& A reference to this object.
+     */
+    FlushScheduler& FlushScheduler::unregisterLogger(ILogger* logger) {
+        lock_guard<mutex> lock(_loggerMutex);
+        const auto existing = std::find_if(_loggers.begin(), _loggers.end(), [logger](const ScheduledLogger& scheduled) { return scheduled.logger == logger; });
+        if (existing == _loggers.end()) { return *this; }
+
+        logger->setScheduledFlushThreshold(0);
+        logger->flushBuffer();
+        _loggers.erase(existing);
+
+        return *this;
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Adapts each logger's threshold to its byte rate and flushes loggers whose oldest record is about to become stale.
+     */
+    void FlushScheduler::tick() {
+        const uint64_t stalenessNs = static_cast<uint64_t>(_maxStalenessMs) * 1000000;
+        const uint64_t tickNs = stalenessNs / TICKS_PER_STALENESS;
+
+        lock_guard<mutex> lock(_loggerMutex);
+        for (auto& scheduled : _loggers) {
+            const auto now = LoggerMetrics::now();
+            const auto byteCount = scheduled.logger->getBufferedByteCount();
+            const auto elapsedNs = now - scheduled.lastTickTime;
+
+            if (elapsedNs != 0) {
+                const auto bytesPerSecond = static_cast<double>(byteCount - scheduled.lastByteCount) * 1e9 / elapsedNs;
+                scheduled.bytesPerSecond += (bytesPerSecond - scheduled.bytesPerSecond) * RATE_SMOOTHING;
+            }
+            scheduled.lastByteCount = byteCount;
+            scheduled.lastTickTime = now;
+
+            // About what is logged within the staleness period; a burst beyond that is flushed right away.
+            const auto expectedBytes = scheduled.bytesPerSecond * _maxStalenessMs / 1000.0;
+            const auto threshold = static_cast<uint32_t>(std::max<double>(MIN_FLUSH_THRESHOLD, std::min<double>(expectedBytes, _maxFlushThreshold)));
+            scheduled.logger->setScheduledFlushThreshold(threshold);
+
+            // A new time means the logger appended to an empty buffer since the timer last flushed it; whatever was there before
+            // has been flushed, by the logger or by us.
+            const auto oldestBufferedTime = scheduled.logger->getOldestBufferedTime();
+            if (oldestBufferedTime == scheduled.handledBufferedTime || now < oldestBufferedTime) { continue; }
+
+            if (now - oldestBufferedTime + tickNs >= stalenessNs) {
+                scheduled.logger->flushBuffer();
+                scheduled.handledBufferedTime = oldestBufferedTime;
+                _timerFlushes.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Ticks TICKS_PER_STALENESS times per staleness period until the scheduler is destroyed.
+     */
+    void FlushScheduler::timerLoop() {
+        const auto tickInterval = std::chrono::microseconds(std::max<uint64_t>(1000, static_cast<uint64_t>(_maxStalenessMs) * 1000 / TICKS_PER_STALENESS));
+        auto nextTick = std::chrono::steady_clock::now() + tickInterval;
+
+        unique_lock<mutex> lock(_timerMutex);
+        while (!_timerCondition.wait_until(lock, nextTick, [this] { return _stopping; })) {
+            lock.unlock();
+            tick();
+            lock.lock();
+
+            nextTick += tickInterval;
+            const auto now = std::chrono::steady_clock::now();
+            if (nextTick < now) { nextTick = now + tickInterval; } // Don't try to catch up after a stall
+        }
+    }
+
+}
@@ -11,16 +11,22 @@
 //	    System Includes		    //
 //////////////////////////////////
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
 #include <fmt/core.h>
-#include <fmt/chrono.h>
+#include <unistd.h>
 
 //////////////////////////////////
 //	    Local Includes		    //
 //////////////////////////////////
+#include "EmergencyLog.hpp"
 #include "ILogger.hpp"
+#include "JsonLineFormatter.hpp"
+#include "StackTraceSymboliser.hpp"
 
 /**
  * @brief The library's main namespace.
@@ -55,8 +61,62 @@ namespace logpp {
     const string ILogger::LOG_FMT_EXCEPT  	=   "${except}"; 	// ${except} => if an exception was passed, output that
     const string ILogger::LOG_FMT_APPNAME   =   "${appname}"; 	// ${appname} => if the application's name was set, output that
     const string ILogger::LOG_FMT_CUSTOM  	=   "${custom}"; 	// ${custom} => this allows for some custom flare to be added to log outputs
+    const string ILogger::LOG_FMT_TS_NS     =   "${ts_ns}";     // ${ts_ns} => the record's wall-clock time in nanoseconds since the Unix epoch
+    const string ILogger::LOG_FMT_TS_US     =   "${ts_us}";     // ${ts_us} => the record's wall-clock time in microseconds since the Unix epoch
+    const string ILogger::LOG_FMT_MONO_NS   =   "${mono_ns}";   // ${mono_ns} => the record's monotonic time in nanoseconds
+    const string ILogger::LOG_FMT_TID       =   "${tid}";       // ${tid} => the kernel thread id of the logging thread
+    const string ILogger::LOG_FMT_CTX       =   "${ctx}";       // ${ctx} => the logging thread's LogContext as key=value pairs; ${ctx:key} outputs a single value
 
     mutex* ILogger::_writeMutex = new mutex();
+    atomic<bool> ILogger::_writerActive(false);
+
+    namespace {
+
+        /**
+         * @brief Per-thread scratch space for building log records.
+         *
+         * Every string in here keeps its capacity between records, so once a thread has logged
+         * a few messages, formatting a record no longer touches the heap.
+         */
+        struct RecordArena {
+            string      record; ///!< The formatted record handed to logMessage()
+            string      formatBuffer; ///!< The result of the *Fmt shortcuts
+            string      structuredMessage; ///!< A structured record's message followed by its fields, in text form
+            string      shortcutMessage; ///!< The message of a const char*/string_view shortcut, for the const string& one
+            string      shortcutFunction; ///!< Its function name
+            bool        recordInUse = false; ///!< Guards against re-entrant logging from within logMessage()
+
+            string              batch; ///!< The formatted records of a batch, appended to the log buffer at once
+            vector<uint32_t>    batchSelection; ///!< The indices of a batch's records which passed the level filter
+            vector<LogBatchEntry> batchEntries; ///!< Copies of batches which weren't passed as arrays
+            const LogTimestamp* batchTimestamp = nullptr; ///!< The timestamp shared by the batch being formatted, if any
+        };
+
+        RecordArena& getRecordArena() {
+            static thread_local RecordArena arena;
+            return arena;
+        }
+
+        // The layout of ILogger::_repeatState
+        const uint64_t REPEAT_COUNT_MASK = (1ull << 39) - 1; ///!< Duplicates since the last summary
+        const uint64_t REPEAT_CHANGING = 1ull << 39; ///!< Set while the last message changes; lock-free comparisons back off
+        const uint64_t REPEAT_GENERATION = 1ull << 40; ///!< Added for every new last message, so a comparison with the old one can't count
+
+        const uint64_t NO_MESSAGE_KEY = UINT64_MAX; ///!< Matches no message, before the first one
+
+        uint64_t getMessageKey(const LogLevel level, const size_t size) { return static_cast<uint64_t>(size) << 8 | static_cast<uint8_t>(level); }
+
+        /**
+         * @brief Gets the (up to) eight bytes of a message at offset as a word, zero-padded.
+         */
+        uint64_t getMessageWord(string_view msg, const size_t offset) {
+            uint64_t word = 0;
+            memcpy(&word, msg.data() + offset, msg.size() - offset < sizeof(word) ? msg.size() - offset : sizeof(word));
+
+            return word;
+        }
+
+    }
 
     // PROTECTED IMPLEMENTATION
 
@@ -72,20 +132,36 @@ namespace logpp {
     ILogger::ILogger(const string& logName, LogLevel maxLevel, uint32_t bufferSize, bool flushBufferAfterWrite) {
         this->_logName = logName;
         this->_maxLoggingLevel = maxLevel;
-        this->_dateFormatString = "%Y.%m.%d";
-        this->_timeFormatString = "%H:%M:%S";
-        #ifdef logpp_USE_PRINTF
-        this->_dateTimeFormatString = formatString("%s %s", _dateFormatString.c_str(), _timeFormatString.c_str());
-        #else
-        this->_dateTimeFormatString = fmt::format("{} {}", _dateFormatString, _timeFormatString);
-        #endif // logpp_USE_PRINTF
 
         // Buffer init
         this->_flushBufferAfterWrite = flushBufferAfterWrite;
         this->_maxBufferSize = bufferSize;
+        this->_scheduledFlushThreshold = 0;
+        this->_bufferedBytes = 0;
+        this->_oldestBufferedTime = 0;
+
+        this->_stackTraceSymboliser = nullptr;
+        this->_traceCaptureEpoch = 0;
+        this->_activeTraceCaptures[0] = 0;
+        this->_activeTraceCaptures[1] = 0;
+
+        // Duplicate suppression is opt-in
+        this->_collapseDuplicates = false;
+        this->_lastMessageLevel = LogLevel::Ok;
+        this->_lastMessageKey = NO_MESSAGE_KEY;
+        for (auto& word : _lastMessageWords) { word = 0; }
+        this->_repeatState = 0;
+        this->_suppressedDuplicates = 0;
+
+        this->_metricsEnabled = false;
+
+        this->_recordFormat = RecordFormat::Text;
 
         // Set default logger format
         setCurrentLoggerFormat();
+
+        // localtime() can't be called from signal handlers, so emergencyLog() needs the offset beforehand
+        EmergencyLog::captureUtcOffset();
     }
 
     /**
@@ -101,102 +177,635 @@ namespace logpp {
      * This method provides a simple way of creating a custom flare for your log messages.
      * This method may be overridden by classes inheriting this abstract class.
      *
-     * @param msg A reference to the message to be logged. This string will be modified!
+     * @param msg The message to be logged.
+     *
+     * @return The formatted message.
      */
     string ILogger::formatLogMessage(const string& msg, LogLevel lvl, const string& func, const int32_t line, const exception* except) {
-        // logFormat local class variable containing formatting
-        if (_loggerFormat.empty() || msg.empty()) {
-            return msg;
+        string formattedMsg;
+        formatLogMessageTo(formattedMsg, msg, lvl, func, line, except);
+
+        return formattedMsg;
+    }
+
+    /**
+     * @brief Formats a log message and appends it to out.
+     *
+     * The format is walked by the logger's TextFormatter; appendLogLevel() decorates the level.
+     *
+     * @param out The string to append to.
+     * @param msg The message to be logged.
+     */
+    void ILogger::formatLogMessageTo(string& out, string_view msg, const LogLevel lvl, string_view func, const int32_t line, const exception* except) {
+        const auto appendLevel = [this](string& levelOut, const LogLevel level) { appendLogLevel(levelOut, level); };
+        const auto batchTimestamp = getRecordArena().batchTimestamp;
+
+        if (batchTimestamp != nullptr) {
+            _textFormatter.formatWith(out, *batchTimestamp, lvl, msg, nullptr, 0, func, line, except, appendLevel);
+        } else {
+            _textFormatter.formatWith(out, lvl, msg, nullptr, 0, func, line, except, appendLevel);
         }
+    }
+
+    /**
+     * @brief Appends the string representation of a log level.
+     *
+     * @param out The string to append to.
+     * @param lvl The log level to append.
+     */
+    void ILogger::appendLogLevel(string& out, const LogLevel lvl) const {
+        TextFormatter::appendLogLevel(out, lvl);
+    }
 
-        string formattedMsg = getCurrentLoggerFormat();
-
-        // FIX: For some reason, this only works when passing the strings as a C string?!
-        stringReplaceAll(formattedMsg, LOG_FMT_DATE, getCurrentDate());
-        stringReplaceAll(formattedMsg, LOG_FMT_TIME, getCurrentTime());
-        stringReplaceAll(formattedMsg, LOG_FMT_DATETIME, getCurrentDateTime());
-        stringReplaceAll(formattedMsg, LOG_FMT_LOGLVL, toString(lvl));
-        stringReplaceAll(formattedMsg, LOG_FMT_MSG, msg);
-
-        if (!_className.empty()) {
-            stringReplaceAll(formattedMsg, LOG_FMT_CLASS, _className);
-        } if (!_appName.empty()) {
-            stringReplaceAll(formattedMsg, LOG_FMT_APPNAME, _appName);
-        } if (!_customFlare.empty()) {
-            stringReplaceAll(formattedMsg, LOG_FMT_CUSTOM, _customFlare);
-        } if (!func.empty()) {
-            stringReplaceAll(formattedMsg, LOG_FMT_FUNC, func);
-        } if (line >= 0) {
-            stringReplaceAll(formattedMsg, LOG_FMT_LINE, to_string(line));
-        } if (except != nullptr) {
-            stringReplaceAll(formattedMsg, LOG_FMT_EXCEPT, except->what());
+    /**
+     * @brief Gets the per-thread buffer used by the *Fmt shortcuts.
+     */
+    string& ILogger::getThreadFormatBuffer() {
+        return getRecordArena().formatBuffer;
+    }
+
+    /**
+     * @brief Gets the per-thread vector batches are copied into when they aren't passed as arrays.
+     */
+    vector<LogBatchEntry>& ILogger::getThreadBatchEntries() {
+        return getRecordArena().batchEntries;
+    }
+
+    /**
+     * @brief Filters, formats and logs a message.
+     *
+     * The level is checked before formatting, so filtered messages are never formatted.
+     *
+     * @param level The log level of the message.
+     * @param msg The pure message.
+     * @param except (Optional) The exception thrown.
+     * @param line (Optional) The line at which the logger was called.
+     * @param func (Optional) The function/method in which the logger was called.
+     * @param fields (Optional) The record's structured fields.
+     * @param fieldCount (Optional) The amount of fields.
+     */
+    void ILogger::formatAndLog(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                               const LogField* fields, const size_t fieldCount) {
+        const bool measure = metricsEnabled();
+
+        if (level > getCurrentMaxLogLevel()) {
+            if (measure) { _metrics.recordFiltered(level); }
+            return;
         }
 
-        return formattedMsg;
+        // Structured records differ in their fields more often than not; only plain messages are collapsed.
+        if (fieldCount == 0 && collapseDuplicates() && isRepeatedMessage(level, msg)) return;
+
+        const auto startTime = measure ? LoggerMetrics::now() : 0;
+
+        if (except == nullptr && !isBadLog(level)) {
+            logRecord(level, msg, except, line, func, fields, fieldCount);
+        } else {
+            logTraceableRecord(level, msg, except, line, func, fields, fieldCount);
+        }
+
+        if (measure) { _metrics.recordAccepted(level, startTime); }
+    }
+
+    /**
+     * @brief Formats a record into the per-thread arena (or the record format) and logs it with logMessage().
+     *
+     * @param level The log level of the message.
+     * @param msg The pure message.
+     * @param except The exception thrown, or nullptr.
+     * @param line The line at which the logger was called, or -1.
+     * @param func The function/method in which the logger was called.
+     * @param fields The record's structured fields.
+     * @param fieldCount The amount of fields.
+     */
+    void ILogger::logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                            const LogField* fields, const size_t fieldCount) {
+        auto& arena = getRecordArena();
+        if (arena.recordInUse) {
+            // Someone is logging from within logMessage(); don't clobber the outer record.
+            string record;
+            formatRecordTo(record, msg, level, func, line, except, fields, fieldCount);
+            logMessage(level, record);
+            return;
+        }
+
+        struct RecordGuard {
+            RecordArena& arena;
+            RecordGuard(RecordArena& arena): arena(arena) { arena.recordInUse = true; arena.record.clear(); }
+            ~RecordGuard() { arena.recordInUse = false; }
+        } guard(arena);
+
+        formatRecordTo(arena.record, msg, level, func, line, except, fields, fieldCount);
+        logMessage(level, arena.record);
+    }
+
+    /**
+     * @brief Logs each selected record of a batch with logRecord(), so loggers which only override logRecord() or logMessage() see every record.
+     *
+     * @param entries The batch.
+     * @param selected The indices of the entries to log, in order.
+     * @param count The amount of indices.
+     */
+    void ILogger::logBatchRecords(const LogBatchEntry* entries, const uint32_t* selected, const size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const auto& entry = entries[selected[i]];
+            logRecord(entry.level, entry.message, entry.except, entry.line, entry.func, entry.fields, entry.fieldCount);
+        }
+    }
+
+    /**
+     * @brief Formats the selected records of a batch into the per-thread arena and appends them to the log buffer at once.
+     *
+     * The clock is read once for the whole batch. The buffer is flushed like it would be after the batch's worst record:
+     * a bad log anywhere in the batch flushes it.
+     *
+     * @param entries The batch.
+     * @param selected The indices of the entries to log, in order.
+     * @param count The amount of indices.
+     */
+    void ILogger::appendBatchToBuffer(const LogBatchEntry* entries, const uint32_t* selected, const size_t count) {
+        auto& arena = getRecordArena();
+        if (arena.recordInUse || count == 0) {
+            // Someone is logging a batch from within logMessage(); the arena's busy.
+            ILogger::logBatchRecords(entries, selected, count);
+            return;
+        }
+
+        const auto timestamp = _textFormatter.getClock()->now();
+
+        struct BatchGuard {
+            RecordArena& arena;
+            BatchGuard(RecordArena& arena, const LogTimestamp& timestamp): arena(arena) { arena.recordInUse = true; arena.batch.clear(); arena.batchTimestamp = &timestamp; }
+            ~BatchGuard() { arena.recordInUse = false; arena.batchTimestamp = nullptr; }
+        } guard(arena, timestamp);
+
+        const auto newLine = getOsNewLineChar();
+        auto flushLevel = entries[selected[count - 1]].level;
+
+        for (size_t i = 0; i < count; i++) {
+            const auto& entry = entries[selected[i]];
+            const auto recordStart = arena.batch.size();
+
+            formatRecordTo(arena.batch, entry.message, entry.level, entry.func, entry.line, entry.except, entry.fields, entry.fieldCount);
+
+            if (arena.batch.size() == recordStart) continue;
+            if (arena.batch.back() != '\n') { arena.batch.append(newLine); }
+            if (isBadLog(entry.level)) { flushLevel = entry.level; }
+        }
+
+        if (arena.batch.empty()) return;
+
+        bufferRecord(flushLevel, arena.batch);
+    }
+
+    /**
+     * @brief Appends a record (or several) to the log buffer and flushes the buffer accordingly.
+     *
+     * The buffer's chunks come from the LogBufferPool. If the pool's budget is exhausted, this logger's buffer is flushed early
+     * to return its chunks, and the record appended again. If other loggers hold the budget, the record is appended beyond it
+     * and flushed right away: the caller pays for the write, which is the backpressure.
+     *
+     * @param level The level of the record; for several, the one which decides whether to flush.
+     * @param record The formatted record; a missing line feed is added.
+     */
+    void ILogger::bufferRecord(const LogLevel level, string_view record) {
+        const auto newLine = record.size() == 0 || record.data()[record.size() - 1] != '\n' ? getOsNewLineChar() : string();
+        const string_view lineEnding(newLine);
+
+        bool needsFlush = false;
+        bool appended = false;
+        {
+            WriteLock lock;
+            const auto previousSize = getBufferSize();
+
+            appended = _logBuffer.append(record, lineEnding);
+            if (appended) { needsFlush = onBufferAppended(level, previousSize); }
+        }
+
+        if (!appended) {
+            flushBuffer();
+
+            WriteLock lock;
+            const auto previousSize = getBufferSize();
+
+            if (_logBuffer.append(record, lineEnding)) {
+                needsFlush = onBufferAppended(level, previousSize);
+            } else {
+                _logBuffer.appendOverdrawn(record, lineEnding);
+                onBufferAppended(level, previousSize);
+                needsFlush = true;
+            }
+        }
+
+        if (needsFlush) {
+            flushBuffer();
+        }
+    }
+
+    /**
+     * @brief Logs a record from a signal handler; async-signal-safe.
+     *
+     * @param level The level of the record.
+     * @param message The message; truncated to fit into EmergencyLog::MAX_RECORD_SIZE.
+     */
+    void ILogger::emergencyLog(const LogLevel level, const char* message) {
+        const size_t NOTE_SIZE = 128;
+        char record[EmergencyLog::MAX_RECORD_SIZE + NOTE_SIZE];
+        auto length = EmergencyLog::formatRecord(record, EmergencyLog::MAX_RECORD_SIZE, level, message);
+
+        // An active writer may be halfway through writing the buffer or appending to it, possibly on the thread this interrupted:
+        // waiting for it might mean waiting forever. Locking the mutex isn't async-signal-safe anyway, so only the flag is claimed.
+        bool active = false;
+        if (_writerActive.compare_exchange_strong(active, true, std::memory_order_acquire)) {
+            forwardEmergencyRecord(*this, level, true, string_view(record, length));
+            _writerActive.store(false, std::memory_order_release);
+            return;
+        }
+
+        length += EmergencyLog::formatRecord(record + length, NOTE_SIZE, LogLevel::Warning, "Buffered records weren't written: another write was in progress");
+        writeEmergencyRecord(level, nullptr, string_view(record, length));
+    }
+
+    /**
+     * @brief Locks the write mutex, then claims the writer flag.
+     *
+     * The mutex orders writers among themselves, so the flag is only ever contended by emergencyLog(), which holds it
+     * for a few write(2)s.
+     */
+    ILogger::WriteLock::WriteLock(): _lock(*_writeMutex) {
+        bool active = false;
+        while (!_writerActive.compare_exchange_weak(active, true, std::memory_order_acquire)) {
+            active = false;
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Releases the writer flag, then the write mutex.
+     */
+    ILogger::WriteLock::~WriteLock() {
+        _writerActive.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Writes an emergency record, after the buffered records if there are any, to stderr.
+     */
+    void ILogger::writeEmergencyRecord(const LogLevel, const LogBuffer* buffered, string_view record) {
+        if (buffered != nullptr) { EmergencyLog::writeBuffer(STDERR_FILENO, *buffered); }
+        EmergencyLog::writeFully(STDERR_FILENO, record.data(), record.size());
+    }
+
+    /**
+     * @brief Has another logger write an emergency record; async-signal-safe.
+     *
+     * @param logger The logger to write the record.
+     * @param level The level of the record.
+     * @param drainBuffer Writes the logger's buffered records first and empties its buffer; only with the writer flag claimed.
+     * @param record The formatted record, including its line feed.
+     */
+    void ILogger::forwardEmergencyRecord(ILogger& logger, const LogLevel level, const bool drainBuffer, string_view record) {
+        logger.writeEmergencyRecord(level, drainBuffer ? &logger._logBuffer : nullptr, record);
+
+        // Returning the chunks would take the pool's lock
+        if (drainBuffer) { logger._logBuffer.abandon(); }
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Calls a const string& shortcut, which subclasses may override, with a message and function name given as string views.
+     *
+     * They're copied into per-thread strings, which are taken out of the arena for the call: a shortcut logging from within
+     * an override gets strings of its own.
+     */
+    void ILogger::forwardShortcut(Shortcut shortcut, string_view msg, const exception* except, const int32_t line, string_view func) {
+        auto& arena = getRecordArena();
+
+        string message;
+        string function;
+        message.swap(arena.shortcutMessage);
+        function.swap(arena.shortcutFunction);
+        message.assign(msg.data(), msg.size());
+        function.assign(func.data(), func.size());
+
+        (this->*shortcut)(message, except, line, function);
+
+        message.swap(arena.shortcutMessage);
+        function.swap(arena.shortcutFunction);
+    }
+
+    /**
+     * @brief Captures the stack for this logger's StackTraceSymboliser, if it has one, and logs the record with a trace=<id> field referencing it.
+     *
+     * @remarks This is the error path: copying the fields allocates.
+     */
+    void ILogger::logTraceableRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line,
+                                     string_view func, const LogField* fields, const size_t fieldCount) {
+        // Counted before the symboliser is loaded, so detachStackTraceSymboliser() waits until this call is done with it.
+        // Both sides are sequentially consistent: either the symboliser is seen detached, or the count is seen by the detaching thread.
+        auto& captures = _activeTraceCaptures[_traceCaptureEpoch.load() & 1];
+        captures.fetch_add(1);
+        struct CaptureGuard {
+            atomic<uint32_t>& captures;
+            ~CaptureGuard() { captures.fetch_sub(1); }
+        } captureGuard{ captures };
+
+        const auto symboliser = _stackTraceSymboliser.load();
+        const auto traceId = symboliser != nullptr ? symboliser->capture(this, level) : 0;
+        if (traceId == 0) {
+            logRecord(level, msg, except, line, func, fields, fieldCount);
+            return;
+        }
+
+        // The trace is logged after its record, even if logging the record throws
+        struct ReleaseGuard {
+            StackTraceSymboliser& symboliser;
+            uint64_t traceId;
+            ~ReleaseGuard() { symboliser.release(traceId); }
+        } releaseGuard{ *symboliser, traceId };
+
+        vector<LogField> tracedFields(fields, fields + fieldCount);
+        tracedFields.push_back(kv("trace", traceId));
+
+        logRecord(level, msg, except, line, func, tracedFields.data(), tracedFields.size());
+    }
+
+    /**
+     * @brief Filters a batch by level (and duplicates, if collapsed) and hands what's left to logBatchRecords().
+     *
+     * @param entries The batch.
+     * @param count The amount of entries.
+     */
+    void ILogger::logBatchEntries(const LogBatchEntry* entries, const size_t count) {
+        if (count == 0) return;
+
+        const bool measure = metricsEnabled();
+        const auto maxLevel = getCurrentMaxLogLevel();
+
+        // Copied, so a batch logged from within logBatchRecords() can't clobber it.
+        vector<uint32_t> selection;
+        selection.swap(getRecordArena().batchSelection);
+        selection.resize(count);
+
+        auto selectedCount = selectLogBatchEntries(entries, count, maxLevel, selection.data());
+
+        if (measure && selectedCount != count) {
+            for (size_t i = 0; i < count; i++) {
+                if (entries[i].level > maxLevel) { _metrics.recordFiltered(entries[i].level); }
+            }
+        }
+
+        if (collapseDuplicates()) {
+            size_t keptCount = 0;
+            for (size_t i = 0; i < selectedCount; i++) {
+                const auto& entry = entries[selection[i]];
+                if (entry.fieldCount == 0 && isRepeatedMessage(entry.level, entry.message)) continue;
+
+                selection[keptCount++] = selection[i];
+            }
+
+            selectedCount = keptCount;
+        }
+
+        const auto startTime = measure ? LoggerMetrics::now() : 0;
+
+        logBatchRecords(entries, selection.data(), selectedCount);
+
+        if (measure && selectedCount != 0) {
+            // Each record is charged its share of the batch's time
+            const auto endTime = LoggerMetrics::now();
+            const auto recordStart = endTime - (endTime - startTime) / selectedCount;
+            for (size_t i = 0; i < selectedCount; i++) { _metrics.recordAccepted(entries[selection[i]].level, recordStart); }
+        }
+
+        selection.swap(getRecordArena().batchSelection);
+    }
+
+    /**
+     * @brief Determines whether a message repeats the previous one and, if so, counts it.
+     *
+     * If the message differs from the previous one, a summary for the previous message's repeats is emitted.
+     *
+     * @remarks Messages are compared by their text, so nothing distinct is ever swallowed. Messages up to 256 bytes are compared
+     * without the lock, against a copy published like a seqlock: a repeat then costs the comparison and one CAS on _repeatState,
+     * which fails if the copy changed meanwhile. The copy is stored with release and loaded with acquire, which costs nothing
+     * on x86 and, unlike fences, ThreadSanitizer understands. Longer messages, and any message while the copy changes, are compared under the lock.
+     * Concurrent callers may race on which message counts as "previous", in which case a duplicate may occasionally
+     * be logged rather than collapsed; nothing is ever lost.
+     *
+     * @param level The level of the current message.
+     * @param msg The pure message.
+     *
+     * @return true If the message is a repeat and must not be logged.
+     */
+    bool ILogger::isRepeatedMessage(const LogLevel level, string_view msg) {
+        const auto key = getMessageKey(level, msg.size());
+
+        if (msg.size() <= LAST_MESSAGE_WORDS * sizeof(uint64_t)) {
+            auto state = _repeatState.load(std::memory_order_acquire);
+            while ((state & REPEAT_CHANGING) == 0 && _lastMessageKey.load(std::memory_order_acquire) == key) {
+                size_t offset = 0;
+                while (offset < msg.size() && getMessageWord(msg, offset) == _lastMessageWords[offset / sizeof(uint64_t)].load(std::memory_order_acquire)) {
+                    offset += sizeof(uint64_t);
+                }
+                if (offset < msg.size()) { break; }
+
+                // If any word read was a newer message's, its store happened after the slow path's fetch_or, so the CAS sees the change and fails
+                if (_repeatState.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) { return true; }
+            }
+        }
+
+        uint64_t repeats;
+        LogLevel previousLevel;
+        {
+            std::lock_guard<mutex> lock(_lastMessageMutex);
+            if (_lastMessageKey.load(std::memory_order_relaxed) == key && string_view(_lastMessage) == msg) {
+                _repeatState.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // Lock-free comparisons back off until the new message is published, and their CAS fails if they read part of it
+            const auto state = _repeatState.fetch_or(REPEAT_CHANGING, std::memory_order_acq_rel);
+
+            repeats = state & REPEAT_COUNT_MASK;
+            previousLevel = _lastMessageLevel;
+
+            // assign() keeps the capacity, so this doesn't allocate in the steady state
+            _lastMessage.assign(msg.data(), msg.size());
+            _lastMessageLevel = level;
+            _lastMessageKey.store(key, std::memory_order_release);
+            if (msg.size() <= LAST_MESSAGE_WORDS * sizeof(uint64_t)) {
+                for (size_t offset = 0; offset < msg.size(); offset += sizeof(uint64_t)) {
+                    _lastMessageWords[offset / sizeof(uint64_t)].store(getMessageWord(msg, offset), std::memory_order_release);
+                }
+            }
+
+            _repeatState.store((state & ~(REPEAT_COUNT_MASK | REPEAT_CHANGING)) + REPEAT_GENERATION, std::memory_order_release);
+        }
+
+        logDuplicateSummary(previousLevel, repeats);
+        return false;
+    }
+
+    /**
+     * @brief Emits the "last message repeated N times" summary; the duplicates' lock mustn't be held, as this logs.
+     */
+    void ILogger::logDuplicateSummary(const LogLevel level, const uint64_t repeats) {
+        if (repeats == 0) return;
+
+        _suppressedDuplicates.fetch_add(repeats, std::memory_order_relaxed);
+        logMessage(level, formatLogMessage(fmt::format("Last message repeated {} times", repeats), level));
+    }
+
+    /**
+     * @brief Does the bookkeeping after a record was appended to the buffer and decides whether to flush.
+     *
+     * Without a FlushScheduler, the buffer is flushed on bad logs, when it reached the maximum buffer size or after every write, if so configured.
+     * With a scheduler, the scheduler's threshold replaces the latter two, and the timer takes care of records which would otherwise sit in the buffer.
+     *
+     * @param level The level of the record.
+     * @param previousSize The buffer's size before the record was appended.
+     *
+     * @return true If the buffer has to be flushed now.
+     */
+    bool ILogger::onBufferAppended(const LogLevel level, const uint32_t previousSize) {
+        const auto scheduledThreshold = getScheduledFlushThreshold();
+        if (scheduledThreshold == 0) {
+            const auto maxBufferSize = getMaxBufferSize();
+            return isBadLog(level) || maxBufferSize == 0 || getBufferSize() >= maxBufferSize || flushBufferAfterWrite();
+        }
+
+        // The write mutex is held, so there's a single writer.
+        _bufferedBytes.store(_bufferedBytes.load(std::memory_order_relaxed) + getBufferSize() - previousSize, std::memory_order_relaxed);
+        if (previousSize == 0) { _oldestBufferedTime.store(LoggerMetrics::now(), std::memory_order_relaxed); }
+
+        return isBadLog(level) || getBufferSize() >= scheduledThreshold;
+    }
+
+    /**
+     * @brief Formats a record according to the record format.
+     *
+     * In text mode, structured fields are appended to the message, which then goes through formatLogMessageTo() like any other.
+     */
+    void ILogger::formatRecordTo(string& out, string_view msg, const LogLevel level, string_view func, const int32_t line, const exception* except,
+                                 const LogField* fields, const size_t fieldCount) {
+        if (_recordFormat == RecordFormat::JsonLines) {
+            const auto batchTimestamp = getRecordArena().batchTimestamp;
+            JsonLineFormatter::formatTo(out, batchTimestamp != nullptr ? *batchTimestamp : _textFormatter.getClock()->now(), level, _logName, msg, fields, fieldCount, func, line, except);
+            return;
+        }
+
+        if (fieldCount == 0) {
+            formatLogMessageTo(out, msg, level, func, line, except);
+            return;
+        }
+
+        auto& message = getRecordArena().structuredMessage;
+        message.assign(msg.data(), msg.size());
+        TextFormatter::appendFields(message, fields, fieldCount);
+
+        formatLogMessageTo(out, message, level, func, line, except);
     }
 
     // PUBLIC IMPLEMENTATION
 
+    /**
+     * @brief Emits the "last message repeated N times" summary for the pending duplicates.
+     */
+    void ILogger::flushDuplicateSummary() {
+        // Every flush passes through here, so don't lock unless there's something to report
+        if ((_repeatState.load(std::memory_order_relaxed) & REPEAT_COUNT_MASK) == 0) return;
+
+        uint64_t repeats;
+        LogLevel level;
+        {
+            std::lock_guard<mutex> lock(_lastMessageMutex);
+            repeats = _repeatState.fetch_and(~REPEAT_COUNT_MASK, std::memory_order_relaxed) & REPEAT_COUNT_MASK;
+            level = _lastMessageLevel;
+        }
+
+        logDuplicateSummary(level, repeats);
+    }
+
+    /**
+     * @brief Gets the total amount of messages suppressed as duplicates by this logger.
+     */
+    uint64_t ILogger::getSuppressedDuplicateCount() const {
+        return _suppressedDuplicates.load(std::memory_order_relaxed) + (_repeatState.load(std::memory_order_relaxed) & REPEAT_COUNT_MASK);
+    }
+
+    /**
+     * @brief Stops capturing traces and waits until no thread uses the previous symboliser any more.
+     *
+     * Captures starting from here count in the other epoch's counter, so threads which keep logging errors
+     * can't keep this waiting; only those which started before are waited for.
+     *
+     * @remarks Captures are short (an unwind and a queue slot), but a capturing thread also logs its record before it's done.
+     */
+    void ILogger::detachStackTraceSymboliser() {
+        _stackTraceSymboliser.store(nullptr);
+
+        const auto previousEpoch = _traceCaptureEpoch.fetch_add(1) & 1;
+        while (_activeTraceCaptures[previousEpoch].load() != 0) { std::this_thread::yield(); }
+    }
+
+    /**
+     * @brief Gets a copy of this logger's self-metrics.
+     *
+     * @return LoggerMetricsSnapshot The metrics, summed up over all threads which used this logger.
+     */
+    LoggerMetricsSnapshot ILogger::getMetricsSnapshot() const {
+        LoggerMetricsSnapshot snapshot;
+        _metrics.fillSnapshot(snapshot);
+
+        snapshot.loggerName = getCurrentLoggerName();
+        snapshot.suppressedDuplicates = getSuppressedDuplicateCount();
+
+        return snapshot;
+    }
+
     /**
      * @brief Gets the current date as per format rules.
      *
-     * @return The current date as defined by _dateFormatString
+     * @return The current date as defined by the date format
      */
     string ILogger::getCurrentDate() const {
-        auto timeStruct = getCurrentLocalTime();
+        string date;
+        _textFormatter.appendLocalTime(date, _textFormatter.getDateFormat(), _textFormatter.getClock()->now());
 
-        #ifdef logpp_USE_PRINTF
-        string charBuffer;
-        strftime(&charBuffer[0], 128, _dateFormatString.c_str(), &timeStruct);
-        return charBuffer;
-        #else
-        return fmt::format("{:" + _dateFormatString + "}", timeStruct);
-        #endif // logpp_USE_PRINTF
+        return date;
     }
 
     /**
      * @brief Gets the current date as per format rules.
      *
-     * @return The current date as defined by _dateTimeFormatString
+     * @return The current date as defined by the date and time formats
      */
     string ILogger::getCurrentDateTime() const {
-        tm timeStruct = getCurrentLocalTime();
-        
-        #ifdef logpp_USE_PRINTF
-        char charBuffer[128];
-        strftime(&charBuffer[0], 128, _dateTimeFormatString.c_str(), &timeStruct);
-        return charBuffer;
-        #else
-        return fmt::format("{:" + _dateTimeFormatString + "}", timeStruct);
-        #endif // logpp_USE_PRINTF
+        string dateTime;
+        _textFormatter.appendLocalTime(dateTime, _textFormatter.getDateTimeFormat(), _textFormatter.getClock()->now());
 
+        return dateTime;
     }
 
     /**
      * @brief Gets the current date as per format rules.
      *
-     * @return The current date as defined by _timeFormatString
+     * @return The current date as defined by the time format
      */
     string ILogger::getCurrentTime() const {
-        auto timeStruct = getCurrentLocalTime();
+        string time;
+        _textFormatter.appendLocalTime(time, _textFormatter.getTimeFormat(), _textFormatter.getClock()->now());
 
-        #ifdef logpp_USE_PRINTF
-        string charBuffer;
-        strftime(&charBuffer[0], 128, _timeFormatString.c_str(), &timeStruct);
-        return charBuffer;
-        #else
-        return fmt::format("{:" + _timeFormatString + "}", timeStruct);
-        #endif // logpp_USE_PRINTF
+        return time;
     }
 
     string ILogger::getOsNewLineChar() const {
-        static string newLine = "";
-
-        if (newLine.empty()) {
+        static const string newLine = [] {
             std::ostringstream str;
             str << std::endl;
-            newLine = str.str();
-        }
+            return str.str();
+        }();
 
         return newLine;
     }
@@ -204,31 +813,17 @@ namespace logpp {
     /**
      * @brief Writes a message to the underlying log buffer and flushes the buffer accordingly.
      *
-     * @remarks Bad log levels (log levels above four) will cause the buffer to always be flushed in this default implementation!
+     * @remarks Bad log levels (Error and Fatal) will cause the buffer to always be flushed in this default implementation!
      *
      * @param level The level of the current log.
      * @param msg The (formatted) message to output.
      */
     void ILogger::logMessage(LogLevel level, const string& msg) {
-        // Check if we're supposed to log anything or not
-        if (level > this->_maxLoggingLevel) return;
-
-        getWriteMutex().lock();
-      
-        if (msg.empty()) return;
-        else if (level >= _maxLoggingLevel) return;
-
-        using std::endl;
-        // _logBuffer << msg << endl; // Add message to buffer
-        if (*msg.end() == '\n') {
-            _logBuffer << msg;
-        } else _logBuffer << msg << endl;
-
-        getWriteMutex().unlock();
-        // Now check if we need to flush
-        if (isBadLog(level) || (getMaxBufferSize() == 0 || getBufferSize() >= getMaxBufferSize()) || flushBufferAfterWrite()) {
-            flushBuffer();
-        }
+        // Check if we're supposed to log anything or not.
+        // The level is read exactly once, so a concurrent reconfiguration can't be seen half-way through.
+        if (level > getCurrentMaxLogLevel() || msg.empty()) return;
+
+        bufferRecord(level, msg);
     }
 
     /**
@@ -240,8 +835,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::debug(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Debug;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Debug, msg, except, line, func);
     }
 
     /**
@@ -253,8 +847,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::error(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Error;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Error, msg, except, line, func);
     }
 
     /**
@@ -266,8 +859,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::fatal(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Fatal;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Fatal, msg, except, line, func);
     }
 
     /**
@@ -279,8 +871,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::info(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Info;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Info, msg, except, line, func);
     }
 
     /**
@@ -292,8 +883,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::ok(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Ok;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Ok, msg, except, line, func);
     }
 
     /**
@@ -305,8 +895,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::trace(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Trace;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Trace, msg, except, line, func);
     }
 
     /**
@@ -318,8 +907,7 @@ namespace logpp {
      * @param func (Optional) The function/method in which the logger was called.
      */
     void ILogger::warning(const string& msg, const exception* except, const int32_t line, const string& func) {
-        auto level = LogLevel::Warning;
-        logMessage(level, formatLogMessage(msg, level, func, line, except));
+        formatAndLog(LogLevel::Warning, msg, except, line, func);
     }
 
 }
@@ -0,0 +1,61 @@
+/**
+ * JournalLogger.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "JournalLogger.hpp"
+
+namespace logpp {
+
+    /**
+     * @brief Construct a new JournalLogger object.
+     *
+     * @param logName The name for this logger; sent as LOGPP_LOGGER.
+     * @param maxLogLevel The maximum logging level to log.
+     * @param identifier The SYSLOG_IDENTIFIER to send; the logger's name if empty.
+     * @param socketPath The path of journald's native socket.
+     */
+    JournalLogger::JournalLogger(const string& logName, const LogLevel maxLogLevel, const string& identifier, const string& socketPath):
+    ILogger(logName, maxLogLevel, 0, false), _sink(socketPath), _identifier(identifier.empty() ? logName : identifier) {
+        setCurrentLoggerFormat("${lmsg}");
+    }
+
+    /**
+     * @brief Sends a record which was formatted elsewhere (e.g. by an AsyncLogger) as the MESSAGE of a journal entry.
+     *
+     * @param level The level of the record.
+     * @param msg The formatted record.
+     */
+    void JournalLogger::logMessage(const LogLevel level, const string& msg) {
+        if (level > getCurrentMaxLogLevel() || msg.empty()) return;
+
+        static thread_local string entry;
+        entry.clear();
+
+        auto length = msg.size();
+        while (length > 0 && (msg[length - 1] == '\n' || msg[length - 1] == '\r')) { length--; }
+
+        JournalSink::formatEntry(entry, level, _identifier, getCurrentLoggerName(), string_view(msg.data(), length), nullptr, 0, string_view(), -1, nullptr);
+        _sink.send(entry);
+    }
+
+    /**
+     * @brief Formats the message with the logger format and sends it with the rest of the record as journal fields.
+     */
+    void JournalLogger::logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                                  const LogField* fields, const size_t fieldCount) {
+        static thread_local string message;
+        static thread_local string entry;
+        message.clear();
+        entry.clear();
+
+        formatLogMessageTo(message, msg, level, func, line, except);
+        JournalSink::formatEntry(entry, level, _identifier, getCurrentLoggerName(), message, fields, fieldCount, func, line, except);
+        _sink.send(entry);
+    }
+
+}
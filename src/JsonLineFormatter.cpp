@@ -0,0 +1,293 @@
+/**
+ * JsonLineFormatter.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "JsonLineFormatter.hpp"
+#include "LogExtensions.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cmath>
+#include <ctime>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace logpp {
+
+    namespace {
+        /**
+         * @brief Gets the offset of the first character in [data, data + size) which has to be escaped in JSON
+         * (control characters, '"' and '\\'), or size if there is none. One byte at a time.
+         */
+        size_t findEscapeScalar(const char* data, const size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                const auto character = static_cast<unsigned char>(data[i]);
+                if (character < 0x20 || character == '"' || character == '\\') { return i; }
+            }
+
+            return size;
+        }
+
+    #if defined(__SSE2__)
+        /**
+         * @brief findEscapeScalar(), 16 bytes at a time.
+         */
+        size_t findEscapeSse2(const char* data, const size_t size) {
+            const auto quote = _mm_set1_epi8('"');
+            const auto backslash = _mm_set1_epi8('\\');
+            const auto maxControl = _mm_set1_epi8(0x1f);
+            size_t offset = 0;
+
+            for (; offset + 16 <= size; offset += 16) {
+                const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+                // Unsigned chunk <= 0x1f is max(chunk, 0x1f) == 0x1f
+                const auto isControl = _mm_cmpeq_epi8(_mm_max_epu8(chunk, maxControl), maxControl);
+                const auto needsEscape = _mm_or_si128(isControl, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+                const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(needsEscape));
+
+                if (mask != 0) { return offset + __builtin_ctz(mask); }
+            }
+
+            return offset + findEscapeScalar(data + offset, size - offset);
+        }
+
+        /**
+         * @brief findEscapeScalar(), 32 bytes at a time. Only called if the CPU supports AVX2.
+         */
+        __attribute__((target("avx2")))
+        size_t findEscapeAvx2(const char* data, const size_t size) {
+            const auto quote = _mm256_set1_epi8('"');
+            const auto backslash = _mm256_set1_epi8('\\');
+            const auto maxControl = _mm256_set1_epi8(0x1f);
+            size_t offset = 0;
+
+            for (; offset + 32 <= size; offset += 32) {
+                const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+                const auto isControl = _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, maxControl), maxControl);
+                const auto needsEscape = _mm256_or_si256(isControl, _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+                const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(needsEscape));
+
+                if (mask != 0) { return offset + __builtin_ctz(mask); }
+            }
+
+            // The tail is handled by non-VEX SSE2 code; clear the upper halves first or every SSE instruction
+            // after this (including the caller's) pays the AVX/SSE transition penalty.
+            _mm256_zeroupper();
+            return offset + findEscapeSse2(data + offset, size - offset);
+        }
+    #endif // __SSE2__
+
+        typedef size_t (*FindEscapeFunction)(const char*, const size_t);
+
+        struct EscapeImplementation {
+            FindEscapeFunction  findEscape;
+            const char*         name;
+        };
+
+        /**
+         * @brief Picks the widest implementation the CPU supports; once per process.
+         */
+        const EscapeImplementation& selectEscapeImplementation() {
+            static const EscapeImplementation implementation = [] {
+                #if defined(__SSE2__)
+                    if (__builtin_cpu_supports("avx2")) { return EscapeImplementation{ &findEscapeAvx2, "avx2" }; }
+                    return EscapeImplementation{ &findEscapeSse2, "sse2" };
+                #else
+                    return EscapeImplementation{ &findEscapeScalar, "scalar" };
+                #endif
+            }();
+
+            return implementation;
+        }
+
+        /**
+         * @brief Gets the name of a level as written to the "level" member; unpadded and in lower case, unlike toString().
+         */
+        const char* getLevelName(const LogLevel level) {
+            switch (level) {
+                case LogLevel::Ok:      return "ok";
+                case LogLevel::Info:    return "info";
+                case LogLevel::Warning: return "warning";
+                case LogLevel::Error:   return "error";
+                case LogLevel::Fatal:   return "fatal";
+                case LogLevel::Debug:   return "debug";
+                case LogLevel::Trace:   return "trace";
+                default:                return "unknown";
+            }
+        }
+
+        void appendLiteral(string& out, const char* literal, const size_t length) { out.append(literal, length); }
+
+        template<size_t N>
+        void appendLiteral(string& out, const char (&literal)[N]) { out.append(literal, N - 1); }
+
+        void appendUnsigned(string& out, const uint64_t value) {
+            const fmt::format_int formatted(value);
+            out.append(formatted.data(), formatted.size());
+        }
+
+        void appendSigned(string& out, const int64_t value) {
+            const fmt::format_int formatted(value);
+            out.append(formatted.data(), formatted.size());
+        }
+
+        void appendQuoted(string& out, string_view value) {
+            out += '"';
+            JsonLineFormatter::appendEscaped(out, value);
+            out += '"';
+        }
+
+        /**
+         * @brief Appends a timestamp as RFC 3339 in UTC with nanoseconds. The date and time of day are cached per thread and second.
+         */
+        void appendTimestamp(string& out, const LogTimestamp& timestamp) {
+            static thread_local time_t cachedSecond = 0;
+            static thread_local char cachedDateTime[32];
+            static thread_local size_t cachedLength = 0; ///!< 0 until the first timestamp; any second may occur
+
+            // Floored, so times before the epoch count their fraction up from the previous second
+            auto seconds = timestamp.realtimeNanoseconds / 1000000000;
+            auto remainder = timestamp.realtimeNanoseconds % 1000000000;
+            if (remainder < 0) {
+                remainder += 1000000000;
+                seconds--;
+            }
+
+            const auto second = static_cast<time_t>(seconds);
+            auto nanoseconds = static_cast<uint32_t>(remainder);
+
+            if (second != cachedSecond || cachedLength == 0) {
+                struct tm utcTime;
+                gmtime_r(&second, &utcTime);
+                cachedLength = strftime(cachedDateTime, sizeof(cachedDateTime), "%Y-%m-%dT%H:%M:%S", &utcTime);
+                cachedSecond = second;
+            }
+
+            char fraction[11] = { '.', '0', '0', '0', '0', '0', '0', '0', '0', '0', 'Z' };
+            for (int32_t digit = 9; digit > 0; digit--) {
+                fraction[digit] = static_cast<char>('0' + nanoseconds % 10);
+                nanoseconds /= 10;
+            }
+
+            out += '"';
+            out.append(cachedDateTime, cachedLength);
+            out.append(fraction, sizeof(fraction));
+            out += '"';
+        }
+    }
+
+    /**
+     * @brief Appends a record as a single JSON object.
+     */
+    void JsonLineFormatter::formatTo(string& out, const LogTimestamp& timestamp, const LogLevel level, string_view loggerName, string_view msg,
+                                     const LogField* fields, const size_t fieldCount, string_view func, const int32_t line, const exception* except) {
+        appendLiteral(out, "{\"ts\":");
+        appendTimestamp(out, timestamp);
+        appendLiteral(out, ",\"level\":\"");
+        out.append(getLevelName(level));
+        appendLiteral(out, "\",\"logger\":");
+        appendQuoted(out, loggerName);
+        appendLiteral(out, ",\"tid\":");
+        appendUnsigned(out, getCurrentThreadId());
+        appendLiteral(out, ",\"msg\":");
+        appendQuoted(out, msg);
+
+        if (func.size() != 0) {
+            appendLiteral(out, ",\"func\":");
+            appendQuoted(out, func);
+        }
+
+        if (line >= 0) {
+            appendLiteral(out, ",\"line\":");
+            appendSigned(out, line);
+        }
+
+        if (except != nullptr) {
+            appendLiteral(out, ",\"exception\":");
+            appendQuoted(out, except->what());
+        }
+
+        for (size_t i = 0; i < fieldCount; i++) { appendField(out, fields[i]); }
+
+        out += '}';
+    }
+
+    /**
+     * @brief Appends ,"key":value for a structured field. Non-finite doubles become null.
+     */
+    void JsonLineFormatter::appendField(string& out, const LogField& field) {
+        out += ',';
+        appendQuoted(out, field.key);
+        out += ':';
+
+        switch (field.type) {
+            case LogField::Type::Int:       appendSigned(out, field.intValue); break;
+            case LogField::Type::UInt:      appendUnsigned(out, field.uintValue); break;
+            case LogField::Type::Bool:      field.boolValue ? appendLiteral(out, "true") : appendLiteral(out, "false"); break;
+            case LogField::Type::String:    appendQuoted(out, field.stringValue); break;
+            case LogField::Type::Double:
+                if (std::isfinite(field.doubleValue)) {
+                    fmt::format_to(std::back_inserter(out), "{}", field.doubleValue);
+                } else {
+                    appendLiteral(out, "null");
+                }
+                break;
+        }
+    }
+
+    /**
+     * @brief Appends a string's contents, escaped for use in a JSON string.
+     *
+     * Runs of characters which don't need escaping are found with SIMD and copied at once.
+     */
+    void JsonLineFormatter::appendEscaped(string& out, string_view value) {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+        const auto findEscape = selectEscapeImplementation().findEscape;
+        const auto data = value.data();
+        const auto size = value.size();
+        size_t position = 0;
+
+        while (position < size) {
+            const auto runLength = findEscape(data + position, size - position);
+            out.append(data + position, runLength);
+            position += runLength;
+
+            if (position == size) { break; }
+
+            const auto character = static_cast<unsigned char>(data[position++]);
+            switch (character) {
+                case '"':   appendLiteral(out, "\\\""); break;
+                case '\\':  appendLiteral(out, "\\\\"); break;
+                case '\n':  appendLiteral(out, "\\n"); break;
+                case '\r':  appendLiteral(out, "\\r"); break;
+                case '\t':  appendLiteral(out, "\\t"); break;
+                case '\b':  appendLiteral(out, "\\b"); break;
+                case '\f':  appendLiteral(out, "\\f"); break;
+                default: {
+                    const char escape[] = { '\\', 'u', '0', '0', HEX_DIGITS[character >> 4], HEX_DIGITS[character & 0xf] };
+                    appendLiteral(out, escape, sizeof(escape));
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Gets the name of the escaping implementation picked for this CPU.
+     */
+    const char* JsonLineFormatter::getEscapeImplementation() {
+        return selectEscapeImplementation().name;
+    }
+
+}
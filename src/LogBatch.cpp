@@ -0,0 +1,77 @@
+/**
+ * LogBatch.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogBatch.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace logpp {
+
+    namespace {
+
+        /**
+         * @brief Branchless selection; every index is written, but only kept ones advance the output.
+         */
+        size_t selectScalar(const LogBatchEntry* entries, const size_t count, const LogLevel maxLevel, uint32_t* selected, const size_t offset) {
+            size_t selectedCount = 0;
+
+            for (size_t i = offset; i < count; i++) {
+                selected[selectedCount] = static_cast<uint32_t>(i);
+                selectedCount += entries[i].level <= maxLevel;
+            }
+
+            return selectedCount;
+        }
+
+    }
+
+    /**
+     * @brief Selects the entries at or below maxLevel.
+     *
+     * The levels of 16 entries are packed into a vector and compared at once; the resulting mask
+     * is walked bit by bit, so a block where everything passes (or nothing does) costs a single compare.
+     */
+    size_t selectLogBatchEntries(const LogBatchEntry* entries, const size_t count, const LogLevel maxLevel, uint32_t* selected) {
+        size_t selectedCount = 0;
+        size_t offset = 0;
+
+        #if defined(__SSE2__)
+        const auto maxLevels = _mm_set1_epi8(static_cast<char>(maxLevel));
+        alignas(16) int8_t levels[16];
+
+        for (; offset + 16 <= count; offset += 16) {
+            for (size_t i = 0; i < 16; i++) { levels[i] = static_cast<int8_t>(entries[offset + i].level); }
+
+            const auto filtered = _mm_cmpgt_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(levels)), maxLevels);
+            auto keep = ~static_cast<uint32_t>(_mm_movemask_epi8(filtered)) & 0xffff;
+
+            while (keep != 0) {
+                selected[selectedCount++] = static_cast<uint32_t>(offset + __builtin_ctz(keep));
+                keep &= keep - 1;
+            }
+        }
+        #endif
+
+        return selectedCount + selectScalar(entries, count, maxLevel, selected + selectedCount, offset);
+    }
+
+    const char* getLogBatchFilterImplementation() {
+        #if defined(__SSE2__)
+            return "sse2";
+        #else
+            return "scalar";
+        #endif
+    }
+
+}
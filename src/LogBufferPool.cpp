@@ -0,0 +1,254 @@
+/**
+ * LogBufferPool.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogBufferPool.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace logpp {
+
+    using std::lock_guard;
+    using std::mutex;
+
+    const uint32_t LogBufferChunk::CAPACITY;
+    const uint64_t LogBufferPool::DEFAULT_BUDGET;
+
+    static_assert(sizeof(LogBufferChunk) == 4096, "A chunk should take up a page");
+
+    namespace {
+        /**
+         * @brief Gets the amount of chunks a budget allows for; a budget below one chunk still allows for one, as 0 means unlimited.
+         */
+        uint64_t getBudgetChunks(const uint64_t budgetBytes) {
+            const auto chunks = budgetBytes / sizeof(LogBufferChunk);
+            return chunks == 0 && budgetBytes != 0 ? 1 : chunks;
+        }
+    }
+
+    //===========================
+    //		LogBufferPool
+    //===========================
+
+    /**
+     * @brief Gets the pool shared by all loggers.
+     */
+    LogBufferPool& LogBufferPool::getInstance() {
+        alignas(LogBufferPool) static char storage[sizeof(LogBufferPool)];
+        static LogBufferPool* instance = new (storage) LogBufferPool();
+
+        return *instance;
+    }
+
+    /**
+     * @brief Construct a new LogBufferPool object; chunks are allocated as they're needed.
+     */
+    LogBufferPool::LogBufferPool(): _freeChunks(nullptr), _freeChunkCount(0), _leasedChunkCount(0), _peakLeasedChunkCount(0),
+    _exhaustedAppends(0), _overdrawnChunks(0), _budgetBytes(DEFAULT_BUDGET) { }
+
+    /**
+     * @brief Takes chunks out of the pool; free chunks are reused before new ones are allocated.
+     *
+     * @param count The amount of chunks.
+     * @param overdraw Hands them out even if that exceeds the budget.
+     *
+     * @return LogBufferChunk* A chain of count empty chunks, or nullptr if they'd exceed the budget.
+     */
+    LogBufferChunk* LogBufferPool::acquire(const size_t count, const bool overdraw) {
+        if (count == 0) { return nullptr; }
+
+        lock_guard<mutex> lock(_poolMutex);
+
+        const auto budgetChunks = getBudgetChunks(getBudget());
+        const auto newChunks = count > _freeChunkCount ? count - _freeChunkCount : 0;
+        const bool exceedsBudget = budgetChunks != 0 && _leasedChunkCount + _freeChunkCount + newChunks > budgetChunks;
+
+        if (exceedsBudget && !overdraw) {
+            _exhaustedAppends++;
+            return nullptr;
+        }
+        if (exceedsBudget) { _overdrawnChunks += count; }
+
+        LogBufferChunk* chain = nullptr;
+        for (size_t i = 0; i < count; i++) {
+            LogBufferChunk* chunk;
+            if (_freeChunks != nullptr) {
+                chunk = _freeChunks;
+                _freeChunks = chunk->next;
+                _freeChunkCount--;
+            } else {
+                chunk = new LogBufferChunk;
+            }
+
+            chunk->next = chain;
+            chunk->size = 0;
+            chain = chunk;
+        }
+
+        _leasedChunkCount += count;
+        _peakLeasedChunkCount = std::max(_peakLeasedChunkCount, _leasedChunkCount);
+
+        return chain;
+    }
+
+    /**
+     * @brief Returns a chain of chunks to the pool. Chunks beyond the budget (after an overdraft) are released to the system.
+     */
+    void LogBufferPool::release(LogBufferChunk* chunks) {
+        if (chunks == nullptr) { return; }
+
+        lock_guard<mutex> lock(_poolMutex);
+
+        while (chunks != nullptr) {
+            auto chunk = chunks;
+            chunks = chunk->next;
+
+            chunk->next = _freeChunks;
+            _freeChunks = chunk;
+            _freeChunkCount++;
+            _leasedChunkCount--;
+        }
+
+        const auto budgetChunks = getBudgetChunks(getBudget());
+        if (budgetChunks != 0 && _leasedChunkCount + _freeChunkCount > budgetChunks) {
+            releaseFreeChunks(budgetChunks > _leasedChunkCount ? budgetChunks - _leasedChunkCount : 0);
+        }
+    }
+
+    /**
+     * @brief Sets the most bytes of chunks the pool hands out; free chunks beyond a lowered budget are released.
+     *
+     * @remarks Chunks in use are kept until their buffers are flushed, even if they exceed the new budget.
+     */
+    void LogBufferPool::setBudget(const uint64_t budgetBytes) {
+        lock_guard<mutex> lock(_poolMutex);
+        _budgetBytes.store(budgetBytes, std::memory_order_relaxed);
+
+        const auto budgetChunks = getBudgetChunks(budgetBytes);
+        if (budgetChunks != 0 && _leasedChunkCount + _freeChunkCount > budgetChunks) {
+            releaseFreeChunks(budgetChunks > _leasedChunkCount ? budgetChunks - _leasedChunkCount : 0);
+        }
+    }
+
+    /**
+     * @brief Releases the free chunks to the system, e.g. after a burst of logging.
+     */
+    void LogBufferPool::trim() {
+        lock_guard<mutex> lock(_poolMutex);
+        releaseFreeChunks(0);
+    }
+
+    /**
+     * @brief Gets the pool's occupancy.
+     */
+    LogBufferPoolStats LogBufferPool::getStats() const {
+        lock_guard<mutex> lock(_poolMutex);
+
+        return LogBufferPoolStats {
+            getBudget(), LogBufferChunk::CAPACITY,
+            _leasedChunkCount, _freeChunkCount, _peakLeasedChunkCount,
+            _exhaustedAppends, _overdrawnChunks
+        };
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Deletes free chunks until keepChunks of them are left.
+     */
+    void LogBufferPool::releaseFreeChunks(const uint64_t keepChunks) {
+        while (_freeChunkCount > keepChunks) {
+            auto chunk = _freeChunks;
+            _freeChunks = chunk->next;
+            _freeChunkCount--;
+
+            delete chunk;
+        }
+    }
+
+    //===========================
+    //		LogBuffer
+    //===========================
+
+    /**
+     * @brief Returns the chunks to the pool.
+     */
+    void LogBuffer::clear() {
+        if (_firstChunk == nullptr) { return; }
+
+        LogBufferPool::getInstance().release(_firstChunk);
+        _firstChunk = nullptr;
+        _lastChunk = nullptr;
+        _size = 0;
+    }
+
+    /**
+     * @brief Gets a copy of the buffered records.
+     */
+    string LogBuffer::toString() const {
+        string contents;
+        contents.reserve(_size);
+        forEachChunk([&contents](string_view chunk) { contents.append(chunk.data(), chunk.size()); });
+
+        return contents;
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Appends a record and its line ending, taking the chunks needed from the pool all at once, so nothing is appended if they can't be had.
+     */
+    bool LogBuffer::appendRecord(string_view record, string_view lineEnding, const bool overdraw) {
+        const auto length = record.size() + lineEnding.size();
+        const auto space = _lastChunk != nullptr ? LogBufferChunk::CAPACITY - _lastChunk->size : 0;
+
+        if (length > space) {
+            const auto chunkCount = (length - space + LogBufferChunk::CAPACITY - 1) / LogBufferChunk::CAPACITY;
+            auto chunks = LogBufferPool::getInstance().acquire(chunkCount, overdraw);
+            if (chunks == nullptr) { return false; }
+
+            // copyToChunks() moves _lastChunk along as the chunks fill up; the last one gets at least a byte
+            if (_lastChunk == nullptr) {
+                _firstChunk = chunks;
+                _lastChunk = chunks;
+            } else {
+                _lastChunk->next = chunks;
+            }
+        }
+
+        copyToChunks(record);
+        copyToChunks(lineEnding);
+        _size += length;
+
+        return true;
+    }
+
+    /**
+     * @brief Copies data to the end of the buffer; the chunks have to be there already.
+     */
+    void LogBuffer::copyToChunks(string_view data) {
+        auto source = data.data();
+        auto remaining = data.size();
+
+        while (remaining > 0) {
+            if (_lastChunk->size == LogBufferChunk::CAPACITY) { _lastChunk = _lastChunk->next; }
+
+            const auto bytes = std::min<size_t>(remaining, LogBufferChunk::CAPACITY - _lastChunk->size);
+            std::memcpy(_lastChunk->data + _lastChunk->size, source, bytes);
+            _lastChunk->size += bytes;
+            source += bytes;
+            remaining -= bytes;
+        }
+    }
+
+}
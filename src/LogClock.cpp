@@ -0,0 +1,111 @@
+/**
+ * LogClock.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogClock.hpp"
+#include "TscClock.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <ctime>
+
+namespace logpp {
+
+    namespace {
+        int64_t readClock(const clockid_t clock) {
+            struct timespec time;
+            clock_gettime(clock, &time);
+
+            return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+        }
+    }
+
+    /**
+     * @brief Gets the process-wide default clock.
+     */
+    shared_ptr<ILogClock> getDefaultLogClock() {
+        static const shared_ptr<ILogClock> defaultClock = std::make_shared<SystemClock>();
+        return defaultClock;
+    }
+
+    //===========================
+    //		SystemClock
+    //===========================
+
+    LogTimestamp SystemClock::now() const {
+        return { readClock(CLOCK_REALTIME), readClock(CLOCK_MONOTONIC) };
+    }
+
+    //===========================
+    //	  CoarseRealtimeClock
+    //===========================
+
+    LogTimestamp CoarseRealtimeClock::now() const {
+        return { readClock(CLOCK_REALTIME_COARSE), readClock(CLOCK_MONOTONIC_COARSE) };
+    }
+
+    //===========================
+    //	   TscRealtimeClock
+    //===========================
+
+    /**
+     * @brief Construct a new TscRealtimeClock object.
+     *
+     * @remarks The first TSC clock in a process calibrates the TSC, which takes a few milliseconds.
+     */
+    TscRealtimeClock::TscRealtimeClock(): _realtimeOffset(0) {
+        resynchronise();
+    }
+
+    LogTimestamp TscRealtimeClock::now() const {
+        // steady_clock is CLOCK_MONOTONIC
+        const auto monotonicNanoseconds = TscClock::toSteadyNanoseconds(TscClock::now());
+
+        return { monotonicNanoseconds + _realtimeOffset.load(std::memory_order_relaxed), monotonicNanoseconds };
+    }
+
+    /**
+     * @brief Measures the offset between the TSC's time line and CLOCK_REALTIME.
+     */
+    void TscRealtimeClock::resynchronise() {
+        const auto before = TscClock::toSteadyNanoseconds(TscClock::now());
+        const auto realtime = readClock(CLOCK_REALTIME);
+        const auto after = TscClock::toSteadyNanoseconds(TscClock::now());
+
+        _realtimeOffset.store(realtime - (before + (after - before) / 2), std::memory_order_relaxed);
+    }
+
+    //===========================
+    //		FrozenClock
+    //===========================
+
+    /**
+     * @brief Construct a new FrozenClock object.
+     *
+     * @param realtimeNanoseconds The wall-clock time, in nanoseconds since the Unix epoch.
+     * @param monotonicNanoseconds The monotonic time.
+     */
+    FrozenClock::FrozenClock(const int64_t realtimeNanoseconds, const int64_t monotonicNanoseconds):
+    _realtimeNanoseconds(realtimeNanoseconds), _monotonicNanoseconds(monotonicNanoseconds) { }
+
+    LogTimestamp FrozenClock::now() const {
+        return { _realtimeNanoseconds.load(std::memory_order_relaxed), _monotonicNanoseconds.load(std::memory_order_relaxed) };
+    }
+
+    void FrozenClock::set(const int64_t realtimeNanoseconds, const int64_t monotonicNanoseconds) {
+        _realtimeNanoseconds.store(realtimeNanoseconds, std::memory_order_relaxed);
+        _monotonicNanoseconds.store(monotonicNanoseconds, std::memory_order_relaxed);
+    }
+
+    void FrozenClock::advance(const int64_t nanoseconds) {
+        _realtimeNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+        _monotonicNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,360 @@
+/**
+ * LogConfigWatcher.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogConfigWatcher.hpp"
+#include "LogExtensions.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace logpp {
+
+    using std::ifstream;
+    using std::invalid_argument;
+    using std::lock_guard;
+    using std::mutex;
+    using std::runtime_error;
+    using std::stringstream;
+
+    const char LogConfigWatcher::CONFIG_KEY_SEPARATOR = '.';
+    const string LogConfigWatcher::CONFIG_WILDCARD = "*";
+
+    std::atomic<int32_t> LogConfigWatcher::_sighupPipeFd(-1);
+
+    namespace {
+        const char WAKEUP_RELOAD = 'r';
+        const char WAKEUP_QUIT   = 'q';
+
+        struct sigaction previousSighupAction; ///!< The SIGHUP disposition before the watcher owning _sighupPipeFd installed its handler; restored by stop()
+
+        /**
+         * @brief Removes leading and trailing whitespace from a string.
+         */
+        inline string trimString(const string& str) {
+            const auto first = str.find_first_not_of(" \t\r\n");
+            if (first == string::npos) { return ""; }
+
+            return str.substr(first, str.find_last_not_of(" \t\r\n") - first + 1);
+        }
+    }
+
+    /**
+     * @brief Construct a new LogConfigWatcher object.
+     *
+     * @param configPath The path to the configuration file to watch.
+     * @param reloadOnSighup Indicates whether to install a SIGHUP handler which triggers a reload; the previous one is restored by stop().
+     */
+    LogConfigWatcher::LogConfigWatcher(const string& configPath, const bool reloadOnSighup):
+    _configPath(configPath), _reloadOnSighup(reloadOnSighup), _inotifyFd(-1), _running(false), _invalidLines(0), _reloadCount(0) {
+        if (configPath.empty()) {
+            throw invalid_argument("Config path must not be empty!");
+        }
+
+        if (pipe2(_wakeupPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+            throw runtime_error(fmt::format("Failed to create wakeup pipe: {}", strerror(errno)));
+        }
+    }
+
+    /**
+     * @brief Destroy the LogConfigWatcher object.
+     *
+     * @remarks Stops the watcher thread if it is still running.
+     */
+    LogConfigWatcher::~LogConfigWatcher() {
+        stop();
+
+        close(_wakeupPipe[0]);
+        close(_wakeupPipe[1]);
+    }
+
+    /**
+     * @brief Adds a logger to the set of loggers affected by the configuration.
+     *
+     * @param logger The logger to register. Loggers are matched by their name (see ILogger::getCurrentLoggerName).
+     *
+     * @return LogConfigWatcher& A reference to this object.
+     */
+    LogConfigWatcher& LogConfigWatcher::registerLogger(ILogger* logger) {
+        if (logger == nullptr) { return *this; }
+
+        lock_guard<mutex> lock(_loggerMutex);
+        if (std::find(_loggers.begin(), _loggers.end(), logger) == _loggers.end()) {
+            _loggers.push_back(logger);
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Removes a logger from the set of loggers affected by the configuration.
+     *
+     * @param logger The logger to remove.
+     *
+     * @return LogConfigWatcher& A reference to this object.
+     */
+    LogConfigWatcher& LogConfigWatcher::unregisterLogger(ILogger* logger) {
+        lock_guard<mutex> lock(_loggerMutex);
+        _loggers.erase(std::remove(_loggers.begin(), _loggers.end(), logger), _loggers.end());
+
+        return *this;
+    }
+
+    /**
+     * @brief Reads the configuration file and applies all valid directives to the registered loggers.
+     *
+     * @return true If the file could be read.
+     * @return false If the file could not be read. Loggers remain untouched.
+     */
+    bool LogConfigWatcher::reload() {
+        ifstream inStream(_configPath);
+        if (!inStream.good()) { return false; }
+
+        stringstream contents;
+        contents << inStream.rdbuf();
+
+        vector<ConfigDirective> directives;
+        uint32_t invalidLines = 0;
+        parseConfig(contents.str(), directives, invalidLines);
+
+        {
+            lock_guard<mutex> lock(_loggerMutex);
+            for (const auto& directive : directives) {
+                for (auto logger : _loggers) {
+                    if (directive.loggerName != CONFIG_WILDCARD && directive.loggerName != logger->getCurrentLoggerName()) { continue; }
+
+                    if (!applyDirective(logger, directive)) { invalidLines++; break; }
+                }
+            }
+        }
+
+        _invalidLines.store(invalidLines, std::memory_order_relaxed);
+        _reloadCount.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    /**
+     * @brief Applies the current configuration and starts the watcher thread.
+     *
+     * @remarks If the configuration file does not exist yet, its directory is watched and it will be applied once it is created.
+     */
+    void LogConfigWatcher::start() {
+        if (_running.exchange(true)) { return; }
+
+        _inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (_inotifyFd < 0) {
+            _running = false;
+            throw runtime_error(fmt::format("Failed to initialise inotify: {}", strerror(errno)));
+        }
+
+        // Watch the directory rather than the file itself; editors and config management tools
+        // tend to replace files via rename(), which would silently drop a watch on the old inode.
+        auto lastSlash = _configPath.find_last_of('/');
+        const auto configDir = lastSlash == string::npos ? string(".") : (lastSlash == 0 ? string("/") : _configPath.substr(0, lastSlash));
+
+        if (inotify_add_watch(_inotifyFd, configDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            close(_inotifyFd);
+            _inotifyFd = -1;
+            _running = false;
+            throw runtime_error(fmt::format("Failed to watch {}: {}", configDir, strerror(errno)));
+        }
+
+        if (_reloadOnSighup) {
+            int32_t expected = -1;
+            if (_sighupPipeFd.compare_exchange_strong(expected, _wakeupPipe[1])) {
+                struct sigaction action;
+                memset(&action, 0, sizeof(action));
+                action.sa_handler = &LogConfigWatcher::sighupHandler;
+                action.sa_flags = SA_RESTART;
+                sigemptyset(&action.sa_mask);
+                sigaction(SIGHUP, &action, &previousSighupAction);
+            }
+        }
+
+        reload();
+        _watcherThread = thread(&LogConfigWatcher::watchLoop, this);
+    }
+
+    /**
+     * @brief Stops the watcher thread and restores the SIGHUP disposition the application had, if this object installed its handler.
+     */
+    void LogConfigWatcher::stop() {
+        if (!_running.exchange(false)) { return; }
+
+        int32_t expected = _wakeupPipe[1];
+        if (_sighupPipeFd.compare_exchange_strong(expected, -1)) {
+            sigaction(SIGHUP, &previousSighupAction, nullptr);
+        }
+
+        const auto quit = WAKEUP_QUIT;
+        (void)!write(_wakeupPipe[1], &quit, sizeof(quit));
+
+        if (_watcherThread.joinable()) {
+            _watcherThread.join();
+        }
+
+        close(_inotifyFd);
+        _inotifyFd = -1;
+    }
+
+    /**
+     * @brief Parses the contents of a configuration file.
+     *
+     * @param contents The raw file contents.
+     * @param out The vector to append parsed directives to.
+     * @param invalidLines Incremented for each line which could not be parsed.
+     *
+     * @return true If all lines were valid.
+     */
+    bool LogConfigWatcher::parseConfig(const string& contents, vector<ConfigDirective>& out, uint32_t& invalidLines) const {
+        stringstream inStream(contents);
+        string line;
+        const auto invalidBefore = invalidLines;
+
+        while (std::getline(inStream, line)) {
+            line = trimString(line);
+            if (line.empty() || line[0] == '#') { continue; }
+
+            const auto equalsPos = line.find('=');
+            if (equalsPos == string::npos) { invalidLines++; continue; }
+
+            const auto target = trimString(line.substr(0, equalsPos));
+            const auto value = trimString(line.substr(equalsPos + 1));
+
+            // Logger names may themselves contain dots, the key is always the last component.
+            const auto separatorPos = target.find_last_of(CONFIG_KEY_SEPARATOR);
+            if (separatorPos == string::npos || separatorPos == 0 || value.empty()) { invalidLines++; continue; }
+
+            out.push_back({ target.substr(0, separatorPos), target.substr(separatorPos + 1), value });
+        }
+
+        return invalidLines == invalidBefore;
+    }
+
+    /**
+     * @brief Applies a single directive to a logger.
+     *
+     * @param logger The logger to modify.
+     * @param directive The directive to apply.
+     *
+     * @return true If the directive was valid and applied.
+     */
+    bool LogConfigWatcher::applyDirective(ILogger* logger, const ConfigDirective& directive) const {
+        auto key = directive.key;
+        auto value = directive.value;
+        stringToLower(key);
+
+        if (key == "level") {
+            LogLevel level;
+            if (!tryParseLogLevel(value, level)) { return false; }
+
+            logger->setCurrentMaxLogLevel(level);
+        } else if (key == "buffersize") {
+            char* numEnd = nullptr;
+            const auto bufferSize = strtoul(value.c_str(), &numEnd, 10);
+            if (numEnd == nullptr || *numEnd != '\0') { return false; }
+
+            logger->setMaxBufferSize(static_cast<uint32_t>(bufferSize));
+        } else if (key == "flushafterwrite") {
+            stringToLower(value);
+            if (value == "true" || value == "1" || value == "yes" || value == "on") {
+                logger->setFlushAfterWrite(true);
+            } else if (value == "false" || value == "0" || value == "no" || value == "off") {
+                logger->setFlushAfterWrite(false);
+            } else { return false; }
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief The watcher thread's main loop.
+     *
+     * Waits on the inotify descriptor and the wakeup pipe (SIGHUP, stop()) and reloads the configuration as required.
+     */
+    void LogConfigWatcher::watchLoop() {
+        const auto configName = getBaseName(_configPath);
+        // Large enough for a handful of events incl. names; inotify never splits an event.
+        alignas(struct inotify_event) char eventBuffer[4096];
+
+        pollfd fds[2] = {
+            { _inotifyFd,       POLLIN, 0 },
+            { _wakeupPipe[0],   POLLIN, 0 }
+        };
+
+        while (_running.load()) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) { continue; }
+                break;
+            }
+
+            bool needsReload = false;
+
+            if (fds[1].revents & POLLIN) {
+                char wakeup;
+                while (read(_wakeupPipe[0], &wakeup, sizeof(wakeup)) == sizeof(wakeup)) {
+                    if (wakeup == WAKEUP_QUIT) { return; }
+                    needsReload = true;
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                ssize_t bytesRead;
+                while ((bytesRead = read(_inotifyFd, eventBuffer, sizeof(eventBuffer))) > 0) {
+                    for (ssize_t offset = 0; offset < bytesRead; ) {
+                        const auto event = reinterpret_cast<const struct inotify_event*>(eventBuffer + offset);
+                        if (event->len > 0 && configName == event->name) {
+                            needsReload = true;
+                        }
+
+                        offset += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+            }
+
+            if (needsReload) {
+                reload();
+            }
+        }
+    }
+
+    /**
+     * @brief SIGHUP handler; wakes the watcher thread.
+     *
+     * @remarks Only async-signal-safe functions may be called from here.
+     */
+    void LogConfigWatcher::sighupHandler(int32_t) {
+        const auto savedErrno = errno;
+        const auto pipeFd = _sighupPipeFd.load();
+
+        if (pipeFd >= 0) {
+            const auto wakeup = WAKEUP_RELOAD;
+            (void)!write(pipeFd, &wakeup, sizeof(wakeup));
+        }
+
+        errno = savedErrno;
+    }
+
+}
@@ -0,0 +1,142 @@
+/**
+ * LogContext.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogContext.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstring>
+#include <vector>
+
+namespace logpp {
+
+    const uint32_t LogContext::MAX_DEPTH = 64;
+
+    namespace {
+        struct ContextEntry {
+            string      key;
+            string      value;
+        };
+
+        /**
+         * @brief A thread's context. entries only ever grows, so popped entries keep their strings' capacity.
+         */
+        struct ThreadContext {
+            std::vector<ContextEntry>   entries;
+            uint32_t                    depth = 0; ///!< Entries in use
+            uint32_t                    overflow = 0; ///!< Pushes beyond MAX_DEPTH, which pops have to skip
+            string                      rendered;
+            bool                        isRenderedCurrent = true;
+        };
+
+        ThreadContext& getThreadContext() {
+            static thread_local ThreadContext context;
+            return context;
+        }
+
+        bool equals(const string& a, const string_view b) {
+            return a.size() == b.size() && memcmp(a.data(), b.data(), b.size()) == 0;
+        }
+
+        /**
+         * @brief Gets a value indicating whether an entry is shadowed by a later entry with the same key.
+         */
+        bool isShadowed(const ThreadContext& context, const uint32_t index) {
+            for (auto later = index + 1; later < context.depth; later++) {
+                if (context.entries[later].key == context.entries[index].key) { return true; }
+            }
+
+            return false;
+        }
+    }
+
+    /**
+     * @brief Adds an entry to the current thread's context.
+     *
+     * @param key The key; referenced by ${ctx:key}.
+     * @param value The value.
+     */
+    void LogContext::push(string_view key, string_view value) {
+        auto& context = getThreadContext();
+
+        if (context.depth == MAX_DEPTH) {
+            context.overflow++;
+            return;
+        }
+
+        if (context.depth == context.entries.size()) { context.entries.emplace_back(); }
+
+        auto& entry = context.entries[context.depth++];
+        entry.key.assign(key.data(), key.size());
+        entry.value.assign(value.data(), value.size());
+        context.isRenderedCurrent = false;
+    }
+
+    /**
+     * @brief Removes the most recently added entry from the current thread's context.
+     */
+    void LogContext::pop() {
+        auto& context = getThreadContext();
+
+        if (context.overflow > 0) {
+            context.overflow--;
+            return;
+        }
+
+        if (context.depth == 0) { return; }
+
+        context.depth--;
+        context.isRenderedCurrent = false;
+    }
+
+    /**
+     * @brief Gets the innermost value for a key.
+     *
+     * @remarks The returned view is invalidated by the next change to the current thread's context.
+     */
+    string_view LogContext::get(string_view key) {
+        const auto& context = getThreadContext();
+
+        for (auto index = context.depth; index > 0; index--) {
+            const auto& entry = context.entries[index - 1];
+            if (equals(entry.key, key)) { return string_view(entry.value.data(), entry.value.size()); }
+        }
+
+        return string_view();
+    }
+
+    /**
+     * @brief Gets the current thread's context as "key=value key=value", outermost entry first; rebuilt only after changes.
+     */
+    const string& LogContext::getRendered() {
+        auto& context = getThreadContext();
+        if (context.isRenderedCurrent) { return context.rendered; }
+
+        context.rendered.clear();
+        for (uint32_t index = 0; index < context.depth; index++) {
+            if (isShadowed(context, index)) { continue; }
+
+            const auto& entry = context.entries[index];
+            if (!context.rendered.empty()) { context.rendered += ' '; }
+            context.rendered.append(entry.key).append(1, '=').append(entry.value);
+        }
+
+        context.isRenderedCurrent = true;
+        return context.rendered;
+    }
+
+    /**
+     * @brief Gets the amount of entries in the current thread's context.
+     */
+    uint32_t LogContext::getDepth() {
+        return getThreadContext().depth;
+    }
+
+}
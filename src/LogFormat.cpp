@@ -0,0 +1,92 @@
+/**
+ * LogFormat.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogFormat.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cstring>
+
+namespace logpp {
+
+    namespace {
+        const size_t CONTEXT_VALUE_PREFIX_LENGTH = sizeof(LOG_FORMAT_CONTEXT_VALUE_PREFIX) - 1;
+    }
+
+    /**
+     * @brief Construct a new LogFormat object.
+     *
+     * @param pattern The format string, containing any of the ${...} variables defined in ILogger.
+     */
+    LogFormat::LogFormat(const string& pattern): _pattern(pattern), _literalLength(0), _usedTokens(0) {
+        compile();
+    }
+
+    /**
+     * @brief Splits the format string into literal and variable segments.
+     */
+    void LogFormat::compile() {
+        size_t literalStart = 0;
+        size_t position = 0;
+
+        while ((position = _pattern.find("${", position)) != string::npos) {
+            const auto closingBrace = _pattern.find('}', position + 2);
+            if (closingBrace == string::npos) { break; }
+
+            const auto nameStart = position + 2;
+            const auto nameLength = closingBrace - nameStart;
+            bool isKnownVariable = false;
+
+            if (nameLength > CONTEXT_VALUE_PREFIX_LENGTH && _pattern.compare(nameStart, CONTEXT_VALUE_PREFIX_LENGTH, LOG_FORMAT_CONTEXT_VALUE_PREFIX) == 0) {
+                addSegment(Token::Literal, literalStart, position - literalStart);
+                addSegment(Token::ContextValue, nameStart + CONTEXT_VALUE_PREFIX_LENGTH, nameLength - CONTEXT_VALUE_PREFIX_LENGTH);
+                isKnownVariable = true;
+            } else {
+                for (const auto& variable : LOG_FORMAT_VARIABLES) {
+                    if (strlen(variable.name) == nameLength && _pattern.compare(nameStart, nameLength, variable.name) == 0) {
+                        addSegment(Token::Literal, literalStart, position - literalStart);
+                        addSegment(variable.token);
+                        isKnownVariable = true;
+                        break;
+                    }
+                }
+            }
+
+            if (isKnownVariable) {
+                literalStart = closingBrace + 1;
+                position = literalStart;
+            } else {
+                // Not one of ours; keep it as text and continue after the "${"
+                position += 2;
+            }
+        }
+
+        addSegment(Token::Literal, literalStart, _pattern.size() - literalStart);
+    }
+
+    /**
+     * @brief Appends a segment to the compiled format. Empty literals are dropped, adjacent literals merged.
+     */
+    void LogFormat::addSegment(const Token token, const size_t offset, const size_t length) {
+        if (token == Token::Literal) {
+            if (length == 0) { return; }
+
+            _literalLength += length;
+            if (!_segments.empty() && _segments.back().token == Token::Literal && _segments.back().offset + _segments.back().length == offset) {
+                _segments.back().length += length;
+                return;
+            }
+        }
+
+        _usedTokens |= 1u << (uint32_t)token;
+        _segments.push_back({ token, static_cast<uint32_t>(offset), static_cast<uint32_t>(length) });
+    }
+
+}
@@ -33,30 +33,43 @@ namespace logpp {
      */
     bool tryParseLogLevel(string level, LogLevel& out) {
         stringToLower(level);
-        auto cString = level.c_str();
-        auto numericValue = strtol(cString, nullptr, 10);
+        level.erase(0, level.find_first_not_of(" \t"));
+        level.erase(level.find_last_not_of(" \t\r\n") + 1);
 
-         if (level == "ok" || numericValue == 0) {
-             out = LogLevel::Ok;
-             return true;
-         } else if (level == "info" || numericValue == 1) {
-             out = LogLevel::Info;
-             return true;
-         } else if (level == "warning" || numericValue == 2) {
-             out = LogLevel::Warning;
-             return true;
-         } else if (level == "fatal" || numericValue == 3) {
-             out = LogLevel::Fatal;
-             return true;
-         } else if (level == "debug" || numericValue == 4) {
-             out = LogLevel::Debug;
-             return true;
-         } else if (level == "trace" || numericValue == 5) {
-             out = LogLevel::Trace;
-             return true;
-         }
+        if (level.empty()) { return false; }
 
-         return false;
+        // Numeric values are only considered if the whole string is a number;
+        // strtol() returns zero for names, which used to turn every name into LogLevel::Ok.
+        char* numEnd = nullptr;
+        const auto numericValue = strtol(level.c_str(), &numEnd, 10);
+        const bool isNumeric = numEnd != nullptr && *numEnd == '\0';
+
+        if (isNumeric) {
+            if (numericValue < (long)LOGLEVEL_MINVALUE || numericValue > (long)LOGLEVEL_MAXVALUE) { return false; }
+
+            out = (LogLevel)numericValue;
+            return true;
+        }
+
+        if (level == "ok" || level == "okay") {
+            out = LogLevel::Ok;
+        } else if (level == "info") {
+            out = LogLevel::Info;
+        } else if (level == "warning" || level == "warn") {
+            out = LogLevel::Warning;
+        } else if (level == "error") {
+            out = LogLevel::Error;
+        } else if (level == "fatal") {
+            out = LogLevel::Fatal;
+        } else if (level == "debug") {
+            out = LogLevel::Debug;
+        } else if (level == "trace") {
+            out = LogLevel::Trace;
+        } else {
+            return false;
+        }
+
+        return true;
     }
 
     /**
@@ -91,12 +104,11 @@ namespace logpp {
     string toString(const LogLevel level, TextColour foreground, TextColour background) {
         using std::to_string;
 
-        return formatString(
-            "\033[%s;%sm%s\033[0m",
-            background == TextColour::None ? "" : to_string((uint32_t)background).c_str(),
-            foreground == TextColour::None ? "" : to_string((uint32_t)foreground).c_str(),
-            toString(level).c_str()
-        );
+        // "\033[<background>;<foreground>m<level>\033[0m"; built by hand as formatString() only exists with logpp_USE_PRINTF
+        return string("\033[")
+             + (background == TextColour::None ? "" : to_string((uint32_t)background)) + ";"
+             + (foreground == TextColour::None ? "" : to_string((uint32_t)foreground)) + "m"
+             + toString(level) + "\033[0m";
     }
 
     
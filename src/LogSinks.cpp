@@ -0,0 +1,326 @@
+/**
+ * LogSinks.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LogSinks.hpp"
+#include "EmergencyLog.hpp"
+#include "LogExtensions.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef logpp_USE_FSTAT
+    #if __cplusplus < 201703L
+        #include <experimental/filesystem>
+    #else
+        #include <filesystem>
+    #endif
+#endif
+
+#include <fmt/format.h>
+
+namespace logpp {
+
+    using std::ifstream;
+    using std::ios_base;
+    using std::ofstream;
+
+    #ifndef logpp_USE_FSTAT
+        #if __cplusplus < 201703L
+            namespace fs = std::experimental::filesystem;
+        #else
+            namespace fs = std::filesystem;
+        #endif
+    #endif
+
+    const static uint64_t ONE_MIB = 1048576u;
+
+    const char* const FileSink::LOGPP_CTRL_DIR = ".logpp";
+    const uint32_t FileSink::CTRL_FILE_MAGIC;
+    const uint32_t FileSink::DEFAULT_MAX_LOG_FILES;
+
+    //===========================
+    //		ConsoleSink
+    //===========================
+
+    /**
+     * @brief Writes buffered records to stdout, adds a missing line feed and flushes stdout.
+     *
+     * @param buffer The records to write.
+     */
+    void ConsoleSink::write(string_view buffer) {
+        using std::cout;
+
+        if (buffer.size() == 0) return;
+
+        cout.write(buffer.data(), buffer.size());
+        if (buffer.data()[buffer.size() - 1] != '\n') {
+            cout << std::endl;
+        }
+
+        cout.flush();
+    }
+
+    /**
+     * @brief Writes a logger's buffer to stdout chunk by chunk, adds a missing line feed and flushes stdout.
+     *
+     * @param buffer The records to write.
+     */
+    void ConsoleSink::write(const LogBuffer& buffer) {
+        using std::cout;
+
+        if (buffer.empty()) return;
+
+        char lastCharacter = '\n';
+        buffer.forEachChunk([&lastCharacter](string_view chunk) {
+            cout.write(chunk.data(), chunk.size());
+            if (chunk.size() > 0) { lastCharacter = chunk.data()[chunk.size() - 1]; }
+        });
+
+        if (lastCharacter != '\n') {
+            cout << std::endl;
+        }
+
+        cout.flush();
+    }
+
+    /**
+     * @brief Writes a single record to stderr, bypassing any buffer.
+     *
+     * @param record The record to write.
+     */
+    void ConsoleSink::writeDirect(string_view record) {
+        using std::cerr;
+
+        if (record.size() == 0) return;
+
+        cerr.write(record.data(), record.size());
+        if (record.data()[record.size() - 1] != '\n') {
+            cerr << std::endl;
+        }
+    }
+
+    /**
+     * @brief Writes buffered records to stdout and an emergency record to stdout or stderr, bypassing the streams' buffers.
+     *
+     * @param level The level of the emergency record; decides where it goes, like with writesDirectly().
+     * @param buffered The buffered records; nullptr if there are none to write.
+     * @param record The emergency record, including its line feed.
+     */
+    void ConsoleSink::writeEmergency(const LogLevel level, const LogBuffer* buffered, string_view record) const {
+        if (buffered != nullptr) { EmergencyLog::writeBuffer(STDOUT_FILENO, *buffered); }
+
+        EmergencyLog::writeFully(writesDirectly(level) ? STDERR_FILENO : STDOUT_FILENO, record.data(), record.size());
+    }
+
+    //===========================
+    //		FileSink
+    //===========================
+
+    /**
+     * @brief Construct a new FileSink object.
+     *
+     * @param filename The path/to/file to log to; the file number is appended to it.
+     * @param loggerName The name of the logger writing to this sink; used for the control file.
+     * @param maxFileSizeInMiB The size at which files are rotated.
+     */
+    FileSink::FileSink(const string& filename, const string& loggerName, const uint32_t maxFileSizeInMiB):
+    _filename(filename), _loggerName(loggerName), _numLogs(0), _maxFileSize(maxFileSizeInMiB), _maxFileCount(DEFAULT_MAX_LOG_FILES), _fd(-1) {
+        initLogContinuation();
+    }
+
+    FileSink::~FileSink() { closeLogFile(); }
+
+    /**
+     * @brief checks if file exists
+     *
+     * @param filename name of requested file
+     *
+     * @return true if file exists, false else
+     */
+    bool FileSink::fileExists(const string& filename) {
+        #ifdef logpp_USE_FSTAT
+        struct stat buffer;
+        return (stat(filename.c_str (), &buffer) == 0);
+        #else
+        return fs::exists(filename);
+        #endif
+    }
+
+    /**
+     * @brief returns size of file in bytes
+     *
+     * @param filename is the name of requested file
+     *
+     * @return size of file in bytes
+     */
+    uint32_t FileSink::fileSize(const string& filename) {
+        #ifdef logpp_USE_FSTAT
+        struct stat buffer;
+        stat(filename.c_str(), &buffer);
+        return buffer.st_size;
+        #else
+        return static_cast<uint32_t>(fs::file_size(filename));
+        #endif
+    }
+
+    /**
+     * @brief Gets the path to the control file for the current logger.
+     *
+     * @return string The path to the control file.
+     */
+    string FileSink::getControlFilePath() const {
+        return fmt::format(
+            "{}/{}/%s.lcf",
+            logpp::getBaseName(_filename),
+            LOGPP_CTRL_DIR,
+            _loggerName
+        );
+    }
+
+    /**
+     * @brief writes buffer into given file. If file is greater than _maxFileSize (in MiB) in size a new file with incremented end number will be created.
+     *
+     * @param buffer The records to write.
+     */
+    void FileSink::write(string_view buffer) {
+        if (buffer.size() == 0 || !openLogFile()) return;
+
+        EmergencyLog::writeFully(_fd, buffer.data(), buffer.size());
+    }
+
+    /**
+     * @brief Writes a logger's buffer into the current file, chunk by chunk; the file is rotated before, like with write(string_view).
+     *
+     * @param buffer The records to write.
+     */
+    void FileSink::write(const LogBuffer& buffer) {
+        if (buffer.empty() || !openLogFile()) return;
+
+        EmergencyLog::writeBuffer(_fd, buffer);
+    }
+
+    /**
+     * @brief Appends buffered records and an emergency record to the current log file, without allocating; gives up silently if it can't be opened.
+     *
+     * @param buffered The buffered records; nullptr if there are none to write.
+     * @param record The emergency record, including its line feed.
+     */
+    void FileSink::writeEmergency(const LogBuffer* buffered, string_view record) const {
+        const size_t MAX_FILE_NUMBER_LENGTH = 10;
+
+        char path[PATH_MAX];
+        if (_filename.size() + MAX_FILE_NUMBER_LENGTH >= sizeof(path)) return;
+
+        // Without the write mutex, _numLogs may be changing; the record then lands in the previous file or the next
+        std::memcpy(path, _filename.data(), _filename.size());
+        const auto length = _filename.size() + EmergencyLog::formatUnsigned(path + _filename.size(), MAX_FILE_NUMBER_LENGTH, _numLogs);
+        path[length] = '\0';
+
+        const auto savedErrno = errno;
+        const auto fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        if (fd >= 0) {
+            if (buffered != nullptr) { EmergencyLog::writeBuffer(fd, *buffered); }
+            EmergencyLog::writeFully(fd, record.data(), record.size());
+            close(fd);
+        }
+
+        errno = savedErrno;
+    }
+
+    /**
+     * @brief Makes sure the current log file is open for appending. If it's reached _maxFileSize (in MiB), the next file is opened instead, truncated.
+     *
+     * The file is kept open between writes, so this usually costs a single fstat(); its path is only formatted when it's (re)opened.
+     *
+     * @return false If the file couldn't be opened; the records are lost, as they were with an unwritable file before.
+     */
+    bool FileSink::openLogFile() {
+        struct stat status;
+
+        // A file deleted from outside is replaced, rather than written to where nobody will read it
+        if (_fd >= 0 && (fstat(_fd, &status) != 0 || status.st_nlink == 0)) { closeLogFile(); }
+
+        if (_fd < 0) {
+            _fd = open(fmt::format("{}{}", _filename, _numLogs).c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+            if (_fd < 0) { return false; }
+
+            if (fstat(_fd, &status) != 0) {
+                closeLogFile();
+                return false;
+            }
+        }
+
+        if (static_cast<uint64_t>(status.st_size) >= _maxFileSize * ONE_MIB) {
+            closeLogFile();
+
+            _numLogs = (_numLogs > _maxFileCount ? 0 : _numLogs + 1);
+            storeLatestLogFile();
+            _fd = open(fmt::format("{}{}", _filename, _numLogs).c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        }
+
+        return _fd >= 0;
+    }
+
+    /**
+     * @brief Closes the current log file, if it's open.
+     */
+    void FileSink::closeLogFile() {
+        if (_fd < 0) return;
+
+        close(_fd);
+        _fd = -1;
+    }
+
+    void FileSink::initLogContinuation() {
+        if (!fileExists(getControlFilePath())) {
+            _numLogs = 0;
+            storeLatestLogFile();
+            return;
+        }
+
+        ifstream inStream(getControlFilePath());
+
+        const auto ctrlFileSize = fileSize(getControlFilePath());
+        uint8_t* buffer = new uint8_t[ctrlFileSize];
+        memset(buffer, 0, ctrlFileSize);
+        ControlFileContents contents = { 0 };
+
+        inStream >> buffer;
+        std::memcpy(&contents, buffer, sizeof(contents));
+
+        delete[] buffer;
+
+        if (contents.magicNumber == CTRL_FILE_MAGIC) {
+            _numLogs = contents.currentWrittenLogFile;
+        }
+    }
+
+    void FileSink::storeLatestLogFile() {
+        ofstream outStream(getControlFilePath(), ios_base::trunc);
+        const ControlFileContents ctrlFile {
+            CTRL_FILE_MAGIC,
+            _numLogs
+        };
+
+        const char* fileContents = reinterpret_cast<const char*>(&ctrlFile);
+        outStream.write(fileContents, sizeof(ctrlFile));
+        outStream.flush();
+    }
+
+}
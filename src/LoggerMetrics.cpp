@@ -0,0 +1,193 @@
+/**
+ * LoggerMetrics.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "LoggerMetrics.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+
+namespace logpp {
+
+    using std::lock_guard;
+    using std::mutex;
+
+    namespace {
+        atomic<uint64_t> nextMetricsId(1);
+
+        /**
+         * @brief A thread's cached pointer to its shard of a LoggerMetrics object.
+         *
+         * Entries are matched by the metrics object's id rather than its address, so an entry belonging to
+         * a destroyed logger can never be mistaken for one of a new logger allocated at the same address.
+         * Such entries are removed whenever the thread adds one, so a thread logging to ever new loggers doesn't pile them up.
+         */
+        struct ShardCacheEntry {
+            uint64_t            metricsId;
+            void*               shard;
+            std::weak_ptr<void> liveness; ///!< Expires with the metrics object
+        };
+
+        vector<ShardCacheEntry>& getShardCache() {
+            static thread_local vector<ShardCacheEntry> shardCache;
+            return shardCache;
+        }
+    }
+
+    LoggerMetrics::Shard::Shard(): bytesWritten(0), flushCount(0), droppedRecords(0) {
+        for (auto& counter : recordsAccepted) { counter.store(0, std::memory_order_relaxed); }
+        for (auto& counter : recordsFiltered) { counter.store(0, std::memory_order_relaxed); }
+    }
+
+    /**
+     * @brief Construct a new LoggerMetrics object.
+     */
+    LoggerMetrics::LoggerMetrics(): _id(nextMetricsId.fetch_add(1, std::memory_order_relaxed)), _liveness(std::make_shared<char>(0)),
+    _bufferHighWaterMark(0), _queueHighWaterMark(0) { }
+
+    /**
+     * @brief Counts a record which passed the level filter.
+     *
+     * @param level The record's level.
+     * @param startTime The time (see now()) the record was accepted at.
+     */
+    void LoggerMetrics::recordAccepted(const LogLevel level, const uint64_t startTime) {
+        auto& shard = getThreadShard();
+        increment(shard.recordsAccepted[static_cast<uint32_t>(level)]);
+        shard.appendLatency.record(now() - startTime);
+    }
+
+    /**
+     * @brief Counts a record which was discarded by the level filter.
+     *
+     * @param level The record's level.
+     */
+    void LoggerMetrics::recordFiltered(const LogLevel level) {
+        const auto index = static_cast<uint32_t>(level);
+        if (index >= LOG_LEVEL_COUNT) { return; }
+
+        increment(getThreadShard().recordsFiltered[index]);
+    }
+
+    /**
+     * @brief Counts a flush of the logger's buffer.
+     *
+     * @param bytes The amount of bytes written.
+     * @param startTime The time (see now()) the flush started at.
+     */
+    void LoggerMetrics::recordFlush(const uint64_t bytes, const uint64_t startTime) {
+        auto& shard = getThreadShard();
+        increment(shard.flushCount);
+        increment(shard.bytesWritten, bytes);
+        shard.flushLatency.record(now() - startTime);
+
+        updateMax(_bufferHighWaterMark, bytes);
+    }
+
+    /**
+     * @brief Counts bytes which were written directly, bypassing the buffer (e.g. bad logs sent to stderr).
+     */
+    void LoggerMetrics::recordWrite(const uint64_t bytes) {
+        increment(getThreadShard().bytesWritten, bytes);
+    }
+
+    /**
+     * @brief Counts records which were lost.
+     */
+    void LoggerMetrics::recordDropped(const uint64_t count) {
+        increment(getThreadShard().droppedRecords, count);
+    }
+
+    /**
+     * @brief Updates the queue high-water mark.
+     *
+     * @param depth The current amount of queued records.
+     */
+    void LoggerMetrics::recordQueueDepth(const uint64_t depth) {
+        updateMax(_queueHighWaterMark, depth);
+    }
+
+    /**
+     * @brief Sums up the shards of all threads.
+     *
+     * @remarks Counters are read individually, so a snapshot taken while other threads are logging may be off by
+     * the records in flight; each counter on its own is never torn.
+     *
+     * @param snapshot The snapshot to fill. Its latency histograms must be empty.
+     */
+    void LoggerMetrics::fillSnapshot(LoggerMetricsSnapshot& snapshot) const {
+        snapshot.recordsAccepted.fill(0);
+        snapshot.recordsFiltered.fill(0);
+        snapshot.bytesWritten = 0;
+        snapshot.flushCount = 0;
+        snapshot.droppedRecords = 0;
+
+        {
+            lock_guard<mutex> lock(_shardMutex);
+            for (const auto& shard : _shards) {
+                for (uint32_t i = 0; i < LOG_LEVEL_COUNT; i++) {
+                    snapshot.recordsAccepted[i] += shard->recordsAccepted[i].load(std::memory_order_relaxed);
+                    snapshot.recordsFiltered[i] += shard->recordsFiltered[i].load(std::memory_order_relaxed);
+                }
+
+                snapshot.bytesWritten += shard->bytesWritten.load(std::memory_order_relaxed);
+                snapshot.flushCount += shard->flushCount.load(std::memory_order_relaxed);
+                snapshot.droppedRecords += shard->droppedRecords.load(std::memory_order_relaxed);
+
+                snapshot.appendLatency.merge(shard->appendLatency);
+                snapshot.flushLatency.merge(shard->flushLatency);
+            }
+        }
+
+        snapshot.bufferHighWaterMark = _bufferHighWaterMark.load(std::memory_order_relaxed);
+        snapshot.queueHighWaterMark = _queueHighWaterMark.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the calling thread's shard, creating it on first use.
+     */
+    LoggerMetrics::Shard& LoggerMetrics::getThreadShard() {
+        auto& shardCache = getShardCache();
+
+        // Most threads log to a handful of loggers; a linear search over the cache beats any map.
+        for (const auto& entry : shardCache) {
+            if (entry.metricsId == _id) { return *static_cast<Shard*>(entry.shard); }
+        }
+
+        return createThreadShard();
+    }
+
+    /**
+     * @brief Creates a shard for the calling thread and adds it to the thread's cache, after removing the entries of destroyed metrics.
+     */
+    LoggerMetrics::Shard& LoggerMetrics::createThreadShard() {
+        Shard* shard = new Shard();
+        {
+            lock_guard<mutex> lock(_shardMutex);
+            _shards.emplace_back(shard);
+        }
+
+        auto& shardCache = getShardCache();
+        shardCache.erase(std::remove_if(shardCache.begin(), shardCache.end(), [](const ShardCacheEntry& entry) { return entry.liveness.expired(); }),
+                         shardCache.end());
+        shardCache.push_back({ _id, shard, _liveness });
+
+        return *shard;
+    }
+
+    /**
+     * @brief Atomically raises a maximum to value, if value is larger.
+     */
+    void LoggerMetrics::updateMax(atomic<uint64_t>& maximum, const uint64_t value) {
+        auto current = maximum.load(std::memory_order_relaxed);
+        while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) { }
+    }
+
+}
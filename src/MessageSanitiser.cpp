@@ -0,0 +1,316 @@
+/**
+ * MessageSanitiser.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "MessageSanitiser.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace logpp {
+
+    const char* const MessageSanitiser::CONTINUATION_PREFIX = "    ";
+
+    namespace {
+
+        const char      ESCAPE = 0x1b;
+        const char      REPLACEMENT_CHARACTER[] = "\xef\xbf\xbd"; ///!< U+FFFD, written in place of invalid UTF-8
+        const size_t    CONTINUATION_PREFIX_LENGTH = 4;
+
+        /**
+         * @brief Determines whether a byte may need sanitising: a control character other than tab, DEL or a non-ASCII byte.
+         */
+        inline bool isUnsafe(const unsigned char character) {
+            return (character < 0x20 && character != '\t') || character >= 0x7f;
+        }
+
+        /**
+         * @brief Gets the offset of the first byte in [data, data + size) which may need sanitising, or size. One byte at a time.
+         */
+        size_t findUnsafeScalar(const char* data, const size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                if (isUnsafe(static_cast<unsigned char>(data[i]))) { return i; }
+            }
+
+            return size;
+        }
+
+    #if defined(__SSE2__)
+        /**
+         * @brief findUnsafeScalar(), 16 bytes at a time.
+         */
+        size_t findUnsafeSse2(const char* data, const size_t size) {
+            const auto space = _mm_set1_epi8(0x20);
+            const auto tab = _mm_set1_epi8('\t');
+            const auto del = _mm_set1_epi8(0x7f);
+            size_t offset = 0;
+
+            for (; offset + 16 <= size; offset += 16) {
+                const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+                // As signed bytes, both the control characters and the non-ASCII bytes are below 0x20
+                const auto isBelowSpace = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmplt_epi8(chunk, space));
+                const auto isUnsafe = _mm_or_si128(isBelowSpace, _mm_cmpeq_epi8(chunk, del));
+                const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(isUnsafe));
+
+                if (mask != 0) { return offset + __builtin_ctz(mask); }
+            }
+
+            return offset + findUnsafeScalar(data + offset, size - offset);
+        }
+
+        /**
+         * @brief findUnsafeScalar(), 32 bytes at a time. Only called if the CPU supports AVX2.
+         */
+        __attribute__((target("avx2")))
+        size_t findUnsafeAvx2(const char* data, const size_t size) {
+            const auto space = _mm256_set1_epi8(0x20);
+            const auto tab = _mm256_set1_epi8('\t');
+            const auto del = _mm256_set1_epi8(0x7f);
+            size_t offset = 0;
+
+            for (; offset + 32 <= size; offset += 32) {
+                const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+                const auto isBelowSpace = _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, tab), _mm256_cmpgt_epi8(space, chunk));
+                const auto isUnsafe = _mm256_or_si256(isBelowSpace, _mm256_cmpeq_epi8(chunk, del));
+                const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(isUnsafe));
+
+                if (mask != 0) { return offset + __builtin_ctz(mask); }
+            }
+
+            // See findEscapeAvx2() in JsonLineFormatter.cpp
+            _mm256_zeroupper();
+            return offset + findUnsafeSse2(data + offset, size - offset);
+        }
+    #endif // __SSE2__
+
+        typedef size_t (*FindUnsafeFunction)(const char*, const size_t);
+
+        struct ScanImplementation {
+            FindUnsafeFunction  findUnsafe;
+            const char*         name;
+        };
+
+        /**
+         * @brief Picks the widest implementation the CPU supports; once per process.
+         */
+        const ScanImplementation& selectScanImplementation() {
+            static const ScanImplementation implementation = [] {
+                #if defined(__SSE2__)
+                    if (__builtin_cpu_supports("avx2")) { return ScanImplementation{ &findUnsafeAvx2, "avx2" }; }
+                    return ScanImplementation{ &findUnsafeSse2, "sse2" };
+                #else
+                    return ScanImplementation{ &findUnsafeScalar, "scalar" };
+                #endif
+            }();
+
+            return implementation;
+        }
+
+        inline bool isInRange(const unsigned char character, const unsigned char first, const unsigned char last) {
+            return character >= first && character <= last;
+        }
+
+        /**
+         * @brief Gets the length of the well-formed UTF-8 sequence at data, or 0 if it's invalid
+         * (stray continuation bytes, overlong forms, surrogates, code points beyond U+10FFFF, truncated sequences).
+         */
+        size_t getUtf8SequenceLength(const unsigned char* data, const size_t available) {
+            const auto lead = data[0];
+            size_t length = 0;
+            unsigned char secondMin = 0x80;
+            unsigned char secondMax = 0xbf;
+
+            if (isInRange(lead, 0xc2, 0xdf)) {
+                length = 2;
+            } else if (isInRange(lead, 0xe0, 0xef)) {
+                length = 3;
+                if (lead == 0xe0) { secondMin = 0xa0; }
+                if (lead == 0xed) { secondMax = 0x9f; }
+            } else if (isInRange(lead, 0xf0, 0xf4)) {
+                length = 4;
+                if (lead == 0xf0) { secondMin = 0x90; }
+                if (lead == 0xf4) { secondMax = 0x8f; }
+            } else {
+                return 0;
+            }
+
+            if (available < length || !isInRange(data[1], secondMin, secondMax)) { return 0; }
+            for (size_t i = 2; i < length; i++) {
+                if (!isInRange(data[i], 0x80, 0xbf)) { return 0; }
+            }
+
+            return length;
+        }
+
+        /**
+         * @brief Gets the offset just past the parameter, intermediate and final bytes of a CSI sequence starting at data[position].
+         */
+        size_t skipControlSequence(const unsigned char* data, size_t position, const size_t size) {
+            while (position < size && isInRange(data[position], 0x30, 0x3f)) { position++; }
+            while (position < size && isInRange(data[position], 0x20, 0x2f)) { position++; }
+            if (position < size && isInRange(data[position], 0x40, 0x7e)) { position++; }
+            return position;
+        }
+
+        /**
+         * @brief Gets the offset just past the ANSI escape sequence starting at data[position] (the ESC).
+         *
+         * Knows CSI sequences (ESC [ ... final byte), string sequences terminated by BEL or ESC \ (OSC, DCS, ...)
+         * and the short ESC sequences. A string sequence without its terminator only loses its introducer.
+         */
+        size_t skipEscapeSequence(const unsigned char* data, size_t position, const size_t size) {
+            if (++position == size) { return size; }
+
+            const auto introducer = data[position++];
+            switch (introducer) {
+                case '[':
+                    return skipControlSequence(data, position, size);
+                case ']': case 'P': case 'X': case '^': case '_':
+                    for (auto end = position; end < size; end++) {
+                        if (data[end] == 0x07) { return end + 1; }
+                        if (data[end] == ESCAPE && end + 1 < size && data[end + 1] == '\\') { return end + 2; }
+                    }
+                    return position;
+                default:
+                    if (!isInRange(introducer, 0x20, 0x7e)) { return position - 1; }
+
+                    // The introducer was an intermediate byte; the sequence ends with the first final byte
+                    if (isInRange(introducer, 0x20, 0x2f)) {
+                        while (position < size && isInRange(data[position], 0x20, 0x2f)) { position++; }
+                        if (position < size && isInRange(data[position], 0x30, 0x7e)) { position++; }
+                    }
+                    return position;
+            }
+        }
+
+        void appendControl(string& out, const uint32_t character, const SanitiseMode mode) {
+            static const char HEX_DIGITS[] = "0123456789abcdef";
+            if (mode == SanitiseMode::Strip) { return; }
+
+            const char escape[] = { '\\', 'x', HEX_DIGITS[(character >> 4) & 0xf], HEX_DIGITS[character & 0xf] };
+            out.append(escape, sizeof(escape));
+        }
+
+        string& getScratchBuffer() {
+            static thread_local string scratch;
+            return scratch;
+        }
+
+    }
+
+    /**
+     * @brief Gets the offset of the first byte which may need sanitising (control characters other than tab, DEL, non-ASCII bytes).
+     *
+     * @return size_t The offset, or msg.size() if the message can be written as it is.
+     */
+    size_t MessageSanitiser::findUnsafe(string_view msg) {
+        return selectScanImplementation().findUnsafe(msg.data(), msg.size());
+    }
+
+    /**
+     * @brief Appends a sanitised copy of a message.
+     *
+     * Runs of safe bytes are found with SIMD and copied at once; the bytes between them are handled one at a time:
+     *  - line breaks (\n, \r\n) are kept and followed by the continuation prefix; trailing ones are dropped
+     *  - other control characters (C0, DEL and C1) are escaped as \xHH or stripped, according to mode; in Strip mode,
+     *    ANSI escape sequences are removed as a whole
+     *  - valid UTF-8 is copied, invalid bytes are replaced by U+FFFD
+     */
+    void MessageSanitiser::sanitiseTo(string& out, string_view msg, const SanitiseMode mode) {
+        if (mode == SanitiseMode::Off) {
+            out.append(msg.data(), msg.size());
+            return;
+        }
+
+        const auto findUnsafe = selectScanImplementation().findUnsafe;
+        const auto data = reinterpret_cast<const unsigned char*>(msg.data());
+        auto size = msg.size();
+        size_t position = 0;
+        size_t runStart = 0; ///!< The start of the bytes which are kept as they are, but haven't been appended yet
+
+        while (size > 0 && (data[size - 1] == '\n' || data[size - 1] == '\r')) { size--; }
+
+        while (position < size) {
+            position += findUnsafe(msg.data() + position, size - position);
+            if (position == size) { break; }
+
+            // Valid UTF-8 stays in the run. Non-ASCII text mixes short runs of both, which are cheaper to walk here
+            // than to hand back to the SIMD scan every few bytes.
+            while (position < size) {
+                const auto character = data[position];
+                if (!isUnsafe(character)) {
+                    position++;
+                    continue;
+                }
+
+                const auto length = character >= 0x80 ? getUtf8SequenceLength(data + position, size - position) : 0;
+                if (length == 0 || (character == 0xc2 && data[position + 1] < 0xa0)) { break; }
+
+                position += length;
+            }
+
+            if (position == size || !isUnsafe(data[position])) { continue; }
+
+            out.append(msg.data() + runStart, position - runStart);
+
+            const auto character = data[position];
+            if (character == '\n') {
+                out.push_back('\n');
+                out.append(CONTINUATION_PREFIX, CONTINUATION_PREFIX_LENGTH);
+                position++;
+            } else if (character == '\r' && position + 1 < size && data[position + 1] == '\n') {
+                position++;
+            } else if (character == ESCAPE && mode == SanitiseMode::Strip) {
+                position = skipEscapeSequence(data, position, size);
+            } else if (character < 0x80) {
+                appendControl(out, character, mode);
+                position++;
+            } else if (character == 0xc2 && position + 1 < size && data[position + 1] < 0xa0 && data[position + 1] >= 0x80) {
+                // U+0080 - U+009F: the C1 control characters, including the single-character CSI
+                appendControl(out, data[position + 1], mode);
+                position += 2;
+                if (data[position - 1] == 0x9b && mode == SanitiseMode::Strip) { position = skipControlSequence(data, position, size); }
+            } else {
+                out.append(REPLACEMENT_CHARACTER, sizeof(REPLACEMENT_CHARACTER) - 1);
+                position++;
+            }
+
+            runStart = position;
+        }
+
+        out.append(msg.data() + runStart, size - runStart);
+    }
+
+    /**
+     * @brief Sanitises out from start in place. If there's nothing to sanitise, which is the common case, out isn't touched.
+     */
+    void MessageSanitiser::sanitiseTail(string& out, const size_t start, const SanitiseMode mode) {
+        if (mode == SanitiseMode::Off || start >= out.size()) { return; }
+
+        const auto unsafeStart = start + findUnsafe(string_view(out.data() + start, out.size() - start));
+        if (unsafeStart == out.size()) { return; }
+
+        auto& scratch = getScratchBuffer();
+        scratch.assign(out, unsafeStart, string::npos);
+        out.resize(unsafeStart);
+
+        sanitiseTo(out, scratch, mode);
+    }
+
+    /**
+     * @brief Gets the name of the scanning implementation picked for this CPU.
+     */
+    const char* MessageSanitiser::getScanImplementation() {
+        return selectScanImplementation().name;
+    }
+
+}
@@ -0,0 +1,95 @@
+/**
+ * RateLimiter.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "RateLimiter.hpp"
+#include "LogExtensions.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <fmt/core.h>
+
+namespace logpp {
+
+    atomic<RateLimiter*> RateLimiter::_callSites(nullptr);
+
+    namespace {
+
+        const int64_t MAX_WINDOW = INT64_MAX / 4; ///!< ~73 years; keeps arrival + interval from overflowing in tryAcquire()
+
+    }
+
+    /**
+     * @brief Construct a new RateLimiter object.
+     *
+     * @remarks Call sites constructed with a file name are registered globally so their suppression counts can be queried.
+     * These must have static storage duration, which the LOGPP_*_RATE_LIMITED macros guarantee.
+     *
+     * @param messagesPerSecond The sustained amount of messages allowed per second; 0 or less (or NaN) suppresses every message.
+     * @param burst The amount of messages which may be logged back-to-back before limiting kicks in.
+     * @param file (Optional) The file containing the call site.
+     * @param line (Optional) The line of the call site.
+     */
+    RateLimiter::RateLimiter(const double messagesPerSecond, const uint32_t burst, const char* file, const int32_t line):
+    _file(file), _line(line), _theoreticalArrival(0), _suppressed(0), _reported(0), _nextCallSite(nullptr) {
+        if (!(messagesPerSecond > 0)) {
+            // An empty bucket that never refills: nextArrival - now is never negative, so every message is suppressed
+            _emissionInterval = 0;
+            _burstWindow = -1;
+        } else {
+            const auto interval = 1e9 / messagesPerSecond;
+            const auto tokens = static_cast<int64_t>(burst == 0 ? 1 : burst);
+
+            _emissionInterval = interval < MAX_WINDOW ? static_cast<int64_t>(interval) : MAX_WINDOW;
+            _burstWindow = _emissionInterval <= MAX_WINDOW / tokens ? _emissionInterval * tokens : MAX_WINDOW;
+        }
+
+        if (_file != nullptr) {
+            _nextCallSite = _callSites.load();
+            while (!_callSites.compare_exchange_weak(_nextCallSite, this)) ;
+        }
+    }
+
+    /**
+     * @brief Gets the amount of messages suppressed over all registered call sites.
+     */
+    uint64_t RateLimiter::getTotalSuppressedCount() {
+        uint64_t total = 0;
+        forEachCallSite([&](const RateLimiter& callSite) { total += callSite.getSuppressedCount(); });
+
+        return total;
+    }
+
+    /**
+     * @brief Calls a function for each registered call site.
+     *
+     * @param callback The function to call.
+     */
+    void RateLimiter::forEachCallSite(const std::function<void(const RateLimiter&)>& callback) {
+        for (auto callSite = _callSites.load(); callSite != nullptr; callSite = callSite->_nextCallSite) {
+            callback(*callSite);
+        }
+    }
+
+    /**
+     * @brief Gets the message logged in place of suppressed messages.
+     *
+     * @param suppressedCount The amount of suppressed messages.
+     *
+     * @return string The summary message.
+     */
+    string RateLimiter::getSuppressionSummary(const uint64_t suppressedCount) const {
+        if (_file == nullptr) {
+            return fmt::format("Rate limit: suppressed {} messages", suppressedCount);
+        }
+
+        return fmt::format("Rate limit: suppressed {} messages from {}:{}", suppressedCount, getBaseName(_file), _line);
+    }
+
+}
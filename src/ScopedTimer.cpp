@@ -0,0 +1,105 @@
+/**
+ * ScopedTimer.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ScopedTimer.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <mutex>
+
+namespace logpp {
+
+    using std::lock_guard;
+    using std::mutex;
+
+    const uint32_t Tracing::SPANS_PER_BATCH;
+
+    atomic<bool> Tracing::_enabled(false);
+
+    namespace {
+        mutex& getSinkMutex() {
+            static mutex sinkMutex;
+            return sinkMutex;
+        }
+
+        shared_ptr<ITraceSink>& getSinkStorage() {
+            static shared_ptr<ITraceSink> sink;
+            return sink;
+        }
+
+        /**
+         * @brief The spans completed on a thread which haven't been handed to the sink yet.
+         * Whatever is left is handed over when the thread exits.
+         */
+        struct ThreadSpanBuffer {
+            TraceSpan   spans[Tracing::SPANS_PER_BATCH];
+            size_t      count = 0;
+
+            ~ThreadSpanBuffer() { writeToSink(); }
+
+            void writeToSink() {
+                if (count == 0) { return; }
+
+                const auto sink = Tracing::getSink();
+                if (sink != nullptr) { sink->writeSpans(spans, count); }
+                count = 0;
+            }
+        };
+
+        ThreadSpanBuffer& getThreadSpanBuffer() {
+            static thread_local ThreadSpanBuffer buffer;
+            return buffer;
+        }
+    }
+
+    /**
+     * @brief Sets the sink completed spans are written to.
+     *
+     * @param sink The sink, or nullptr to disable tracing. Spans still buffered by other threads go to whichever sink is set when they are handed over.
+     */
+    void Tracing::setSink(shared_ptr<ITraceSink> sink) {
+        lock_guard<mutex> lock(getSinkMutex());
+
+        _enabled.store(sink != nullptr, std::memory_order_relaxed);
+        getSinkStorage() = std::move(sink);
+    }
+
+    /**
+     * @brief Gets the current sink; nullptr if tracing is disabled.
+     */
+    shared_ptr<ITraceSink> Tracing::getSink() {
+        lock_guard<mutex> lock(getSinkMutex());
+
+        return getSinkStorage();
+    }
+
+    /**
+     * @brief Buffers a completed span on the current thread; hands the buffer to the sink once it is full.
+     */
+    void Tracing::recordSpan(const TraceSpan& span) {
+        auto& buffer = getThreadSpanBuffer();
+
+        buffer.spans[buffer.count++] = span;
+        if (buffer.count == SPANS_PER_BATCH) { buffer.writeToSink(); }
+    }
+
+    /**
+     * @brief Hands the spans buffered on the current thread to the sink, then flushes the sink.
+     *
+     * @remarks Other threads' spans are handed over when their buffers fill up or the threads exit.
+     */
+    void Tracing::flush() {
+        getThreadSpanBuffer().writeToSink();
+
+        const auto sink = getSink();
+        if (sink != nullptr) { sink->flush(); }
+    }
+
+}
@@ -0,0 +1,382 @@
+/**
+ * ShmRing.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ShmRing.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace logpp {
+
+    using std::invalid_argument;
+    using std::runtime_error;
+
+    const uint32_t ShmRingSink::DEFAULT_SLOT_COUNT;
+    const uint32_t ShmRingSink::DEFAULT_SLOT_SIZE;
+
+    namespace {
+
+        const auto RING_INIT_TIMEOUT = std::chrono::milliseconds(100); ///!< How long to wait for another process to finish creating a ring
+        const auto SLOT_TAKEOVER_TIMEOUT = std::chrono::milliseconds(1); ///!< How long to wait for a writer a lap behind to finish its slot
+
+        size_t getMappingSize(const uint32_t slotCount, const uint32_t slotSize) {
+            return sizeof(ShmRingHeader) + static_cast<size_t>(slotCount) * slotSize;
+        }
+
+        ShmRingSlot* getSlot(ShmRingHeader* header, const uint64_t sequence) {
+            const auto index = sequence & (header->slotCount - 1);
+            return reinterpret_cast<ShmRingSlot*>(reinterpret_cast<char*>(header) + sizeof(ShmRingHeader) + index * header->slotSize);
+        }
+
+        const ShmRingSlot* getSlot(const ShmRingHeader* header, const uint64_t sequence) {
+            return getSlot(const_cast<ShmRingHeader*>(header), sequence);
+        }
+
+        /**
+         * @brief Maps an opened ring; the descriptor isn't needed afterwards.
+         */
+        void* mapRing(const int fd, const size_t size, const int protection, const string& shmName) {
+            auto mapping = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) {
+                const auto error = errno;
+                close(fd);
+                throw runtime_error(fmt::format("Could not map shared memory {}: {}", shmName, strerror(error)));
+            }
+
+            close(fd);
+            return mapping;
+        }
+
+        /**
+         * @brief Waits for the creator of a ring to size it; until then, its header can't be mapped.
+         *
+         * @param size Set to the ring's size.
+         */
+        bool waitForRingSize(const int fd, size_t& size) {
+            const auto deadline = std::chrono::steady_clock::now() + RING_INIT_TIMEOUT;
+            struct stat status;
+
+            while (fstat(fd, &status) == 0) {
+                if (static_cast<size_t>(status.st_size) >= sizeof(ShmRingHeader)) {
+                    size = status.st_size;
+                    return true;
+                }
+
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Waits for the creator of a ring to publish its magic number.
+         */
+        bool waitForRing(const ShmRingHeader* header) {
+            const auto deadline = std::chrono::steady_clock::now() + RING_INIT_TIMEOUT;
+
+            while (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC) {
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            return true;
+        }
+
+    }
+
+    //===========================
+    //		ShmRingSink
+    //===========================
+
+    /**
+     * @brief Gets the name of the POSIX shared-memory object backing a ring.
+     */
+    string ShmRingSink::getShmName(const string& ringName) { return "/logpp." + ringName; }
+
+    /**
+     * @brief Deletes a ring. Processes which have it mapped keep reading (or writing) their copy.
+     *
+     * @return true If the ring existed.
+     */
+    bool ShmRingSink::remove(const string& ringName) { return shm_unlink(getShmName(ringName).c_str()) == 0; }
+
+    /**
+     * @brief Construct a new ShmRingSink object.
+     *
+     * Attaches to an existing ring of the same geometry, so a restarted application continues its sequence numbers.
+     * A ring which another process is still creating is waited for; a ring with a different geometry is replaced.
+     *
+     * @param ringName The name of the ring, as passed to logpp-tail.
+     * @param slotCount The number of records the ring holds; must be a power of two.
+     * @param slotSize The bytes per record, including the 16-byte slot header; must be a multiple of 8.
+     */
+    ShmRingSink::ShmRingSink(const string& ringName, const uint32_t slotCount, const uint32_t slotSize):
+    _header(nullptr), _mappingSize(getMappingSize(slotCount, slotSize)) {
+        if (slotCount < 2 || (slotCount & (slotCount - 1)) != 0) {
+            throw invalid_argument("The slot count of a shared-memory ring must be a power of two");
+        }
+
+        if (slotSize <= sizeof(ShmRingSlot) || slotSize % alignof(ShmRingSlot) != 0) {
+            throw invalid_argument(fmt::format("The slot size of a shared-memory ring must be a multiple of {} and larger than {}", alignof(ShmRingSlot), sizeof(ShmRingSlot)));
+        }
+
+        const auto shmName = getShmName(ringName);
+
+        // Once to attach to or create the ring, once more if an existing ring had to be replaced
+        for (int attempt = 0; attempt < 2 && _header == nullptr; attempt++) {
+            auto fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+            const bool isCreator = fd >= 0;
+
+            if (!isCreator && errno == EEXIST) {
+                fd = shm_open(shmName.c_str(), O_RDWR, 0);
+            }
+
+            if (fd < 0) {
+                throw runtime_error(fmt::format("Could not open shared memory {}: {}", shmName, strerror(errno)));
+            }
+
+            if (isCreator) {
+                if (ftruncate(fd, _mappingSize) != 0) {
+                    const auto error = errno;
+                    close(fd);
+                    shm_unlink(shmName.c_str());
+                    throw runtime_error(fmt::format("Could not size shared memory {}: {}", shmName, strerror(error)));
+                }
+
+                // The new pages are zeroed: every slot reads as never written
+                _header = static_cast<ShmRingHeader*>(mapRing(fd, _mappingSize, PROT_READ | PROT_WRITE, shmName));
+                _header->version = SHM_RING_VERSION;
+                _header->slotCount = slotCount;
+                _header->slotSize = slotSize;
+                _header->nextSequence.store(0, std::memory_order_relaxed);
+                __atomic_store_n(&_header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+                break;
+            }
+
+            // The creator may not have sized or initialised the ring yet; only a ring which was initialised with another geometry is replaced
+            size_t ringSize = 0;
+            if (!waitForRingSize(fd, ringSize)) {
+                close(fd);
+                throw runtime_error(fmt::format("Shared memory {} was never initialised as a log ring; delete it with ShmRingSink::remove()", shmName));
+            }
+
+            auto header = static_cast<ShmRingHeader*>(mapRing(fd, ringSize, PROT_READ | PROT_WRITE, shmName));
+            if (!waitForRing(header)) {
+                munmap(header, ringSize);
+                throw runtime_error(fmt::format("Shared memory {} was never initialised as a log ring; delete it with ShmRingSink::remove()", shmName));
+            }
+
+            if (ringSize == _mappingSize && header->version == SHM_RING_VERSION && header->slotCount == slotCount && header->slotSize == slotSize) {
+                _header = header;
+                break;
+            }
+
+            munmap(header, ringSize);
+            shm_unlink(shmName.c_str());
+        }
+
+        if (_header == nullptr) {
+            throw runtime_error(fmt::format("Could not create shared memory {}: it's being replaced concurrently", shmName));
+        }
+    }
+
+    ShmRingSink::~ShmRingSink() {
+        munmap(_header, _mappingSize);
+    }
+
+    /**
+     * @brief Publishes a single record, tagged with its level so readers can filter it.
+     */
+    void ShmRingSink::publish(const LogLevel level, string_view record) {
+        publishRecord(static_cast<uint8_t>(level), record);
+    }
+
+    /**
+     * @brief Publishes each line of a buffer as a separate record.
+     */
+    void ShmRingSink::write(string_view buffer) {
+        const auto data = buffer.data();
+        size_t start = 0;
+
+        while (start < buffer.size()) {
+            auto end = start;
+            while (end < buffer.size() && data[end] != '\n') { end++; }
+
+            publishRecord(SHM_RING_UNKNOWN_LEVEL, string_view(data + start, end - start));
+            start = end + 1;
+        }
+    }
+
+    /**
+     * @brief Claims the next sequence number and copies a record into its slot.
+     *
+     * The slot's sequence is marked odd before the copy and even after it, so a reader copying the slot
+     * at the same time sees that its copy may be torn.
+     *
+     * Claiming the slot is a CAS, so two writers a lap apart never copy into it at once: a writer finding a later
+     * record in its slot drops its own (readers count it as lost), and one finding an earlier record still being
+     * copied waits for it. A writer stalled mid-copy for longer than SLOT_TAKEOVER_TIMEOUT (e.g. a crashed process)
+     * is taken over; its record is dropped, and only if it resumes copying afterwards can the later record be torn.
+     */
+    void ShmRingSink::publishRecord(const uint8_t level, string_view record) {
+        auto length = record.size();
+        while (length > 0 && (record.data()[length - 1] == '\n' || record.data()[length - 1] == '\r')) { length--; }
+        if (length == 0) return;
+
+        const auto sequence = _header->nextSequence.fetch_add(1, std::memory_order_relaxed);
+        auto slot = getSlot(_header, sequence);
+        const auto maxLength = getMaxRecordLength();
+        const auto stamp = (sequence + 1) << 1;
+
+        if (!claimSlot(slot, stamp)) return;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->length = static_cast<uint32_t>(length > maxLength ? maxLength : length);
+        slot->level = level;
+        slot->flags = length > maxLength ? SHM_RING_TRUNCATED : 0;
+        std::memcpy(reinterpret_cast<char*>(slot + 1), record.data(), slot->length);
+
+        // Fails only if a writer a lap ahead took the slot over; the record is lost then
+        auto claimed = stamp | 1;
+        slot->sequence.compare_exchange_strong(claimed, stamp, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Marks a slot as being written with the given stamp (odd), unless a later record owns it.
+     *
+     * @return false If the slot holds (or is being filled with) a later record; the caller's record is dropped.
+     */
+    bool ShmRingSink::claimSlot(ShmRingSlot* slot, const uint64_t stamp) {
+        auto current = slot->sequence.load(std::memory_order_relaxed);
+        auto deadline = std::chrono::steady_clock::time_point::max();
+
+        while (true) {
+            if ((current >> 1) >= (stamp >> 1)) return false;
+
+            // A writer a lap behind is still copying; it won't take long, unless it's stalled or gone
+            if ((current & 1) != 0) {
+                const auto now = std::chrono::steady_clock::now();
+                if (deadline == std::chrono::steady_clock::time_point::max()) { deadline = now + SLOT_TAKEOVER_TIMEOUT; }
+
+                if (now < deadline) {
+                    std::this_thread::yield();
+                    current = slot->sequence.load(std::memory_order_relaxed);
+                    continue;
+                }
+            }
+
+            if (slot->sequence.compare_exchange_weak(current, stamp | 1, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    //===========================
+    //		ShmRingReader
+    //===========================
+
+    /**
+     * @brief Construct a new ShmRingReader object.
+     *
+     * @param ringName The name of the ring.
+     * @param fromOldest Whether to start at the oldest record still in the ring instead of the next one written.
+     */
+    ShmRingReader::ShmRingReader(const string& ringName, const bool fromOldest):
+    _header(nullptr), _mappingSize(0), _nextSequence(0), _lostRecords(0) {
+        const auto shmName = ShmRingSink::getShmName(ringName);
+        const auto fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+
+        if (fd < 0) {
+            throw runtime_error(fmt::format("Could not open shared memory {}: {}", shmName, strerror(errno)));
+        }
+
+        if (!waitForRingSize(fd, _mappingSize)) {
+            close(fd);
+            throw runtime_error(fmt::format("{} is not a log ring", shmName));
+        }
+
+        _header = static_cast<const ShmRingHeader*>(mapRing(fd, _mappingSize, PROT_READ, shmName));
+
+        if (!waitForRing(_header) || _header->version != SHM_RING_VERSION ||
+            _mappingSize != getMappingSize(_header->slotCount, _header->slotSize)) {
+            munmap(const_cast<ShmRingHeader*>(_header), _mappingSize);
+            throw runtime_error(fmt::format("{} is not a log ring, or was written by an incompatible version", shmName));
+        }
+
+        const auto next = _header->nextSequence.load(std::memory_order_acquire);
+        _nextSequence = fromOldest && next > _header->slotCount ? next - _header->slotCount : (fromOldest ? 0 : next);
+    }
+
+    ShmRingReader::~ShmRingReader() {
+        munmap(const_cast<ShmRingHeader*>(_header), _mappingSize);
+    }
+
+    /**
+     * @brief Copies the next record out of the ring.
+     *
+     * Records that have been overwritten are skipped and added to getLostRecords(); the sequence numbers of the
+     * records read show where the gaps are.
+     *
+     * @return false If the writers haven't finished the next record yet.
+     */
+    bool ShmRingReader::read(ShmRingRecord& record) {
+        const uint64_t slotCount = _header->slotCount;
+        const auto maxLength = _header->slotSize - sizeof(ShmRingSlot);
+
+        while (true) {
+            const auto next = _header->nextSequence.load(std::memory_order_acquire);
+            if (_nextSequence >= next) return false;
+
+            if (next - _nextSequence > slotCount) {
+                // Lapped: everything older than the ring's worth of records has been overwritten
+                _lostRecords += next - slotCount - _nextSequence;
+                _nextSequence = next - slotCount;
+            }
+
+            const auto slot = getSlot(_header, _nextSequence);
+            const auto stamp = (_nextSequence + 1) << 1;
+            const auto before = slot->sequence.load(std::memory_order_acquire);
+
+            if (before == stamp) {
+                const size_t length = slot->length;
+                record.level = slot->level;
+                record.truncated = (slot->flags & SHM_RING_TRUNCATED) != 0;
+                record.text.assign(reinterpret_cast<const char*>(slot + 1), length > maxLength ? maxLength : length);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                    record.sequence = _nextSequence++;
+                    return true;
+                }
+            } else if ((before >> 1) <= (stamp >> 1)) {
+                // Still being written, or claimed but not started yet
+                return false;
+            }
+
+            // Overwritten by a later record before or while it was copied
+            _lostRecords++;
+            _nextSequence++;
+        }
+    }
+
+}
@@ -0,0 +1,38 @@
+/**
+ * ShmRingLogger.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "ShmRingLogger.hpp"
+
+namespace logpp {
+
+    /**
+     * @brief Construct a new ShmRingLogger object.
+     *
+     * @param logName The name for this logger.
+     * @param maxLogLevel The maximum logging level to log.
+     * @param ringName The name of the ring to publish into; created if it doesn't exist.
+     * @param slotCount The number of records the ring holds; a power of two.
+     * @param slotSize The bytes per record in the ring; longer records are truncated.
+     */
+    ShmRingLogger::ShmRingLogger(const string& logName, const LogLevel maxLogLevel, const string& ringName, const uint32_t slotCount, const uint32_t slotSize):
+    ILogger(logName, maxLogLevel, 0, false), _sink(ringName, slotCount, slotSize) { }
+
+    /**
+     * @brief Publishes a formatted record into the ring. Publishing is lock-free, so the write mutex isn't taken.
+     *
+     * @param level The record's level.
+     * @param msg The formatted record.
+     */
+    void ShmRingLogger::logMessage(const LogLevel level, const string& msg) {
+        if (level > getCurrentMaxLogLevel() || msg.empty()) return;
+
+        _sink.publish(level, msg);
+    }
+
+}
@@ -0,0 +1,325 @@
+/**
+ * StackTraceSymboliser.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "StackTraceSymboliser.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fmt/format.h>
+
+namespace logpp {
+
+    using std::invalid_argument;
+    using std::lock_guard;
+    using std::mutex;
+    using std::unique_lock;
+
+    const uint32_t StackTraceSymboliser::MAX_FRAMES;
+    const uint32_t StackTraceSymboliser::DEFAULT_QUEUE_CAPACITY;
+
+    namespace {
+
+        const char LOGPP_FRAME_PREFIX[] = "logpp::"; ///!< Frames of the logging calls themselves are left out of traces
+
+        /**
+         * @brief Set on the background thread while it logs a trace; the trace's own record mustn't be traced.
+         */
+        thread_local bool isWritingTrace = false;
+
+        void logAtLevel(ILogger* logger, const LogLevel level, const string& message) {
+            switch (level) {
+                case LogLevel::Ok:      logger->ok(message); break;
+                case LogLevel::Info:    logger->info(message); break;
+                case LogLevel::Warning: logger->warning(message); break;
+                case LogLevel::Error:   logger->error(message); break;
+                case LogLevel::Fatal:   logger->fatal(message); break;
+                case LogLevel::Debug:   logger->debug(message); break;
+                case LogLevel::Trace:   logger->trace(message); break;
+            }
+        }
+
+    }
+
+    /**
+     * @brief Resolves a return address to a readable description.
+     *
+     * Exported functions are given as "demangled name+0xoffset (module)"; other addresses as "module+0xoffset",
+     * the offset into the module's mapping, for addr2line.
+     *
+     * @remarks This reads the dynamic symbol tables and demangles; it's too slow for the logging thread.
+     */
+    string StackTraceSymboliser::describeAddress(const void* address) {
+        Dl_info info;
+        if (address == nullptr || dladdr(address, &info) == 0) {
+            return fmt::format("{}", address);
+        }
+
+        const auto module = info.dli_fname != nullptr && info.dli_fname[0] != '\0' ? info.dli_fname : "?";
+        const auto addressValue = reinterpret_cast<uintptr_t>(address);
+
+        if (info.dli_sname == nullptr || info.dli_saddr == nullptr) {
+            return fmt::format("{}+{:#x}", module, addressValue - reinterpret_cast<uintptr_t>(info.dli_fbase));
+        }
+
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        auto description = fmt::format("{}+{:#x} ({})", status == 0 && demangled != nullptr ? demangled : info.dli_sname,
+                                       addressValue - reinterpret_cast<uintptr_t>(info.dli_saddr), module);
+        free(demangled);
+
+        return description;
+    }
+
+    /**
+     * @brief Construct a new StackTraceSymboliser object and start its background thread.
+     *
+     * @param queueCapacity The most traces waiting to be symbolised; the slots are allocated up front.
+     */
+    StackTraceSymboliser::StackTraceSymboliser(const uint32_t queueCapacity):
+    _queue(queueCapacity), _queueHead(0), _queueTail(0), _stopping(false),
+    _nextTraceId(1), _capturedTraces(0), _droppedTraces(0) {
+        if (queueCapacity == 0) {
+            throw invalid_argument("The stack trace queue needs at least one slot!");
+        }
+
+        {
+            // The first backtrace() loads the unwinder, which allocates and takes locks; not on a failing thread, then.
+            void* frames[4];
+            backtrace(frames, 4);
+        }
+
+        _symboliserThread = thread(&StackTraceSymboliser::symboliserLoop, this);
+    }
+
+    /**
+     * @brief Destroy the StackTraceSymboliser object.
+     *
+     * @remarks The loggers stop capturing traces first, and threads in the middle of capturing one are waited for;
+     * the traces already queued are still logged.
+     */
+    StackTraceSymboliser::~StackTraceSymboliser() {
+        {
+            lock_guard<mutex> lock(_loggerMutex);
+            for (auto logger : _loggers) { logger->detachStackTraceSymboliser(); }
+        }
+
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            _stopping = true;
+        }
+
+        _queueCondition.notify_all();
+        if (_symboliserThread.joinable()) { _symboliserThread.join(); }
+
+        lock_guard<mutex> lock(_loggerMutex);
+        _loggers.clear();
+    }
+
+    /**
+     * @brief Adds stack traces to a logger's bad logs and records with exceptions.
+     *
+     * @param logger The logger.
+     *
+     * @return StackTraceSymboliser& A reference to this object.
+     */
+    StackTraceSymboliser& StackTraceSymboliser::registerLogger(ILogger* logger) {
+        if (logger == nullptr) { return *this; }
+
+        lock_guard<mutex> lock(_loggerMutex);
+        if (std::find(_loggers.begin(), _loggers.end(), logger) != _loggers.end()) { return *this; }
+
+        _loggers.push_back(logger);
+        logger->setStackTraceSymboliser(this);
+
+        return *this;
+    }
+
+    /**
+     * @brief Stops tracing a logger's records; the traces queued for it so far are logged first.
+     *
+     * @param logger The logger to remove.
+     *
+     * @return StackTraceSymboliser& A reference to this object.
+     */
+    StackTraceSymboliser& StackTraceSymboliser::unregisterLogger(ILogger* logger) {
+        {
+            lock_guard<mutex> lock(_loggerMutex);
+            if (std::find(_loggers.begin(), _loggers.end(), logger) == _loggers.end()) { return *this; }
+
+            logger->detachStackTraceSymboliser();
+        }
+
+        flush();
+
+        lock_guard<mutex> lock(_loggerMutex);
+        _loggers.erase(std::remove(_loggers.begin(), _loggers.end(), logger), _loggers.end());
+
+        return *this;
+    }
+
+    /**
+     * @brief Captures the calling thread's return addresses into a preallocated slot.
+     *
+     * This is all the failing thread pays for: an unwind of its stack and a short critical section; nothing is resolved
+     * and nothing is allocated. The trace is logged once release() is called for it.
+     *
+     * @return uint64_t The trace's id, or 0 if the queue is full (or the symboliser is stopping).
+     */
+    uint64_t StackTraceSymboliser::capture(ILogger* logger, const LogLevel level) {
+        if (isWritingTrace) { return 0; }
+
+        // One more, since this function's own frame is left out
+        void* frames[MAX_FRAMES + 1];
+        const auto depth = backtrace(frames, MAX_FRAMES + 1);
+
+        unique_lock<mutex> lock(_queueMutex);
+        if (_stopping || _queueTail - _queueHead == _queue.size()) {
+            lock.unlock();
+            _droppedTraces.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+
+        const auto traceId = _nextTraceId.fetch_add(1, std::memory_order_relaxed);
+        auto& trace = _queue[_queueTail % _queue.size()];
+        trace.logger = logger;
+        trace.level = level;
+        trace.id = traceId;
+        trace.depth = depth > 1 ? static_cast<uint32_t>(depth - 1) : 0;
+        trace.released = false;
+        std::memcpy(trace.frames, frames + 1, trace.depth * sizeof(void*));
+        _queueTail++;
+
+        lock.unlock();
+        _capturedTraces.fetch_add(1, std::memory_order_relaxed);
+
+        return traceId;
+    }
+
+    /**
+     * @brief Marks a captured trace as ready to be logged.
+     */
+    void StackTraceSymboliser::release(const uint64_t traceId) {
+        {
+            lock_guard<mutex> lock(_queueMutex);
+            for (auto position = _queueHead; position != _queueTail; position++) {
+                auto& trace = _queue[position % _queue.size()];
+                if (trace.id == traceId) {
+                    trace.released = true;
+                    break;
+                }
+            }
+        }
+
+        _queueCondition.notify_one();
+    }
+
+    /**
+     * @brief Waits until the traces queued so far have been logged.
+     *
+     * @remarks Traces are logged in order, so this also waits for traces whose records are still being logged.
+     */
+    void StackTraceSymboliser::flush() {
+        unique_lock<mutex> lock(_queueMutex);
+        const auto target = _queueTail;
+
+        _idleCondition.wait(lock, [this, target]() { return _queueHead >= target; });
+    }
+
+    /**
+     * @brief Gets the amount of distinct return addresses resolved so far.
+     */
+    size_t StackTraceSymboliser::getCachedAddresses() const {
+        lock_guard<mutex> lock(_cacheMutex);
+        return _addressCache.size();
+    }
+
+    // PRIVATE IMPLEMENTATION
+
+    /**
+     * @brief Logs released traces in the order they were captured, until the symboliser is stopped and the queue is empty.
+     */
+    void StackTraceSymboliser::symboliserLoop() {
+        unique_lock<mutex> lock(_queueMutex);
+
+        while (true) {
+            _queueCondition.wait(lock, [this]() {
+                return (_queueHead != _queueTail && _queue[_queueHead % _queue.size()].released) || (_stopping && _queueHead == _queueTail);
+            });
+
+            if (_queueHead == _queueTail) { break; }
+
+            // The slot isn't reused before the head moves on, but copy it anyway: capture() writes other slots meanwhile
+            const auto trace = _queue[_queueHead % _queue.size()];
+            lock.unlock();
+
+            // An exception escaping the thread would terminate the application; the trace is counted as dropped instead
+            try {
+                writeTrace(trace);
+            } catch (...) {
+                _droppedTraces.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            lock.lock();
+            _queueHead++;
+            _idleCondition.notify_all();
+        }
+    }
+
+    /**
+     * @brief Symbolises a trace and logs it to its logger, if that's still registered.
+     */
+    void StackTraceSymboliser::writeTrace(const PendingTrace& trace) {
+        isWritingTrace = true;
+        struct WritingTraceGuard {
+            ~WritingTraceGuard() { isWritingTrace = false; }
+        } writingTraceGuard;
+
+        lock_guard<mutex> lock(_loggerMutex);
+        if (std::find(_loggers.begin(), _loggers.end(), trace.logger) != _loggers.end()) {
+            // Leave out the logging calls on top of the stack; the first frame is their caller
+            uint32_t first = 0;
+            while (first < trace.depth && resolveAddress(trace.frames[first]).compare(0, sizeof(LOGPP_FRAME_PREFIX) - 1, LOGPP_FRAME_PREFIX) == 0) { first++; }
+            if (first == trace.depth) { first = 0; }
+
+            auto message = fmt::format("Stack trace {}:", trace.id);
+            for (auto frame = first; frame < trace.depth; frame++) {
+                fmt::format_to(std::back_inserter(message), "\n#{} {} {}", frame - first, trace.frames[frame], resolveAddress(trace.frames[frame]));
+            }
+
+            logAtLevel(trace.logger, trace.level, message);
+        }
+    }
+
+    /**
+     * @brief Gets the description of a return address, resolving it on its first use.
+     */
+    const string& StackTraceSymboliser::resolveAddress(void* address) {
+        {
+            lock_guard<mutex> lock(_cacheMutex);
+            const auto cached = _addressCache.find(address);
+            if (cached != _addressCache.end()) { return cached->second; }
+        }
+
+        auto description = describeAddress(address);
+
+        // Only this thread adds entries, and references to them stay valid
+        lock_guard<mutex> lock(_cacheMutex);
+        return _addressCache.emplace(address, std::move(description)).first->second;
+    }
+
+}
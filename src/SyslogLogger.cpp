@@ -0,0 +1,75 @@
+/**
+ * SyslogLogger.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "SyslogLogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <climits>
+
+#include <unistd.h>
+
+namespace logpp {
+
+    /**
+     * @brief Construct a new SyslogLogger object.
+     *
+     * @param logName The name for this logger.
+     * @param maxLogLevel The maximum logging level to log.
+     * @param appName The APP-NAME to send; the logger's name if empty.
+     * @param facility The facility, as in syslog.h (LOG_USER, LOG_DAEMON, LOG_LOCAL0...).
+     * @param socketPath The path of the syslog daemon's socket.
+     */
+    SyslogLogger::SyslogLogger(const string& logName, const LogLevel maxLogLevel, const string& appName, const int facility, const string& socketPath):
+    ILogger(logName, maxLogLevel, 0, false), _sink(socketPath), _appName(appName.empty() ? logName : appName), _facility(facility),
+    _processId(static_cast<uint32_t>(getpid())) {
+        char hostName[HOST_NAME_MAX + 1] = { 0 };
+        if (gethostname(hostName, sizeof(hostName) - 1) == 0) { _hostName = hostName; }
+
+        setCurrentLoggerFormat("${lmsg}");
+    }
+
+    /**
+     * @brief Sends a record which was formatted elsewhere (e.g. by an AsyncLogger) as the MSG of a syslog message.
+     *
+     * @param level The level of the record.
+     * @param msg The formatted record.
+     */
+    void SyslogLogger::logMessage(const LogLevel level, const string& msg) {
+        if (level > getCurrentMaxLogLevel() || msg.empty()) return;
+
+        static thread_local string entry;
+        entry.clear();
+
+        auto length = msg.size();
+        while (length > 0 && (msg[length - 1] == '\n' || msg[length - 1] == '\r')) { length--; }
+
+        SyslogSink::formatEntry(entry, _facility, level, getClock()->now().realtimeNanoseconds, _hostName, _appName, _processId,
+                                string_view(msg.data(), length), nullptr, 0, string_view(), -1, nullptr);
+        _sink.send(entry);
+    }
+
+    /**
+     * @brief Formats the message with the logger format and sends it with the rest of the record as structured data.
+     */
+    void SyslogLogger::logRecord(const LogLevel level, string_view msg, const exception* except, const int32_t line, string_view func,
+                                 const LogField* fields, const size_t fieldCount) {
+        static thread_local string message;
+        static thread_local string entry;
+        message.clear();
+        entry.clear();
+
+        formatLogMessageTo(message, msg, level, func, line, except);
+        SyslogSink::formatEntry(entry, _facility, level, getClock()->now().realtimeNanoseconds, _hostName, _appName, _processId,
+                                message, fields, fieldCount, func, line, except);
+        _sink.send(entry);
+    }
+
+}
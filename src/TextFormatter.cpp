@@ -0,0 +1,151 @@
+/**
+ * TextFormatter.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "TextFormatter.hpp"
+#include "JsonLineFormatter.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <ctime>
+#include <iterator>
+
+#include <fmt/format.h>
+
+namespace logpp {
+
+    namespace {
+
+        /**
+         * @brief The local time of the second a thread last formatted.
+         */
+        struct LocalTimeCache {
+            time_t      second = -1;
+            struct tm   localTime; ///!< localtime_r() takes a lock in glibc; only call it once per second
+        };
+
+        /**
+         * @brief Gets the local time for a second from the per-thread cache.
+         *
+         * @param second The second since the Unix epoch.
+         */
+        const struct tm& getCachedLocalTime(const time_t second) {
+            static thread_local LocalTimeCache cache;
+
+            if (second != cache.second) {
+                localtime_r(&second, &cache.localTime);
+                cache.second = second;
+            }
+
+            return cache.localTime;
+        }
+
+    }
+
+    /**
+     * @brief Construct a new TextFormatter object.
+     *
+     * Dates are formatted as %Y.%m.%d and times as %H:%M:%S; records are timestamped by the default clock.
+     *
+     * @param format The logger format string.
+     */
+    TextFormatter::TextFormatter(const string& format): _format(format), _dateFormat("%Y.%m.%d"), _timeFormat("%H:%M:%S"),
+    _clock(getDefaultLogClock()), _sanitiseMode(SanitiseMode::Escape) {
+        _dateTimeFormat = _dateFormat + " " + _timeFormat;
+    }
+
+    /**
+     * @brief Appends the decimal representation of an integer.
+     */
+    void TextFormatter::appendInteger(string& out, int64_t value) {
+        char digits[24];
+        char* cursor = digits + sizeof(digits);
+        const bool isNegative = value < 0;
+        uint64_t magnitude = isNegative ? 0 - (uint64_t)value : (uint64_t)value;
+
+        do {
+            *--cursor = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (isNegative) { *--cursor = '-'; }
+
+        out.append(cursor, digits + sizeof(digits) - cursor);
+    }
+
+    /**
+     * @brief Appends structured fields as " key=value" pairs. String values are quoted (and escaped like JSON strings) if they are empty
+     * or contain spaces, quotes, '=', backslashes or control characters, so a value can't pass for another field or break the line.
+     */
+    void TextFormatter::appendFields(string& out, const LogField* fields, const size_t fieldCount) {
+        for (size_t i = 0; i < fieldCount; i++) {
+            const auto& field = fields[i];
+
+            out += ' ';
+            out.append(field.key.data(), field.key.size());
+            out += '=';
+
+            switch (field.type) {
+                case LogField::Type::Int:       appendInteger(out, field.intValue); break;
+                case LogField::Type::UInt:      fmt::format_to(std::back_inserter(out), "{}", field.uintValue); break;
+                case LogField::Type::Double:    fmt::format_to(std::back_inserter(out), "{}", field.doubleValue); break;
+                case LogField::Type::Bool:      out.append(field.boolValue ? "true" : "false"); break;
+                case LogField::Type::String: {
+                    const auto& value = field.stringValue;
+                    bool needsQuotes = value.size() == 0;
+                    for (size_t c = 0; c < value.size() && !needsQuotes; c++) {
+                        const auto character = static_cast<unsigned char>(value.data()[c]);
+                        needsQuotes = character <= ' ' || character == '"' || character == '=' || character == '\\';
+                    }
+
+                    if (needsQuotes) {
+                        out += '"';
+                        JsonLineFormatter::appendEscaped(out, value);
+                        out += '"';
+                    } else {
+                        out.append(value.data(), value.size());
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Sets the strftime format used for ${date}; ${datetime} follows.
+     */
+    void TextFormatter::setDateFormat(const string& dateFormat) {
+        _dateFormat = dateFormat;
+        _dateTimeFormat = _dateFormat + " " + _timeFormat;
+    }
+
+    /**
+     * @brief Sets the strftime format used for ${time}; ${datetime} follows.
+     */
+    void TextFormatter::setTimeFormat(const string& timeFormat) {
+        _timeFormat = timeFormat;
+        _dateTimeFormat = _dateFormat + " " + _timeFormat;
+    }
+
+    /**
+     * @brief Appends a timestamp's local time to out, using a strftime format.
+     *
+     * @param out The string to append to.
+     * @param format The strftime format.
+     * @param timestamp The record's timestamp.
+     */
+    void TextFormatter::appendLocalTime(string& out, const string& format, const LogTimestamp& timestamp) const {
+        char charBuffer[128];
+        const auto second = static_cast<time_t>(timestamp.realtimeNanoseconds / 1000000000);
+        const auto length = strftime(charBuffer, sizeof(charBuffer), format.c_str(), &getCachedLocalTime(second));
+
+        out.append(charBuffer, length);
+    }
+
+}
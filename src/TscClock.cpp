@@ -0,0 +1,70 @@
+/**
+ * TscClock.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "TscClock.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+namespace logpp {
+
+    namespace {
+        const auto CALIBRATION_TIME = std::chrono::milliseconds(10);
+
+        /**
+         * @brief Checks CPUID for an invariant TSC (leaf 0x80000007, EDX bit 8).
+         */
+        bool hasInvariantTsc() {
+            #if defined(__x86_64__) || defined(__i386__)
+                uint32_t eax, ebx, ecx, edx;
+                if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) { return false; }
+                if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) { return false; }
+
+                return (edx & (1u << 8)) != 0;
+            #else
+                return false;
+            #endif
+        }
+    }
+
+    /**
+     * @brief Measures the TSC against steady_clock over CALIBRATION_TIME.
+     *
+     * @remarks Runs once, on the first use of the clock; that call blocks for the calibration time.
+     */
+    TscClock::Calibration TscClock::calibrate() {
+        Calibration calibration { false, 1.0, 0, 0 };
+
+        #if defined(__x86_64__) || defined(__i386__)
+            if (hasInvariantTsc()) {
+                const auto startNanoseconds = getSteadyNanoseconds();
+                const auto startTicks = __rdtsc();
+                std::this_thread::sleep_for(CALIBRATION_TIME);
+                const auto endNanoseconds = getSteadyNanoseconds();
+                const auto endTicks = __rdtsc();
+
+                if (endTicks > startTicks && endNanoseconds > startNanoseconds) {
+                    calibration.usesTsc = true;
+                    calibration.ticksPerNanosecond = static_cast<double>(endTicks - startTicks) / (endNanoseconds - startNanoseconds);
+                    calibration.baseTicks = endTicks;
+                    calibration.baseNanoseconds = endNanoseconds;
+                }
+            }
+        #endif
+
+        return calibration;
+    }
+
+}
@@ -0,0 +1,564 @@
+/**
+ * UnixDatagramSink.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "UnixDatagramSink.hpp"
+#include "LogExtensions.hpp"
+#include "TextFormatter.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace logpp {
+
+    const size_t UnixDatagramSink::DEFAULT_MAX_PENDING_BYTES;
+    const uint32_t UnixDatagramSink::MAX_BATCH_SIZE;
+    const uint32_t UnixDatagramSink::CLOSE_DRAIN_TIMEOUT_MS;
+
+    const char* const JournalSink::DEFAULT_SOCKET_PATH = "/run/systemd/journal/socket";
+
+    const char* const SyslogSink::DEFAULT_SOCKET_PATH = "/dev/log";
+    const char* const SyslogSink::STRUCTURED_DATA_ID = "logpp@32473";
+    const size_t SyslogSink::MAX_TRUNCATED_SIZE;
+
+    namespace {
+
+        const auto RECONNECT_INTERVAL = std::chrono::seconds(1);
+        const auto FLUSH_RETRY_INTERVAL = std::chrono::milliseconds(1); ///!< How long send() leaves a full socket alone unless a batch piles up
+
+        /**
+         * @brief Appends a structured field's value as text; strings are appended as they are.
+         */
+        void appendFieldValue(string& out, const LogField& field) {
+            switch (field.type) {
+                case LogField::Type::Int:       TextFormatter::appendInteger(out, field.intValue); break;
+                case LogField::Type::UInt:      fmt::format_to(std::back_inserter(out), "{}", field.uintValue); break;
+                case LogField::Type::Double:    fmt::format_to(std::back_inserter(out), "{}", field.doubleValue); break;
+                case LogField::Type::Bool:      out.append(field.boolValue ? "true" : "false"); break;
+                case LogField::Type::String:    out.append(field.stringValue.data(), field.stringValue.size()); break;
+            }
+        }
+
+        /**
+         * @brief Appends a value of an RFC 5424 SD-PARAM; '"', '\' and ']' are escaped.
+         */
+        void appendParamValue(string& out, string_view value) {
+            for (size_t i = 0; i < value.size(); i++) {
+                const auto c = value.data()[i];
+                if (c == '"' || c == '\\' || c == ']') { out += '\\'; }
+                out += c;
+            }
+        }
+
+        /**
+         * @brief Appends an RFC 5424 SD-NAME or APP-NAME: printable US-ASCII without '=', ']' and '"', cut to maxLength characters.
+         */
+        void appendParamName(string& out, string_view key, const size_t maxLength = 32) {
+            const auto length = key.size() < maxLength ? key.size() : maxLength;
+
+            for (size_t i = 0; i < length; i++) {
+                const auto c = key.data()[i];
+                out += (c > ' ' && c < 127 && c != '=' && c != ']' && c != '"') ? c : '_';
+            }
+
+            if (length == 0) { out += '_'; }
+        }
+
+        /**
+         * @brief Appends the UTC time of a timestamp as an RFC 5424 TIMESTAMP with microseconds.
+         */
+        void appendUtcTimestamp(string& out, const int64_t realtimeNanoseconds) {
+            struct UtcTimeCache {
+                time_t  second = -1;
+                char    text[20]; ///!< YYYY-MM-DDTHH:MM:SS
+            };
+            static thread_local UtcTimeCache cache;
+
+            const auto second = static_cast<time_t>(realtimeNanoseconds / 1000000000);
+            if (second != cache.second) {
+                struct tm utc;
+                gmtime_r(&second, &utc);
+                strftime(cache.text, sizeof(cache.text), "%Y-%m-%dT%H:%M:%S", &utc);
+                cache.second = second;
+            }
+
+            out.append(cache.text, 19);
+            fmt::format_to(std::back_inserter(out), ".{:06}Z", (realtimeNanoseconds / 1000) % 1000000);
+        }
+
+    }
+
+    /**
+     * @brief Maps a log level to a syslog severity.
+     *
+     * Ok is a notice (5), debug and trace records are both LOG_DEBUG (7).
+     */
+    int getSyslogSeverity(const LogLevel level) {
+        switch (level) {
+            case LogLevel::Fatal:   return 2; // LOG_CRIT
+            case LogLevel::Error:   return 3; // LOG_ERR
+            case LogLevel::Warning: return 4; // LOG_WARNING
+            case LogLevel::Ok:      return 5; // LOG_NOTICE
+            case LogLevel::Info:    return 6; // LOG_INFO
+            default:                return 7; // LOG_DEBUG
+        }
+    }
+
+    //===========================
+    //		UnixDatagramSink
+    //===========================
+
+    /**
+     * @brief Construct a new UnixDatagramSink object.
+     *
+     * @param socketPath The path of the receiver's socket.
+     * @param maxPendingBytes The most bytes kept while the socket is full; records beyond that are dropped.
+     */
+    UnixDatagramSink::UnixDatagramSink(const string& socketPath, const size_t maxPendingBytes):
+    _socketPath(socketPath), _socketFd(-1), _pendingBytes(0), _maxPendingBytes(maxPendingBytes), _queuedSinceFlush(0), _batchedDatagrams(0), _droppedDatagrams(0) { }
+
+    UnixDatagramSink::~UnixDatagramSink() {
+        drain(std::chrono::milliseconds(CLOSE_DRAIN_TIMEOUT_MS));
+
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        _droppedDatagrams.fetch_add(_pending.size(), std::memory_order_relaxed);
+        closeLocked();
+    }
+
+    /**
+     * @brief Sends a datagram without blocking.
+     *
+     * If datagrams are already waiting, or the socket's queue is full, the datagram waits with them and the
+     * whole backlog is sent in batches as the socket drains: by later calls, or by flush().
+     */
+    void UnixDatagramSink::send(string_view datagram) {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+
+        if (_pending.empty() && sendDirectLocked(datagram)) return;
+
+        if (_pendingBytes + datagram.size() > _maxPendingBytes) {
+            _droppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            _pending.emplace_back(datagram.data(), datagram.size());
+            _pendingBytes += datagram.size();
+        }
+
+        // The socket was full a moment ago; retrying with every record would cost a failing system call each
+        if (++_queuedSinceFlush >= MAX_BATCH_SIZE || std::chrono::steady_clock::now() >= _nextFlushAttempt) {
+            flushLocked();
+        }
+    }
+
+    /**
+     * @brief Sends as many pending datagrams as the socket takes right now.
+     */
+    void UnixDatagramSink::flush() {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        flushLocked();
+    }
+
+    /**
+     * @brief Sends the pending datagrams, waiting for the socket to drain if necessary.
+     *
+     * @param timeout The most time to wait.
+     *
+     * @return true If nothing is pending any more.
+     */
+    bool UnixDatagramSink::drain(const std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (true) {
+            int socketFd = -1;
+            {
+                std::lock_guard<std::mutex> lock(_sinkMutex);
+                flushLocked();
+
+                if (_pending.empty()) return true;
+                socketFd = _socketFd;
+            }
+
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) return false;
+
+            if (socketFd < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            struct pollfd writable = { socketFd, POLLOUT, 0 };
+            poll(&writable, 1, static_cast<int>(remaining.count()));
+        }
+    }
+
+    /**
+     * @brief Gets the amount of datagrams waiting for the socket to drain.
+     */
+    size_t UnixDatagramSink::getPendingDatagrams() const {
+        std::lock_guard<std::mutex> lock(_sinkMutex);
+        return _pending.size();
+    }
+
+    /**
+     * @brief Drops datagrams the socket refused as too large.
+     */
+    bool UnixDatagramSink::sendOversized(const int, string_view) { return false; }
+
+    /**
+     * @brief Connects the socket, unless that failed less than a second ago.
+     */
+    bool UnixDatagramSink::connectLocked() {
+        if (_socketFd >= 0) return true;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now < _nextConnectAttempt) return false;
+        _nextConnectAttempt = now + RECONNECT_INTERVAL;
+
+        struct sockaddr_un address;
+        if (_socketPath.size() >= sizeof(address.sun_path)) return false;
+
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, _socketPath.c_str(), _socketPath.size());
+
+        _socketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (_socketFd < 0) return false;
+
+        if (connect(_socketFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+            closeLocked();
+            return false;
+        }
+
+        return true;
+    }
+
+    void UnixDatagramSink::closeLocked() {
+        if (_socketFd >= 0) {
+            close(_socketFd);
+            _socketFd = -1;
+        }
+    }
+
+    /**
+     * @brief Sends a single datagram.
+     *
+     * @return false If the socket is full and the datagram has to wait; datagrams which can't be sent at all are dropped.
+     */
+    bool UnixDatagramSink::sendDirectLocked(string_view datagram) {
+        if (!connectLocked()) {
+            _droppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (::send(_socketFd, datagram.data(), datagram.size(), MSG_DONTWAIT | MSG_NOSIGNAL) >= 0) return true;
+
+        switch (errno) {
+            case EAGAIN:
+            case ENOBUFS:
+                return false;
+            case EMSGSIZE:
+                if (!sendOversized(_socketFd, datagram)) { _droppedDatagrams.fetch_add(1, std::memory_order_relaxed); }
+                return true;
+            default:
+                // The receiver went away (e.g. it was restarted); reconnect with the next record
+                closeLocked();
+                _nextConnectAttempt = std::chrono::steady_clock::time_point();
+                _droppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+                return true;
+        }
+    }
+
+    /**
+     * @brief Sends pending datagrams, up to MAX_BATCH_SIZE per sendmmsg(), until the socket is full.
+     */
+    void UnixDatagramSink::flushLocked() {
+        struct mmsghdr messages[MAX_BATCH_SIZE];
+        struct iovec vectors[MAX_BATCH_SIZE];
+
+        _queuedSinceFlush = 0;
+        _nextFlushAttempt = std::chrono::steady_clock::now() + FLUSH_RETRY_INTERVAL;
+
+        while (!_pending.empty()) {
+            if (!connectLocked()) return;
+
+            const auto batchSize = _pending.size() < MAX_BATCH_SIZE ? static_cast<uint32_t>(_pending.size()) : MAX_BATCH_SIZE;
+            std::memset(messages, 0, sizeof(messages[0]) * batchSize);
+
+            for (uint32_t i = 0; i < batchSize; i++) {
+                vectors[i].iov_base = const_cast<char*>(_pending[i].data());
+                vectors[i].iov_len = _pending[i].size();
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            const auto sent = sendmmsg(_socketFd, messages, batchSize, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent > 0) {
+                _batchedDatagrams.fetch_add(sent, std::memory_order_relaxed);
+                for (int i = 0; i < sent; i++) {
+                    _pendingBytes -= _pending.front().size();
+                    _pending.pop_front();
+                }
+                continue;
+            }
+
+            const auto error = errno;
+            if (error == EAGAIN || error == ENOBUFS) return;
+
+            // The first datagram can't be sent; the batch's rest may well be
+            if (error == EMSGSIZE && sendOversized(_socketFd, _pending.front())) {
+                _batchedDatagrams.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                _droppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+                if (error != EMSGSIZE) { closeLocked(); }
+            }
+
+            _pendingBytes -= _pending.front().size();
+            _pending.pop_front();
+        }
+    }
+
+    //===========================
+    //		JournalSink
+    //===========================
+
+    /**
+     * @brief Appends a field as NAME=value, or in the length-prefixed binary form if the value contains line feeds.
+     */
+    void JournalSink::appendField(string& out, string_view name, string_view value) {
+        out.append(name.data(), name.size());
+
+        if (std::memchr(value.data(), '\n', value.size()) == nullptr) {
+            out += '=';
+            out.append(value.data(), value.size());
+            out += '\n';
+            return;
+        }
+
+        out += '\n';
+        uint64_t length = value.size();
+        for (int i = 0; i < 8; i++) {
+            out += static_cast<char>(length & 0xff); // little endian
+            length >>= 8;
+        }
+        out.append(value.data(), value.size());
+        out += '\n';
+    }
+
+    /**
+     * @brief Appends a structured field's key as a journal field name: upper case letters, digits and underscores,
+     *        at most 64 characters and not starting with an underscore or a digit.
+     */
+    void JournalSink::appendFieldName(string& out, string_view key) {
+        const auto start = out.size();
+
+        for (size_t i = 0; i < key.size() && out.size() - start < 64; i++) {
+            const auto c = key.data()[i];
+
+            if (c >= 'a' && c <= 'z') {
+                out += static_cast<char>(c - 'a' + 'A');
+            } else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                out += c;
+            } else if (out.size() != start) {
+                out += '_';
+            }
+        }
+
+        if (out.size() == start || (out[start] >= '0' && out[start] <= '9')) {
+            out.insert(start, "F_");
+        }
+    }
+
+    /**
+     * @brief Appends a journal entry in the native protocol.
+     *
+     * Besides MESSAGE, PRIORITY and SYSLOG_IDENTIFIER, the entry has CODE_FUNC and CODE_LINE (if known), TID,
+     * LOGPP_LOGGER, LOGPP_EXCEPTION (if any) and a field per structured field.
+     */
+    void JournalSink::formatEntry(string& out, const LogLevel level, string_view identifier, string_view loggerName, string_view message,
+                                  const LogField* fields, const size_t fieldCount, string_view func, const int32_t line, const exception* except) {
+        out += "PRIORITY=";
+        out += static_cast<char>('0' + getSyslogSeverity(level));
+        out += '\n';
+
+        appendField(out, "SYSLOG_IDENTIFIER", identifier);
+        appendField(out, "MESSAGE", message);
+
+        if (func.size() != 0) { appendField(out, "CODE_FUNC", func); }
+        if (line >= 0) {
+            out += "CODE_LINE=";
+            TextFormatter::appendInteger(out, line);
+            out += '\n';
+        }
+
+        out += "TID=";
+        TextFormatter::appendInteger(out, getCurrentThreadId());
+        out += '\n';
+
+        appendField(out, "LOGPP_LOGGER", loggerName);
+        if (except != nullptr) { appendField(out, "LOGPP_EXCEPTION", except->what()); }
+
+        static thread_local string value;
+        static thread_local string name;
+        for (size_t i = 0; i < fieldCount; i++) {
+            value.clear();
+            name.clear();
+            appendFieldValue(value, fields[i]);
+            appendFieldName(name, fields[i].key);
+            appendField(out, name, value);
+        }
+    }
+
+    /**
+     * @brief Writes the entry to a sealed memfd and passes its descriptor to journald, as sd_journal_send() does.
+     */
+    bool JournalSink::sendOversized(const int socketFd, string_view datagram) {
+        #ifdef MFD_ALLOW_SEALING
+        const auto memFd = memfd_create("logpp-journal", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (memFd < 0) return false;
+
+        size_t written = 0;
+        while (written < datagram.size()) {
+            const auto result = write(memFd, datagram.data() + written, datagram.size() - written);
+            if (result <= 0) {
+                close(memFd);
+                return false;
+            }
+            written += result;
+        }
+
+        // journald only accepts sealed memfds, so the contents can't change under it
+        if (fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+            close(memFd);
+            return false;
+        }
+
+        union {
+            struct cmsghdr  header;
+            char            buffer[CMSG_SPACE(sizeof(int))];
+        } control;
+        std::memset(&control, 0, sizeof(control));
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        auto controlHeader = CMSG_FIRSTHDR(&message);
+        controlHeader->cmsg_level = SOL_SOCKET;
+        controlHeader->cmsg_type = SCM_RIGHTS;
+        controlHeader->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(controlHeader), &memFd, sizeof(int));
+
+        const auto sent = sendmsg(socketFd, &message, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0;
+        close(memFd);
+        return sent;
+        #else
+        (void)socketFd;
+        (void)datagram;
+        return false;
+        #endif
+    }
+
+    //===========================
+    //		SyslogSink
+    //===========================
+
+    /**
+     * @brief Appends an RFC 5424 message: <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID - [logpp@32473 ...] MSG
+     *
+     * The structured-data element holds func, line, exception and the structured fields; it's "-" if there are none.
+     *
+     * @param facility The facility, as in syslog.h (e.g. LOG_USER, LOG_LOCAL0).
+     */
+    void SyslogSink::formatEntry(string& out, const int facility, const LogLevel level, const int64_t realtimeNanoseconds, string_view hostName,
+                                 string_view appName, const uint32_t processId, string_view message, const LogField* fields, const size_t fieldCount,
+                                 string_view func, const int32_t line, const exception* except) {
+        out += '<';
+        TextFormatter::appendInteger(out, (facility & ~7) | getSyslogSeverity(level));
+        out += ">1 ";
+        appendUtcTimestamp(out, realtimeNanoseconds);
+        out += ' ';
+        if (hostName.size() == 0) {
+            out += '-';
+        } else {
+            out.append(hostName.data(), hostName.size());
+        }
+        out += ' ';
+        appendParamName(out, appName, 48);
+        out += ' ';
+        TextFormatter::appendInteger(out, processId);
+        out += " - ";
+
+        if (func.size() == 0 && line < 0 && except == nullptr && fieldCount == 0) {
+            out += '-';
+        } else {
+            out += '[';
+            out += STRUCTURED_DATA_ID;
+
+            if (func.size() != 0) {
+                out += " func=\"";
+                appendParamValue(out, func);
+                out += '"';
+            }
+
+            if (line >= 0) {
+                out += " line=\"";
+                TextFormatter::appendInteger(out, line);
+                out += '"';
+            }
+
+            if (except != nullptr) {
+                out += " exception=\"";
+                appendParamValue(out, except->what());
+                out += '"';
+            }
+
+            static thread_local string value;
+            for (size_t i = 0; i < fieldCount; i++) {
+                value.clear();
+                appendFieldValue(value, fields[i]);
+
+                out += ' ';
+                appendParamName(out, fields[i].key);
+                out += "=\"";
+                appendParamValue(out, value);
+                out += '"';
+            }
+
+            out += ']';
+        }
+
+        if (message.size() != 0) {
+            out += ' ';
+            out.append(message.data(), message.size());
+        }
+    }
+
+    /**
+     * @brief Sends the first MAX_TRUNCATED_SIZE bytes of the message.
+     */
+    bool SyslogSink::sendOversized(const int socketFd, string_view datagram) {
+        const auto length = datagram.size() < MAX_TRUNCATED_SIZE ? datagram.size() : MAX_TRUNCATED_SIZE;
+        return ::send(socketFd, datagram.data(), length, MSG_DONTWAIT | MSG_NOSIGNAL) >= 0;
+    }
+
+}
@@ -0,0 +1,357 @@
+/**
+ * HeapProfiler.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include "memory_allocation/HeapProfiler.hpp"
+#include "memory_allocation/LeakDetection.hpp"
+#include "ILogger.hpp"
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <execinfo.h>
+#include <fmt/format.h>
+
+namespace logpp { namespace memory {
+
+    using std::lock_guard;
+    using std::mutex;
+    using std::unique_lock;
+
+    const uint64_t HeapProfiler::DEFAULT_SAMPLE_INTERVAL = 512 * 1024;
+    const uint32_t HeapProfiler::MAX_STACK_DEPTH;
+    const uint32_t HeapProfiler::SAMPLE_FILTER_SIZE;
+    const uint32_t HeapProfiler::MAX_SITES = 4096;
+    const uint32_t HeapProfiler::MAX_REPORTED_SITES = 20;
+
+    atomic<bool> HeapProfiler::_active(false);
+    atomic<bool> HeapProfiler::_started(false);
+
+    namespace {
+        const uint32_t  SAMPLE_TABLE_CAPACITY = 1u << 16; //!< Live samples; covers ~32 GiB of live heap at the default interval
+        const uint32_t  MAX_HOOK_FRAMES = 4; //!< Frames of the profiler and allocation hooks on top of the allocating code
+        const uint64_t  SITE_FREE = 0;
+        const uint64_t  SITE_RESERVED = 1;
+
+        const char* const BYTE_UNITS[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+
+        string formatBytes(double bytes) {
+            uint32_t unit = 0;
+            while (bytes >= 1024 && unit + 1 < sizeof(BYTE_UNITS) / sizeof(BYTE_UNITS[0])) { bytes /= 1024; unit++; }
+
+            return fmt::format("{:.1f} {}", bytes, BYTE_UNITS[unit]);
+        }
+
+        /**
+         * @brief A per-thread xorshift64* generator; seeded from the thread's stack address so threads don't sample in lockstep.
+         */
+        uint64_t getNextRandom() {
+            static thread_local uint64_t state = 0;
+            if (state == 0) { state = reinterpret_cast<uintptr_t>(&state) * 0x9e3779b97f4a7c15ull | 1; }
+
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545f4914f6cdd1dull;
+        }
+    }
+
+    /**
+     * @brief Gets the process-wide profiler.
+     *
+     * @remarks Like the AllocationTracker, the profiler lives in static storage and is never destroyed.
+     */
+    HeapProfiler& HeapProfiler::getInstance() {
+        alignas(HeapProfiler) static char storage[sizeof(HeapProfiler)];
+        static HeapProfiler* instance = [] {
+            AllocationHookGuard guard;
+            return new (storage) HeapProfiler();
+        }();
+
+        return *instance;
+    }
+
+    /**
+     * @brief Construct a new HeapProfiler object.
+     */
+    HeapProfiler::HeapProfiler(): _samples(SAMPLE_TABLE_CAPACITY), _sampleInterval(DEFAULT_SAMPLE_INTERVAL), _droppedSamples(0),
+    _reportLogger(nullptr), _reportInterval(60), _previousAllocatedBytes(MAX_SITES, 0), _previousReportTime(std::chrono::steady_clock::now()) {
+        // Not operator new; sites are added from within operator new.
+        _sites = static_cast<Site*>(calloc(MAX_SITES, sizeof(Site)));
+
+        for (auto& liveSamples : _sampleFilter) { liveSamples.store(0, std::memory_order_relaxed); }
+    }
+
+    /**
+     * @brief Starts sampling allocations and periodically logging a summary.
+     *
+     * @param logger The logger to write the summaries to; typically a FileLogger. Must outlive the profiler's use, or stop() be called first.
+     * @param sampleInterval The average amount of bytes allocated between two samples.
+     * @param reportInterval The time between two summaries.
+     */
+    void HeapProfiler::start(ILogger& logger, const uint64_t sampleInterval, const std::chrono::seconds reportInterval) {
+        AllocationHookGuard guard;
+        stop();
+
+        {
+            // The first backtrace() loads the unwinder, which allocates; do that here rather than inside operator new.
+            void* frames[4];
+            backtrace(frames, 4);
+        }
+
+        {
+            lock_guard<mutex> lock(_reportMutex);
+            _reportLogger = &logger;
+            _reportInterval = reportInterval;
+            _previousReportTime = std::chrono::steady_clock::now();
+        }
+
+        _sampleInterval.store(sampleInterval == 0 ? 1 : sampleInterval, std::memory_order_relaxed);
+        _started.store(true);
+        _active.store(true);
+
+        _reportThread = std::thread(&HeapProfiler::reportLoop, this);
+    }
+
+    /**
+     * @brief Stops sampling and the periodic summaries.
+     *
+     * @remarks Samples which are still alive are kept; frees continue to be accounted for.
+     */
+    void HeapProfiler::stop() {
+        AllocationHookGuard guard;
+
+        {
+            lock_guard<mutex> lock(_reportMutex);
+            if (!_active.exchange(false)) { return; }
+        }
+
+        _reportCondition.notify_all();
+        if (_reportThread.joinable()) {
+            _reportThread.join();
+        }
+    }
+
+    /**
+     * @brief Removes a sample from the sample table, if memory was sampled.
+     */
+    void HeapProfiler::removeSample(const void* memory) {
+        Sample sample;
+        if (!_samples.remove(memory, &sample)) { return; }
+
+        _sampleFilter[getFilterIndex(memory)].fetch_sub(1, std::memory_order_relaxed);
+        _sites[sample.siteIndex].liveBytes.fetch_sub(sample.weight, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets all sites, most live bytes first.
+     */
+    vector<HeapProfileSite> HeapProfiler::getProfile() const {
+        AllocationHookGuard guard;
+        lock_guard<mutex> lock(_reportMutex);
+
+        return collectSites();
+    }
+
+    /**
+     * @brief Gets a human-readable summary of the sites with the most live bytes; one site per line.
+     */
+    string HeapProfiler::formatProfile() const {
+        AllocationHookGuard guard;
+        const auto sites = getProfile();
+
+        uint64_t liveBytes = 0;
+        double allocationRate = 0;
+        for (const auto& site : sites) {
+            liveBytes += site.liveBytes;
+            allocationRate += site.allocatedBytesPerSecond;
+        }
+
+        auto summary = fmt::format("Heap profile: {} live, {}/s allocated, {} sites; 1 sample per {}, {} samples dropped",
+                                   formatBytes(liveBytes), formatBytes(allocationRate), sites.size(),
+                                   formatBytes(getSampleInterval()), getDroppedSampleCount());
+
+        for (size_t i = 0; i < sites.size() && i < MAX_REPORTED_SITES; i++) {
+            const auto& site = sites[i];
+            summary += fmt::format("\n{:>10} live {:>10}/s at ", formatBytes(site.liveBytes), formatBytes(site.allocatedBytesPerSecond));
+
+            for (size_t frame = 0; frame < site.frames.size() && frame < 4; frame++) {
+                if (frame != 0) { summary += " <- "; }
+                summary += describeAddress(site.frames[frame]);
+            }
+        }
+
+        return summary;
+    }
+
+    /**
+     * @brief Logs the summary, one line per site, and starts a new interval for the allocation rates.
+     *
+     * @param logger The logger to log to.
+     */
+    void HeapProfiler::logProfile(ILogger& logger) {
+        AllocationHookGuard guard;
+        const auto summary = formatProfile();
+
+        {
+            lock_guard<mutex> lock(_reportMutex);
+            for (uint32_t i = 0; i < MAX_SITES; i++) {
+                _previousAllocatedBytes[i] = _sites[i].allocatedBytes.load(std::memory_order_relaxed);
+            }
+            _previousReportTime = std::chrono::steady_clock::now();
+        }
+
+        size_t lineStart = 0;
+        while (lineStart < summary.size()) {
+            auto lineEnd = summary.find('\n', lineStart);
+            if (lineEnd == string::npos) { lineEnd = summary.size(); }
+
+            logger.info(summary.substr(lineStart, lineEnd - lineStart));
+            lineStart = lineEnd + 1;
+        }
+
+        logger.flushBuffer();
+    }
+
+    /**
+     * @brief Records a sampled allocation: captures its call stack and adds it to the sample table. The slow path.
+     */
+    void HeapProfiler::sampleAllocation(const void* memory, const size_t size, const void* caller) {
+        auto& bytesUntilSample = getThreadBytesUntilSample();
+        // The first allocation of each thread only initialises its countdown.
+        const bool isFirstAllocation = bytesUntilSample + static_cast<int64_t>(size) == 0;
+        bytesUntilSample = getNextSampleDistance();
+
+        if (isFirstAllocation || isInsideAllocationHook()) { return; }
+        AllocationHookGuard guard;
+
+        // An allocation of size bytes is sampled with probability 1 - e^(-size / interval); weigh it accordingly.
+        const auto interval = static_cast<double>(getSampleInterval());
+        const auto probability = 1.0 - std::exp(-static_cast<double>(size) / interval);
+        const auto weight = static_cast<uint64_t>(probability > 0 ? size / probability : interval);
+
+        void* frames[MAX_STACK_DEPTH + MAX_HOOK_FRAMES];
+        const auto capturedFrames = static_cast<uint32_t>(std::max(0, backtrace(frames, MAX_STACK_DEPTH + MAX_HOOK_FRAMES)));
+
+        // Drop the hooks' own frames. How many there are depends on inlining and tail calls, so look for the
+        // return address of operator new rather than skipping a fixed amount.
+        uint32_t firstFrame = 0;
+        while (firstFrame < capturedFrames && firstFrame < MAX_HOOK_FRAMES && frames[firstFrame] != caller) { firstFrame++; }
+        if (firstFrame == capturedFrames || firstFrame == MAX_HOOK_FRAMES) { firstFrame = std::min(capturedFrames, 2u); }
+
+        const auto depth = std::min(capturedFrames - firstFrame, MAX_STACK_DEPTH);
+        const auto siteIndex = findOrAddSite(const_cast<const void* const*>(frames + firstFrame), depth);
+        // Count the sample before publishing it, so its free can't miss it.
+        auto& liveSamples = _sampleFilter[getFilterIndex(memory)];
+        liveSamples.fetch_add(1, std::memory_order_relaxed);
+
+        if (siteIndex == MAX_SITES || !_samples.insert(memory, { weight, siteIndex })) {
+            liveSamples.fetch_sub(1, std::memory_order_relaxed);
+            _droppedSamples.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        _sites[siteIndex].liveBytes.fetch_add(weight, std::memory_order_relaxed);
+        _sites[siteIndex].allocatedBytes.fetch_add(weight, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Draws the amount of bytes until the next sample from an exponential distribution around the sample interval.
+     */
+    int64_t HeapProfiler::getNextSampleDistance() {
+        // 53 random bits as a double in (0, 1]
+        const auto uniform = ((getNextRandom() >> 11) + 1) * (1.0 / 9007199254740992.0);
+        return static_cast<int64_t>(-std::log(uniform) * getSampleInterval()) + 1;
+    }
+
+    /**
+     * @brief Finds the site for a call stack, adding it if it is new.
+     *
+     * @return uint32_t The site's index, or MAX_SITES if the site table is full.
+     */
+    uint32_t HeapProfiler::findOrAddSite(const void* const* frames, const uint32_t depth) {
+        if (_sites == nullptr) { return MAX_SITES; }
+
+        // FNV-1a over the frame addresses; 0 and 1 are reserved as markers.
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (uint32_t i = 0; i < depth; i++) {
+            hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 0x100000001b3ull;
+        }
+        hash |= 2;
+
+        for (uint32_t probe = 0; probe < MAX_SITES; probe++) {
+            const auto index = static_cast<uint32_t>(hash + probe) & (MAX_SITES - 1);
+            auto& site = _sites[index];
+            auto siteHash = site.hash.load(std::memory_order_acquire);
+
+            if (siteHash == hash && site.depth == depth && memcmp(site.frames, frames, depth * sizeof(void*)) == 0) {
+                return index;
+            }
+
+            if (siteHash == SITE_FREE && site.hash.compare_exchange_strong(siteHash, SITE_RESERVED, std::memory_order_acquire)) {
+                site.depth = depth;
+                memcpy(site.frames, frames, depth * sizeof(void*));
+                site.hash.store(hash, std::memory_order_release);
+                return index;
+            }
+
+            // Either a different stack, or one being added concurrently (which may be this one; then it's simply added twice).
+        }
+
+        return MAX_SITES;
+    }
+
+    /**
+     * @brief Collects the sites and their allocation rates since the previous report. Call with _reportMutex held.
+     */
+    vector<HeapProfileSite> HeapProfiler::collectSites() const {
+        const auto elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _previousReportTime).count();
+        vector<HeapProfileSite> sites;
+
+        for (uint32_t i = 0; _sites != nullptr && i < MAX_SITES; i++) {
+            const auto& site = _sites[i];
+            if (site.hash.load(std::memory_order_acquire) <= SITE_RESERVED) { continue; }
+
+            const auto allocatedBytes = site.allocatedBytes.load(std::memory_order_relaxed);
+            sites.push_back({
+                vector<const void*>(site.frames, site.frames + site.depth),
+                // liveBytes may briefly wrap if a free is accounted for before its allocation; clamp it
+                std::min(site.liveBytes.load(std::memory_order_relaxed), allocatedBytes),
+                allocatedBytes,
+                elapsedSeconds > 0 ? (allocatedBytes - _previousAllocatedBytes[i]) / elapsedSeconds : 0
+            });
+        }
+
+        std::sort(sites.begin(), sites.end(), [](const HeapProfileSite& a, const HeapProfileSite& b) { return a.liveBytes > b.liveBytes; });
+
+        return sites;
+    }
+
+    /**
+     * @brief The reporting thread's main loop; logs a summary every report interval until stopped.
+     */
+    void HeapProfiler::reportLoop() {
+        AllocationHookGuard guard;
+
+        unique_lock<mutex> lock(_reportMutex);
+        while (_active.load()) {
+            _reportCondition.wait_for(lock, _reportInterval);
+            if (!_active.load()) { break; }
+
+            auto logger = _reportLogger;
+            lock.unlock();
+            logProfile(*logger);
+            lock.lock();
+        }
+    }
+
+} /* memory */ } /* logpp */
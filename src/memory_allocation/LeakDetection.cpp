@@ -2,38 +2,283 @@
  * @file LeakDetection.cpp
  * @author Simon Cahill (simon@h3lix.de)
  * @brief Contains the implementation of the LeakDetection header.
- * @version 0.1
+ * @version 0.2
  * @date 2020-01-29
- * 
+ *
  * @copyright Copyright (c) 2020
  */
 
+/****************************
+ *	    Local Includes	    *
+ ****************************/
 #include "memory_allocation/LeakDetection.hpp"
+#include "memory_allocation/HeapProfiler.hpp"
+#include "ILogger.hpp"
 
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include <dlfcn.h>
+#include <fmt/format.h>
 
 namespace logpp { namespace memory {
 
-    LeakLogger* LeakLogger::_instance = nullptr;
+    const uint32_t AllocationTracker::DEFAULT_CAPACITY = 1u << 20;
+
+    namespace {
+        thread_local uint32_t samplingCountdown = 0;
+
+        string getCallSiteName(const AllocationSiteReport& site) {
+            if (site.file != nullptr) {
+                return fmt::format("{}:{}", getBaseName(site.file), site.line);
+            }
+
+            return describeAddress(site.caller);
+        }
+    }
+
+    /**
+     * @brief Gets a readable name for a code address: symbol+offset if the symbol is exported, the address otherwise.
+     *
+     * @remarks Link executables with -rdynamic to resolve their own symbols.
+     */
+    string describeAddress(const void* address) {
+        Dl_info info;
+        if (address != nullptr && dladdr(address, &info) != 0 && info.dli_sname != nullptr) {
+            return fmt::format("{}+{:#x}", info.dli_sname, (uintptr_t)address - (uintptr_t)info.dli_saddr);
+        }
+
+        return fmt::format("{}", address);
+    }
+
+    /**
+     * @brief Gets the process-wide tracker.
+     *
+     * @remarks The tracker is constructed on first use and deliberately never destroyed, as operator delete
+     * may still be called by other objects' static destructors during shutdown.
+     *
+     * @return AllocationTracker& A reference to the tracker.
+     */
+    AllocationTracker& AllocationTracker::getInstance() {
+        alignas(AllocationTracker) static char storage[sizeof(AllocationTracker)];
+        static AllocationTracker* instance = new (storage) AllocationTracker(DEFAULT_CAPACITY);
+
+        return *instance;
+    }
+
+    /**
+     * @brief Construct a new AllocationTracker object.
+     *
+     * @param capacity The amount of allocations which can be tracked at once.
+     */
+    AllocationTracker::AllocationTracker(const uint32_t capacity):
+    _allocations(capacity), _enabled(true), _sampleInterval(1), _untrackedCount(0), _exitReportRegistered(false), _exitLogger(nullptr) { }
+
+    /**
+     * @brief Allocates memory and tracks it, unless tracking is disabled or the allocation isn't sampled.
+     * Also feeds the heap profiler, if it is running.
+     *
+     * @param size The amount of bytes to allocate.
+     * @param file The file the allocation was made in, or nullptr.
+     * @param line The line the allocation was made at, or -1.
+     * @param caller The address the allocation was made from.
+     *
+     * @return void* The allocated memory.
+     */
+    void* AllocationTracker::allocate(const size_t size, const char* file, const int32_t line, const void* caller) {
+        void* memory = malloc(size == 0 ? 1 : size);
+        if (memory == nullptr) { throw std::bad_alloc(); }
+
+        if (isEnabled() && !isInsideAllocationHook() && shouldSample()) {
+            track(memory, size, file, line, caller);
+        }
+
+        if (HeapProfiler::isActive()) {
+            HeapProfiler::getInstance().recordAllocation(memory, size, caller);
+        }
+
+        return memory;
+    }
+
+    /**
+     * @brief Untracks and frees memory allocated by allocate().
+     */
+    void AllocationTracker::deallocate(void* memory) {
+        if (memory == nullptr) { return; }
+
+        untrack(memory);
+        if (HeapProfiler::wasStarted()) {
+            HeapProfiler::getInstance().recordDeallocation(memory);
+        }
+
+        free(memory);
+    }
+
+    /**
+     * @brief Tracks an allocation.
+     *
+     * @param memory The allocated memory.
+     * @param size The size of the allocation.
+     * @param file The file the allocation was made in, or nullptr.
+     * @param line The line the allocation was made at, or -1.
+     * @param caller The address the allocation was made from.
+     */
+    void AllocationTracker::track(const void* memory, const size_t size, const char* file, const int32_t line, const void* caller) {
+        if (!_allocations.insert(memory, { size, file, caller, line })) {
+            _untrackedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Stops tracking an allocation.
+     *
+     * @param memory The memory being freed.
+     *
+     * @return true If the allocation was tracked.
+     */
+    bool AllocationTracker::untrack(const void* memory) {
+        return _allocations.remove(memory);
+    }
+
+    /**
+     * @brief Gets the live allocations grouped by call site, largest (in bytes) first.
+     *
+     * @remarks The table is read while other threads may be (de)allocating; allocations made or freed
+     * while the report is being built may or may not be included.
+     */
+    vector<AllocationSiteReport> AllocationTracker::getLiveAllocationsBySite() const {
+        AllocationHookGuard guard;
+
+        // Keyed by file name rather than pointer; the same __FILE__ may be a different literal in different TUs.
+        std::map<std::tuple<string, int32_t, const void*>, AllocationSiteReport> sites;
+
+        _allocations.forEach([&](const void*, const TrackedAllocation& allocation) {
+            const auto key = std::make_tuple(string(allocation.file == nullptr ? "" : allocation.file), allocation.line, allocation.file == nullptr ? allocation.caller : nullptr);
+            auto& site = sites.emplace(key, AllocationSiteReport{ allocation.file, allocation.line, allocation.caller, 0, 0 }).first->second;
+            site.allocations++;
+            site.bytes += allocation.size;
+        });
+
+        vector<AllocationSiteReport> report;
+        report.reserve(sites.size());
+        for (const auto& site : sites) { report.push_back(site.second); }
+
+        std::sort(report.begin(), report.end(), [](const AllocationSiteReport& a, const AllocationSiteReport& b) { return a.bytes > b.bytes; });
+
+        return report;
+    }
+
+    /**
+     * @brief Gets a human-readable report of the live allocations, one call site per line.
+     */
+    string AllocationTracker::formatLeakReport() const {
+        AllocationHookGuard guard;
+
+        const auto sites = getLiveAllocationsBySite();
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+        for (const auto& site : sites) {
+            allocations += site.allocations;
+            bytes += site.bytes;
+        }
+
+        auto report = fmt::format("{} live allocations ({} bytes) from {} call sites; sampling 1 in {}, {} untracked",
+                                  allocations, bytes, sites.size(), getSampleInterval(), getUntrackedCount());
+
+        for (const auto& site : sites) {
+            report += fmt::format("\n{:>12} bytes in {:>8} allocations at {}", site.bytes, site.allocations, getCallSiteName(site));
+        }
+
+        return report;
+    }
+
+    /**
+     * @brief Logs the leak report as warnings, one line per call site.
+     *
+     * @param logger The logger to log to.
+     */
+    void AllocationTracker::logLeakReport(ILogger& logger) const {
+        AllocationHookGuard guard;
+
+        const auto report = formatLeakReport();
+        size_t lineStart = 0;
+
+        while (lineStart < report.size()) {
+            auto lineEnd = report.find('\n', lineStart);
+            if (lineEnd == string::npos) { lineEnd = report.size(); }
+
+            logger.warning(report.substr(lineStart, lineEnd - lineStart));
+            lineStart = lineEnd + 1;
+        }
+
+        logger.flushBuffer();
+    }
+
+    /**
+     * @brief Registers an at-exit handler which reports the allocations still alive when the process exits.
+     *
+     * @param logger The logger to log the report to. It must still be alive at exit. If nullptr, the report is printed to stderr.
+     */
+    void AllocationTracker::reportLeaksAtExit(ILogger* logger) {
+        _exitLogger.store(logger);
+
+        if (!_exitReportRegistered.exchange(true)) {
+            std::atexit(&AllocationTracker::atExitHandler);
+        }
+    }
+
+    /**
+     * @brief Decides whether the current allocation is sampled.
+     */
+    bool AllocationTracker::shouldSample() {
+        const auto interval = getSampleInterval();
+        if (interval <= 1) { return true; }
+
+        if (samplingCountdown == 0 || samplingCountdown > interval) {
+            samplingCountdown = interval;
+        }
+
+        return --samplingCountdown == 0;
+    }
+
+    /**
+     * @brief Reports the live allocations at exit.
+     */
+    void AllocationTracker::atExitHandler() {
+        auto& tracker = getInstance();
+        const auto logger = tracker._exitLogger.load();
+
+        if (logger != nullptr) {
+            tracker.logLeakReport(*logger);
+            return;
+        }
+
+        AllocationHookGuard guard;
+        const auto report = tracker.formatLeakReport();
+        fprintf(stderr, "%s\n", report.c_str());
+    }
 
 } /* memory */ } /* logpp */
 
-void* operator new(const std::size_t size, const string file, const int32_t line) {
-    logpp::memory::LeakLogger::getInstance().allocatedMemory(size, file, line);
-    return operator new(size);
+void* operator new(const std::size_t size, const char* file, const int32_t line) {
+    return logpp::memory::AllocationTracker::getInstance().allocate(size, file, line, __builtin_return_address(0));
 }
 
-void* operator new[](const std::size_t size, const string file, const int32_t line) {
-    logpp::memory::LeakLogger::getInstance().allocatedMemory(size, file, line);
-    return operator new[](size);
+void* operator new[](const std::size_t size, const char* file, const int32_t line) {
+    return logpp::memory::AllocationTracker::getInstance().allocate(size, file, line, __builtin_return_address(0));
 }
 
-void operator delete(void* mem, const string file, const int32_t line) {
-    logpp::memory::LeakLogger::getInstance().deallocatedMemory(file, line);
-    operator delete(mem);
+void operator delete(void* memory, const char*, const int32_t) noexcept {
+    logpp::memory::AllocationTracker::getInstance().deallocate(memory);
 }
 
-void operator delete[](void* mem, const string file, const int32_t line) {
-    logpp::memory::LeakLogger::getInstance().deallocatedMemory(file, line);
-    operator delete(mem);
+void operator delete[](void* memory, const char*, const int32_t) noexcept {
+    logpp::memory::AllocationTracker::getInstance().deallocate(memory);
 }
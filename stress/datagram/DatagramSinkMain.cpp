@@ -0,0 +1,380 @@
+/**
+ * DatagramSinkMain.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ *
+ * Checks JournalSink, SyslogSink and UnixDatagramSink against a stand-in receiver: an AF_UNIX SOCK_DGRAM socket bound
+ * in a temporary directory, read by the test instead of journald or syslog. Covers the journal's field encoding (including
+ * the length-prefixed form of multi-line values), oversized journal entries passed as a sealed memfd (SCM_RIGHTS),
+ * sendmmsg() batching once the socket returned EAGAIN, and drop counting without a receiver. Exits with 1 if a check fails.
+ *
+ * Usage: logpp_datagram_sinks [--dir <socket dir>]
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include <log.hpp>
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using logpp::JournalSink;
+using logpp::LogLevel;
+using logpp::SyslogSink;
+using logpp::UnixDatagramSink;
+
+using std::string;
+using std::vector;
+
+namespace {
+
+    const int       RECEIVE_TIMEOUT_MS = 1000;
+    const size_t    MAX_DATAGRAM_SIZE = 256 * 1024;
+    const size_t    OVERSIZED_ENTRY_SIZE = 4 * 1024 * 1024;  //!< Beyond any default wmem_max, so send() fails with EMSGSIZE
+    const uint32_t  BACKLOG_RECORDS = 4000;                 //!< Far more than the receiver's queue holds (net.unix.max_dgram_qlen)
+
+    uint32_t failures = 0;
+
+    void check(const bool condition, const string& description) {
+        if (condition) { return; }
+
+        failures++;
+        printf("    FAILED: %s\n", description.c_str());
+        fflush(stdout);
+    }
+
+    /**
+     * @brief The receiving end a sink sends to, in place of journald or syslog.
+     */
+    class StandIn {
+        public:
+            explicit StandIn(const string& path): _path(path) {
+                _socketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+                if (_socketFd < 0) { throw std::runtime_error(fmt::format("socket(): {}", strerror(errno))); }
+
+                struct sockaddr_un address;
+                memset(&address, 0, sizeof(address));
+                address.sun_family = AF_UNIX;
+                strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+                unlink(path.c_str());
+                if (bind(_socketFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+                    close(_socketFd);
+                    throw std::runtime_error(fmt::format("bind({}): {}", path, strerror(errno)));
+                }
+            }
+
+            ~StandIn() {
+                close(_socketFd);
+                unlink(_path.c_str());
+            }
+
+            StandIn(const StandIn&) = delete;
+            StandIn& operator=(const StandIn&) = delete;
+
+            /**
+             * @brief Receives a datagram, and the descriptor passed with it, if any; waits up to RECEIVE_TIMEOUT_MS.
+             *
+             * @param passedFd Set to the descriptor received with SCM_RIGHTS, or -1.
+             *
+             * @return false If nothing arrived within the timeout.
+             */
+            bool receive(string& datagram, int& passedFd) {
+                passedFd = -1;
+
+                struct pollfd readable = { _socketFd, POLLIN, 0 };
+                if (poll(&readable, 1, RECEIVE_TIMEOUT_MS) <= 0) { return false; }
+
+                datagram.resize(MAX_DATAGRAM_SIZE);
+                struct iovec vector = { &datagram[0], datagram.size() };
+
+                union {
+                    struct cmsghdr  header;
+                    char            buffer[CMSG_SPACE(sizeof(int))];
+                } control;
+
+                struct msghdr message;
+                memset(&message, 0, sizeof(message));
+                message.msg_iov = &vector;
+                message.msg_iovlen = 1;
+                message.msg_control = control.buffer;
+                message.msg_controllen = sizeof(control.buffer);
+
+                const auto received = recvmsg(_socketFd, &message, MSG_CMSG_CLOEXEC);
+                if (received < 0) { return false; }
+                datagram.resize(static_cast<size_t>(received));
+
+                for (auto header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+                    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) { memcpy(&passedFd, CMSG_DATA(header), sizeof(int)); }
+                }
+
+                return true;
+            }
+
+            bool receive(string& datagram) {
+                int passedFd;
+                const auto received = receive(datagram, passedFd);
+                if (passedFd >= 0) { close(passedFd); }
+
+                return received;
+            }
+
+        private:
+            string  _path;
+            int     _socketFd;
+    };
+
+    /**
+     * @brief Splits a journal entry in the native protocol into its fields; both NAME=value and the length-prefixed form.
+     *
+     * @return false If the entry is malformed.
+     */
+    bool parseJournalEntry(const string& entry, vector<std::pair<string, string>>& fields) {
+        size_t position = 0;
+
+        while (position < entry.size()) {
+            const auto end = entry.find_first_of("=\n", position);
+            if (end == string::npos) { return false; }
+
+            const auto name = entry.substr(position, end - position);
+            if (entry[end] == '=') {
+                const auto valueEnd = entry.find('\n', end + 1);
+                if (valueEnd == string::npos) { return false; }
+
+                fields.emplace_back(name, entry.substr(end + 1, valueEnd - end - 1));
+                position = valueEnd + 1;
+                continue;
+            }
+
+            if (end + 9 > entry.size()) { return false; }
+
+            uint64_t length = 0;
+            for (int i = 7; i >= 0; i--) { length = length << 8 | static_cast<unsigned char>(entry[end + 1 + i]); }
+
+            const auto valueStart = end + 9;
+            if (valueStart + length + 1 > entry.size() || entry[valueStart + length] != '\n') { return false; }
+
+            fields.emplace_back(name, entry.substr(valueStart, length));
+            position = valueStart + length + 1;
+        }
+
+        return true;
+    }
+
+    const string* findField(const vector<std::pair<string, string>>& fields, const string& name) {
+        for (const auto& field : fields) {
+            if (field.first == name) { return &field.second; }
+        }
+
+        return nullptr;
+    }
+
+    void checkField(const vector<std::pair<string, string>>& fields, const string& name, const string& expected) {
+        const auto value = findField(fields, name);
+        check(value != nullptr && *value == expected,
+              fmt::format("{} is \"{}\", expected \"{}\"", name, value != nullptr ? *value : "<missing>", expected));
+    }
+
+    /**
+     * @brief A journal entry arrives with its fields intact; multi-line values use the length-prefixed form.
+     */
+    void checkJournalFields(const string& dir) {
+        printf("journal field encoding\n");
+        StandIn standIn(dir + "/journal");
+        JournalSink sink(dir + "/journal");
+
+        const std::runtime_error error("disk\nfull");
+        const logpp::LogField fields[] = { logpp::kv("user id", 42), logpp::kv("9lives", "yes"), logpp::kv("query", "SELECT *\nFROM t") };
+
+        string entry;
+        JournalSink::formatEntry(entry, LogLevel::Error, "datagram-test", "sinks", "first line\nsecond line", fields, 3, "checkJournalFields", 123, &error);
+        sink.send(entry);
+
+        string datagram;
+        check(standIn.receive(datagram), "no journal entry received");
+        check(datagram == entry, "the journal entry changed on its way");
+
+        vector<std::pair<string, string>> parsed;
+        check(parseJournalEntry(datagram, parsed), "the journal entry is malformed");
+        checkField(parsed, "PRIORITY", "3");
+        checkField(parsed, "SYSLOG_IDENTIFIER", "datagram-test");
+        checkField(parsed, "MESSAGE", "first line\nsecond line");
+        checkField(parsed, "CODE_FUNC", "checkJournalFields");
+        checkField(parsed, "CODE_LINE", "123");
+        checkField(parsed, "LOGPP_LOGGER", "sinks");
+        checkField(parsed, "LOGPP_EXCEPTION", "disk\nfull");
+        checkField(parsed, "USER_ID", "42");
+        checkField(parsed, "F_9LIVES", "yes");
+        checkField(parsed, "QUERY", "SELECT *\nFROM t");
+        check(findField(parsed, "TID") != nullptr, "TID is missing");
+
+        check(datagram.find("MESSAGE\n") != string::npos && datagram.find("MESSAGE=") == string::npos,
+              "the multi-line MESSAGE isn't in the length-prefixed form");
+        check(sink.getDroppedDatagrams() == 0, "the journal entry was counted as dropped");
+    }
+
+    /**
+     * @brief An entry too large for a datagram arrives as a sealed memfd passed with SCM_RIGHTS.
+     */
+    void checkJournalMemfd(const string& dir) {
+        printf("journal memfd for oversized entries\n");
+        #ifdef MFD_ALLOW_SEALING
+        StandIn standIn(dir + "/journal-memfd");
+        JournalSink sink(dir + "/journal-memfd");
+
+        string entry;
+        JournalSink::formatEntry(entry, LogLevel::Info, "datagram-test", "sinks", string(OVERSIZED_ENTRY_SIZE, 'x'), nullptr, 0, "", -1, nullptr);
+        sink.send(entry);
+
+        string datagram;
+        int memFd = -1;
+        check(standIn.receive(datagram, memFd), "nothing received for the oversized entry");
+        check(memFd >= 0, "no descriptor was passed with SCM_RIGHTS");
+        check(datagram.empty(), fmt::format("the memfd's datagram carries {} bytes", datagram.size()));
+        if (memFd < 0) { return; }
+
+        struct stat fileInfo;
+        check(fstat(memFd, &fileInfo) == 0 && static_cast<size_t>(fileInfo.st_size) == entry.size(),
+              fmt::format("the memfd holds {} bytes, expected {}", static_cast<long long>(fileInfo.st_size), entry.size()));
+
+        const auto seals = fcntl(memFd, F_GET_SEALS);
+        check(seals >= 0 && (seals & (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)) == (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL),
+              fmt::format("the memfd isn't sealed (seals {:#x})", seals));
+
+        string contents(entry.size(), '\0');
+        check(pread(memFd, &contents[0], contents.size(), 0) == static_cast<ssize_t>(contents.size()) && contents == entry,
+              "the memfd's contents differ from the entry");
+        close(memFd);
+
+        check(sink.getDroppedDatagrams() == 0, "the oversized entry was counted as dropped");
+        #else
+        (void)dir;
+        printf("    skipped: memfd sealing isn't available\n");
+        #endif
+    }
+
+    /**
+     * @brief Once the receiver's queue is full, records are kept and sent with sendmmsg(); none are lost or reordered.
+     */
+    void checkBatching(const string& dir) {
+        printf("sendmmsg batching after EAGAIN\n");
+        StandIn standIn(dir + "/batching");
+        UnixDatagramSink sink(dir + "/batching");
+
+        // The stand-in doesn't read yet, so its queue fills up and the sink has to keep the rest
+        for (uint32_t i = 0; i < BACKLOG_RECORDS; i++) { sink.send(fmt::format("record {}", i)); }
+        check(sink.getPendingDatagrams() > 0, "no records were kept; the receiver's queue never filled up");
+
+        vector<string> received;
+        std::thread reader([&]() {
+            string datagram;
+            while (received.size() < BACKLOG_RECORDS && standIn.receive(datagram)) { received.push_back(datagram); }
+        });
+
+        check(sink.drain(std::chrono::milliseconds(5000)), "the pending records weren't sent within 5 s");
+        reader.join();
+
+        check(received.size() == BACKLOG_RECORDS, fmt::format("{} of {} records arrived", received.size(), BACKLOG_RECORDS));
+        for (uint32_t i = 0; i < received.size(); i++) {
+            if (received[i] != fmt::format("record {}", i)) {
+                check(false, fmt::format("record {} arrived as \"{}\"", i, received[i]));
+                break;
+            }
+        }
+
+        check(sink.getBatchedDatagrams() > 0, "no records were sent in batches");
+        check(sink.getDroppedDatagrams() == 0, fmt::format("{} records were dropped", sink.getDroppedDatagrams()));
+        printf("    %llu of %u records sent in batches\n", static_cast<unsigned long long>(sink.getBatchedDatagrams()), BACKLOG_RECORDS);
+    }
+
+    /**
+     * @brief Without a receiver, every record is dropped and counted; the sink picks the receiver up once it's there.
+     */
+    void checkDrops(const string& dir) {
+        printf("drop counting without a receiver\n");
+        const auto path = dir + "/absent";
+        SyslogSink sink(path);
+
+        string entry;
+        for (uint32_t i = 0; i < 5; i++) {
+            entry.clear();
+            SyslogSink::formatEntry(entry, logpp::SYSLOG_FACILITY_USER, LogLevel::Warning, 0, "host", "datagram-test", 1, "nobody listens", nullptr, 0, "", -1, nullptr);
+            sink.send(entry);
+        }
+
+        check(sink.getDroppedDatagrams() == 5, fmt::format("{} of 5 records counted as dropped", sink.getDroppedDatagrams()));
+        check(sink.getPendingDatagrams() == 0, "records without a receiver were kept");
+
+        // Reconnection is retried at most once per second
+        StandIn standIn(path);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.send(entry);
+
+        string datagram;
+        check(standIn.receive(datagram) && datagram == entry, "the record sent after the receiver appeared didn't arrive");
+        check(datagram.compare(0, 6, "<12>1 ") == 0, fmt::format("the syslog message starts with \"{}\"", datagram.substr(0, 6)));
+        check(sink.getDroppedDatagrams() == 5, "the record sent to the receiver was counted as dropped");
+    }
+
+    bool parseOptions(int32_t argC, char* argV[], string& dir) {
+        for (int32_t i = 1; i < argC; i++) {
+            const string arg = argV[i];
+
+            if (arg == "--dir" && i + 1 < argC) {
+                dir = argV[++i];
+            } else {
+                fprintf(stderr, "Usage: %s [--dir <socket dir>]\n", argV[0]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+int main(int32_t argC, char* argV[]) {
+    string baseDir = "/tmp";
+    if (!parseOptions(argC, argV, baseDir)) { return 1; }
+
+    string dir = baseDir + "/logpp_datagram.XXXXXX";
+    if (mkdtemp(&dir[0]) == nullptr) {
+        fprintf(stderr, "mkdtemp(%s): %s\n", dir.c_str(), strerror(errno));
+        return 1;
+    }
+
+    try {
+        checkJournalFields(dir);
+        checkJournalMemfd(dir);
+        checkBatching(dir);
+        checkDrops(dir);
+    } catch (const std::exception& error) {
+        printf("    FAILED: %s\n", error.what());
+        failures++;
+    }
+
+    rmdir(dir.c_str());
+
+    printf("%s\n", failures == 0 ? "OK" : fmt::format("{} FAILED", failures).c_str());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,568 @@
+/**
+ * StressMain.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ *
+ * Hammers ConsoleLogger and FileLogger (rotating every MiB) from many threads and checks every line they wrote.
+ * Each record carries its thread and a per-thread sequence number, and a payload derived from both; the output is
+ * read back and checked for torn, interleaved, duplicated, reordered and lost records. Exits with 1 if any are found.
+ *
+ * Configure with -Dlogpp_USE_TSAN=ON to run it under ThreadSanitizer; pass a longer --duration-s for soak runs.
+ *
+ * Usage: logpp_stress [--duration-s <s>] [--threads <threads>] [--buffer-size <bytes>] [--dir <log dir>] [--sink <console|file>] [--keep-files]
+ *                     [--pool-budget <bytes>]
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include <log.hpp>
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using logpp::ConsoleLogger;
+using logpp::FileLogger;
+using logpp::ILogger;
+using logpp::LogBatchEntry;
+using logpp::LogLevel;
+
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    const uint32_t  DEADLINE_CHECK_INTERVAL = 64;   //!< Records between two checks of the deadline
+    const uint32_t  BAD_RECORD_INTERVAL = 16;       //!< Every 16th record is an error; ConsoleLogger writes those straight to stderr
+    const uint32_t  CALL_PATTERN_LENGTH = 32;       //!< The calls repeat every 32 records:
+    const uint32_t  FORMATTED_RECORD = 3;           //!<  - record 3 is logged with infoFmt()
+    const uint32_t  BATCH_START = 8;                //!<  - records 8 to 23 are logged with a single logBatch()
+    const uint32_t  BATCH_SIZE = 16;                //!<  - the others with info() or error()
+    const uint32_t  LONG_RECORD_INTERVAL = 1021;    //!< Every so often a record is longer than the default buffer
+    const uint32_t  LONG_PAYLOAD_LENGTH = 5000;
+    const uint32_t  FLUSH_INTERVAL_US = 500;        //!< How often a separate thread flushes the logger, racing the producers
+    const uint32_t  FILE_SIZE_MIB = 1;              //!< Files are rotated as often as FileLogger allows
+    const size_t    MAX_REPORTED_ERRORS = 10;       //!< Per checker; the rest are only counted
+    const char      RECORD_MARKER[] = "stress t=";
+
+    /**
+     * @brief Options parsed from the command line.
+     */
+    struct StressOptions {
+        uint32_t    durationS   = 10;
+        uint32_t    threadCount = std::max(4u, std::min(16u, std::thread::hardware_concurrency()));
+        uint32_t    bufferSize  = 4096;
+        string      logDir      = "/dev/shm";
+        string      sink;       //!< Empty: both
+        bool        keepFiles   = false;
+        uint64_t    poolBudget  = logpp::LogBufferPool::DEFAULT_BUDGET; //!< Small budgets exercise the early flushes and overdrafts
+    };
+
+    /**
+     * @brief The outcome of stressing a single logger.
+     */
+    struct StressResult {
+        string          sink;
+        uint64_t        records;
+        double          seconds;
+        uint64_t        lines;
+        uint64_t        bytes;
+        uint32_t        files;
+        uint64_t        errors;
+        vector<string>  errorMessages;
+    };
+
+    inline bool isBadRecord(const uint64_t sequence) { return sequence % BAD_RECORD_INTERVAL == BAD_RECORD_INTERVAL - 1; }
+
+    inline LogLevel getRecordLevel(const uint64_t sequence) { return isBadRecord(sequence) ? LogLevel::Error : LogLevel::Info; }
+
+    /**
+     * @brief Appends the payload of a record: its length and contents are derived from the thread and sequence number,
+     * so a record spliced together from two others doesn't pass for either.
+     */
+    void appendPayload(string& out, const uint32_t thread, const uint64_t sequence) {
+        const auto length = (sequence % LONG_RECORD_INTERVAL == 0 ? LONG_PAYLOAD_LENGTH : 0) + (sequence * 7 + thread) % 61;
+
+        out += "p=";
+        for (uint64_t i = 0; i < length; i++) { out.push_back(static_cast<char>('a' + (sequence + thread + i) % 26)); }
+    }
+
+    /**
+     * @brief Builds the message of a record: "stress t=<thread> s=<sequence> p=<payload>".
+     */
+    const string& buildMessage(string& out, const uint32_t thread, const uint64_t sequence) {
+        out.clear();
+        fmt::format_to(std::back_inserter(out), "{}{} s={} ", RECORD_MARKER, thread, sequence);
+        appendPayload(out, thread, sequence);
+
+        return out;
+    }
+
+    /**
+     * @brief Which of a thread's records a checker expects to see.
+     */
+    enum class RecordStream {
+        All,
+        GoodRecords,    //!< ConsoleLogger's stdout
+        BadRecords      //!< ConsoleLogger's stderr
+    };
+
+    /**
+     * @brief Checks the lines of an output stream as they're read.
+     *
+     * Every line must be a complete record with the same prefix length as the first one (torn or interleaved writes
+     * break this), and every thread's records must appear once and in order (lost, duplicated or reordered records
+     * break this).
+     */
+    class RecordChecker {
+        public:
+            RecordChecker(const string& name, const uint32_t threadCount, const RecordStream stream):
+            _source(name), _stream(stream), _nextSequence(threadCount, 0), _prefixLength(string::npos), _lineNumber(0), _lines(0), _errors(0) { }
+
+            /**
+             * @brief Starts checking a new source (e.g. the next log file); records may continue from the previous one, lines may not.
+             */
+            void beginSource(const string& source) {
+                _source = source;
+                _lineNumber = 0;
+            }
+
+            void consume(const char* data, size_t size) {
+                while (size > 0) {
+                    const auto newline = static_cast<const char*>(memchr(data, '\n', size));
+                    if (newline == nullptr) {
+                        _partialLine.append(data, size);
+                        return;
+                    }
+
+                    const auto length = static_cast<size_t>(newline - data);
+                    if (_partialLine.empty()) {
+                        checkLine(data, length);
+                    } else {
+                        _partialLine.append(data, length);
+                        checkLine(_partialLine.data(), _partialLine.size());
+                        _partialLine.clear();
+                    }
+
+                    data += length + 1;
+                    size -= length + 1;
+                }
+            }
+
+            /**
+             * @brief Ends the current source; a record without its line feed is torn.
+             */
+            void endSource() {
+                if (_partialLine.empty()) { return; }
+
+                _lineNumber++;
+                fail("unterminated line", _partialLine.data(), _partialLine.size());
+                _partialLine.clear();
+            }
+
+            /**
+             * @brief Checks that no thread's last records are missing.
+             *
+             * @param recordCounts The amount of records each thread logged.
+             */
+            void finish(const vector<uint64_t>& recordCounts) {
+                for (uint32_t thread = 0; thread < _nextSequence.size(); thread++) {
+                    const auto next = getNextExpected(_nextSequence[thread]);
+                    if (next < recordCounts[thread]) {
+                        const auto message = fmt::format("thread {} lost its last records, from {} of {}", thread, next, recordCounts[thread]);
+                        fail("lost records", message.data(), message.size());
+                    }
+                }
+            }
+
+            uint64_t getLines() const { return _lines; }
+            uint64_t getErrors() const { return _errors; }
+            const vector<string>& getErrorMessages() const { return _errorMessages; }
+
+        private:
+            bool isExpected(const uint64_t sequence) const {
+                switch (_stream) {
+                    case RecordStream::GoodRecords: return !isBadRecord(sequence);
+                    case RecordStream::BadRecords:  return isBadRecord(sequence);
+                    default:                        return true;
+                }
+            }
+
+            uint64_t getNextExpected(uint64_t sequence) const {
+                while (!isExpected(sequence)) { sequence++; }
+                return sequence;
+            }
+
+            void checkLine(const char* line, const size_t length) {
+                _lineNumber++;
+                _lines++;
+
+                const auto marker = static_cast<const char*>(memmem(line, length, RECORD_MARKER, sizeof(RECORD_MARKER) - 1));
+                if (marker == nullptr) { return fail("not a record", line, length); }
+
+                const auto prefixLength = static_cast<size_t>(marker - line);
+                if (_prefixLength == string::npos) { _prefixLength = prefixLength; }
+                if (line[0] != '[' || prefixLength != _prefixLength) { return fail("interleaved record", line, length); }
+
+                // The line ends at the line feed, not at a NUL; copy the two numbers before parsing them
+                const string numbers(marker + sizeof(RECORD_MARKER) - 1, std::min<size_t>(48, length - prefixLength - (sizeof(RECORD_MARKER) - 1)));
+                char* end = nullptr;
+                const auto thread = strtoul(numbers.c_str(), &end, 10);
+                if (strncmp(end, " s=", 3) != 0 || thread >= _nextSequence.size()) { return fail("malformed record", line, length); }
+                const auto sequence = static_cast<uint64_t>(strtoull(end + 3, nullptr, 10));
+
+                buildMessage(_expectedMessage, static_cast<uint32_t>(thread), sequence);
+                if (length - prefixLength != _expectedMessage.size() || memcmp(marker, _expectedMessage.data(), _expectedMessage.size()) != 0) {
+                    return fail("torn record", line, length);
+                }
+
+                auto& nextSequence = _nextSequence[thread];
+                const auto expected = getNextExpected(nextSequence);
+                if (sequence < expected) {
+                    fail(fmt::format("duplicate or reordered record (expected s={})", expected).c_str(), line, length);
+                } else if (sequence > expected) {
+                    fail(fmt::format("lost records (expected s={})", expected).c_str(), line, length);
+                }
+
+                nextSequence = std::max(nextSequence, sequence + 1);
+            }
+
+            void fail(const char* what, const char* line, const size_t length) {
+                if (_errors++ >= MAX_REPORTED_ERRORS) { return; }
+
+                _errorMessages.push_back(fmt::format("{}:{}: {}: {}{}", _source, _lineNumber, what,
+                                                     string(line, std::min<size_t>(length, 120)), length > 120 ? "..." : ""));
+            }
+
+        private:
+            string              _source;
+            RecordStream        _stream;
+            vector<uint64_t>    _nextSequence; ///!< Per thread: the sequence number after the last one seen
+            size_t              _prefixLength; ///!< The length of the timestamp and level in front of the message
+            string              _partialLine;
+            string              _expectedMessage;
+            uint64_t            _lineNumber;
+            uint64_t            _lines;
+            uint64_t            _errors;
+            vector<string>      _errorMessages;
+    };
+
+    /**
+     * @brief Logs records from a single thread until the deadline, cycling through the different calls.
+     *
+     * @return The amount of records logged.
+     */
+    uint64_t produceRecords(ILogger& logger, const uint32_t thread, const Clock::time_point deadline) {
+        string message;
+        string payload;
+        vector<string> batchMessages(BATCH_SIZE);
+        vector<LogBatchEntry> batch(BATCH_SIZE);
+        uint64_t sequence = 0;
+
+        for (bool running = true; running; running = Clock::now() < deadline) {
+            for (uint32_t i = 0; i < DEADLINE_CHECK_INTERVAL; i++) {
+                const auto position = sequence % CALL_PATTERN_LENGTH;
+
+                if (position == BATCH_START) {
+                    for (uint32_t j = 0; j < BATCH_SIZE; j++) {
+                        batch[j] = LogBatchEntry(getRecordLevel(sequence + j), buildMessage(batchMessages[j], thread, sequence + j));
+                    }
+
+                    logger.logBatch(batch.data(), batch.data() + batch.size());
+                    sequence += BATCH_SIZE;
+                    continue;
+                }
+
+                if (position == FORMATTED_RECORD) {
+                    payload.clear();
+                    appendPayload(payload, thread, sequence);
+                    #if logpp_USE_PRINTF
+                    logger.infoFmt("stress t=%u s=%llu %s", thread, static_cast<unsigned long long>(sequence), payload.c_str());
+                    #else
+                    logger.infoFmt("stress t={} s={} {}", thread, sequence, payload);
+                    #endif
+                } else if (isBadRecord(sequence)) {
+                    logger.error(buildMessage(message, thread, sequence));
+                } else {
+                    logger.info(buildMessage(message, thread, sequence));
+                }
+
+                sequence++;
+            }
+        }
+
+        return sequence;
+    }
+
+    /**
+     * @brief Runs the producers against a logger, with another thread flushing it meanwhile.
+     *
+     * @return The amount of records each thread logged.
+     */
+    vector<uint64_t> runProducers(ILogger& logger, const StressOptions& options, double& seconds) {
+        vector<uint64_t> recordCounts(options.threadCount, 0);
+        vector<std::thread> producers;
+        std::atomic<bool> producing(true);
+
+        const auto startTime = Clock::now();
+        const auto deadline = startTime + std::chrono::seconds(options.durationS);
+
+        std::thread flusher([&]() {
+            while (producing.load()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(FLUSH_INTERVAL_US));
+                logger.flushBuffer();
+            }
+        });
+
+        for (uint32_t thread = 0; thread < options.threadCount; thread++) {
+            producers.emplace_back([&, thread]() { recordCounts[thread] = produceRecords(logger, thread, deadline); });
+        }
+
+        for (auto& producer : producers) { producer.join(); }
+        producing = false;
+        flusher.join();
+
+        logger.flushBuffer();
+        seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+        return recordCounts;
+    }
+
+    uint64_t sum(const vector<uint64_t>& values) {
+        uint64_t total = 0;
+        for (const auto value : values) { total += value; }
+
+        return total;
+    }
+
+    void collectErrors(StressResult& result, const RecordChecker& checker) {
+        result.lines += checker.getLines();
+        result.errors += checker.getErrors();
+        result.errorMessages.insert(result.errorMessages.end(), checker.getErrorMessages().begin(), checker.getErrorMessages().end());
+    }
+
+    /**
+     * @brief Reads a pipe into a checker until all of its write ends are closed.
+     */
+    void checkPipe(const int32_t fd, RecordChecker& checker, uint64_t& bytes) {
+        vector<char> buffer(1 << 16);
+
+        while (true) {
+            const auto bytesRead = read(fd, buffer.data(), buffer.size());
+            if (bytesRead < 0 && errno == EINTR) { continue; }
+            if (bytesRead <= 0) { break; }
+
+            checker.consume(buffer.data(), static_cast<size_t>(bytesRead));
+            bytes += static_cast<uint64_t>(bytesRead);
+        }
+
+        checker.endSource();
+    }
+
+    /**
+     * @brief Stresses a ConsoleLogger writing bad logs to stderr; stdout and stderr are redirected into pipes and checked as they're read.
+     */
+    StressResult runConsole(const StressOptions& options) {
+        StressResult result = { "console", 0, 0, 0, 0, 0, 0, { } };
+        int32_t stdoutPipe[2];
+        int32_t stderrPipe[2];
+
+        std::cout.flush();
+        fflush(stdout);
+
+        const auto savedStdout = dup(STDOUT_FILENO);
+        const auto savedStderr = dup(STDERR_FILENO);
+        if (savedStdout < 0 || savedStderr < 0 || pipe(stdoutPipe) != 0 || pipe(stderrPipe) != 0 ||
+            dup2(stdoutPipe[1], STDOUT_FILENO) < 0 || dup2(stderrPipe[1], STDERR_FILENO) < 0) {
+            perror("Failed to redirect stdout/stderr");
+            exit(1);
+        }
+        close(stdoutPipe[1]);
+        close(stderrPipe[1]);
+
+        RecordChecker stdoutChecker("stdout", options.threadCount, RecordStream::GoodRecords);
+        RecordChecker stderrChecker("stderr", options.threadCount, RecordStream::BadRecords);
+        uint64_t stdoutBytes = 0;
+        uint64_t stderrBytes = 0;
+        std::thread stdoutReader(checkPipe, stdoutPipe[0], std::ref(stdoutChecker), std::ref(stdoutBytes));
+        std::thread stderrReader(checkPipe, stderrPipe[0], std::ref(stderrChecker), std::ref(stderrBytes));
+
+        vector<uint64_t> recordCounts;
+        {
+            ConsoleLogger logger("stress", LogLevel::Trace, true, options.bufferSize, false);
+            recordCounts = runProducers(logger, options, result.seconds);
+        }
+
+        // Closes the last write ends, so the readers see the end of the streams
+        std::cout.flush();
+        dup2(savedStdout, STDOUT_FILENO);
+        dup2(savedStderr, STDERR_FILENO);
+        close(savedStdout);
+        close(savedStderr);
+
+        stdoutReader.join();
+        stderrReader.join();
+        close(stdoutPipe[0]);
+        close(stderrPipe[0]);
+
+        stdoutChecker.finish(recordCounts);
+        stderrChecker.finish(recordCounts);
+
+        result.records = sum(recordCounts);
+        result.bytes = stdoutBytes + stderrBytes;
+        collectErrors(result, stdoutChecker);
+        collectErrors(result, stderrChecker);
+
+        return result;
+    }
+
+    bool fileExists(const string& path) {
+        struct stat fileInfo;
+        return stat(path.c_str(), &fileInfo) == 0;
+    }
+
+    /**
+     * @brief Stresses a FileLogger rotating every MiB.
+     *
+     * Files are checked as soon as the logger has moved on to the next one, and removed unless they're to be kept,
+     * so soak runs don't fill the disk.
+     */
+    StressResult runFile(const StressOptions& options) {
+        StressResult result = { "file", 0, 0, 0, 0, 0, 0, { } };
+        const auto logFile = options.logDir + "/logpp_stress.log";
+
+        for (uint32_t file = 0; unlink((logFile + std::to_string(file)).c_str()) == 0; file++) { }
+
+        RecordChecker checker("file", options.threadCount, RecordStream::All);
+        std::atomic<bool> loggerDestroyed(false);
+
+        std::thread follower([&]() {
+            vector<char> contents;
+
+            for (uint32_t file = 0; ; ) {
+                const auto done = loggerDestroyed.load();
+                const auto path = logFile + std::to_string(file);
+
+                if (!(done ? fileExists(path) : fileExists(logFile + std::to_string(file + 1)))) {
+                    if (done) { break; }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    continue;
+                }
+
+                std::ifstream inStream(path, std::ios_base::binary);
+                contents.assign(std::istreambuf_iterator<char>(inStream), std::istreambuf_iterator<char>());
+
+                checker.beginSource(path);
+                checker.consume(contents.data(), contents.size());
+                checker.endSource();
+
+                result.bytes += contents.size();
+                result.files++;
+                if (!options.keepFiles) { unlink(path.c_str()); }
+                file++;
+            }
+        });
+
+        vector<uint64_t> recordCounts;
+        {
+            FileLogger logger("stress", LogLevel::Trace, logFile, options.bufferSize, FILE_SIZE_MIB, false, true);
+            logger.setMaxFileCount(UINT32_MAX - 1);
+            recordCounts = runProducers(logger, options, result.seconds);
+        }
+
+        loggerDestroyed = true;
+        follower.join();
+
+        checker.finish(recordCounts);
+        result.records = sum(recordCounts);
+        collectErrors(result, checker);
+
+        return result;
+    }
+
+    void printResult(const StressResult& result, const StressOptions& options) {
+        printf("%-8s %2u threads %7.2f s %12llu records %10.0f records/s %8.1f MiB/s %10llu lines",
+               result.sink.c_str(), options.threadCount, result.seconds, static_cast<unsigned long long>(result.records),
+               result.seconds > 0 ? result.records / result.seconds : 0.0,
+               result.seconds > 0 ? result.bytes / result.seconds / (1024.0 * 1024.0) : 0.0,
+               static_cast<unsigned long long>(result.lines));
+        if (result.files > 0) { printf(" %6u files", result.files); }
+        printf("  %s\n", result.errors == 0 ? "OK" : fmt::format("{} ERRORS", result.errors).c_str());
+
+        for (const auto& message : result.errorMessages) { printf("    %s\n", message.c_str()); }
+        fflush(stdout);
+    }
+
+    bool parseOptions(int32_t argC, char* argV[], StressOptions& options) {
+        for (int32_t i = 1; i < argC; i++) {
+            const string arg = argV[i];
+            const bool hasValue = i + 1 < argC;
+
+            if (arg == "--duration-s" && hasValue) {
+                options.durationS = static_cast<uint32_t>(std::max(1l, strtol(argV[++i], nullptr, 10)));
+            } else if (arg == "--threads" && hasValue) {
+                options.threadCount = static_cast<uint32_t>(std::max(1l, strtol(argV[++i], nullptr, 10)));
+            } else if (arg == "--buffer-size" && hasValue) {
+                options.bufferSize = static_cast<uint32_t>(std::max(0l, strtol(argV[++i], nullptr, 10)));
+            } else if (arg == "--dir" && hasValue) {
+                options.logDir = argV[++i];
+            } else if (arg == "--sink" && hasValue && (string(argV[i + 1]) == "console" || string(argV[i + 1]) == "file")) {
+                options.sink = argV[++i];
+            } else if (arg == "--pool-budget" && hasValue) {
+                options.poolBudget = strtoull(argV[++i], nullptr, 10);
+            } else if (arg == "--keep-files") {
+                options.keepFiles = true;
+            } else {
+                fprintf(stderr, "Usage: %s [--duration-s <s>] [--threads <threads>] [--buffer-size <bytes>] [--dir <log dir>] [--sink <console|file>] [--keep-files] [--pool-budget <bytes>]\n", argV[0]);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+int main(int32_t argC, char* argV[]) {
+    StressOptions options;
+    if (!parseOptions(argC, argV, options)) { return 1; }
+
+    logpp::LogBufferPool::getInstance().setBudget(options.poolBudget);
+
+    vector<StressResult> results;
+    if (options.sink.empty() || options.sink == "console") { results.push_back(runConsole(options)); }
+    if (options.sink.empty() || options.sink == "file") { results.push_back(runFile(options)); }
+
+    uint64_t errors = 0;
+    for (const auto& result : results) {
+        printResult(result, options);
+        errors += result.errors;
+    }
+
+    const auto pool = logpp::LogBufferPool::getInstance().getStats();
+    printf("buffer pool: peak %llu chunks (%llu KiB of %llu KiB), %llu appends over budget, %llu chunks overdrawn\n",
+           static_cast<unsigned long long>(pool.peakLeasedChunks), static_cast<unsigned long long>(pool.peakLeasedChunks * sizeof(logpp::LogBufferChunk) / 1024),
+           static_cast<unsigned long long>(pool.budgetBytes / 1024), static_cast<unsigned long long>(pool.exhaustedAppends),
+           static_cast<unsigned long long>(pool.overdrawnChunks));
+
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+/**
+ * LogppTail.cpp
+ *
+ * log++ - Intuitive logging library for C++ written by Simon Cahill.
+ *
+ * Follows a shared-memory log ring (see ShmRingSink) and writes its records to stdout, optionally filtered.
+ * Records lost because the reader fell behind are reported on stderr.
+ *
+ * Usage: logpp-tail <ring name> [--level <max level>] [--grep <substring>] [--from-start] [--no-follow]
+ */
+
+/****************************
+ *	    Local Includes	    *
+ ****************************/
+#include <ShmRing.hpp>
+
+/***************************
+ *	    System Includes    *
+ ***************************/
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+
+using logpp::LogLevel;
+using logpp::ShmRingReader;
+using logpp::ShmRingRecord;
+
+using std::string;
+
+namespace {
+
+    const auto MIN_IDLE_SLEEP = std::chrono::microseconds(100);
+    const auto MAX_IDLE_SLEEP = std::chrono::milliseconds(10);
+
+    volatile std::sig_atomic_t stopRequested = 0;
+
+    struct TailOptions {
+        string      ringName;
+        LogLevel    maxLevel = logpp::LOGLEVEL_MAXVALUE;
+        string      filter;
+        bool        fromStart = false;
+        bool        follow = true;
+    };
+
+    bool parseOptions(int32_t argC, char* argV[], TailOptions& options) {
+        for (int32_t i = 1; i < argC; i++) {
+            const string arg = argV[i];
+            const bool hasValue = i + 1 < argC;
+
+            if (arg == "--level" && hasValue) {
+                if (!logpp::tryParseLogLevel(argV[++i], options.maxLevel)) {
+                    fprintf(stderr, "Unknown log level %s\n", argV[i]);
+                    return false;
+                }
+            } else if (arg == "--grep" && hasValue) {
+                options.filter = argV[++i];
+            } else if (arg == "--from-start") {
+                options.fromStart = true;
+            } else if (arg == "--no-follow") {
+                options.follow = false;
+            } else if (options.ringName.empty() && !arg.empty() && arg[0] != '-') {
+                options.ringName = arg;
+            } else {
+                options.ringName.clear();
+                break;
+            }
+        }
+
+        if (options.ringName.empty()) {
+            fprintf(stderr, "Usage: %s <ring name> [--level <max level>] [--grep <substring>] [--from-start] [--no-follow]\n", argV[0]);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Records without a level (written through ShmRingSink::write()) always pass the level filter.
+     */
+    bool isWanted(const ShmRingRecord& record, const TailOptions& options) {
+        if (record.level != logpp::SHM_RING_UNKNOWN_LEVEL && static_cast<LogLevel>(record.level) > options.maxLevel) return false;
+
+        return options.filter.empty() || record.text.find(options.filter) != string::npos;
+    }
+
+}
+
+int main(int32_t argC, char* argV[]) {
+    TailOptions options;
+    if (!parseOptions(argC, argV, options)) { return 1; }
+
+    std::signal(SIGINT, [](int) { stopRequested = 1; });
+    std::signal(SIGTERM, [](int) { stopRequested = 1; });
+
+    try {
+        ShmRingReader reader(options.ringName, options.fromStart);
+        ShmRingRecord record;
+        uint64_t reportedLosses = 0;
+        auto idleSleep = std::chrono::duration_cast<std::chrono::microseconds>(MIN_IDLE_SLEEP);
+
+        while (!stopRequested) {
+            if (!reader.read(record)) {
+                fflush(stdout);
+                if (!options.follow) break;
+
+                std::this_thread::sleep_for(idleSleep);
+                idleSleep = std::min(idleSleep * 2, std::chrono::duration_cast<std::chrono::microseconds>(MAX_IDLE_SLEEP));
+                continue;
+            }
+
+            idleSleep = MIN_IDLE_SLEEP;
+
+            if (reader.getLostRecords() != reportedLosses) {
+                fprintf(stderr, "logpp-tail: lost %llu record(s) before #%llu\n",
+                        static_cast<unsigned long long>(reader.getLostRecords() - reportedLosses), static_cast<unsigned long long>(record.sequence));
+                reportedLosses = reader.getLostRecords();
+            }
+
+            if (!isWanted(record, options)) continue;
+
+            fwrite(record.text.data(), 1, record.text.size(), stdout);
+            fputc('\n', stdout);
+        }
+    } catch (const std::exception& ex) {
+        fprintf(stderr, "logpp-tail: %s\n", ex.what());
+        return 1;
+    }
+
+    fflush(stdout);
+    return 0;
+}